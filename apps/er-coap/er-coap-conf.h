@@ -68,6 +68,21 @@
 #define COAP_MAX_OBSERVERS    COAP_MAX_OPEN_TRANSACTIONS - 1
 #endif /* COAP_MAX_OBSERVERS */
 
+/* Render each notification once and share it among the observers */
+#ifndef COAP_SHARED_NOTIFICATIONS
+#define COAP_SHARED_NOTIFICATIONS      0
+#endif /* COAP_SHARED_NOTIFICATIONS */
+
+/* Number of shared notification buffers */
+#ifndef COAP_MAX_SHARED_BUFFERS
+#define COAP_MAX_SHARED_BUFFERS        2
+#endif /* COAP_MAX_SHARED_BUFFERS */
+
+/* Number of shared confirmable notifications in flight */
+#ifndef COAP_MAX_SHARED_TRANSACTIONS
+#define COAP_MAX_SHARED_TRANSACTIONS   COAP_MAX_OBSERVERS
+#endif /* COAP_MAX_SHARED_TRANSACTIONS */
+
 /* Interval in notifies in which NON notifies are changed to CON notifies to check client. */
 #define COAP_OBSERVE_REFRESH_INTERVAL  20
 
@@ -59,8 +59,9 @@ LIST(observers_list);
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
 static coap_observer_t *
-add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
-             size_t token_len, const char *uri, int uri_len)
+add_observer(resource_t *resource, uip_ipaddr_t *addr, uint16_t port,
+             const uint8_t *token, size_t token_len, const char *uri,
+             int uri_len)
 {
   /* Remove existing observe relationship, if any. */
   coap_remove_observer_by_uri(addr, port, uri);
@@ -74,6 +75,7 @@ add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
     }
     memcpy(o->url, uri, max);
     o->url[max] = 0;
+    o->resource = resource;
     uip_ipaddr_copy(&o->addr, addr);
     o->port = port;
     o->token_len = token_len;
@@ -180,6 +182,57 @@ coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
 /*---------------------------------------------------------------------------*/
 /*- Notification ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
+#if COAP_SHARED_NOTIFICATIONS
+static void
+notify_shared(coap_observer_t *obs, coap_packet_t *notification,
+              coap_shared_buffer_t *shared)
+{
+  coap_transaction_t *transaction = NULL;
+  coap_message_type_t type;
+  uint32_t observe = 0;
+
+  /* a notification still in flight is replaced by this one */
+  transaction = coap_get_transaction_by_mid(obs->last_mid);
+  if(transaction != NULL && (transaction->shared == NULL
+                             || !uip_ipaddr_cmp(&transaction->addr,
+                                                &obs->addr)
+                             || transaction->port != obs->port)) {
+    transaction = NULL;
+  }
+
+  type = notification->type;
+  if(obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0) {
+    PRINTF("           Force Confirmable for\n");
+    type = COAP_TYPE_CON;
+  }
+  if(notification->code < BAD_REQUEST_4_00) {
+    observe = (obs->obs_counter)++;
+  }
+
+  /* update last MID for RST matching */
+  obs->last_mid = coap_get_mid();
+
+  if(transaction != NULL) {
+    coap_update_shared_transaction(transaction, obs->last_mid, shared,
+                                   observe);
+  } else if(type == COAP_TYPE_CON
+            && (transaction = coap_new_shared_transaction(obs->last_mid,
+                                                          &obs->addr,
+                                                          obs->port,
+                                                          shared,
+                                                          obs->token,
+                                                          obs->token_len,
+                                                          observe))) {
+    coap_send_transaction(transaction);
+  } else {
+    /* no transaction needed, or none left: send without retransmissions */
+    coap_send_shared_message(shared, &obs->addr, obs->port,
+                             COAP_TYPE_NON, obs->last_mid, obs->token,
+                             obs->token_len, observe);
+  }
+}
+#endif /* COAP_SHARED_NOTIFICATIONS */
+/*---------------------------------------------------------------------------*/
 void
 coap_notify_observers(resource_t *resource)
 {
@@ -192,6 +245,10 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
   coap_packet_t notification[1]; /* this way the packet can be treated as pointer as usual */
   coap_packet_t request[1]; /* this way the packet can be treated as pointer as usual */
   coap_observer_t *obs = NULL;
+#if COAP_SHARED_NOTIFICATIONS
+  coap_shared_buffer_t *shared = NULL;
+  uint8_t unshared = 0;
+#endif
   int url_len, obs_url_len;
   char url[COAP_OBSERVER_URL_LEN];
 
@@ -214,18 +271,53 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
   url_len = strlen(url);
   for(obs = (coap_observer_t *)list_head(observers_list); obs;
       obs = obs->next) {
+    /* The observer's URL was matched against the resource when the
+       request was dispatched, so only a sub-path needs comparing */
+    if(obs->resource != resource) {
+      continue;
+    }
     obs_url_len = strlen(obs->url);
 
     /* Do a match based on the parent/sub-resource match so that it is
        possible to do parent-node observe */
-    if((obs_url_len == url_len
-        || (obs_url_len > url_len
-            && (resource->flags & HAS_SUB_RESOURCES)
-            && obs->url[url_len] == '/'))
-       && strncmp(url, obs->url, url_len) == 0) {
+    if(subpath == NULL
+       || ((obs_url_len == url_len
+            || (obs_url_len > url_len
+                && (resource->flags & HAS_SUB_RESOURCES)
+                && obs->url[url_len] == '/'))
+           && strncmp(url, obs->url, url_len) == 0)) {
       coap_transaction_t *transaction = NULL;
 
-      /*TODO implement special transaction for CON, sharing the same buffer to allow for more observers */
+      PRINTF("           Observer ");
+      PRINT6ADDR(&obs->addr);
+      PRINTF(":%u\n", obs->port);
+
+#if COAP_SHARED_NOTIFICATIONS
+      if(shared == NULL && !unshared) {
+        /* render the notification once, for all observers */
+        shared = coap_new_shared_buffer();
+        if(shared != NULL) {
+          resource->get_handler(request, notification,
+                                shared->buffer + COAP_MAX_HEADER_SIZE,
+                                REST_MAX_CHUNK_SIZE, NULL);
+          if(notification->code < BAD_REQUEST_4_00) {
+            coap_set_header_observe(notification, 0);
+          }
+          if(!coap_serialize_shared_buffer(shared, notification)) {
+            PRINTF("Observe: %s\n", coap_error_message);
+            shared = NULL;
+          }
+        }
+        if(shared == NULL) {
+          /* render it for each observer instead */
+          unshared = 1;
+        }
+      }
+      if(shared != NULL) {
+        notify_shared(obs, notification, shared);
+        continue;
+      }
+#endif /* COAP_SHARED_NOTIFICATIONS */
 
       if((transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port))) {
         if(obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0) {
@@ -233,10 +325,6 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
           notification->type = COAP_TYPE_CON;
         }
 
-        PRINTF("           Observer ");
-        PRINT6ADDR(&obs->addr);
-        PRINTF(":%u\n", obs->port);
-
         /* update last MID for RST matching */
         obs->last_mid = transaction->mid;
 
@@ -271,7 +359,8 @@ coap_observe_handler(resource_t *resource, void *request, void *response)
   if(coap_req->code == COAP_GET && coap_res->code < 128) { /* GET request and response without error code */
     if(IS_OPTION(coap_req, COAP_OPTION_OBSERVE)) {
       if(coap_req->observe == 0) {
-        obs = add_observer(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport,
+        obs = add_observer(resource, &UIP_IP_BUF->srcipaddr,
+                           UIP_UDP_BUF->srcport,
                            coap_req->token, coap_req->token_len,
                            coap_req->uri_path, coap_req->uri_path_len);
        if(obs) {
@@ -36,6 +36,7 @@
  *      Matthias Kovatsch <kovatsch@inf.ethz.ch>
  */
 
+#include <string.h>
 #include "contiki.h"
 #include "contiki-net.h"
 #include "er-coap-transactions.h"
@@ -53,10 +54,26 @@
 #define PRINTLLADDR(addr)
 #endif
 
+/* where uip_udp_packet_send() puts the payload, so messages built here need not be copied */
+#define COAP_SEND_BUF ((uint8_t *)&uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN])
+
+/* transaction with its own message buffer */
+struct coap_buffered_transaction {
+  coap_transaction_t t;
+  uint8_t buffer[COAP_MAX_PACKET_SIZE + 1];
+};
+
 /*---------------------------------------------------------------------------*/
-MEMB(transactions_memb, coap_transaction_t, COAP_MAX_OPEN_TRANSACTIONS);
+MEMB(transactions_memb, struct coap_buffered_transaction,
+     COAP_MAX_OPEN_TRANSACTIONS);
 LIST(transactions_list);
 
+#if COAP_SHARED_NOTIFICATIONS
+MEMB(shared_transactions_memb, coap_transaction_t,
+     COAP_MAX_SHARED_TRANSACTIONS);
+static coap_shared_buffer_t shared_buffers[COAP_MAX_SHARED_BUFFERS];
+#endif /* COAP_SHARED_NOTIFICATIONS */
+
 static struct process *transaction_handler_process = NULL;
 
 /*---------------------------------------------------------------------------*/
@@ -67,34 +84,108 @@ coap_register_as_transaction_handler()
 {
   transaction_handler_process = PROCESS_CURRENT();
 }
-coap_transaction_t *
-coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
+static void
+init_transaction(coap_transaction_t *t, uint16_t mid, uip_ipaddr_t *addr,
+                 uint16_t port)
 {
-  coap_transaction_t *t = memb_alloc(&transactions_memb);
+  t->mid = mid;
+  t->retrans_counter = 0;
 
-  if(t) {
-    t->mid = mid;
-    t->retrans_counter = 0;
+  /* save client address */
+  uip_ipaddr_copy(&t->addr, addr);
+  t->port = port;
+
+  t->callback = NULL;
+  t->callback_data = NULL;
+  t->shared = NULL;
 
-    /* save client address */
-    uip_ipaddr_copy(&t->addr, addr);
-    t->port = port;
+  list_add(transactions_list, t); /* list itself makes sure same element is not added twice */
+}
+#if COAP_SHARED_NOTIFICATIONS
+/*---------------------------------------------------------------------------*/
+/* build the message of one recipient from a shared buffer */
+static uint16_t
+build_shared_message(coap_shared_buffer_t *b, coap_message_type_t type,
+                     uint16_t mid, const uint8_t *token, uint8_t token_len,
+                     uint32_t observe, uint8_t *out)
+{
+  uint8_t *p = out;
+  uint16_t start = b->observe_start ? b->observe_start : b->len;
+  size_t i = 0;
 
-    list_add(transactions_list, t); /* list itself makes sure same element is not added twice */
+  *p++ = (b->buffer[0] & ~(COAP_HEADER_TYPE_MASK | COAP_HEADER_TOKEN_LEN_MASK))
+    | (COAP_HEADER_TYPE_MASK & type << COAP_HEADER_TYPE_POSITION)
+    | (COAP_HEADER_TOKEN_LEN_MASK & token_len << COAP_HEADER_TOKEN_LEN_POSITION);
+  *p++ = b->buffer[1];
+  *p++ = (uint8_t)(mid >> 8);
+  *p++ = (uint8_t)mid;
+  memcpy(p, token, token_len);
+  p += token_len;
+
+  /* options before Observe */
+  memcpy(p, b->buffer + COAP_HEADER_LEN, start - COAP_HEADER_LEN);
+  p += start - COAP_HEADER_LEN;
+
+  if(b->observe_start) {
+    /* same encoding as coap_serialize_int_option() */
+    if(0xFF000000 & observe) {
+      p[++i] = (uint8_t)(observe >> 24);
+    }
+    if(0xFFFF0000 & observe) {
+      p[++i] = (uint8_t)(observe >> 16);
+    }
+    if(0xFFFFFF00 & observe) {
+      p[++i] = (uint8_t)(observe >> 8);
+    }
+    if(0xFFFFFFFF & observe) {
+      p[++i] = (uint8_t)(observe);
+    }
+    p[0] = b->observe_delta << 4 | i;
+    p += i + 1;
+
+    /* the remaining options and the payload */
+    memcpy(p, b->buffer + b->observe_end, b->len - b->observe_end);
+    p += b->len - b->observe_end;
   }
 
-  return t;
+  return p - out;
+}
+#endif /* COAP_SHARED_NOTIFICATIONS */
+/*---------------------------------------------------------------------------*/
+coap_transaction_t *
+coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
+{
+  struct coap_buffered_transaction *bt = memb_alloc(&transactions_memb);
+
+  if(bt) {
+    bt->t.packet = bt->buffer;
+    init_transaction(&bt->t, mid, addr, port);
+    return &bt->t;
+  }
+
+  return NULL;
 }
 /*---------------------------------------------------------------------------*/
 void
 coap_send_transaction(coap_transaction_t *t)
 {
+  uint8_t type;
+
   PRINTF("Sending transaction %u\n", t->mid);
 
-  coap_send_message(&t->addr, t->port, t->packet, t->packet_len);
+#if COAP_SHARED_NOTIFICATIONS
+  if(t->shared) {
+    type = COAP_TYPE_CON;
+    coap_send_shared_message(t->shared, &t->addr, t->port, type, t->mid,
+                             t->token, t->token_len, t->observe);
+  } else
+#endif /* COAP_SHARED_NOTIFICATIONS */
+  {
+    type = (COAP_HEADER_TYPE_MASK & t->packet[0]) >> COAP_HEADER_TYPE_POSITION;
+    coap_send_message(&t->addr, t->port, t->packet, t->packet_len);
+  }
 
-  if(COAP_TYPE_CON ==
-     ((COAP_HEADER_TYPE_MASK & t->packet[0]) >> COAP_HEADER_TYPE_POSITION)) {
+  if(COAP_TYPE_CON == type) {
     if(t->retrans_counter < COAP_MAX_RETRANSMIT) {
       /* not timed out yet */
       PRINTF("Keeping transaction %u\n", t->mid);
@@ -146,6 +237,13 @@ coap_clear_transaction(coap_transaction_t *t)
 
     etimer_stop(&t->retrans_timer);
     list_remove(transactions_list, t);
+#if COAP_SHARED_NOTIFICATIONS
+    if(t->shared) {
+      t->shared->refs--;
+      memb_free(&shared_transactions_memb, t);
+      return;
+    }
+#endif /* COAP_SHARED_NOTIFICATIONS */
     memb_free(&transactions_memb, t);
   }
 }
@@ -162,6 +260,129 @@ coap_get_transaction_by_mid(uint16_t mid)
   }
   return NULL;
 }
+#if COAP_SHARED_NOTIFICATIONS
+/*---------------------------------------------------------------------------*/
+/*- Shared buffers ----------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+coap_shared_buffer_t *
+coap_new_shared_buffer(void)
+{
+  int i;
+
+  for(i = 0; i < COAP_MAX_SHARED_BUFFERS; i++) {
+    if(shared_buffers[i].refs == 0) {
+      return &shared_buffers[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Serialize a message, with no token, into a shared buffer and locate its
+ * Observe option. The payload is expected at COAP_MAX_HEADER_SIZE in the
+ * buffer. Returns 0 on error.
+ */
+int
+coap_serialize_shared_buffer(coap_shared_buffer_t *b, void *packet)
+{
+  coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
+  unsigned int number = 0;
+  size_t length;
+  uint16_t i;
+
+  coap_pkt->token_len = 0;
+  b->len = coap_serialize_message(coap_pkt, b->buffer);
+  if(b->len == 0) {
+    return 0;
+  }
+  /* leave room for the longest token and Observe value */
+  if(b->len - coap_pkt->payload_len + COAP_TOKEN_LEN + 4 >
+     COAP_MAX_HEADER_SIZE) {
+    coap_error_message = "Serialized header exceeds COAP_MAX_HEADER_SIZE";
+    return 0;
+  }
+
+  b->observe_start = 0;
+  if(!IS_OPTION(coap_pkt, COAP_OPTION_OBSERVE)) {
+    return 1;
+  }
+
+  /* only options numbered below Observe can precede it, so deltas are short */
+  i = COAP_HEADER_LEN;
+  while(i < b->len && b->buffer[i] != 0xFF) {
+    number += b->buffer[i] >> 4;
+    length = b->buffer[i] & 0x0F;
+    if(number == COAP_OPTION_OBSERVE) {
+      b->observe_start = i;
+      b->observe_end = i + 1 + length;
+      b->observe_delta = b->buffer[i] >> 4;
+      return 1;
+    }
+    if(length == 13) {
+      length = b->buffer[++i] + 13;
+    } else if(length == 14) {
+      length = (b->buffer[i + 1] << 8 | b->buffer[i + 2]) + 269;
+      i += 2;
+    }
+    i += 1 + length;
+  }
+
+  coap_error_message = "Observe option not found";
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_send_shared_message(coap_shared_buffer_t *b, uip_ipaddr_t *addr,
+                         uint16_t port, coap_message_type_t type,
+                         uint16_t mid, const uint8_t *token,
+                         uint8_t token_len, uint32_t observe)
+{
+  coap_send_message(addr, port, COAP_SEND_BUF,
+                    build_shared_message(b, type, mid, token, token_len,
+                                         observe, COAP_SEND_BUF));
+}
+/*---------------------------------------------------------------------------*/
+coap_transaction_t *
+coap_new_shared_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port,
+                            coap_shared_buffer_t *b, const uint8_t *token,
+                            uint8_t token_len, uint32_t observe)
+{
+  coap_transaction_t *t = memb_alloc(&shared_transactions_memb);
+
+  if(t) {
+    init_transaction(t, mid, addr, port);
+    t->packet = NULL;
+    t->packet_len = 0;
+    t->shared = b;
+    b->refs++;
+    t->token_len = token_len;
+    memcpy(t->token, token, token_len);
+    t->observe = observe;
+  }
+
+  return t;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Replace the message of a shared transaction in flight, e.g., with a newer
+ * notification, and send it. The retransmission state is kept.
+ */
+void
+coap_update_shared_transaction(coap_transaction_t *t, uint16_t mid,
+                               coap_shared_buffer_t *b, uint32_t observe)
+{
+  b->refs++;
+  t->shared->refs--;
+  t->shared = b;
+  t->mid = mid;
+  t->observe = observe;
+
+  PRINTF("Updating transaction %u\n", t->mid);
+
+  coap_send_shared_message(b, &t->addr, t->port, COAP_TYPE_CON, t->mid,
+                           t->token, t->token_len, t->observe);
+}
+#endif /* COAP_SHARED_NOTIFICATIONS */
 /*---------------------------------------------------------------------------*/
 void
 coap_check_transactions()
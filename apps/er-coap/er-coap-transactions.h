@@ -48,6 +48,20 @@
 #define COAP_RESPONSE_TIMEOUT_TICKS         (CLOCK_SECOND * COAP_RESPONSE_TIMEOUT)
 #define COAP_RESPONSE_TIMEOUT_BACKOFF_MASK  (long)((CLOCK_SECOND * COAP_RESPONSE_TIMEOUT * ((float)COAP_RESPONSE_RANDOM_FACTOR - 1.0)) + 0.5) + 1
 
+/*
+ * A message serialized once and sent to several recipients, e.g., an observe
+ * notification. Token, MID, type, and the Observe option value are patched
+ * in for each recipient; the rest of the message is shared.
+ */
+typedef struct coap_shared_buffer {
+  uint8_t refs;                 /* number of transactions using the buffer */
+  uint16_t len;
+  uint16_t observe_start;       /* Observe option position, 0 if not set */
+  uint16_t observe_end;
+  uint8_t observe_delta;
+  uint8_t buffer[COAP_MAX_PACKET_SIZE + 1];
+} coap_shared_buffer_t;
+
 /* container for transactions with message buffer and retransmission info */
 typedef struct coap_transaction {
   struct coap_transaction *next;        /* for LIST */
@@ -62,9 +76,16 @@ typedef struct coap_transaction {
   restful_response_handler callback;
   void *callback_data;
 
+  /* for shared transactions, the recipient's part of the message */
+  coap_shared_buffer_t *shared;
+  uint8_t token_len;
+  uint8_t token[COAP_TOKEN_LEN];
+  uint32_t observe;
+
   uint16_t packet_len;
-  uint8_t packet[COAP_MAX_PACKET_SIZE + 1];     /* +1 for the terminating '\0' which will not be sent
-                                                 * Use snprintf(buf, len+1, "", ...) to completely fill payload */
+  uint8_t *packet;      /* COAP_MAX_PACKET_SIZE + 1 bytes, NULL for shared transactions
+                         * +1 for the terminating '\0' which will not be sent
+                         * Use snprintf(buf, len+1, "", ...) to completely fill payload */
 } coap_transaction_t;
 
 void coap_register_as_transaction_handler(void);
@@ -75,6 +96,25 @@ void coap_send_transaction(coap_transaction_t *t);
 void coap_clear_transaction(coap_transaction_t *t);
 coap_transaction_t *coap_get_transaction_by_mid(uint16_t mid);
 
+#if COAP_SHARED_NOTIFICATIONS
+coap_shared_buffer_t *coap_new_shared_buffer(void);
+int coap_serialize_shared_buffer(coap_shared_buffer_t *b, void *packet);
+void coap_send_shared_message(coap_shared_buffer_t *b, uip_ipaddr_t *addr,
+                              uint16_t port, coap_message_type_t type,
+                              uint16_t mid, const uint8_t *token,
+                              uint8_t token_len, uint32_t observe);
+coap_transaction_t *coap_new_shared_transaction(uint16_t mid,
+                                                uip_ipaddr_t *addr,
+                                                uint16_t port,
+                                                coap_shared_buffer_t *b,
+                                                const uint8_t *token,
+                                                uint8_t token_len,
+                                                uint32_t observe);
+void coap_update_shared_transaction(coap_transaction_t *t, uint16_t mid,
+                                    coap_shared_buffer_t *b,
+                                    uint32_t observe);
+#endif /* COAP_SHARED_NOTIFICATIONS */
+
 void coap_check_transactions(void);
 
 #endif /* COAP_TRANSACTIONS_H_ */
@@ -58,6 +58,15 @@ PROCESS(rest_engine_process, "REST Engine");
 /*---------------------------------------------------------------------------*/
 LIST(restful_services);
 LIST(restful_periodic_services);
+
+#if REST_URI_INDEX_SIZE
+/* Resources hashed by URL, to find the parent resources of a path by hashing its prefixes */
+static resource_t *uri_index[REST_URI_INDEX_SIZE];
+static uint16_t uri_index_count;
+
+#define URI_HASH_INIT 5381
+#define URI_HASH_ADD(h, c) ((uint16_t)((h) * 33 + (uint8_t)(c)))
+#endif /* REST_URI_INDEX_SIZE */
 /*---------------------------------------------------------------------------*/
 /*- REST Engine API ---------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -102,6 +111,32 @@ rest_init_engine(void)
 void
 rest_activate_resource(resource_t *resource, char *path)
 {
+#if REST_URI_INDEX_SIZE
+  resource_t **r;
+  const char *c;
+  uint16_t hash = URI_HASH_INIT;
+
+  /* Unlink the resource if it is activated again. Its old hash is
+     only compared as a pointer chain, so it may be uninitialized. */
+  for(r = &uri_index[resource->index_hash % REST_URI_INDEX_SIZE];
+      *r != NULL; r = &(*r)->index_next) {
+    if(*r == resource) {
+      *r = resource->index_next;
+      break;
+    }
+  }
+
+  for(c = path; *c != '\0'; c++) {
+    hash = URI_HASH_ADD(hash, *c);
+  }
+  resource->index_hash = hash;
+  resource->index_order = uri_index_count++;
+  resource->index_next = NULL;
+  for(r = &uri_index[hash % REST_URI_INDEX_SIZE]; *r != NULL;
+      r = &(*r)->index_next);
+  *r = resource;
+#endif /* REST_URI_INDEX_SIZE */
+
   resource->url = path;
   list_add(restful_services, resource);
 
@@ -123,19 +158,48 @@ rest_get_resources(void)
 {
   return restful_services;
 }
+#if REST_URI_INDEX_SIZE
 /*---------------------------------------------------------------------------*/
-int
-rest_invoke_restful_service(void *request, void *response, uint8_t *buffer,
-                            uint16_t buffer_size, int32_t *offset)
+/* Look up one prefix of a path; returns the best of it and the resource so far */
+static resource_t *
+index_lookup(resource_t *best, uint16_t hash, const char *url, int len,
+             uint8_t parent)
 {
-  uint8_t found = 0;
-  uint8_t allowed = 1;
+  resource_t *r;
 
-  resource_t *resource = NULL;
-  const char *url = NULL;
-  int url_len, res_url_len;
+  for(r = uri_index[hash % REST_URI_INDEX_SIZE]; r != NULL;
+      r = r->index_next) {
+    if(r->index_hash == hash
+       && (best == NULL || r->index_order < best->index_order)
+       && (!parent || (r->flags & HAS_SUB_RESOURCES))
+       && strncmp(r->url, url, len) == 0 && r->url[len] == '\0') {
+      best = r;
+    }
+  }
+  return best;
+}
+#endif /* REST_URI_INDEX_SIZE */
+/*---------------------------------------------------------------------------*/
+resource_t *
+rest_find_resource(const char *url, int url_len)
+{
+#if REST_URI_INDEX_SIZE
+  resource_t *best = NULL;
+  uint16_t hash = URI_HASH_INIT;
+  int i;
+
+  /* every prefix up to a '/' may be a parent resource */
+  for(i = 0; i < url_len; i++) {
+    if(url[i] == '/') {
+      best = index_lookup(best, hash, url, i, 1);
+    }
+    hash = URI_HASH_ADD(hash, url[i]);
+  }
+  return index_lookup(best, hash, url, url_len, 0);
+#else /* REST_URI_INDEX_SIZE */
+  resource_t *resource;
+  int res_url_len;
 
-  url_len = REST.get_url(request, &url);
   for(resource = (resource_t *)list_head(restful_services);
       resource; resource = resource->next) {
 
@@ -146,31 +210,50 @@ rest_invoke_restful_service(void *request, void *response, uint8_t *buffer,
             && (resource->flags & HAS_SUB_RESOURCES)
             && url[res_url_len] == '/'))
        && strncmp(resource->url, url, res_url_len) == 0) {
-      found = 1;
-      rest_resource_flags_t method = REST.get_method_type(request);
-
-      PRINTF("/%s, method %u, resource->flags %u\n", resource->url,
-             (uint16_t)method, resource->flags);
-
-      if((method & METHOD_GET) && resource->get_handler != NULL) {
-        /* call handler function */
-        resource->get_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_POST) && resource->post_handler != NULL) {
-        /* call handler function */
-        resource->post_handler(request, response, buffer, buffer_size,
+      return resource;
+    }
+  }
+  return NULL;
+#endif /* REST_URI_INDEX_SIZE */
+}
+/*---------------------------------------------------------------------------*/
+int
+rest_invoke_restful_service(void *request, void *response, uint8_t *buffer,
+                            uint16_t buffer_size, int32_t *offset)
+{
+  uint8_t found = 0;
+  uint8_t allowed = 1;
+
+  resource_t *resource = NULL;
+  const char *url = NULL;
+  int url_len;
+
+  url_len = REST.get_url(request, &url);
+  resource = rest_find_resource(url, url_len);
+  if(resource != NULL) {
+    found = 1;
+    rest_resource_flags_t method = REST.get_method_type(request);
+
+    PRINTF("/%s, method %u, resource->flags %u\n", resource->url,
+           (uint16_t)method, resource->flags);
+
+    if((method & METHOD_GET) && resource->get_handler != NULL) {
+      /* call handler function */
+      resource->get_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_POST) && resource->post_handler != NULL) {
+      /* call handler function */
+      resource->post_handler(request, response, buffer, buffer_size,
+                             offset);
+    } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
+      /* call handler function */
+      resource->put_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
+      /* call handler function */
+      resource->delete_handler(request, response, buffer, buffer_size,
                                offset);
-      } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
-        /* call handler function */
-        resource->put_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
-        /* call handler function */
-        resource->delete_handler(request, response, buffer, buffer_size,
-                                 offset);
-      } else {
-        allowed = 0;
-        REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
-      }
-      break;
+    } else {
+      allowed = 0;
+      REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
     }
   }
   if(!found) {
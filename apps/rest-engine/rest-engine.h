@@ -62,6 +62,16 @@
 #define REST_MAX_CHUNK_SIZE     64
 #endif
 
+/*
+ * The number of hash buckets of the URI index used to find the resource for a request.
+ * Set to 0 to search the list of resources instead, which saves RAM when there are only a few.
+ */
+#ifdef REST_CONF_URI_INDEX_SIZE
+#define REST_URI_INDEX_SIZE     REST_CONF_URI_INDEX_SIZE
+#else
+#define REST_URI_INDEX_SIZE     0
+#endif
+
 struct resource_s;
 struct periodic_resource_s;
 
@@ -95,6 +105,11 @@ struct resource_s {
     restful_trigger_handler trigger;
     restful_trigger_handler resume;
   };
+#if REST_URI_INDEX_SIZE
+  struct resource_s *index_next;  /* next resource in the same URI index bucket */
+  uint16_t index_hash;            /* hash of the URL */
+  uint16_t index_order;           /* activation order, the first matching resource is used */
+#endif /* REST_URI_INDEX_SIZE */
 };
 typedef struct resource_s resource_t;
 
@@ -248,6 +263,17 @@ void rest_init_engine(void);
  */
 void rest_activate_resource(resource_t *resource, char *path);
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief      Finds the resource that handles a URI path.
+ * \param url  The URI path, which need not be null-terminated.
+ * \param url_len
+ *             The length of the URI path.
+ * \return     The first activated resource with that URL, or with a URL that
+ *             is a parent path of it and the HAS_SUB_RESOURCES flag; NULL if
+ *             there is none.
+ */
+resource_t *rest_find_resource(const char *url, int url_len);
+/*---------------------------------------------------------------------------*/
 /**
  * \brief      Returns the list of registered RESTful resources.
  * \return     The resource list.
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Shell command for the native tap device statistics
+ */
+
+#include "contiki.h"
+#include "shell-tapdev.h"
+#include "tapdev6.h"
+
+#include <stdio.h>
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_tapdev_stats_process, "tapdev-stats");
+SHELL_COMMAND(tapdev_stats_command,
+	      "tapdev-stats",
+	      "tapdev-stats: show tap device receive statistics",
+	      &shell_tapdev_stats_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_tapdev_stats_process, ev, data)
+{
+  struct tapdev_stats stats;
+  char buf[100];
+
+  PROCESS_BEGIN();
+
+  tapdev_get_stats(&stats);
+  snprintf(buf, sizeof(buf),
+           "%lu frames in %lu batches, max %lu, ring full %lu, batch %d",
+           stats.frames, stats.batches, stats.max_batch, stats.ring_full,
+           TAPDEV_RX_BATCH);
+  shell_output_str(&tapdev_stats_command, "tapdev: ", buf);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_tapdev_init(void)
+{
+  shell_register_command(&tapdev_stats_command);
+}
+/*---------------------------------------------------------------------------*/
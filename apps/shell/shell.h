@@ -402,6 +402,7 @@ struct shell_input {
 #include "shell-run.h"
 #include "shell-sendtest.h"
 #include "shell-sky.h"
+#include "shell-tapdev.h"
 #include "shell-tcpsend.h"
 #include "shell-text.h"
 #include "shell-time.h"
@@ -29,6 +29,7 @@
 
 #include "contiki.h"
 #include "net/packetbuf.h"
+#include "lib/crc16.h"
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
 
@@ -88,3 +89,31 @@ packetutils_deserialize_atts(const uint8_t *data, int size)
   return pos;
 }
 /*---------------------------------------------------------------------------*/
+int
+packetutils_append_crc(uint8_t *data, int len)
+{
+  uint16_t crc;
+
+  crc = crc16_data(data, len, 0);
+  data[len++] = crc >> 8;
+  data[len++] = crc & 255;
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+packetutils_check_crc(const uint8_t *data, int len)
+{
+  uint16_t crc;
+
+  if(len < 2) {
+    return -1;
+  }
+  len -= 2;
+  crc = crc16_data(data, len, 0);
+  if(data[len] != (crc >> 8) || data[len + 1] != (crc & 255)) {
+    PRINTF("packetutils: bad CRC\n");
+    return -1;
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
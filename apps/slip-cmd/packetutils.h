@@ -34,4 +34,10 @@ int packetutils_serialize_atts(uint8_t *data, int size);
 
 int packetutils_deserialize_atts(const uint8_t *data, int size);
 
+/* Append a CRC-16 of the first len bytes, return the new length */
+int packetutils_append_crc(uint8_t *data, int len);
+
+/* Return the length without the CRC, or -1 if the CRC is wrong */
+int packetutils_check_crc(const uint8_t *data, int len);
+
 #endif /* PACKETUTILS_H_ */
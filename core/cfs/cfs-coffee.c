@@ -55,6 +55,7 @@
 #endif
 
 #include "contiki-conf.h"
+#include "sys/cc.h"
 #include "cfs/cfs.h"
 #include "cfs-coffee-arch.h"
 #include "cfs/cfs-coffee.h"
@@ -90,6 +91,39 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING  1
 #endif
 
+/*
+ * The name cache maps hashes of file names to the start pages of the
+ * files, so that find_file() can avoid scanning the file headers of
+ * the whole storage. Each entry uses four bytes of RAM. When every
+ * active file fits in the cache, a failed lookup needs no flash reads
+ * at all. Set to 0 to disable the cache.
+ */
+#ifndef COFFEE_NAME_CACHE_SIZE
+#define COFFEE_NAME_CACHE_SIZE 0
+#endif
+#if COFFEE_NAME_CACHE_SIZE > 0xffff
+#error COFFEE_NAME_CACHE_SIZE must be at most 65535
+#endif
+
+/* Count header reads and name cache hits. See cfs_coffee_get_stats(). */
+#ifndef COFFEE_STATS
+#define COFFEE_STATS 0
+#endif
+
+/*
+ * The write buffer combines consecutive writes into one COFFEE_WRITE
+ * of up to this many bytes, so that a file appended to in small
+ * records is programmed a page at a time. A run of buffered bytes
+ * never crosses a multiple of the buffer size, so the buffer should
+ * divide the page size of the flash. Buffered bytes are written when
+ * a write is not consecutive or fills the buffer, before any read or
+ * erase that may see them, when a file is closed, and on
+ * cfs_coffee_flush(). Set to 0 to write at once.
+ */
+#ifndef COFFEE_WRITE_BUFFER_SIZE
+#define COFFEE_WRITE_BUFFER_SIZE 0
+#endif
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -193,6 +227,20 @@ struct file_header {
   char name[COFFEE_NAME_LENGTH];
 };
 
+#if COFFEE_NAME_CACHE_SIZE > 0
+/* A name cache entry. Unused entries have the page INVALID_PAGE. */
+struct name_cache_entry {
+  uint16_t hash;
+  coffee_page_t page;
+};
+
+/* The cache is built on the first lookup, by a single scan of the
+   storage. It is complete as long as it holds every active file. */
+#define NAME_CACHE_UNBUILT  0
+#define NAME_CACHE_PARTIAL  1
+#define NAME_CACHE_COMPLETE 2
+#endif /* COFFEE_NAME_CACHE_SIZE > 0 */
+
 /* This is needed because of a buggy compiler. */
 struct log_param {
   cfs_offset_t offset;
@@ -209,18 +257,122 @@ static struct file_desc coffee_fd_set[COFFEE_FD_SET_SIZE];
 static coffee_page_t next_free;
 static char gc_wait;
 
+#if COFFEE_NAME_CACHE_SIZE > 0
+static struct name_cache_entry name_cache[COFFEE_NAME_CACHE_SIZE];
+static uint8_t name_cache_state;
+static uint16_t name_cache_victim;
+#endif
+
+#if COFFEE_STATS
+static struct cfs_coffee_stats coffee_stats;
+#define STATS_ADD(field) coffee_stats.field++
+#else
+#define STATS_ADD(field)
+#endif
+
+#if COFFEE_WRITE_BUFFER_SIZE > 0
+/* Bytes written to offset and on, but not yet to the storage. */
+static struct {
+  cfs_offset_t offset;
+  uint16_t len;
+  unsigned char data[COFFEE_WRITE_BUFFER_SIZE];
+} write_buffer;
+#endif
+
+/*---------------------------------------------------------------------------*/
+int
+cfs_coffee_flush(void)
+{
+#if COFFEE_WRITE_BUFFER_SIZE > 0
+  if(write_buffer.len > 0) {
+    STATS_ADD(flash_writes);
+    COFFEE_WRITE(write_buffer.data, write_buffer.len, write_buffer.offset);
+    write_buffer.len = 0;
+  }
+#endif
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+flash_write(const void *buf, unsigned size, cfs_offset_t offset)
+{
+#if COFFEE_WRITE_BUFFER_SIZE > 0
+  cfs_offset_t end;
+  unsigned n;
+
+  while(size > 0) {
+    if(write_buffer.len > 0 &&
+       offset == write_buffer.offset + write_buffer.len) {
+      /* Add to the buffered bytes, up to the next multiple of the
+         buffer size. */
+      n = COFFEE_WRITE_BUFFER_SIZE - offset % COFFEE_WRITE_BUFFER_SIZE;
+      if(n > size) {
+        n = size;
+      }
+      memcpy(&write_buffer.data[write_buffer.len], buf, n);
+      write_buffer.len += n;
+    } else {
+      cfs_coffee_flush();
+      /* Write the bytes up to the last multiple of the buffer size at
+         once, and buffer the rest. */
+      end = (offset + size) / COFFEE_WRITE_BUFFER_SIZE *
+        COFFEE_WRITE_BUFFER_SIZE;
+      if(end > offset) {
+        n = end - offset;
+        STATS_ADD(flash_writes);
+        COFFEE_WRITE(buf, n, offset);
+      } else {
+        n = size;
+        memcpy(write_buffer.data, buf, n);
+        write_buffer.offset = offset;
+        write_buffer.len = n;
+      }
+    }
+    buf = (const char *)buf + n;
+    size -= n;
+    offset += n;
+
+    if(write_buffer.len > 0 && offset % COFFEE_WRITE_BUFFER_SIZE == 0) {
+      cfs_coffee_flush();
+    }
+  }
+#else
+  STATS_ADD(flash_writes);
+  COFFEE_WRITE(buf, size, offset);
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static void
+flash_read(void *buf, unsigned size, cfs_offset_t offset)
+{
+#if COFFEE_WRITE_BUFFER_SIZE > 0
+  if(write_buffer.len > 0 && offset < write_buffer.offset + write_buffer.len &&
+     offset + size > write_buffer.offset) {
+    cfs_coffee_flush();
+  }
+#endif
+  COFFEE_READ(buf, size, offset);
+}
+/*---------------------------------------------------------------------------*/
+static void
+flash_erase(coffee_page_t sector)
+{
+  cfs_coffee_flush();
+  COFFEE_ERASE(sector);
+}
 /*---------------------------------------------------------------------------*/
 static void
 write_header(struct file_header *hdr, coffee_page_t page)
 {
   hdr->flags |= HDR_FLAG_VALID;
-  COFFEE_WRITE(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
+  flash_write(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
 }
 /*---------------------------------------------------------------------------*/
 static void
 read_header(struct file_header *hdr, coffee_page_t page)
 {
-  COFFEE_READ(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
+  flash_read(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
+  STATS_ADD(header_reads);
 #if DEBUG
   if(HDR_ACTIVE(*hdr) && !HDR_VALID(*hdr)) {
     PRINTF("Invalid header at page %u!\n", (unsigned)page);
@@ -387,7 +539,7 @@ collect_garbage(int mode)
         isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
       }
 
-      COFFEE_ERASE(sector);
+      flash_erase(sector);
       PRINTF("Coffee: Erased sector %d!\n", sector);
 
       if(mode == GC_RELUCTANT && isolation_count > 0) {
@@ -459,6 +611,97 @@ load_file(coffee_page_t start, struct file_header *hdr)
 
   return file;
 }
+#if COFFEE_NAME_CACHE_SIZE > 0
+/*---------------------------------------------------------------------------*/
+static uint16_t
+name_hash(const char *name)
+{
+  uint16_t hash;
+  int i;
+
+  /* Only the part of the name that fits in the file header is hashed. */
+  hash = 5381;
+  for(i = 0; i < COFFEE_NAME_LENGTH - 1 && name[i] != '\0'; i++) {
+    hash = (hash << 5) + hash + (unsigned char)name[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_cache_insert(const char *name, coffee_page_t page)
+{
+  int i;
+
+  for(i = 0; i < COFFEE_NAME_CACHE_SIZE; i++) {
+    if(name_cache[i].page == INVALID_PAGE) {
+      break;
+    }
+  }
+
+  if(i == COFFEE_NAME_CACHE_SIZE) {
+    /* The cache is full. Evict an entry in round-robin order, after
+       which misses must be resolved by scanning the storage. */
+    i = name_cache_victim;
+    name_cache_victim = (name_cache_victim + 1) % COFFEE_NAME_CACHE_SIZE;
+    name_cache_state = NAME_CACHE_PARTIAL;
+  }
+
+  name_cache[i].hash = name_hash(name);
+  name_cache[i].page = page;
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_cache_remove(coffee_page_t page)
+{
+  int i;
+
+  for(i = 0; i < COFFEE_NAME_CACHE_SIZE; i++) {
+    if(name_cache[i].page == page) {
+      name_cache[i].page = INVALID_PAGE;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_cache_reset(uint8_t state)
+{
+  int i;
+
+  for(i = 0; i < COFFEE_NAME_CACHE_SIZE; i++) {
+    name_cache[i].page = INVALID_PAGE;
+  }
+  name_cache_victim = 0;
+  name_cache_state = state;
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_cache_build(void)
+{
+  struct file_header hdr;
+  coffee_page_t page;
+
+  name_cache_reset(NAME_CACHE_COMPLETE);
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
+      name_cache_insert(hdr.name, page);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct file *
+get_file(coffee_page_t page, struct file_header *hdr)
+{
+  int i;
+
+  for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
+    if(!FILE_FREE(&coffee_files[i]) && coffee_files[i].page == page) {
+      return &coffee_files[i];
+    }
+  }
+  return load_file(page, hdr);
+}
+#endif /* COFFEE_NAME_CACHE_SIZE > 0 */
 /*---------------------------------------------------------------------------*/
 static struct file *
 find_file(const char *name)
@@ -467,6 +710,30 @@ find_file(const char *name)
   struct file_header hdr;
   coffee_page_t page;
 
+#if COFFEE_NAME_CACHE_SIZE > 0
+  uint16_t hash;
+
+  if(name_cache_state == NAME_CACHE_UNBUILT) {
+    name_cache_build();
+  }
+
+  /* Verify the name of each candidate, since hashes may collide. */
+  hash = name_hash(name);
+  for(i = 0; i < COFFEE_NAME_CACHE_SIZE; i++) {
+    if(name_cache[i].page != INVALID_PAGE && name_cache[i].hash == hash) {
+      read_header(&hdr, name_cache[i].page);
+      if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr) && strcmp(name, hdr.name) == 0) {
+        STATS_ADD(name_cache_hits);
+        return get_file(name_cache[i].page, &hdr);
+      }
+    }
+  }
+
+  STATS_ADD(name_cache_misses);
+  if(name_cache_state == NAME_CACHE_COMPLETE) {
+    return NULL;
+  }
+#else
   /* First check if the file metadata is cached. */
   for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
     if(FILE_FREE(&coffee_files[i])) {
@@ -478,12 +745,18 @@ find_file(const char *name)
       return &coffee_files[i];
     }
   }
+#endif /* COFFEE_NAME_CACHE_SIZE > 0 */
 
   /* Scan the flash memory sequentially otherwise. */
   for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
     read_header(&hdr, page);
     if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr) && strcmp(name, hdr.name) == 0) {
+#if COFFEE_NAME_CACHE_SIZE > 0
+      name_cache_insert(hdr.name, page);
+      return get_file(page, &hdr);
+#else
       return load_file(page, &hdr);
+#endif
     }
   }
 
@@ -509,7 +782,7 @@ file_end(coffee_page_t start)
    */
 
   for(page = hdr.max_pages - 1; page >= 0; page--) {
-    COFFEE_READ(buf, sizeof(buf), (start + page) * COFFEE_PAGE_SIZE);
+    flash_read(buf, sizeof(buf), (start + page) * COFFEE_PAGE_SIZE);
     for(i = COFFEE_PAGE_SIZE - 1; i >= 0; i--) {
       if(buf[i] != 0) {
         if(page == 0 && i < sizeof(hdr)) {
@@ -583,6 +856,10 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
 
   gc_wait = 0;
 
+#if COFFEE_NAME_CACHE_SIZE > 0
+  name_cache_remove(page);
+#endif
+
   /* Close all file descriptors that reference the removed file. */
   if(close_fds) {
     for(i = 0; i < COFFEE_FD_SET_SIZE; i++) {
@@ -647,6 +924,13 @@ reserve(const char *name, coffee_page_t pages,
   hdr.flags = HDR_FLAG_ALLOCATED | flags;
   write_header(&hdr, page);
 
+#if COFFEE_NAME_CACHE_SIZE > 0
+  /* An unbuilt cache picks up the file when it is built. */
+  if(name_cache_state != NAME_CACHE_UNBUILT && !(flags & HDR_FLAG_LOG)) {
+    name_cache_insert(hdr.name, page);
+  }
+#endif
+
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
          (unsigned)pages, (unsigned)page, name);
 
@@ -713,7 +997,7 @@ get_record_index(coffee_page_t log_page, uint16_t search_records,
       }
 
       base -= batch_size * sizeof(indices[0]);
-      COFFEE_READ(&indices, sizeof(indices[0]) * batch_size, base);
+      flash_read(&indices, sizeof(indices[0]) * batch_size, base);
 
       for(i = batch_size - 1; i >= 0; i--) {
         if(indices[i] - 1 == region) {
@@ -754,7 +1038,7 @@ read_log_page(struct file_header *hdr, int16_t record_count,
   base = absolute_offset(hdr->log_page, log_records * sizeof(region));
   base += (cfs_offset_t)match_index * log_record_size;
   base += lp->offset;
-  COFFEE_READ(lp->buf, lp->size, base);
+  flash_read(lp->buf, lp->size, base);
 
   return lp->size;
 }
@@ -824,7 +1108,7 @@ merge_log(coffee_page_t file_page, int extend)
       cfs_close(fd);
       return -1;
     } else if(n > 0) {
-      COFFEE_WRITE(buf, n, absolute_offset(new_file->page, offset));
+      flash_write(buf, n, absolute_offset(new_file->page, offset));
       offset += n;
     }
   } while(n != 0);
@@ -881,8 +1165,8 @@ find_next_record(struct file *file, coffee_page_t log_page,
       batch_size = log_records - processed >= preferred_batch_size ?
         preferred_batch_size : log_records - processed;
 
-      COFFEE_READ(&indices, batch_size * sizeof(indices[0]),
-                  absolute_offset(log_page, processed * sizeof(indices[0])));
+      flash_read(&indices, batch_size * sizeof(indices[0]),
+                 absolute_offset(log_page, processed * sizeof(indices[0])));
       for(log_record = 0; log_record < batch_size; log_record++) {
         if(indices[log_record] == 0) {
           log_record += processed;
@@ -945,8 +1229,8 @@ write_log_page(struct file *file, struct log_param *lp)
 
     if((lp->offset > 0 || lp->size != log_record_size) &&
        read_log_page(&hdr, log_record, &lp_out) < 0) {
-      COFFEE_READ(copy_buf, sizeof(copy_buf),
-                  absolute_offset(file->page, offset));
+      flash_read(copy_buf, sizeof(copy_buf),
+                 absolute_offset(file->page, offset));
     }
 
     memcpy(&copy_buf[lp->offset], lp->buf, lp->size);
@@ -957,12 +1241,12 @@ write_log_page(struct file *file, struct log_param *lp)
      */
     offset = absolute_offset(log_page, 0);
     ++region;
-    COFFEE_WRITE(&region, sizeof(region),
-                 offset + log_record * sizeof(region));
+    flash_write(&region, sizeof(region),
+                offset + log_record * sizeof(region));
 
     offset += log_records * sizeof(region);
-    COFFEE_WRITE(copy_buf, sizeof(copy_buf),
-                 offset + log_record * log_record_size);
+    flash_write(copy_buf, sizeof(copy_buf),
+                offset + log_record * log_record_size);
     file->record_count = log_record + 1;
   }
 
@@ -1023,6 +1307,7 @@ void
 cfs_close(int fd)
 {
   if(FD_VALID(fd)) {
+    cfs_coffee_flush();
     coffee_fd_set[fd].flags = COFFEE_FD_FREE;
     coffee_fd_set[fd].file->references--;
     coffee_fd_set[fd].file = NULL;
@@ -1120,7 +1405,7 @@ cfs_read(int fd, void *buf, unsigned size)
 
   /* If the file is not modified, read directly from the file extent. */
   if(!FILE_MODIFIED(file)) {
-    COFFEE_READ(buf, size, absolute_offset(file->page, fdp->offset));
+    flash_read(buf, size, absolute_offset(file->page, fdp->offset));
     fdp->offset += size;
     return size;
   }
@@ -1141,7 +1426,7 @@ cfs_read(int fd, void *buf, unsigned size)
 
     /* Read from the original file if we cannot find the data in the log. */
     if(r < 0) {
-      COFFEE_READ(buf, lp.size, absolute_offset(file->page, fdp->offset));
+      flash_read(buf, lp.size, absolute_offset(file->page, fdp->offset));
       r = lp.size;
     }
     fdp->offset += r;
@@ -1232,7 +1517,7 @@ cfs_write(int fd, const void *buf, unsigned size)
        * corresponding end offset in the original extent to ensure that
        * the correct file size is calculated when opening the file again.
        */
-      COFFEE_WRITE(dummy, 1, absolute_offset(file->page, fdp->offset - 1));
+      flash_write(dummy, 1, absolute_offset(file->page, fdp->offset - 1));
     }
   } else {
 #endif /* COFFEE_MICRO_LOGS */
@@ -1242,7 +1527,7 @@ cfs_write(int fd, const void *buf, unsigned size)
   }
 #endif /* COFFEE_APPEND_ONLY */
 
-  COFFEE_WRITE(buf, size, absolute_offset(file->page, fdp->offset));
+  flash_write(buf, size, absolute_offset(file->page, fdp->offset));
   fdp->offset += size;
 #if COFFEE_MICRO_LOGS
 }
@@ -1272,14 +1557,16 @@ cfs_readdir(struct cfs_dir *dir, struct cfs_dirent *record)
   struct file_header hdr;
   coffee_page_t page;
   coffee_page_t next_page;
+  size_t len;
 
   memcpy(&page, dir->dummy_space, sizeof(coffee_page_t));
 
   while(page < COFFEE_PAGE_COUNT) {
     read_header(&hdr, page);
     if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
-      memcpy(record->name, hdr.name, sizeof(record->name));
-      record->name[sizeof(record->name) - 1] = '\0';
+      len = MIN(sizeof(hdr.name), sizeof(record->name));
+      memcpy(record->name, hdr.name, len);
+      record->name[len - 1] = '\0';
       record->size = file_end(page);
 
       next_page = next_file(page, &hdr);
@@ -1356,7 +1643,7 @@ cfs_coffee_format(void)
   PRINTF("Coffee: Formatting %u sectors", (unsigned)COFFEE_SECTOR_COUNT);
 
   for(i = 0; i < COFFEE_SECTOR_COUNT; i++) {
-    COFFEE_ERASE(i);
+    flash_erase(i);
     PRINTF(".");
   }
 
@@ -1365,9 +1652,23 @@ cfs_coffee_format(void)
   memset(&coffee_fd_set, 0, sizeof(coffee_fd_set));
   next_free = 0;
   gc_wait = 1;
+#if COFFEE_NAME_CACHE_SIZE > 0
+  /* The storage is empty, so there is nothing to scan for. */
+  name_cache_reset(NAME_CACHE_COMPLETE);
+#endif
 
   PRINTF(" done!\n");
 
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+void
+cfs_coffee_get_stats(struct cfs_coffee_stats *stats)
+{
+#if COFFEE_STATS
+  memcpy(stats, &coffee_stats, sizeof(*stats));
+#else
+  memset(stats, 0, sizeof(*stats));
+#endif /* COFFEE_STATS */
+}
+/*---------------------------------------------------------------------------*/
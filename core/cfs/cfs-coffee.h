@@ -140,6 +140,41 @@ int cfs_coffee_set_io_semantics(int fd, unsigned flags);
  */
 int cfs_coffee_format(void);
 
+/**
+ * \brief Write buffered data to the storage.
+ * \return 0
+ *
+ * With COFFEE_WRITE_BUFFER_SIZE set, Coffee combines consecutive
+ * writes in a RAM buffer and writes them to the storage together.
+ * The buffer is written when a file is closed, and when Coffee itself
+ * needs to read or erase the buffered area. Call this function to
+ * make sure that the data written so far is in the storage, e.g.,
+ * before the node may lose power. Without the write buffer, all data
+ * is written at once and this function does nothing.
+ */
+int cfs_coffee_flush(void);
+
+/** Coffee I/O statistics. */
+struct cfs_coffee_stats {
+  unsigned long header_reads;      /**< File headers read from storage. */
+  unsigned long name_cache_hits;   /**< Lookups resolved by the name cache. */
+  unsigned long name_cache_misses; /**< Lookups not found in the name cache. */
+  unsigned long flash_writes;      /**< Calls to COFFEE_WRITE. */
+};
+
+/**
+ * \brief Get the Coffee I/O statistics.
+ * \param stats A pointer to the structure to fill in.
+ *
+ * The statistics are only collected when COFFEE_STATS is set to
+ * a non-zero value in the platform configuration; otherwise they are
+ * all zero. Comparing the header read count with and without
+ * COFFEE_NAME_CACHE_SIZE shows how many storage reads the name cache
+ * saves, and the flash write count with and without
+ * COFFEE_WRITE_BUFFER_SIZE how many writes the write buffer combines.
+ */
+void cfs_coffee_get_stats(struct cfs_coffee_stats *stats);
+
 /** @} */
 /** @} */
 
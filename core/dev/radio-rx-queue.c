@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Queue of received frames between a radio driver's interrupt
+ *         handler and its process
+ */
+
+#include "dev/radio-rx-queue.h"
+#include "net/packetbuf.h"
+#include <string.h>
+
+/*---------------------------------------------------------------------------*/
+void
+radio_rx_queue_init(struct radio_rx_queue *q, uint8_t *buf,
+                    uint8_t frames, uint16_t max_len)
+{
+  frame_ring_init(&q->ring, buf, frames, max_len + RADIO_RX_QUEUE_META_LEN);
+  q->slot = NULL;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t *
+radio_rx_queue_reserve(struct radio_rx_queue *q)
+{
+  q->slot = frame_ring_reserve(&q->ring);
+  return q->slot == NULL ? NULL : q->slot + RADIO_RX_QUEUE_META_LEN;
+}
+/*---------------------------------------------------------------------------*/
+void
+radio_rx_queue_commit(struct radio_rx_queue *q, uint16_t len,
+                      int8_t rssi, uint8_t lqi)
+{
+  if(q->slot == NULL) {
+    return;
+  }
+  q->slot[0] = (uint8_t)rssi;
+  q->slot[1] = lqi;
+  q->slot = NULL;
+  frame_ring_commit(&q->ring, len + RADIO_RX_QUEUE_META_LEN);
+}
+/*---------------------------------------------------------------------------*/
+int
+radio_rx_queue_get(struct radio_rx_queue *q, void *buf, uint16_t bufsize)
+{
+  uint8_t *slot;
+  uint16_t len;
+
+  slot = frame_ring_peek(&q->ring, &len);
+  if(slot == NULL) {
+    return 0;
+  }
+  len -= RADIO_RX_QUEUE_META_LEN;
+  if(len <= bufsize) {
+    memcpy(buf, slot + RADIO_RX_QUEUE_META_LEN, len);
+    packetbuf_set_attr(PACKETBUF_ATTR_RSSI, (int8_t)slot[0]);
+    packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, slot[1]);
+  } else {
+    len = 0;
+  }
+  frame_ring_release(&q->ring);
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+radio_rx_queue_read(struct radio_rx_queue *q)
+{
+  int len;
+
+  if(!radio_rx_queue_pending(q)) {
+    return 0;
+  }
+  packetbuf_clear();
+  len = radio_rx_queue_get(q, packetbuf_dataptr(), PACKETBUF_SIZE);
+  packetbuf_set_datalen(len);
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+radio_rx_queue_pending(const struct radio_rx_queue *q)
+{
+  return frame_ring_elements(&q->ring);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Queue of received frames between a radio driver's interrupt
+ *         handler and its process
+ *
+ *         Drivers that read a frame into packetbuf only once their
+ *         process is polled lose every frame that arrives before
+ *         that. With this queue, the interrupt handler reads each
+ *         frame into a free slot of a frame ring, together with its
+ *         RSSI and link quality, and the process later moves the
+ *         frames into packetbuf one by one.
+ */
+
+#ifndef RADIO_RX_QUEUE_H_
+#define RADIO_RX_QUEUE_H_
+
+#include "contiki.h"
+#include "lib/frame-ring.h"
+
+/* The RSSI and link quality are stored in front of each frame */
+#define RADIO_RX_QUEUE_META_LEN 2
+
+/** \brief The buffer size needed for \p frames frames of up to \p max_len bytes */
+#define RADIO_RX_QUEUE_BUF_SIZE(frames, max_len) \
+  ((frames) * FRAME_RING_SLOT_SIZE((max_len) + RADIO_RX_QUEUE_META_LEN))
+
+struct radio_rx_queue {
+  struct frame_ring ring;
+  uint8_t *slot;
+};
+
+/**
+ * \brief Initialize a queue
+ * \param q The queue
+ * \param buf RADIO_RX_QUEUE_BUF_SIZE(frames, max_len) bytes
+ * \param frames The number of frames, a power of two of at most 128
+ * \param max_len The maximum frame length
+ */
+void radio_rx_queue_init(struct radio_rx_queue *q, uint8_t *buf,
+                         uint8_t frames, uint16_t max_len);
+
+/**
+ * \brief Get the buffer to read the next frame to (interrupt handler)
+ * \return The buffer, or NULL if the queue is full
+ */
+uint8_t *radio_rx_queue_reserve(struct radio_rx_queue *q);
+
+/**
+ * \brief Queue the frame read to the buffer from radio_rx_queue_reserve()
+ * \param q The queue
+ * \param len The frame length
+ * \param rssi The RSSI of the frame
+ * \param lqi The link quality of the frame
+ */
+void radio_rx_queue_commit(struct radio_rx_queue *q, uint16_t len,
+                           int8_t rssi, uint8_t lqi);
+
+/**
+ * \brief Copy the oldest frame out of the queue (process)
+ * \param q The queue
+ * \param buf The buffer to copy the frame to
+ * \param bufsize The size of the buffer
+ * \return The frame length, or 0 if the queue was empty or the frame
+ *         did not fit into the buffer
+ *
+ * Like the read() function of a radio driver, sets
+ * PACKETBUF_ATTR_RSSI and PACKETBUF_ATTR_LINK_QUALITY. A frame that
+ * does not fit is dropped.
+ */
+int radio_rx_queue_get(struct radio_rx_queue *q, void *buf, uint16_t bufsize);
+
+/**
+ * \brief Move the oldest frame to packetbuf (process)
+ * \return The frame length, or 0 if the queue was empty or the frame
+ *         did not fit into packetbuf
+ *
+ * Clears packetbuf and sets PACKETBUF_ATTR_RSSI and
+ * PACKETBUF_ATTR_LINK_QUALITY.
+ */
+int radio_rx_queue_read(struct radio_rx_queue *q);
+
+/** \brief The number of frames in the queue */
+int radio_rx_queue_pending(const struct radio_rx_queue *q);
+
+#endif /* RADIO_RX_QUEUE_H_ */
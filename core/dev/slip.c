@@ -60,7 +60,14 @@ uint16_t slip_rubbish, slip_twopackets, slip_overflow, slip_ip_drop;
 #endif
 
 /* Must be at least one byte larger than UIP_BUFSIZE! */
+#ifdef SLIP_CONF_RX_BUFSIZE
+#define RX_BUFSIZE SLIP_CONF_RX_BUFSIZE
+#if RX_BUFSIZE < (UIP_BUFSIZE - UIP_LLH_LEN + 1)
+#error "SLIP_CONF_RX_BUFSIZE too small for UIP_BUFSIZE"
+#endif
+#else
 #define RX_BUFSIZE (UIP_BUFSIZE - UIP_LLH_LEN + 16)
+#endif
 
 enum {
   STATE_TWOPACKETS = 0,	/* We have 2 packets and drop incoming data. */
@@ -64,7 +64,96 @@ static const uint8_t sbox[256] =   {
 0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
 0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16 };
 
+#if AES_128_WITH_TTABLE
+/*
+ * te[x] is MixColumn applied to the column (sbox[x], 0, 0, 0), with
+ * row r in bits 8r to 8r + 7. The tables for rows 1 to 3 are rotations
+ * of it.
+ */
+static const uint32_t te[256] = {
+  0xa56363c6UL, 0x847c7cf8UL, 0x997777eeUL, 0x8d7b7bf6UL,
+  0x0df2f2ffUL, 0xbd6b6bd6UL, 0xb16f6fdeUL, 0x54c5c591UL,
+  0x50303060UL, 0x03010102UL, 0xa96767ceUL, 0x7d2b2b56UL,
+  0x19fefee7UL, 0x62d7d7b5UL, 0xe6abab4dUL, 0x9a7676ecUL,
+  0x45caca8fUL, 0x9d82821fUL, 0x40c9c989UL, 0x877d7dfaUL,
+  0x15fafaefUL, 0xeb5959b2UL, 0xc947478eUL, 0x0bf0f0fbUL,
+  0xecadad41UL, 0x67d4d4b3UL, 0xfda2a25fUL, 0xeaafaf45UL,
+  0xbf9c9c23UL, 0xf7a4a453UL, 0x967272e4UL, 0x5bc0c09bUL,
+  0xc2b7b775UL, 0x1cfdfde1UL, 0xae93933dUL, 0x6a26264cUL,
+  0x5a36366cUL, 0x413f3f7eUL, 0x02f7f7f5UL, 0x4fcccc83UL,
+  0x5c343468UL, 0xf4a5a551UL, 0x34e5e5d1UL, 0x08f1f1f9UL,
+  0x937171e2UL, 0x73d8d8abUL, 0x53313162UL, 0x3f15152aUL,
+  0x0c040408UL, 0x52c7c795UL, 0x65232346UL, 0x5ec3c39dUL,
+  0x28181830UL, 0xa1969637UL, 0x0f05050aUL, 0xb59a9a2fUL,
+  0x0907070eUL, 0x36121224UL, 0x9b80801bUL, 0x3de2e2dfUL,
+  0x26ebebcdUL, 0x6927274eUL, 0xcdb2b27fUL, 0x9f7575eaUL,
+  0x1b090912UL, 0x9e83831dUL, 0x742c2c58UL, 0x2e1a1a34UL,
+  0x2d1b1b36UL, 0xb26e6edcUL, 0xee5a5ab4UL, 0xfba0a05bUL,
+  0xf65252a4UL, 0x4d3b3b76UL, 0x61d6d6b7UL, 0xceb3b37dUL,
+  0x7b292952UL, 0x3ee3e3ddUL, 0x712f2f5eUL, 0x97848413UL,
+  0xf55353a6UL, 0x68d1d1b9UL, 0x00000000UL, 0x2cededc1UL,
+  0x60202040UL, 0x1ffcfce3UL, 0xc8b1b179UL, 0xed5b5bb6UL,
+  0xbe6a6ad4UL, 0x46cbcb8dUL, 0xd9bebe67UL, 0x4b393972UL,
+  0xde4a4a94UL, 0xd44c4c98UL, 0xe85858b0UL, 0x4acfcf85UL,
+  0x6bd0d0bbUL, 0x2aefefc5UL, 0xe5aaaa4fUL, 0x16fbfbedUL,
+  0xc5434386UL, 0xd74d4d9aUL, 0x55333366UL, 0x94858511UL,
+  0xcf45458aUL, 0x10f9f9e9UL, 0x06020204UL, 0x817f7ffeUL,
+  0xf05050a0UL, 0x443c3c78UL, 0xba9f9f25UL, 0xe3a8a84bUL,
+  0xf35151a2UL, 0xfea3a35dUL, 0xc0404080UL, 0x8a8f8f05UL,
+  0xad92923fUL, 0xbc9d9d21UL, 0x48383870UL, 0x04f5f5f1UL,
+  0xdfbcbc63UL, 0xc1b6b677UL, 0x75dadaafUL, 0x63212142UL,
+  0x30101020UL, 0x1affffe5UL, 0x0ef3f3fdUL, 0x6dd2d2bfUL,
+  0x4ccdcd81UL, 0x140c0c18UL, 0x35131326UL, 0x2fececc3UL,
+  0xe15f5fbeUL, 0xa2979735UL, 0xcc444488UL, 0x3917172eUL,
+  0x57c4c493UL, 0xf2a7a755UL, 0x827e7efcUL, 0x473d3d7aUL,
+  0xac6464c8UL, 0xe75d5dbaUL, 0x2b191932UL, 0x957373e6UL,
+  0xa06060c0UL, 0x98818119UL, 0xd14f4f9eUL, 0x7fdcdca3UL,
+  0x66222244UL, 0x7e2a2a54UL, 0xab90903bUL, 0x8388880bUL,
+  0xca46468cUL, 0x29eeeec7UL, 0xd3b8b86bUL, 0x3c141428UL,
+  0x79dedea7UL, 0xe25e5ebcUL, 0x1d0b0b16UL, 0x76dbdbadUL,
+  0x3be0e0dbUL, 0x56323264UL, 0x4e3a3a74UL, 0x1e0a0a14UL,
+  0xdb494992UL, 0x0a06060cUL, 0x6c242448UL, 0xe45c5cb8UL,
+  0x5dc2c29fUL, 0x6ed3d3bdUL, 0xefacac43UL, 0xa66262c4UL,
+  0xa8919139UL, 0xa4959531UL, 0x37e4e4d3UL, 0x8b7979f2UL,
+  0x32e7e7d5UL, 0x43c8c88bUL, 0x5937376eUL, 0xb76d6ddaUL,
+  0x8c8d8d01UL, 0x64d5d5b1UL, 0xd24e4e9cUL, 0xe0a9a949UL,
+  0xb46c6cd8UL, 0xfa5656acUL, 0x07f4f4f3UL, 0x25eaeacfUL,
+  0xaf6565caUL, 0x8e7a7af4UL, 0xe9aeae47UL, 0x18080810UL,
+  0xd5baba6fUL, 0x887878f0UL, 0x6f25254aUL, 0x722e2e5cUL,
+  0x241c1c38UL, 0xf1a6a657UL, 0xc7b4b473UL, 0x51c6c697UL,
+  0x23e8e8cbUL, 0x7cdddda1UL, 0x9c7474e8UL, 0x211f1f3eUL,
+  0xdd4b4b96UL, 0xdcbdbd61UL, 0x868b8b0dUL, 0x858a8a0fUL,
+  0x907070e0UL, 0x423e3e7cUL, 0xc4b5b571UL, 0xaa6666ccUL,
+  0xd8484890UL, 0x05030306UL, 0x01f6f6f7UL, 0x120e0e1cUL,
+  0xa36161c2UL, 0x5f35356aUL, 0xf95757aeUL, 0xd0b9b969UL,
+  0x91868617UL, 0x58c1c199UL, 0x271d1d3aUL, 0xb99e9e27UL,
+  0x38e1e1d9UL, 0x13f8f8ebUL, 0xb398982bUL, 0x33111122UL,
+  0xbb6969d2UL, 0x70d9d9a9UL, 0x898e8e07UL, 0xa7949433UL,
+  0xb69b9b2dUL, 0x221e1e3cUL, 0x92878715UL, 0x20e9e9c9UL,
+  0x49cece87UL, 0xff5555aaUL, 0x78282850UL, 0x7adfdfa5UL,
+  0x8f8c8c03UL, 0xf8a1a159UL, 0x80898909UL, 0x170d0d1aUL,
+  0xdabfbf65UL, 0x31e6e6d7UL, 0xc6424284UL, 0xb86868d0UL,
+  0xc3414182UL, 0xb0999929UL, 0x772d2d5aUL, 0x110f0f1eUL,
+  0xcbb0b07bUL, 0xfc5454a8UL, 0xd6bbbb6dUL, 0x3a16162cUL
+};
+
+#define ROTL(w, n) (((w) << (n)) | ((w) >> (32 - (n))))
+
+/* One column of a full round */
+#define ROUND_COLUMN(a, b, c, d, k) \
+  (te[(a) & 0xff] ^ ROTL(te[((b) >> 8) & 0xff], 8) ^ \
+   ROTL(te[((c) >> 16) & 0xff], 16) ^ ROTL(te[(d) >> 24], 24) ^ (k))
+
+/* One column of the last round, which skips MixColumn */
+#define LAST_COLUMN(a, b, c, d, k) \
+  ((sbox[(a) & 0xff] | ((uint32_t)sbox[((b) >> 8) & 0xff] << 8) | \
+    ((uint32_t)sbox[((c) >> 16) & 0xff] << 16) | \
+    ((uint32_t)sbox[(d) >> 24] << 24)) ^ (k))
+
+static uint32_t round_keys[11][4];
+#else /* AES_128_WITH_TTABLE */
 static uint8_t round_keys[11][AES_128_KEY_LENGTH];
+#endif /* AES_128_WITH_TTABLE */
 
 /*---------------------------------------------------------------------------*/
 /* multiplies by 2 in GF(2) */
@@ -76,26 +165,96 @@ galois_mul2(uint8_t value)
 }
 /*---------------------------------------------------------------------------*/
 static void
-set_key(const uint8_t *key)
+expand_key(uint8_t keys[11][AES_128_KEY_LENGTH], const uint8_t *key)
 {
   uint8_t i;
   uint8_t j;
   uint8_t rcon;
   
   rcon = 0x01;
-  memcpy(round_keys[0], key, AES_128_KEY_LENGTH);
+  memcpy(keys[0], key, AES_128_KEY_LENGTH);
   for(i = 1; i <= 10; i++) {
-    round_keys[i][0] = sbox[round_keys[i - 1][13]] ^ round_keys[i - 1][0] ^ rcon;
-    round_keys[i][1] = sbox[round_keys[i - 1][14]] ^ round_keys[i - 1][1];
-    round_keys[i][2] = sbox[round_keys[i - 1][15]] ^ round_keys[i - 1][2];
-    round_keys[i][3] = sbox[round_keys[i - 1][12]] ^ round_keys[i - 1][3];
+    keys[i][0] = sbox[keys[i - 1][13]] ^ keys[i - 1][0] ^ rcon;
+    keys[i][1] = sbox[keys[i - 1][14]] ^ keys[i - 1][1];
+    keys[i][2] = sbox[keys[i - 1][15]] ^ keys[i - 1][2];
+    keys[i][3] = sbox[keys[i - 1][12]] ^ keys[i - 1][3];
     for(j = 4; j < AES_128_BLOCK_SIZE; j++) {
-      round_keys[i][j] = round_keys[i - 1][j] ^ round_keys[i][j - 4];
+      keys[i][j] = keys[i - 1][j] ^ keys[i][j - 4];
     }
     rcon = galois_mul2(rcon);
   }
 }
 /*---------------------------------------------------------------------------*/
+#if AES_128_WITH_TTABLE
+static uint32_t
+load_column(const uint8_t *p)
+{
+  return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)
+      | ((uint32_t)p[3] << 24);
+}
+/*---------------------------------------------------------------------------*/
+static void
+store_column(uint8_t *p, uint32_t w)
+{
+  p[0] = w;
+  p[1] = w >> 8;
+  p[2] = w >> 16;
+  p[3] = w >> 24;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_key(const uint8_t *key)
+{
+  uint8_t keys[11][AES_128_KEY_LENGTH];
+  uint8_t i;
+  uint8_t j;
+
+  expand_key(keys, key);
+  for(i = 0; i <= 10; i++) {
+    for(j = 0; j < 4; j++) {
+      round_keys[i][j] = load_column(&keys[i][j << 2]);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+encrypt(uint8_t *state)
+{
+  uint32_t s0, s1, s2, s3;
+  uint32_t t0, t1, t2, t3;
+  uint8_t round;
+
+  /* round 0 */
+  s0 = load_column(state) ^ round_keys[0][0];
+  s1 = load_column(state + 4) ^ round_keys[0][1];
+  s2 = load_column(state + 8) ^ round_keys[0][2];
+  s3 = load_column(state + 12) ^ round_keys[0][3];
+
+  /* ByteSub, ShiftRow, MixColumn and AddRoundKey in one go */
+  for(round = 1; round < 10; round++) {
+    t0 = ROUND_COLUMN(s0, s1, s2, s3, round_keys[round][0]);
+    t1 = ROUND_COLUMN(s1, s2, s3, s0, round_keys[round][1]);
+    t2 = ROUND_COLUMN(s2, s3, s0, s1, round_keys[round][2]);
+    t3 = ROUND_COLUMN(s3, s0, s1, s2, round_keys[round][3]);
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+
+  store_column(state, LAST_COLUMN(s0, s1, s2, s3, round_keys[10][0]));
+  store_column(state + 4, LAST_COLUMN(s1, s2, s3, s0, round_keys[10][1]));
+  store_column(state + 8, LAST_COLUMN(s2, s3, s0, s1, round_keys[10][2]));
+  store_column(state + 12, LAST_COLUMN(s3, s0, s1, s2, round_keys[10][3]));
+}
+#else /* AES_128_WITH_TTABLE */
+/*---------------------------------------------------------------------------*/
+static void
+set_key(const uint8_t *key)
+{
+  expand_key(round_keys, key);
+}
+/*---------------------------------------------------------------------------*/
 static void
 encrypt(uint8_t *state)
 {
@@ -165,6 +324,16 @@ encrypt(uint8_t *state)
     }
   }
 }
+#endif /* AES_128_WITH_TTABLE */
+/*---------------------------------------------------------------------------*/
+static void
+encrypt_blocks(uint8_t *blocks, uint8_t count)
+{
+  while(count--) {
+    encrypt(blocks);
+    blocks += AES_128_BLOCK_SIZE;
+  }
+}
 /*---------------------------------------------------------------------------*/
 void
 aes_128_set_padded_key(uint8_t *key, uint8_t key_len)
@@ -178,6 +347,7 @@ aes_128_set_padded_key(uint8_t *key, uint8_t key_len)
 /*---------------------------------------------------------------------------*/
 const struct aes_128_driver aes_128_driver = {
   set_key,
-  encrypt
+  encrypt,
+  encrypt_blocks
 };
 /*---------------------------------------------------------------------------*/
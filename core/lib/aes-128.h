@@ -51,6 +51,17 @@
 #define AES_128            aes_128_driver
 #endif /* AES_128_CONF */
 
+/*
+ * The software driver uses a 1 KB lookup table that merges SubBytes
+ * and MixColumns, which is several times faster than the byte-wise
+ * rounds but costs flash. Worth it on 32-bit CPUs.
+ */
+#ifdef AES_128_CONF_WITH_TTABLE
+#define AES_128_WITH_TTABLE AES_128_CONF_WITH_TTABLE
+#else /* AES_128_CONF_WITH_TTABLE */
+#define AES_128_WITH_TTABLE 0
+#endif /* AES_128_CONF_WITH_TTABLE */
+
 /**
  * Structure of AES drivers.
  */
@@ -65,6 +76,16 @@ struct aes_128_driver {
    * \brief Encrypts.
    */
   void (* encrypt)(uint8_t *plaintext_and_result);
+
+  /**
+   * \brief Encrypts several independent blocks, e.g., the counter
+   *        blocks of CCM*. May be NULL, in which case callers call
+   *        encrypt() once per block. Drivers for engines that can
+   *        process a batch of blocks in one go should set it.
+   * \param blocks The blocks, AES_128_BLOCK_SIZE bytes each
+   * \param count  The number of blocks
+   */
+  void (* encrypt_blocks)(uint8_t *blocks, uint8_t count);
 };
 
 /**
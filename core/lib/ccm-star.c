@@ -46,6 +46,13 @@
 #define CCM_STAR_AUTH_FLAGS(Adata, M) ((Adata ? (1u << 6) : 0) | (((M - 2u) >> 1) << 3) | 1u)
 #define CCM_STAR_ENCRYPTION_FLAGS     1
 
+/* Number of key stream blocks computed per AES_128 call */
+#ifdef CCM_STAR_CONF_BATCH_BLOCKS
+#define CCM_STAR_BATCH_BLOCKS CCM_STAR_CONF_BATCH_BLOCKS
+#else /* CCM_STAR_CONF_BATCH_BLOCKS */
+#define CCM_STAR_BATCH_BLOCKS 4
+#endif /* CCM_STAR_CONF_BATCH_BLOCKS */
+
 /*---------------------------------------------------------------------------*/
 static void
 set_iv(uint8_t *iv,
@@ -59,84 +66,48 @@ set_iv(uint8_t *iv,
   iv[15] = counter;
 }
 /*---------------------------------------------------------------------------*/
-/* XORs the block m[pos] ... m[pos + 15] with K_{counter} */
+/* Puts the key stream blocks K_{counter} ... K_{counter + count - 1} in s */
 static void
-ctr_step(const uint8_t *nonce,
-    uint8_t pos,
-    uint8_t *m_and_result,
-    uint8_t m_len,
-    uint8_t counter)
+key_stream(const uint8_t *nonce,
+    uint8_t counter,
+    uint8_t s[][AES_128_BLOCK_SIZE],
+    uint8_t count)
 {
-  uint8_t a[AES_128_BLOCK_SIZE];
   uint8_t i;
   
-  set_iv(a, CCM_STAR_ENCRYPTION_FLAGS, nonce, counter);
-  AES_128.encrypt(a);
-  
-  for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
-    m_and_result[pos + i] ^= a[i];
+  for(i = 0; i < count; i++) {
+    set_iv(s[i], CCM_STAR_ENCRYPTION_FLAGS, nonce, counter + i);
+  }
+  if(AES_128.encrypt_blocks) {
+    AES_128.encrypt_blocks(s[0], count);
+  } else {
+    for(i = 0; i < count; i++) {
+      AES_128.encrypt(s[i]);
+    }
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Feeds the a_len bytes of additional data into the CBC-MAC x */
 static void
-mic(const uint8_t *nonce,
-    const uint8_t *m, uint8_t m_len,
-    const uint8_t *a, uint8_t a_len,
-    uint8_t *result,
-    uint8_t mic_len)
+mic_header(uint8_t *x, const uint8_t *a, uint8_t a_len)
 {
-  uint8_t x[AES_128_BLOCK_SIZE];
-  uint8_t pos;
+  uint16_t pos;
   uint8_t i;
   
-  set_iv(x, CCM_STAR_AUTH_FLAGS(a_len, mic_len), nonce, m_len);
-  AES_128.encrypt(x);
-  
-  if(a_len) {
-    x[1] = x[1] ^ a_len;
-    for(i = 2; (i - 2 < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
-      x[i] ^= a[i - 2];
-    }
-    
-    AES_128.encrypt(x);
-    
-    pos = 14;
-    while(pos < a_len) {
-      for(i = 0; (pos + i < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
-        x[i] ^= a[pos + i];
-      }
-      pos += AES_128_BLOCK_SIZE;
-      AES_128.encrypt(x);
-    }
-  }
-  
-  if(m_len) {
-    pos = 0;
-    while(pos < m_len) {
-      for(i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
-        x[i] ^= m[pos + i];
-      }
-      pos += AES_128_BLOCK_SIZE;
-      AES_128.encrypt(x);
-    }
+  x[1] = x[1] ^ a_len;
+  for(i = 2; (i - 2 < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
+    x[i] ^= a[i - 2];
   }
   
-  ctr_step(nonce, 0, x, AES_128_BLOCK_SIZE, 0);
-  
-  memcpy(result, x, mic_len);
-}
-/*---------------------------------------------------------------------------*/
-static void
-ctr(const uint8_t *nonce, uint8_t *m, uint8_t m_len)
-{
-  uint8_t pos;
-  uint8_t counter;
+  AES_128.encrypt(x);
   
-  pos = 0;
-  counter = 1;
-  while(pos < m_len) {
-    ctr_step(nonce, pos, m, m_len, counter++);
+  pos = 14;
+  while(pos < a_len) {
+    for(i = 0; (pos + i < a_len) && (i < AES_128_BLOCK_SIZE); i++) {
+      x[i] ^= a[pos + i];
+    }
     pos += AES_128_BLOCK_SIZE;
+    AES_128.encrypt(x);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -146,6 +117,12 @@ set_key(const uint8_t *key)
   AES_128.set_key(key);
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Single pass over m: each block is fed into the CBC-MAC and XORed with
+ * its key stream block, plaintext first. The key stream is computed
+ * CCM_STAR_BATCH_BLOCKS blocks at a time, so that AES engines which
+ * implement encrypt_blocks() get several counter blocks per call.
+ */
 static void
 aead(const uint8_t* nonce,
     uint8_t* m, uint8_t m_len,
@@ -153,20 +130,60 @@ aead(const uint8_t* nonce,
     uint8_t *result, uint8_t mic_len,
     int forward)
 {
-  if(!forward) {
-    /* decrypt */
-    ctr(nonce, m, m_len);
+  uint8_t x[AES_128_BLOCK_SIZE];
+  uint8_t s[CCM_STAR_BATCH_BLOCKS][AES_128_BLOCK_SIZE];
+  uint8_t s0[AES_128_BLOCK_SIZE];
+  uint8_t blocks;
+  uint8_t counter;
+  uint8_t first;
+  uint8_t pos;
+  uint8_t len;
+  uint8_t i;
+  uint8_t j;
+  
+  set_iv(x, CCM_STAR_AUTH_FLAGS(a_len, mic_len), nonce, m_len);
+  AES_128.encrypt(x);
+  
+  if(a_len) {
+    mic_header(x, a, a_len);
   }
   
-  mic(nonce,
-    m, m_len,
-    a, a_len,
-    result,
-    mic_len);
+  /* K_0 encrypts the MIC; it comes with the first batch. */
+  blocks = (m_len + AES_128_BLOCK_SIZE - 1) / AES_128_BLOCK_SIZE + 1;
+  counter = 0;
+  pos = 0;
+  while(blocks) {
+    first = counter;
+    i = blocks < CCM_STAR_BATCH_BLOCKS ? blocks : CCM_STAR_BATCH_BLOCKS;
+    key_stream(nonce, counter, s, i);
+    counter += i;
+    blocks -= i;
+    
+    for(j = 0; j < counter - first; j++) {
+      if(first + j == 0) {
+        memcpy(s0, s[0], AES_128_BLOCK_SIZE);
+        continue;
+      }
+      
+      len = m_len - pos < AES_128_BLOCK_SIZE ? m_len - pos : AES_128_BLOCK_SIZE;
+      if(forward) {
+        for(i = 0; i < len; i++) {
+          x[i] ^= m[pos + i];
+          m[pos + i] ^= s[j][i];
+        }
+      } else {
+        for(i = 0; i < len; i++) {
+          m[pos + i] ^= s[j][i];
+          x[i] ^= m[pos + i];
+        }
+      }
+      AES_128.encrypt(x);
+      pos += len;
+    }
+  }
   
-  if(forward) {
-    /* encrypt */
-    ctr(nonce, m, m_len);
+  for(i = 0; i < mic_len; i++) {
+    result[i] = x[i] ^ s0[i];
   }
 }
 /*---------------------------------------------------------------------------*/
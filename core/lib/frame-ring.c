@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Frame ring library. A lock-free single-producer,
+ *         single-consumer ring of fixed-size frame slots, for handing
+ *         frames from an interrupt handler to a process.
+ */
+
+#include "lib/frame-ring.h"
+#include <string.h>
+
+/* Slot n holds the frame length in its first two bytes, then the frame */
+#define SLOT(r, n) (&(r)->data[(uint16_t)((n) & (r)->mask) * (r)->slot_size])
+
+/*---------------------------------------------------------------------------*/
+void
+frame_ring_init(struct frame_ring *r, uint8_t *data,
+                uint8_t slots, uint16_t max_len)
+{
+  r->data = data;
+  r->slot_size = FRAME_RING_SLOT_SIZE(max_len);
+  r->mask = slots - 1;
+  r->put_ptr = 0;
+  r->get_ptr = 0;
+  r->dropped = 0;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t *
+frame_ring_reserve(struct frame_ring *r)
+{
+  /* The indexes run freely and are only masked to address a slot, so
+     all slots can be used. */
+  if((uint8_t)(r->put_ptr - r->get_ptr) > r->mask) {
+    r->dropped++;
+    return NULL;
+  }
+  /* The consumer must be done with the slot before it is overwritten. */
+  FRAME_RING_BARRIER();
+  return SLOT(r, r->put_ptr) + 2;
+}
+/*---------------------------------------------------------------------------*/
+void
+frame_ring_commit(struct frame_ring *r, uint16_t len)
+{
+  uint8_t *slot;
+
+  slot = SLOT(r, r->put_ptr);
+  slot[0] = len >> 8;
+  slot[1] = len & 0xff;
+  /* The frame must be in place before the consumer can see it. */
+  FRAME_RING_BARRIER();
+  r->put_ptr = r->put_ptr + 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+frame_ring_put(struct frame_ring *r, const void *frame, uint16_t len)
+{
+  uint8_t *slot;
+
+  if(len > r->slot_size - 2) {
+    return 0;
+  }
+  slot = frame_ring_reserve(r);
+  if(slot == NULL) {
+    return 0;
+  }
+  memcpy(slot, frame, len);
+  frame_ring_commit(r, len);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t *
+frame_ring_peek(struct frame_ring *r, uint16_t *len)
+{
+  uint8_t *slot;
+
+  if(r->put_ptr == r->get_ptr) {
+    return NULL;
+  }
+  /* Read the slot only after seeing the producer's index update. */
+  FRAME_RING_BARRIER();
+  slot = SLOT(r, r->get_ptr);
+  *len = (slot[0] << 8) | slot[1];
+  return slot + 2;
+}
+/*---------------------------------------------------------------------------*/
+void
+frame_ring_release(struct frame_ring *r)
+{
+  if(r->put_ptr == r->get_ptr) {
+    return;
+  }
+  /* Finish reading the slot before the producer may reuse it. */
+  FRAME_RING_BARRIER();
+  r->get_ptr = r->get_ptr + 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+frame_ring_get(struct frame_ring *r, void *buf, uint16_t bufsize)
+{
+  uint8_t *frame;
+  uint16_t len;
+
+  frame = frame_ring_peek(r, &len);
+  if(frame == NULL) {
+    return -1;
+  }
+  if(len > bufsize) {
+    len = 0;
+  } else {
+    memcpy(buf, frame, len);
+  }
+  frame_ring_release(r);
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+frame_ring_elements(const struct frame_ring *r)
+{
+  return (uint8_t)(r->put_ptr - r->get_ptr);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the frame ring library
+ */
+
+/** \addtogroup lib
+ * @{ */
+
+/**
+ * \defgroup frame-ring Frame ring library
+ * @{
+ *
+ * A ring of fixed-size slots that each hold one frame of up to a
+ * given length. It has a single producer, typically an interrupt
+ * handler, and a single consumer, typically a process, which need no
+ * lock: the producer only writes put_ptr and the consumer only writes
+ * get_ptr. Both are 8-bit quantities, which are read and written
+ * atomically on all supported CPUs.
+ *
+ * Frames are written and read in place. The producer reserves the next
+ * free slot, fills it and commits it with the frame length; the
+ * consumer peeks at the oldest slot and releases it when done.
+ *
+ * FRAME_RING_BARRIER() orders the slot contents against the index
+ * updates. On single-core CPUs, where producer and consumer are an
+ * interrupt and the code it interrupts, a compiler barrier is
+ * enough. Platforms where they may run on different cores, like
+ * native with threads, set FRAME_RING_CONF_BARRIER to a full memory
+ * barrier and FRAME_RING_CONF_CACHE_LINE to keep the two indexes on
+ * different cache lines.
+ */
+
+#ifndef FRAME_RING_H_
+#define FRAME_RING_H_
+
+#include "contiki-conf.h"
+
+#ifdef FRAME_RING_CONF_BARRIER
+#define FRAME_RING_BARRIER() FRAME_RING_CONF_BARRIER()
+#elif defined(__GNUC__)
+#define FRAME_RING_BARRIER() __asm__ __volatile__("" : : : "memory")
+#else
+#define FRAME_RING_BARRIER()
+#endif
+
+#ifdef FRAME_RING_CONF_CACHE_LINE
+#define FRAME_RING_CACHE_LINE FRAME_RING_CONF_CACHE_LINE
+#else /* FRAME_RING_CONF_CACHE_LINE */
+#define FRAME_RING_CACHE_LINE 0
+#endif /* FRAME_RING_CONF_CACHE_LINE */
+
+/**
+ * \brief      The buffer size needed per slot for frames of up to
+ *             \p max_len bytes, including the stored frame length.
+ */
+#define FRAME_RING_SLOT_SIZE(max_len) ((max_len) + 2)
+
+/**
+ * \brief      Structure that holds the state of a frame ring.
+ */
+struct frame_ring {
+  uint8_t *data;
+  uint16_t slot_size;
+  uint8_t mask;
+
+  /* Written by the producer only. */
+  volatile uint8_t put_ptr;
+  /* Frames not queued because the ring was full */
+  uint16_t dropped;
+#if FRAME_RING_CACHE_LINE
+  uint8_t pad[FRAME_RING_CACHE_LINE];
+#endif /* FRAME_RING_CACHE_LINE */
+
+  /* Written by the consumer only. */
+  volatile uint8_t get_ptr;
+};
+
+/**
+ * \brief      Initialize a frame ring
+ * \param r    A pointer to the frame ring
+ * \param data An array of slots * FRAME_RING_SLOT_SIZE(max_len) bytes
+ * \param slots The number of slots, a power of two of at most 128
+ * \param max_len The maximum frame length
+ */
+void frame_ring_init(struct frame_ring *r, uint8_t *data,
+                     uint8_t slots, uint16_t max_len);
+
+/**
+ * \brief      Get the next free slot (producer)
+ * \param r    A pointer to the frame ring
+ * \return     The slot to write a frame to, or NULL if the ring is full
+ *
+ *             The frame becomes visible to the consumer with
+ *             frame_ring_commit(). A slot that is not committed is
+ *             returned again by the next call.
+ */
+uint8_t *frame_ring_reserve(struct frame_ring *r);
+
+/**
+ * \brief      Hand the slot from frame_ring_reserve() to the consumer
+ * \param r    A pointer to the frame ring
+ * \param len  The length of the frame in the slot
+ */
+void frame_ring_commit(struct frame_ring *r, uint16_t len);
+
+/**
+ * \brief      Copy a frame into the ring (producer)
+ * \param r    A pointer to the frame ring
+ * \param frame The frame
+ * \param len  The length of the frame
+ * \return     Non-zero if the frame was queued, or zero if the ring
+ *             was full or the frame too long
+ */
+int frame_ring_put(struct frame_ring *r, const void *frame, uint16_t len);
+
+/**
+ * \brief      Get the oldest frame (consumer)
+ * \param r    A pointer to the frame ring
+ * \param len  Set to the length of the frame
+ * \return     The frame, or NULL if the ring is empty
+ *
+ *             The frame stays in the ring until frame_ring_release()
+ *             is called.
+ */
+uint8_t *frame_ring_peek(struct frame_ring *r, uint16_t *len);
+
+/**
+ * \brief      Remove the oldest frame (consumer)
+ * \param r    A pointer to the frame ring
+ */
+void frame_ring_release(struct frame_ring *r);
+
+/**
+ * \brief      Copy the oldest frame out of the ring (consumer)
+ * \param r    A pointer to the frame ring
+ * \param buf  The buffer to copy the frame to
+ * \param bufsize The size of the buffer
+ * \return     The length of the frame, 0 if it did not fit into the
+ *             buffer and was dropped, or -1 if the ring was empty
+ */
+int frame_ring_get(struct frame_ring *r, void *buf, uint16_t bufsize);
+
+/**
+ * \brief      Get the number of frames in the ring
+ * \param r    A pointer to the frame ring
+ */
+int frame_ring_elements(const struct frame_ring *r);
+
+#endif /* FRAME_RING_H_ */
+
+/** @}*/
+/** @}*/
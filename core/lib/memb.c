@@ -47,12 +47,69 @@
 #include "contiki.h"
 #include "lib/memb.h"
 
+#if MEMB_STATS
+static struct memb *pools;
+#endif /* MEMB_STATS */
+
+#if MEMB_FREELIST
+/*
+ * The link of a free chunk sits in its last two bytes, away from the
+ * list pointer that structs kept in lists start with. It holds the
+ * distance to the next free chunk minus one, so that the zeroed memory
+ * of a new block links each chunk to the following one.
+ */
+#define LINK(m, i) ((char *)(m)->mem + ((i) + 1) * (m)->size - \
+                    sizeof(unsigned short))
+
+/* Chunks too small to hold a link are searched for like without the
+   free list. */
+#define HAS_FREELIST(m) ((m)->size >= sizeof(unsigned short))
+/*---------------------------------------------------------------------------*/
+static unsigned short
+next_free(struct memb *m, unsigned short i)
+{
+  unsigned short link;
+
+  memcpy(&link, LINK(m, i), sizeof(link));
+  return i + 1 + link;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_next_free(struct memb *m, unsigned short i, unsigned short next)
+{
+  unsigned short link;
+
+  link = next - i - 1;
+  memcpy(LINK(m, i), &link, sizeof(link));
+}
+#endif /* MEMB_FREELIST */
+/*---------------------------------------------------------------------------*/
+#if MEMB_STATS
+static void
+register_pool(struct memb *m)
+{
+  if(!m->registered) {
+    m->registered = 1;
+    m->next = pools;
+    pools = m;
+  }
+}
+#endif /* MEMB_STATS */
 /*---------------------------------------------------------------------------*/
 void
 memb_init(struct memb *m)
 {
   memset(m->count, 0, m->num);
   memset(m->mem, 0, m->size * m->num);
+#if MEMB_FREELIST || MEMB_STATS
+  m->used = 0;
+#endif /* MEMB_FREELIST || MEMB_STATS */
+#if MEMB_FREELIST
+  m->free = 0;
+#endif /* MEMB_FREELIST */
+#if MEMB_STATS
+  register_pool(m);
+#endif /* MEMB_STATS */
 }
 /*---------------------------------------------------------------------------*/
 void *
@@ -60,44 +117,82 @@ memb_alloc(struct memb *m)
 {
   int i;
 
+#if MEMB_STATS
+  register_pool(m);
+#endif /* MEMB_STATS */
+
+#if MEMB_FREELIST
+  if(HAS_FREELIST(m)) {
+    i = m->free;
+    if(i < m->num) {
+      m->free = next_free(m, i);
+      goto found;
+    }
+  } else
+#endif /* MEMB_FREELIST */
   for(i = 0; i < m->num; ++i) {
     if(m->count[i] == 0) {
-      /* If this block was unused, we increase the reference count to
-	 indicate that it now is used and return a pointer to the
-	 memory block. */
-      ++(m->count[i]);
-      return (void *)((char *)m->mem + (i * m->size));
+      goto found;
     }
   }
 
   /* No free block was found, so we return NULL to indicate failure to
      allocate block. */
+#if MEMB_STATS
+  if(m->failed < 0xffff) {
+    m->failed++;
+  }
+#endif /* MEMB_STATS */
   return NULL;
+
+found:
+  /* If this block was unused, we increase the reference count to
+     indicate that it now is used and return a pointer to the
+     memory block. */
+  ++(m->count[i]);
+#if MEMB_FREELIST || MEMB_STATS
+  m->used++;
+#endif /* MEMB_FREELIST || MEMB_STATS */
+#if MEMB_STATS
+  if(m->used > m->max_used) {
+    m->max_used = m->used;
+  }
+#endif /* MEMB_STATS */
+  return (void *)((char *)m->mem + (i * m->size));
 }
 /*---------------------------------------------------------------------------*/
 char
 memb_free(struct memb *m, void *ptr)
 {
   int i;
-  char *ptr2;
+  unsigned long offset;
 
-  /* Walk through the list of blocks and try to find the block to
-     which the pointer "ptr" points to. */
-  ptr2 = (char *)m->mem;
-  for(i = 0; i < m->num; ++i) {
-    
-    if(ptr2 == (char *)ptr) {
-      /* We've found to block to which "ptr" points so we decrease the
-	 reference count and return the new value of it. */
-      if(m->count[i] > 0) {
-	/* Make sure that we don't deallocate free memory. */
-	--(m->count[i]);
+  /* Find the block to which the pointer "ptr" points. */
+  if(!memb_inmemb(m, ptr)) {
+    return -1;
+  }
+  offset = (char *)ptr - (char *)m->mem;
+  if(offset % m->size != 0) {
+    return -1;
+  }
+  i = offset / m->size;
+
+  /* Decrease the reference count and return the new value of it. Make
+     sure that we don't deallocate free memory. */
+  if(m->count[i] > 0) {
+    if(--(m->count[i]) == 0) {
+#if MEMB_FREELIST || MEMB_STATS
+      m->used--;
+#endif /* MEMB_FREELIST || MEMB_STATS */
+#if MEMB_FREELIST
+      if(HAS_FREELIST(m)) {
+        set_next_free(m, i, m->free);
+        m->free = i;
       }
-      return m->count[i];
+#endif /* MEMB_FREELIST */
     }
-    ptr2 += m->size;
   }
-  return -1;
+  return m->count[i];
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -110,6 +205,9 @@ memb_inmemb(struct memb *m, void *ptr)
 int
 memb_numfree(struct memb *m)
 {
+#if MEMB_FREELIST || MEMB_STATS
+  return m->num - m->used;
+#else /* MEMB_FREELIST || MEMB_STATS */
   int i;
   int num_free = 0;
 
@@ -120,5 +218,14 @@ memb_numfree(struct memb *m)
   }
 
   return num_free;
+#endif /* MEMB_FREELIST || MEMB_STATS */
+}
+/*---------------------------------------------------------------------------*/
+#if MEMB_STATS
+struct memb *
+memb_pools(void)
+{
+  return pools;
 }
+#endif /* MEMB_STATS */
 /** @} */
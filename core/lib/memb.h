@@ -48,6 +48,17 @@
  * memory by the memb_alloc() function, and are deallocated with the
  * memb_free() function.
  *
+ * By default, memb_alloc() and memb_free() search the block for a free
+ * or the given chunk. With MEMB_CONF_FREELIST set, the free chunks are
+ * kept in a list instead, which makes both constant time. The link is
+ * kept in the last two bytes of each free chunk, so a chunk must not
+ * be accessed after it has been deallocated.
+ *
+ * With MEMB_CONF_STATS set, every block counts how many chunks are in
+ * use, the most that have been in use at a time, and the number of
+ * failed allocations. Blocks are registered by memb_init() or their
+ * first allocation, and can be listed with memb_pools().
+ *
  * @{
  */
 
@@ -65,6 +76,37 @@
 
 #include "sys/cc.h"
 
+#ifdef MEMB_CONF_FREELIST
+#define MEMB_FREELIST MEMB_CONF_FREELIST
+#else /* MEMB_CONF_FREELIST */
+#define MEMB_FREELIST 0
+#endif /* MEMB_CONF_FREELIST */
+
+#ifdef MEMB_CONF_STATS
+#define MEMB_STATS MEMB_CONF_STATS
+#else /* MEMB_CONF_STATS */
+#define MEMB_STATS 0
+#endif /* MEMB_CONF_STATS */
+
+/* Initializers of the optional fields of struct memb, in order */
+#if MEMB_STATS
+#define MEMB_STATS_INIT(name) , #name, 0, 0, 0, 0
+#else /* MEMB_STATS */
+#define MEMB_STATS_INIT(name)
+#endif /* MEMB_STATS */
+
+#if MEMB_FREELIST || MEMB_STATS
+#define MEMB_USED_INIT , 0
+#else /* MEMB_FREELIST || MEMB_STATS */
+#define MEMB_USED_INIT
+#endif /* MEMB_FREELIST || MEMB_STATS */
+
+#if MEMB_FREELIST
+#define MEMB_FREE_INIT , 0
+#else /* MEMB_FREELIST */
+#define MEMB_FREE_INIT
+#endif /* MEMB_FREELIST */
+
 /**
  * Declare a memory block.
  *
@@ -91,13 +133,29 @@ MEMB(connections, struct connection, 16);
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_count), \
-                                          (void *)CC_CONCAT(name,_memb_mem)}
+                                          (void *)CC_CONCAT(name,_memb_mem) \
+                                          MEMB_STATS_INIT(name) \
+                                          MEMB_USED_INIT \
+                                          MEMB_FREE_INIT}
 
 struct memb {
   unsigned short size;
   unsigned short num;
   char *count;
   void *mem;
+#if MEMB_STATS
+  const char *name;
+  struct memb *next;
+  unsigned short max_used;   /**< Most chunks in use at a time */
+  unsigned short failed;     /**< Allocations that found no free chunk */
+  unsigned char registered;
+#endif /* MEMB_STATS */
+#if MEMB_FREELIST || MEMB_STATS
+  unsigned short used;       /**< Chunks in use */
+#endif /* MEMB_FREELIST || MEMB_STATS */
+#if MEMB_FREELIST
+  unsigned short free;       /**< First free chunk, or num if none */
+#endif /* MEMB_FREELIST */
 };
 
 /**
@@ -132,6 +190,14 @@ int memb_inmemb(struct memb *m, void *ptr);
 
 int  memb_numfree(struct memb *m);
 
+#if MEMB_STATS
+/**
+ * Get the first registered memory block. The others follow through
+ * the next field.
+ */
+struct memb *memb_pools(void);
+#endif /* MEMB_STATS */
+
 /** @} */
 /** @} */
 
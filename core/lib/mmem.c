@@ -57,7 +57,134 @@
 
 LIST(mmemlist);
 unsigned int avail_memory;
+
+#if MMEM_DEFERRED_COMPACTION
+#include "sys/process.h"
+
+#ifdef MMEM_CONF_SIZE_CLASSES
+#define MMEM_SIZE_CLASSES MMEM_CONF_SIZE_CLASSES
+#else
+#define MMEM_SIZE_CLASSES 6
+#endif
+
+#ifdef MMEM_CONF_COMPACT_BUDGET
+#define MMEM_COMPACT_BUDGET MMEM_CONF_COMPACT_BUDGET
+#else
+#define MMEM_COMPACT_BUDGET 256
+#endif
+
+/* A hole is a free area between two blocks. Holes that are large
+   enough to hold a struct hole are kept in the free list of their
+   size class; smaller ones are only recovered when a neighbouring
+   block is freed or when the memory is compacted. The list of blocks
+   is kept ordered by address, so the holes around a block are found
+   from its neighbours in that list. */
+struct hole {
+  struct hole *next;
+  struct hole *prev;
+  unsigned int size;
+};
+
+#define HOLE_MIN    sizeof(struct hole)
+#define ALIGN(size) (((size) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+#define EXTENT(m)   ALIGN((m)->size)
+#define END(m)      ((char *)(m)->ptr + EXTENT(m))
+
+static void *memory_words[(MMEM_SIZE + sizeof(void *) - 1) / sizeof(void *)];
+#define memory ((char *)memory_words)
+
+static struct hole *holes[MMEM_SIZE_CLASSES];
+/* End of the last block. */
+static char *top;
+static unsigned long moved;
+static unsigned int compactions;
+
+#if MMEM_COMPACT_BUDGET > 0
+PROCESS(mmem_compact_process, "Managed memory compaction");
+#endif
+/*---------------------------------------------------------------------------*/
+static int
+size_class(unsigned int size)
+{
+  int c;
+
+  size /= HOLE_MIN;
+  for(c = 0; size > 1 && c < MMEM_SIZE_CLASSES - 1; c++) {
+    size >>= 1;
+  }
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hole_add(char *start, unsigned int size)
+{
+  struct hole *h;
+  int c;
+
+  if(size < HOLE_MIN) {
+    return;
+  }
+  h = (struct hole *)start;
+  c = size_class(size);
+  h->size = size;
+  h->prev = NULL;
+  h->next = holes[c];
+  if(h->next != NULL) {
+    h->next->prev = h;
+  }
+  holes[c] = h;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hole_remove(char *start, unsigned int size)
+{
+  struct hole *h;
+
+  if(size < HOLE_MIN) {
+    return;
+  }
+  h = (struct hole *)start;
+  if(h->prev != NULL) {
+    h->prev->next = h->next;
+  } else {
+    holes[size_class(size)] = h->next;
+  }
+  if(h->next != NULL) {
+    h->next->prev = h->prev;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct hole *
+hole_find(unsigned int size)
+{
+  struct hole *h;
+  int c;
+
+  /* Only the first hole of a larger class needs to be looked at,
+     except in the last class, which has no upper bound. */
+  for(c = size_class(size); c < MMEM_SIZE_CLASSES; c++) {
+    for(h = holes[c]; h != NULL; h = h->next) {
+      if(h->size >= size) {
+        return h;
+      }
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+schedule_compaction(void)
+{
+#if MMEM_COMPACT_BUDGET > 0
+  if(!process_is_running(&mmem_compact_process)) {
+    process_start(&mmem_compact_process, NULL);
+  }
+  process_poll(&mmem_compact_process);
+#endif
+}
+#else /* MMEM_DEFERRED_COMPACTION */
 static char memory[MMEM_SIZE];
+#endif /* MMEM_DEFERRED_COMPACTION */
 
 /*---------------------------------------------------------------------------*/
 /**
@@ -82,6 +209,46 @@ static char memory[MMEM_SIZE];
 int
 mmem_alloc(struct mmem *m, unsigned int size)
 {
+#if MMEM_DEFERRED_COMPACTION
+  struct mmem *n, *prev;
+  struct hole *h;
+  unsigned int extent, hole_size;
+
+  extent = ALIGN(size);
+  if(avail_memory < extent) {
+    return 0;
+  }
+
+  h = hole_find(extent);
+  if(h != NULL) {
+    /* Take the beginning of the hole and keep the rest as a hole. */
+    hole_size = h->size;
+    hole_remove((char *)h, hole_size);
+    hole_add((char *)h + extent, hole_size - extent);
+    m->ptr = h;
+
+    prev = NULL;
+    for(n = list_head(mmemlist);
+        n != NULL && (char *)n->ptr <= (char *)h;
+        n = list_item_next(n)) {
+      prev = n;
+    }
+    list_insert(mmemlist, prev, m);
+  } else {
+    if((unsigned int)(&memory[MMEM_SIZE] - top) < extent) {
+      /* The memory is free, but not in one piece. */
+      mmem_compact(~0U);
+      compactions++;
+    }
+    m->ptr = top;
+    top += extent;
+    list_add(mmemlist, m);
+  }
+
+  m->size = size;
+  avail_memory -= extent;
+  return 1;
+#else /* MMEM_DEFERRED_COMPACTION */
   /* Check if we have enough memory left for this allocation. */
   if(avail_memory < size) {
     return 0;
@@ -104,6 +271,7 @@ mmem_alloc(struct mmem *m, unsigned int size)
   /* Return non-zero to indicate that we were able to allocate
      memory. */
   return 1;
+#endif /* MMEM_DEFERRED_COMPACTION */
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -119,7 +287,33 @@ void
 mmem_free(struct mmem *m)
 {
   struct mmem *n;
+#if MMEM_DEFERRED_COMPACTION
+  struct mmem *prev;
+  char *start, *end;
 
+  prev = NULL;
+  for(n = list_head(mmemlist); n != NULL && n != m; n = list_item_next(n)) {
+    prev = n;
+  }
+  if(n == NULL) {
+    return;
+  }
+
+  /* Merge the block with the holes before and after it. */
+  start = prev != NULL ? END(prev) : memory;
+  end = m->next != NULL ? (char *)m->next->ptr : top;
+  hole_remove(start, (char *)m->ptr - start);
+  if(m->next != NULL) {
+    hole_remove(END(m), end - END(m));
+    hole_add(start, end - start);
+    schedule_compaction();
+  } else {
+    top = start;
+  }
+
+  avail_memory += EXTENT(m);
+  list_remove(mmemlist, m);
+#else /* MMEM_DEFERRED_COMPACTION */
   if(m->next != NULL) {
     /* Compact the memory after the allocation that is to be removed
        by moving it downwards. */
@@ -137,6 +331,7 @@ mmem_free(struct mmem *m)
 
   /* Remove the memory block from the list. */
   list_remove(mmemlist, m);
+#endif /* MMEM_DEFERRED_COMPACTION */
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -157,8 +352,92 @@ mmem_init(void)
   }
   list_init(mmemlist);
   avail_memory = MMEM_SIZE;
+#if MMEM_DEFERRED_COMPACTION
+  top = memory;
+#endif
   inited = 1;
 }
 /*---------------------------------------------------------------------------*/
+#if MMEM_DEFERRED_COMPACTION
+int
+mmem_compact(unsigned int budget)
+{
+  struct mmem *n;
+  char *start, *end;
+  unsigned int gap, extent, done;
+
+  done = 0;
+  start = memory;
+  for(n = list_head(mmemlist); n != NULL; n = list_item_next(n)) {
+    gap = (char *)n->ptr - start;
+    if(gap > 0) {
+      if(done >= budget) {
+        return 1;
+      }
+      /* Move the block to the beginning of the hole before it, which
+         then merges with the hole after it. */
+      extent = EXTENT(n);
+      end = n->next != NULL ? (char *)n->next->ptr : top;
+      hole_remove(start, gap);
+      hole_remove(END(n), end - END(n));
+      memmove(start, n->ptr, extent);
+      n->ptr = start;
+      if(n->next != NULL) {
+        hole_add(END(n), end - END(n));
+      } else {
+        top = END(n);
+      }
+      done += extent;
+      moved += extent;
+    }
+    start = END(n);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+mmem_get_stats(struct mmem_stats *stats)
+{
+  struct mmem *n;
+  char *start;
+  unsigned int gap;
+
+  stats->free = avail_memory;
+  stats->largest = &memory[MMEM_SIZE] - top;
+  stats->holes = 0;
+  start = memory;
+  for(n = list_head(mmemlist); n != NULL; n = list_item_next(n)) {
+    gap = (char *)n->ptr - start;
+    if(gap > 0) {
+      stats->holes++;
+      if(gap > stats->largest) {
+        stats->largest = gap;
+      }
+    }
+    start = END(n);
+  }
+  stats->moved = moved;
+  stats->compactions = compactions;
+}
+/*---------------------------------------------------------------------------*/
+#if MMEM_COMPACT_BUDGET > 0
+PROCESS_THREAD(mmem_compact_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+    /* Compact only while no other events are waiting, a few blocks at
+       a time, until no holes remain. */
+    if(process_nevents() > 0 || mmem_compact(MMEM_COMPACT_BUDGET)) {
+      process_poll(&mmem_compact_process);
+    }
+  }
+
+  PROCESS_END();
+}
+#endif /* MMEM_COMPACT_BUDGET > 0 */
+/*---------------------------------------------------------------------------*/
+#endif /* MMEM_DEFERRED_COMPACTION */
 
 /** @} */
@@ -44,6 +44,17 @@
  * stays in place. Therefore, a level of indirection is used: access
  * to allocated memory must always be done using a special macro.
  *
+ * With MMEM_CONF_DEFERRED_COMPACTION set, mmem_free() does not
+ * compact the memory. The freed block is left as a hole that is kept
+ * in one of MMEM_SIZE_CLASSES free lists, ordered by size, and reused
+ * by later allocations. The holes are removed by a process that moves
+ * at most MMEM_COMPACT_BUDGET bytes each time it runs, and only runs
+ * when no other events are pending. If an allocation does not fit in
+ * any hole or above the last block, the memory is compacted at once,
+ * so an allocation still succeeds whenever enough memory is free.
+ * Note that in this mode, blocks may move whenever the calling process
+ * yields, not only when mmem_free() is called.
+ *
  * \note This module has not been heavily tested.
  * @{
  */
@@ -59,6 +70,8 @@
 #ifndef MMEM_H_
 #define MMEM_H_
 
+#include "contiki-conf.h"
+
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Get a pointer to the managed memory
@@ -87,6 +100,37 @@ int  mmem_alloc(struct mmem *m, unsigned int size);
 void mmem_free(struct mmem *);
 void mmem_init(void);
 
+#ifdef MMEM_CONF_DEFERRED_COMPACTION
+#define MMEM_DEFERRED_COMPACTION MMEM_CONF_DEFERRED_COMPACTION
+#else
+#define MMEM_DEFERRED_COMPACTION 0
+#endif
+
+#if MMEM_DEFERRED_COMPACTION
+/** Fragmentation statistics, see mmem_get_stats() */
+struct mmem_stats {
+  unsigned int free;        /**< Free bytes in total */
+  unsigned int largest;     /**< Largest contiguous free area */
+  unsigned int holes;       /**< Free areas below the last block */
+  unsigned long moved;      /**< Bytes moved by compaction so far */
+  unsigned int compactions; /**< Allocations that compacted all memory */
+};
+
+/**
+ * \brief      Move blocks down to remove holes
+ * \param budget Stop after this many bytes have been moved
+ * \return     Non-zero if holes remain
+ *
+ *             Blocks are moved whole, so the budget may be exceeded
+ *             by up to one block. Called by the compaction process;
+ *             it may also be called from the idle loop of a platform.
+ */
+int  mmem_compact(unsigned int budget);
+
+/** \brief Get the fragmentation statistics of the managed memory */
+void mmem_get_stats(struct mmem_stats *stats);
+#endif /* MMEM_DEFERRED_COMPACTION */
+
 #endif /* MMEM_H_ */
 
 /** @} */
@@ -75,7 +75,7 @@ acked(struct tcp_socket *s)
        outputbuf_lastsent */
 
     if(s->output_data_send_nxt > 0) {
-      memcpy(&s->output_data_ptr[0],
+      memmove(&s->output_data_ptr[0],
              &s->output_data_ptr[s->output_data_send_nxt],
              s->output_data_maxlen - s->output_data_send_nxt);
     }
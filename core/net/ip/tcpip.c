@@ -72,6 +72,10 @@ extern struct uip_fallback_interface UIP_FALLBACK_INTERFACE;
 #include "rpl/rpl.h"
 #endif
 
+#if UIP_TCP_WINDOW
+#include "net/ipv6/uip-tcp-window.h"
+#endif /* UIP_TCP_WINDOW */
+
 process_event_t tcpip_event;
 #if UIP_CONF_ICMP6
 process_event_t tcpip_icmp6_event;
@@ -182,6 +186,19 @@ check_for_tcp_syn(void)
 #endif /* UIP_TCP || UIP_CONF_IP_FORWARD */
 }
 /*---------------------------------------------------------------------------*/
+#if UIP_TCP_WINDOW
+static void
+tcp_window_poll(void)
+{
+  /* Poll the application again at once while it is waiting to send
+     and there is room in the window, so that the window is filled
+     with back to back segments rather than one per timer pulse. */
+  if(uip_conn != NULL && uip_tcp_window_wants_poll(uip_conn)) {
+    tcpip_poll_tcp(uip_conn);
+  }
+}
+#endif /* UIP_TCP_WINDOW */
+/*---------------------------------------------------------------------------*/
 static void
 packet_input(void)
 {
@@ -210,6 +227,9 @@ packet_input(void)
 #endif /* NETSTACK_CONF_WITH_IPV6 */
 #endif /* UIP_CONF_TCP_SPLIT */
     }
+#if UIP_TCP_WINDOW
+    tcp_window_poll();
+#endif /* UIP_TCP_WINDOW */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -424,6 +444,9 @@ eventhandler(process_event_t ev, process_data_t data)
           uip_periodic(i);
 #if NETSTACK_CONF_WITH_IPV6
           tcpip_ipv6_output();
+#if UIP_TCP_WINDOW
+          tcp_window_poll();
+#endif /* UIP_TCP_WINDOW */
 #else
           if(uip_len > 0) {
             PRINTF("tcpip_output from periodic len %d\n", uip_len);
@@ -481,6 +504,9 @@ eventhandler(process_event_t ev, process_data_t data)
       uip_poll_conn(data);
 #if NETSTACK_CONF_WITH_IPV6
       tcpip_ipv6_output();
+#if UIP_TCP_WINDOW
+      tcp_window_poll();
+#endif /* UIP_TCP_WINDOW */
 #else /* NETSTACK_CONF_WITH_IPV6 */
       if(uip_len > 0) {
         PRINTF("tcpip_output from tcp poll len %d\n", uip_len);
@@ -526,6 +552,9 @@ tcpip_ipv6_output(void)
 {
   uip_ds6_nbr_t *nbr = NULL;
   uip_ipaddr_t *nexthop;
+#if UIP_CONF_IPV6_RPL
+  uip_ipaddr_t srh_nexthop;
+#endif /* UIP_CONF_IPV6_RPL */
 
   if(uip_len == 0) {
     return;
@@ -544,6 +573,15 @@ tcpip_ipv6_output(void)
   }
 
   if(!uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+#if UIP_CONF_IPV6_RPL
+    /* The root of a non-storing RPL DODAG adds a source route to
+       packets for nodes in the DODAG. */
+    if(rpl_insert_srh_header()) {
+      uip_clear_buf();
+      return;
+    }
+#endif /* UIP_CONF_IPV6_RPL */
+
     /* Next hop determination */
     nbr = NULL;
 
@@ -552,6 +590,12 @@ tcpip_ipv6_output(void)
        nexthop address. */
     if(uip_ds6_is_addr_onlink(&UIP_IP_BUF->destipaddr)){
       nexthop = &UIP_IP_BUF->destipaddr;
+#if UIP_CONF_IPV6_RPL
+    } else if(rpl_srh_get_next_hop(&srh_nexthop)) {
+      /* A source routed packet goes to the neighbor that is its
+         current destination. */
+      nexthop = &srh_nexthop;
+#endif /* UIP_CONF_IPV6_RPL */
     } else {
       uip_ds6_route_t *route;
       /* Check if we have a route to the destination address. */
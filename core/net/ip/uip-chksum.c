@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Word-at-a-time computation of the Internet checksum.
+ *
+ *         The buffer is summed 32 bits at a time in the native byte
+ *         order into a 64-bit accumulator, which is folded to 16 bits
+ *         at the end. The one's complement sum is independent of byte
+ *         order apart from a final byte swap (RFC 1071, section 2), so
+ *         the result is identical to the byte pair loop in uip6.c.
+ */
+
+#include "net/ip/uip.h"
+#include "net/ip/uip_arch.h"
+
+#include <string.h>
+
+#if UIP_WORD_CHKSUM
+/*---------------------------------------------------------------------------*/
+static uint32_t
+load32(const uint8_t *p)
+{
+  uint32_t w;
+
+  /* Compiles to a single load on CPUs with unaligned access. */
+  memcpy(&w, p, sizeof(w));
+  return w;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum_add(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint64_t acc;
+  uint16_t w;
+
+  acc = 0;
+  while(len >= 16) {
+    acc += load32(data);
+    acc += load32(data + 4);
+    acc += load32(data + 8);
+    acc += load32(data + 12);
+    data += 16;
+    len -= 16;
+  }
+  while(len >= 4) {
+    acc += load32(data);
+    data += 4;
+    len -= 4;
+  }
+  if(len >= 2) {
+    memcpy(&w, data, sizeof(w));
+    acc += w;
+    data += 2;
+    len -= 2;
+  }
+
+  /* Fold the accumulator into a 16-bit one's complement sum. */
+  acc = (acc & 0xffffffff) + (acc >> 32);
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+
+#if UIP_BYTE_ORDER == UIP_LITTLE_ENDIAN
+  acc = ((acc & 0xff) << 8) | (acc >> 8);
+#endif
+
+  /* A trailing odd byte is the high byte of a zero-padded word. */
+  if(len == 1) {
+    acc += (uint16_t)data[0] << 8;
+  }
+
+  acc += sum;
+  acc = (acc & 0xffff) + (acc >> 16);
+  acc = (acc & 0xffff) + (acc >> 16);
+
+  /* Return sum in host byte order. */
+  return (uint16_t)acc;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_WORD_CHKSUM */
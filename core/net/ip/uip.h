@@ -1370,6 +1370,14 @@ struct uip_conn {
   uint8_t timer;         /**< The retransmission timer. */
   uint8_t nrtx;          /**< The number of retransmissions for the last
                               segment sent. */
+#if UIP_TCP_WINDOW
+  struct uip_tcp_seg *rtxq; /**< Unacknowledged segments, oldest first. */
+  uint16_t snd_wnd;      /**< Window last advertised by the remote host. */
+  uint8_t nseg;          /**< Number of segments in the rtxq. */
+  uint8_t cwnd;          /**< Congestion window, in segments. */
+  uint8_t dupacks;       /**< Duplicate ACKs received for the oldest segment. */
+  uint8_t wflags;        /**< Sliding window state flags. */
+#endif /* UIP_TCP_WINDOW */
 
   uip_tcp_appstate_t appstate; /** The application state. */
 };
@@ -103,6 +103,23 @@ void uip_add32(uint8_t *op32, uint16_t op16);
  */
 uint16_t uip_chksum(uint16_t *data, uint16_t len);
 
+/**
+ * Add a buffer to a partial Internet checksum.
+ *
+ * This is the word-at-a-time implementation used by uIP when
+ * UIP_WORD_CHKSUM is set.
+ *
+ * \param sum The partial one's complement sum, in host byte order.
+ *
+ * \param data A pointer to the buffer. It does not need to be aligned.
+ *
+ * \param len The length of the buffer.
+ *
+ * \return The one's complement sum of sum and the 16-bit words of the
+ * buffer, in host byte order.
+ */
+uint16_t uip_chksum_add(uint16_t sum, const uint8_t *data, uint16_t len);
+
 /**
  * Calculate the IP header checksum of the packet header in uip_buf.
  *
@@ -511,6 +511,40 @@ void uip_log(char *msg);
 #define UIP_TIME_WAIT_TIMEOUT UIP_CONF_WAIT_TIMEOUT
 #endif
 
+/**
+ * The maximum number of unacknowledged segments a TCP connection may
+ * have in flight.
+ *
+ * By default, uIP only allows a single unacknowledged segment per
+ * connection, which bounds throughput by the round-trip time. Setting
+ * this to a value above zero enables the sliding window mode (IPv6
+ * only): outgoing segments are copied into a retransmit buffer so that
+ * several can be in flight, lost segments are retransmitted by the
+ * stack rather than by the application, and duplicate ACKs trigger a
+ * fast retransmit.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_WINDOW_SEGMENTS
+#define UIP_TCP_WINDOW_SEGMENTS (UIP_CONF_TCP_WINDOW_SEGMENTS)
+#else
+#define UIP_TCP_WINDOW_SEGMENTS 0
+#endif
+
+#define UIP_TCP_WINDOW (UIP_TCP && UIP_TCP_WINDOW_SEGMENTS > 0)
+
+/**
+ * The number of UIP_TCP_MSS sized retransmit buffers shared by all
+ * TCP connections in the sliding window mode.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_WINDOW_BUFFERS
+#define UIP_TCP_WINDOW_BUFFERS (UIP_CONF_TCP_WINDOW_BUFFERS)
+#else
+#define UIP_TCP_WINDOW_BUFFERS (UIP_TCP_WINDOW_SEGMENTS * 2)
+#endif
+
 /** @} */
 /*------------------------------------------------------------------------------*/
 /**
@@ -619,6 +653,21 @@ void uip_log(char *msg);
 #define UIP_BYTE_ORDER     (UIP_LITTLE_ENDIAN)
 #endif /* UIP_CONF_BYTE_ORDER */
 
+/**
+ * Compute the Internet checksum 32 bits at a time with a 64-bit
+ * accumulator, instead of one 16-bit word at a time.
+ *
+ * This is faster on 32- and 64-bit CPUs, but generates larger and
+ * slower code on 8- and 16-bit CPUs.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_WORD_CHKSUM
+#define UIP_WORD_CHKSUM    (UIP_CONF_WORD_CHKSUM)
+#else /* UIP_CONF_WORD_CHKSUM */
+#define UIP_WORD_CHKSUM    0
+#endif /* UIP_CONF_WORD_CHKSUM */
+
 /** @} */
 /*------------------------------------------------------------------------------*/
 
@@ -46,14 +46,53 @@
 #define NUM_ENTRIES 32
 #endif /* IP64_ADDRMAP_CONF_ENTRIES */
 
+/* Number of buckets in each of the two hash indexes: the outbound
+   index, keyed on the IPv6 address/port, IPv4 address/port, and
+   protocol, and the inbound index, keyed on the mapped port. */
+#ifdef IP64_ADDRMAP_CONF_HASH_SIZE
+#define HASH_SIZE IP64_ADDRMAP_CONF_HASH_SIZE
+#else /* IP64_ADDRMAP_CONF_HASH_SIZE */
+#define HASH_SIZE (NUM_ENTRIES / 2 + 1)
+#endif /* IP64_ADDRMAP_CONF_HASH_SIZE */
+
+/* Mappings are aged by an expiry wheel of WHEEL_SLOTS slots, each
+   covering WHEEL_TICK clock ticks. A mapping whose lifetime is longer
+   than one revolution of the wheel is looked at once per revolution
+   until it expires. */
+#ifdef IP64_ADDRMAP_CONF_WHEEL_SLOTS
+#define WHEEL_SLOTS IP64_ADDRMAP_CONF_WHEEL_SLOTS
+#else /* IP64_ADDRMAP_CONF_WHEEL_SLOTS */
+#define WHEEL_SLOTS 32
+#endif /* IP64_ADDRMAP_CONF_WHEEL_SLOTS */
+
+#ifdef IP64_ADDRMAP_CONF_WHEEL_TICK
+#define WHEEL_TICK IP64_ADDRMAP_CONF_WHEEL_TICK
+#else /* IP64_ADDRMAP_CONF_WHEEL_TICK */
+#define WHEEL_TICK (CLOCK_SECOND * 2)
+#endif /* IP64_ADDRMAP_CONF_WHEEL_TICK */
+
+#if WHEEL_SLOTS < 1 || WHEEL_SLOTS > 254
+#error IP64_ADDRMAP_CONF_WHEEL_SLOTS must be between 1 and 254
+#endif
+
+#define NO_SLOT 255
+
 MEMB(entrymemb, struct ip64_addrmap_entry, NUM_ENTRIES);
 LIST(entrylist);
 
+static struct ip64_addrmap_entry *forward_index[HASH_SIZE];
+static struct ip64_addrmap_entry *reverse_index[HASH_SIZE];
+
+static struct ip64_addrmap_entry *wheel[WHEEL_SLOTS];
+static clock_time_t wheel_time;
+
+static struct ip64_addrmap_stats stats;
+
 #define FIRST_MAPPED_PORT 10000
 #define LAST_MAPPED_PORT  20000
 static uint16_t mapped_port = FIRST_MAPPED_PORT;
 
-#define printf(...)
+#define HASH_ADD(h, v) ((uint16_t)(((h) << 5) + (h) + (v)))
 
 /*---------------------------------------------------------------------------*/
 struct ip64_addrmap_entry *
@@ -62,29 +101,163 @@ ip64_addrmap_list(void)
   return list_head(entrylist);
 }
 /*---------------------------------------------------------------------------*/
+int
+ip64_addrmap_count(void)
+{
+  return list_length(entrylist);
+}
+/*---------------------------------------------------------------------------*/
+const struct ip64_addrmap_stats *
+ip64_addrmap_stats(void)
+{
+  return &stats;
+}
+/*---------------------------------------------------------------------------*/
 void
 ip64_addrmap_init(void)
 {
   memb_init(&entrymemb);
   list_init(entrylist);
+  memset(forward_index, 0, sizeof(forward_index));
+  memset(reverse_index, 0, sizeof(reverse_index));
+  memset(wheel, 0, sizeof(wheel));
+  memset(&stats, 0, sizeof(stats));
+  wheel_time = clock_time() / WHEEL_TICK;
   mapped_port = FIRST_MAPPED_PORT;
 }
 /*---------------------------------------------------------------------------*/
+static uint16_t
+forward_hash(const uip_ip6addr_t *ip6addr,
+             uint16_t ip6port,
+             const uip_ip4addr_t *ip4addr,
+             uint16_t ip4port,
+             uint8_t protocol)
+{
+  uint16_t h;
+  int i;
+
+  h = HASH_ADD(5381, protocol);
+  h = HASH_ADD(h, ip6port);
+  h = HASH_ADD(h, ip4port);
+  for(i = 0; i < 8; i++) {
+    h = HASH_ADD(h, ip6addr->u16[i]);
+  }
+  h = HASH_ADD(h, ip4addr->u16[0]);
+  h = HASH_ADD(h, ip4addr->u16[1]);
+  return h % HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+reverse_hash(uint16_t port)
+{
+  /* Only the port goes into the hash, so that all mappings that use a
+     given port end up in the same bucket regardless of protocol. */
+  return port % HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+wheel_insert(struct ip64_addrmap_entry *m)
+{
+  clock_time_t slots;
+
+  /* Place the entry in the slot where its timer expires, or in the
+     furthest slot if the timer expires after one full revolution. */
+  if(timer_expired(&m->timer)) {
+    slots = 1;
+  } else {
+    slots = timer_remaining(&m->timer) / WHEEL_TICK + 1;
+    if(slots > WHEEL_SLOTS) {
+      slots = WHEEL_SLOTS;
+    }
+  }
+  m->wheel_slot = (wheel_time + slots) % WHEEL_SLOTS;
+  m->wheel_next = wheel[m->wheel_slot];
+  wheel[m->wheel_slot] = m;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_entry(struct ip64_addrmap_entry *m)
+{
+  struct ip64_addrmap_entry **p;
+
+  for(p = &forward_index[forward_hash(&m->ip6addr, m->ip6port,
+                                      &m->ip4addr, m->ip4port,
+                                      m->protocol)];
+      *p != NULL; p = &(*p)->forward_next) {
+    if(*p == m) {
+      *p = m->forward_next;
+      break;
+    }
+  }
+
+  for(p = &reverse_index[reverse_hash(m->mapped_port)];
+      *p != NULL; p = &(*p)->reverse_next) {
+    if(*p == m) {
+      *p = m->reverse_next;
+      break;
+    }
+  }
+
+  if(m->wheel_slot != NO_SLOT) {
+    for(p = &wheel[m->wheel_slot]; *p != NULL; p = &(*p)->wheel_next) {
+      if(*p == m) {
+        *p = m->wheel_next;
+        break;
+      }
+    }
+  }
+
+  list_remove(entrylist, m);
+  memb_free(&entrymemb, m);
+}
+/*---------------------------------------------------------------------------*/
 static void
 check_age(void)
 {
-  struct ip64_addrmap_entry *m;
+  struct ip64_addrmap_entry *m, *next;
+  clock_time_t now;
+  uint8_t slot;
+
+  /* Advance the expiry wheel up to the current time, and look only at
+     the mappings in the slots that we pass. Mappings that have had
+     their lifetime extended since they were put in the wheel are
+     moved to a later slot; the others are thrown away. */
+  now = clock_time() / WHEEL_TICK;
+  if(now - wheel_time > WHEEL_SLOTS) {
+    wheel_time = now - WHEEL_SLOTS;
+  }
+  while(wheel_time != now) {
+    wheel_time++;
+    slot = wheel_time % WHEEL_SLOTS;
+    m = wheel[slot];
+    wheel[slot] = NULL;
+    while(m != NULL) {
+      next = m->wheel_next;
+      m->wheel_slot = NO_SLOT;
+      if(timer_expired(&m->timer)) {
+        remove_entry(m);
+        stats.expired++;
+      } else {
+        wheel_insert(m);
+      }
+      m = next;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_age_all(void)
+{
+  struct ip64_addrmap_entry *m, *next;
 
   /* Walk through the list of address mappings, throw away the ones
-     that are too old. */
-  m = list_head(entrylist);
-  while(m != NULL) {
+     that are too old. This catches mappings whose lifetime has been
+     shortened after they were put in the expiry wheel. */
+  for(m = list_head(entrylist); m != NULL; m = next) {
+    next = list_item_next(m);
     if(timer_expired(&m->timer)) {
-      list_remove(entrylist, m);
-      memb_free(&entrymemb, m);
-      m = list_head(entrylist);
-    } else {
-      m = list_item_next(m);
+      remove_entry(m);
+      stats.expired++;
     }
   }
 }
@@ -95,9 +268,6 @@ recycle(void)
   /* Find the oldest recyclable mapping and remove it. */
   struct ip64_addrmap_entry *m, *oldest;
 
-  /* Walk through the list of address mappings, throw away the ones
-     that are too old. */
-
   oldest = NULL;
   for(m = list_head(entrylist);
       m != NULL;
@@ -117,8 +287,8 @@ recycle(void)
   /* If we found an oldest recyclable entry, remove it and return
      non-zero. */
   if(oldest != NULL) {
-    list_remove(entrylist, oldest);
-    memb_free(&entrymemb, oldest);
+    remove_entry(oldest);
+    stats.recycled++;
     return 1;
   }
 
@@ -134,25 +304,28 @@ ip64_addrmap_lookup(const uip_ip6addr_t *ip6addr,
 {
   struct ip64_addrmap_entry *m;
 
-  printf("lookup ip4port %d ip6port %d\n", uip_htons(ip4port),
-	 uip_htons(ip6port));
   check_age();
-  for(m = list_head(entrylist); m != NULL; m = list_item_next(m)) {
-    printf("protocol %d %d, ip4port %d %d, ip6port %d %d, ip4 %d ip6 %d\n",
-	   m->protocol, protocol,
-	   m->ip4port, ip4port,
-	   m->ip6port, ip6port,
-	   uip_ip4addr_cmp(&m->ip4addr, ip4addr),
-	   uip_ip6addr_cmp(&m->ip6addr, ip6addr));
+  stats.lookups++;
+  for(m = forward_index[forward_hash(ip6addr, ip6port,
+                                     ip4addr, ip4port, protocol)];
+      m != NULL; m = m->forward_next) {
     if(m->protocol == protocol &&
        m->ip4port == ip4port &&
        m->ip6port == ip6port &&
        uip_ip4addr_cmp(&m->ip4addr, ip4addr) &&
        uip_ip6addr_cmp(&m->ip6addr, ip6addr)) {
+      /* The mapping may have timed out without the expiry wheel
+         having reached it yet. */
+      if(timer_expired(&m->timer)) {
+        remove_entry(m);
+        stats.expired++;
+        break;
+      }
       m->ip6to4++;
       return m;
     }
   }
+  stats.lookup_misses++;
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -162,19 +335,37 @@ ip64_addrmap_lookup_port(uint16_t mapped_port, uint8_t protocol)
   struct ip64_addrmap_entry *m;
 
   check_age();
-  for(m = list_head(entrylist); m != NULL; m = list_item_next(m)) {
-    printf("mapped port %d %d, protocol %d %d\n",
-	   m->mapped_port, mapped_port,
-	   m->protocol, protocol);
+  stats.port_lookups++;
+  for(m = reverse_index[reverse_hash(mapped_port)];
+      m != NULL; m = m->reverse_next) {
     if(m->mapped_port == mapped_port &&
        m->protocol == protocol) {
+      if(timer_expired(&m->timer)) {
+        remove_entry(m);
+        stats.expired++;
+        break;
+      }
       m->ip4to6++;
       return m;
     }
   }
+  stats.port_misses++;
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+static int
+mapped_port_in_use(uint16_t port)
+{
+  struct ip64_addrmap_entry *m;
+
+  for(m = reverse_index[reverse_hash(port)]; m != NULL; m = m->reverse_next) {
+    if(m->mapped_port == port) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 static void
 increase_mapped_port(void)
 {
@@ -190,12 +381,20 @@ ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
 		    uint8_t protocol)
 {
   struct ip64_addrmap_entry *m;
+  uint16_t h;
 
   check_age();
   m = memb_alloc(&entrymemb);
   if(m == NULL) {
-    /* We could not allocate an entry, try to recycle one and try to
-       allocate again. */
+    /* We could not allocate an entry. Throw away any mappings that
+       have timed out but that the expiry wheel has not yet seen, and
+       try again. */
+    check_age_all();
+    m = memb_alloc(&entrymemb);
+  }
+  if(m == NULL) {
+    /* Still no free entry, try to recycle one and try to allocate
+       again. */
     if(recycle()) {
       m = memb_alloc(&entrymemb);
     }
@@ -214,24 +413,25 @@ ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
     /* Pick a new, unused local port. First make sure that the
        mapped_port number does not belong to any active connection. If
        so, we keep increasing the mapped_port until we're free. */
-    {
-      struct ip64_addrmap_entry *n;
-      n = list_head(entrylist);
-      while(n != NULL) {
-	if(n->mapped_port == mapped_port) {
-	  increase_mapped_port();
-	  n = list_head(entrylist);
-	} else {
-	  n = list_item_next(m);
-	}
-      }
+    while(mapped_port_in_use(mapped_port)) {
+      increase_mapped_port();
     }
     m->mapped_port = mapped_port;
     increase_mapped_port();
 
+    h = forward_hash(ip6addr, ip6port, ip4addr, ip4port, protocol);
+    m->forward_next = forward_index[h];
+    forward_index[h] = m;
+    h = reverse_hash(m->mapped_port);
+    m->reverse_next = reverse_index[h];
+    reverse_index[h] = m;
+    wheel_insert(m);
+
     list_add(entrylist, m);
+    stats.created++;
     return m;
   }
+  stats.create_failures++;
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -240,6 +440,8 @@ ip64_addrmap_set_lifetime(struct ip64_addrmap_entry *e,
                           clock_time_t time)
 {
   if(e != NULL) {
+    /* The entry stays in its current slot in the expiry wheel and is
+       moved when the wheel reaches it. */
     timer_set(&e->timer, time);
   }
 }
@@ -38,20 +38,40 @@
 
 struct ip64_addrmap_entry {
   struct ip64_addrmap_entry *next;
+  struct ip64_addrmap_entry *forward_next; /* Chain in the 6-tuple index. */
+  struct ip64_addrmap_entry *reverse_next; /* Chain in the mapped-port index. */
+  struct ip64_addrmap_entry *wheel_next;   /* Chain in the expiry wheel. */
   struct timer timer;
   uip_ip6addr_t ip6addr;
   uip_ip4addr_t ip4addr;
+  /* Number of packets translated from IPv6 to IPv4 and from IPv4 to
+     IPv6 over this mapping. */
   uint32_t ip6to4, ip4to6;
   uint16_t mapped_port;
   uint16_t ip6port;
   uint16_t ip4port;
   uint8_t protocol;
   uint8_t flags;
+  uint8_t wheel_slot;
 };
 
 #define FLAGS_NONE       0
 #define FLAGS_RECYCLABLE 1
 
+/**
+ * Counters kept by the address mapping module, for monitoring.
+ */
+struct ip64_addrmap_stats {
+  unsigned long lookups;         /* Outbound (6-tuple) lookups. */
+  unsigned long lookup_misses;   /* Outbound lookups that found nothing. */
+  unsigned long port_lookups;    /* Inbound (mapped port) lookups. */
+  unsigned long port_misses;     /* Inbound lookups that found nothing. */
+  unsigned long created;         /* Mappings created. */
+  unsigned long expired;         /* Mappings removed because they timed out. */
+  unsigned long recycled;        /* Mappings removed to make room. */
+  unsigned long create_failures; /* Mappings that could not be created. */
+};
+
 /**
  * Initialize the ip64_addrmap module.
  */
@@ -100,4 +120,14 @@ void ip64_addrmap_set_recycleble(struct ip64_addrmap_entry *e);
  * Obtain the list of all address mappings.
  */
 struct ip64_addrmap_entry *ip64_addrmap_list(void);
+
+/**
+ * Obtain the number of active address mappings.
+ */
+int ip64_addrmap_count(void);
+
+/**
+ * Obtain the counters of the address mapping module.
+ */
+const struct ip64_addrmap_stats *ip64_addrmap_stats(void);
 #endif /* IP64_ADDRMAP_H */
@@ -250,6 +250,323 @@ static uint16_t my_tag;
 /* Assuming that the worst growth for uncompression is 38 bytes */
 #define SICSLOWPAN_FIRST_FRAGMENT_SIZE (SICSLOWPAN_FRAGMENT_SIZE + 38)
 
+/* FRAG_POOL selects the pooled reassembly engine: datagrams are
+ * described by REASS_CONTEXTS small descriptors that all draw blocks
+ * from one shared pool, and every fragment is copied once, straight to
+ * its final offset within its datagram. */
+#ifdef SICSLOWPAN_CONF_FRAG_POOL
+#define SICSLOWPAN_FRAG_POOL SICSLOWPAN_CONF_FRAG_POOL
+#else
+#define SICSLOWPAN_FRAG_POOL 0
+#endif
+
+#if SICSLOWPAN_FRAG_POOL
+/* The size of each pool block, a multiple of the 8 byte fragment unit */
+#ifdef SICSLOWPAN_CONF_FRAG_POOL_BLOCK_SIZE
+#define SICSLOWPAN_FRAG_POOL_BLOCK_SIZE SICSLOWPAN_CONF_FRAG_POOL_BLOCK_SIZE
+#else
+#define SICSLOWPAN_FRAG_POOL_BLOCK_SIZE 64
+#endif
+
+/* The number of pool blocks; by default about the same amount of RAM
+ * as the fragment buffers and contexts of the non-pooled engine */
+#ifdef SICSLOWPAN_CONF_FRAG_POOL_BLOCKS
+#define SICSLOWPAN_FRAG_POOL_BLOCKS SICSLOWPAN_CONF_FRAG_POOL_BLOCKS
+#else
+#define SICSLOWPAN_FRAG_POOL_BLOCKS                                     \
+  ((SICSLOWPAN_FRAGMENT_BUFFERS * SICSLOWPAN_FRAGMENT_SIZE +            \
+    SICSLOWPAN_REASS_CONTEXTS * SICSLOWPAN_FIRST_FRAGMENT_SIZE) /       \
+   SICSLOWPAN_FRAG_POOL_BLOCK_SIZE)
+#endif
+
+#if SICSLOWPAN_FRAG_POOL_BLOCK_SIZE % 8 != 0
+#error SICSLOWPAN_CONF_FRAG_POOL_BLOCK_SIZE must be a multiple of 8
+#endif
+#if SICSLOWPAN_FRAG_POOL_BLOCKS >= 255
+#error SICSLOWPAN_CONF_FRAG_POOL_BLOCKS must be less than 255
+#endif
+
+/* The largest datagram that fits in uip_buf, and what it takes to
+   describe one */
+#define REASS_MAX_LEN    (UIP_BUFSIZE - UIP_LLH_LEN)
+#define REASS_BLOCKS     ((REASS_MAX_LEN + SICSLOWPAN_FRAG_POOL_BLOCK_SIZE - 1) / \
+                          SICSLOWPAN_FRAG_POOL_BLOCK_SIZE)
+#define REASS_UNITS      ((REASS_MAX_LEN + 7) / 8)
+#define REASS_NO_BLOCK   0xff
+
+/* A descriptor stays allocated, without pool blocks, once its datagram
+   is delivered so that late duplicates of it can be recognized */
+#define REASS_ACTIVE(r)  ((r)->len > 0 && (r)->received < (r)->len)
+
+/* A datagram being reassembled */
+struct sicslowpan_reass {
+  /** The link-layer source of the fragments */
+  linkaddr_t sender;
+  /** The datagram tag of the fragments */
+  uint16_t tag;
+  /** The datagram size (if zero this descriptor is not allocated) */
+  uint16_t len;
+  /** The number of datagram bytes received so far */
+  uint16_t received;
+  /** Reassembly %process %timer. */
+  struct timer reass_timer;
+  /** Pool block holding each block-sized piece of the datagram */
+  uint8_t block[REASS_BLOCKS];
+  /** Bitmap of the 8 byte units received so far */
+  uint8_t units[(REASS_UNITS + 7) / 8];
+};
+
+static struct sicslowpan_reass reass[SICSLOWPAN_REASS_CONTEXTS];
+
+static uint8_t pool[SICSLOWPAN_FRAG_POOL_BLOCKS][SICSLOWPAN_FRAG_POOL_BLOCK_SIZE];
+/* Stack of the free pool blocks */
+static uint8_t pool_free[SICSLOWPAN_FRAG_POOL_BLOCKS];
+static uint8_t pool_free_count;
+
+static struct sicslowpan_reass_stats reass_stats;
+
+/*---------------------------------------------------------------------------*/
+static void
+reass_init(void)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_FRAG_POOL_BLOCKS; i++) {
+    pool_free[i] = i;
+  }
+  pool_free_count = SICSLOWPAN_FRAG_POOL_BLOCKS;
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    reass[i].len = 0;
+    memset(reass[i].block, REASS_NO_BLOCK, sizeof(reass[i].block));
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+reass_release(struct sicslowpan_reass *r)
+{
+  int i;
+
+  for(i = 0; i < REASS_BLOCKS; i++) {
+    if(r->block[i] != REASS_NO_BLOCK) {
+      pool_free[pool_free_count++] = r->block[i];
+      r->block[i] = REASS_NO_BLOCK;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+reass_free(struct sicslowpan_reass *r)
+{
+  reass_release(r);
+  r->len = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Free all expired reassemblies except the one given */
+static int
+reass_timeout(struct sicslowpan_reass *not_this)
+{
+  int i;
+  int count = 0;
+
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(REASS_ACTIVE(&reass[i]) && &reass[i] != not_this &&
+       timer_expired(&reass[i].reass_timer)) {
+      reass_free(&reass[i]);
+      reass_stats.timeouts++;
+      count++;
+    }
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+/* Free the oldest reassembly other than the one given */
+static int
+reass_evict(struct sicslowpan_reass *not_this)
+{
+  int i;
+  struct sicslowpan_reass *oldest = NULL;
+  clock_time_t now = clock_time();
+
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(REASS_ACTIVE(&reass[i]) && &reass[i] != not_this &&
+       (oldest == NULL ||
+        (clock_time_t)(now - reass[i].reass_timer.start) >
+        (clock_time_t)(now - oldest->reass_timer.start))) {
+      oldest = &reass[i];
+    }
+  }
+  if(oldest == NULL) {
+    return 0;
+  }
+  PRINTF("*** Evicting reassembly - tag: %d\n", oldest->tag);
+  reass_free(oldest);
+  reass_stats.evictions++;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Find the reassembly a fragment belongs to, or start a new one */
+static struct sicslowpan_reass *
+reass_get(uint16_t tag, uint16_t frag_size)
+{
+  int i;
+  struct sicslowpan_reass *r = NULL;
+  const linkaddr_t *sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  clock_time_t now = clock_time();
+
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(reass[i].len == frag_size && reass[i].tag == tag &&
+       linkaddr_cmp(&reass[i].sender, sender)) {
+      if(!REASS_ACTIVE(&reass[i])) {
+        /* The datagram has already been delivered */
+        reass_stats.duplicates++;
+        return NULL;
+      }
+      return &reass[i];
+    }
+  }
+
+  if(frag_size == 0 || frag_size > REASS_MAX_LEN) {
+    PRINTF("*** Datagram size out of range - tag: %d size: %d\n", tag, frag_size);
+    reass_stats.dropped++;
+    return NULL;
+  }
+
+  /* Prefer an unused descriptor to the one that remembers the
+     oldest delivered datagram */
+  reass_timeout(NULL);
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(reass[i].len == 0) {
+      r = &reass[i];
+      break;
+    }
+    if(!REASS_ACTIVE(&reass[i]) &&
+       (r == NULL ||
+        (clock_time_t)(now - reass[i].reass_timer.start) >
+        (clock_time_t)(now - r->reass_timer.start))) {
+      r = &reass[i];
+    }
+  }
+  if(r == NULL) {
+    reass_evict(NULL);
+    for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+      if(!REASS_ACTIVE(&reass[i])) {
+        r = &reass[i];
+        break;
+      }
+    }
+  }
+
+  r->len = frag_size;
+  r->tag = tag;
+  r->received = 0;
+  linkaddr_copy(&r->sender, sender);
+  memset(r->block, REASS_NO_BLOCK, sizeof(r->block));
+  memset(r->units, 0, sizeof(r->units));
+  timer_set(&r->reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+/* Copy a fragment to its offset within the datagram. Returns 1 if it
+   was stored, 0 if it was a duplicate and -1 if it was dropped. */
+static int
+reass_place(struct sicslowpan_reass *r, uint16_t offset,
+            const uint8_t *data, uint16_t len)
+{
+  uint16_t u, first, last;
+  uint16_t set;
+  uint16_t b, pos, chunk;
+
+  /* The last fragment may carry extraneous bytes at the end */
+  if(offset >= r->len || len == 0) {
+    PRINTF("*** Fragment outside datagram - tag: %d offset: %d\n", r->tag, offset);
+    reass_free(r);
+    reass_stats.overlaps++;
+    return -1;
+  }
+  if(len > r->len - offset) {
+    len = r->len - offset;
+  }
+
+  /* Every fragment but the last covers whole 8 byte units, so an
+     exact duplicate sets no new unit and a fragment that sets only
+     some of its units overlaps an earlier, different one. */
+  first = offset >> 3;
+  last = (offset + len - 1) >> 3;
+  set = 0;
+  for(u = first; u <= last; u++) {
+    if(r->units[u >> 3] & (1 << (u & 7))) {
+      set++;
+    }
+  }
+  if(set == last - first + 1) {
+    reass_stats.duplicates++;
+    return 0;
+  }
+  if(set > 0) {
+    PRINTF("*** Overlapping fragment - tag: %d offset: %d\n", r->tag, offset);
+    reass_free(r);
+    reass_stats.overlaps++;
+    return -1;
+  }
+
+  /* Allocate the pool blocks the fragment spans */
+  for(b = offset / SICSLOWPAN_FRAG_POOL_BLOCK_SIZE;
+      b <= (offset + len - 1) / SICSLOWPAN_FRAG_POOL_BLOCK_SIZE; b++) {
+    if(r->block[b] != REASS_NO_BLOCK) {
+      continue;
+    }
+    while(pool_free_count == 0) {
+      if(reass_timeout(r) == 0 && reass_evict(r) == 0) {
+        PRINTF("*** Fragment pool full - tag: %d offset: %d\n", r->tag, offset);
+        reass_free(r);
+        reass_stats.dropped++;
+        return -1;
+      }
+    }
+    r->block[b] = pool_free[--pool_free_count];
+  }
+
+  for(pos = offset; pos < offset + len; pos += chunk) {
+    b = pos / SICSLOWPAN_FRAG_POOL_BLOCK_SIZE;
+    chunk = SICSLOWPAN_FRAG_POOL_BLOCK_SIZE - pos % SICSLOWPAN_FRAG_POOL_BLOCK_SIZE;
+    if(chunk > offset + len - pos) {
+      chunk = offset + len - pos;
+    }
+    memcpy(&pool[r->block[b]][pos % SICSLOWPAN_FRAG_POOL_BLOCK_SIZE],
+           data + (pos - offset), chunk);
+  }
+
+  for(u = first; u <= last; u++) {
+    r->units[u >> 3] |= 1 << (u & 7);
+  }
+  r->received += len;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Copy a complete datagram into uip and release its blocks */
+static void
+reass_deliver(struct sicslowpan_reass *r)
+{
+  uint16_t b, pos, chunk;
+
+  for(b = 0, pos = 0; pos < r->len; b++, pos += chunk) {
+    chunk = r->len - pos;
+    if(chunk > SICSLOWPAN_FRAG_POOL_BLOCK_SIZE) {
+      chunk = SICSLOWPAN_FRAG_POOL_BLOCK_SIZE;
+    }
+    memcpy((uint8_t *)UIP_IP_BUF + pos, pool[r->block[b]], chunk);
+  }
+  reass_release(r);
+  reass_stats.reassembled++;
+}
+/*---------------------------------------------------------------------------*/
+void
+sicslowpan_get_reass_stats(struct sicslowpan_reass_stats *stats)
+{
+  *stats = reass_stats;
+}
+#else /* SICSLOWPAN_FRAG_POOL */
+
 /* all information needed for reassembly */
 struct sicslowpan_frag_info {
   /** When reassembling, the source address of the fragments being merged */
@@ -432,6 +749,7 @@ copy_frags2uip(int context)
   /* deallocate all the fragments for this context */
   clear_fragments(context);
 }
+#endif /* SICSLOWPAN_FRAG_POOL */
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 /* -------------------------------------------------------------------------- */
@@ -1495,8 +1813,9 @@ output(const uip_lladdr_t *localdest)
  *  copied in siclowpan_buf. If the IP packet is complete it is copied
  *  to uip_buf and the IP layer is called.
  *
- * \note We do not check for overlapping sicslowpan fragments
- * (it is a SHALL in the RFC 4944 and should never happen)
+ * \note Unless SICSLOWPAN_CONF_FRAG_POOL is set, we do not check for
+ * overlapping sicslowpan fragments (it is a SHALL in the RFC 4944 and
+ * should never happen)
  */
 static void
 input(void)
@@ -1509,7 +1828,11 @@ input(void)
 
 #if SICSLOWPAN_CONF_FRAG
   uint8_t is_fragment = 0;
+#if SICSLOWPAN_FRAG_POOL
+  struct sicslowpan_reass *frag_reass = NULL;
+#else /* SICSLOWPAN_FRAG_POOL */
   int8_t frag_context = 0;
+#endif /* SICSLOWPAN_FRAG_POOL */
 
   /* tag of the fragment */
   uint16_t frag_tag = 0;
@@ -1551,6 +1874,14 @@ input(void)
       first_fragment = 1;
       is_fragment = 1;
 
+#if SICSLOWPAN_FRAG_POOL
+      /* The header is uncompressed in uip_buf and moved to the pool
+         once its length is known */
+      frag_reass = reass_get(frag_tag, frag_size);
+      if(frag_reass == NULL) {
+        return;
+      }
+#else /* SICSLOWPAN_FRAG_POOL */
       /* Add the fragment to the fragmentation context */
       frag_context = add_fragment(frag_tag, frag_size, frag_offset);
 
@@ -1559,6 +1890,7 @@ input(void)
       }
 
       buffer = frag_info[frag_context].first_frag;
+#endif /* SICSLOWPAN_FRAG_POOL */
 
       break;
     case SICSLOWPAN_DISPATCH_FRAGN:
@@ -1579,6 +1911,24 @@ input(void)
       PRINTFI("last_fragment?: packetbuf_payload_len %d frag_size %d\n",
               packetbuf_datalen() - packetbuf_hdr_len, frag_size);
 
+#if SICSLOWPAN_FRAG_POOL
+      if(packetbuf_datalen() <= packetbuf_hdr_len) {
+        return;
+      }
+      frag_reass = reass_get(frag_tag, frag_size);
+      if(frag_reass == NULL ||
+         reass_place(frag_reass, (uint16_t)frag_offset << 3,
+                     packetbuf_ptr + packetbuf_hdr_len,
+                     packetbuf_datalen() - packetbuf_hdr_len) <= 0) {
+        return;
+      }
+
+      buffer = NULL;
+
+      if(frag_reass->received >= frag_size) {
+        last_fragment = 1;
+      }
+#else /* SICSLOWPAN_FRAG_POOL */
       /* Add the fragment to the fragmentation context (this will also
          copy the payload) */
       frag_context = add_fragment(frag_tag, frag_size, frag_offset);
@@ -1594,6 +1944,7 @@ input(void)
       if(frag_info[frag_context].reassembled_len >= frag_size) {
         last_fragment = 1;
       }
+#endif /* SICSLOWPAN_FRAG_POOL */
       is_fragment = 1;
       break;
     default:
@@ -1672,6 +2023,22 @@ input(void)
 
 #if SICSLOWPAN_CONF_FRAG
   if(frag_size > 0) {
+#if SICSLOWPAN_FRAG_POOL
+    /* Place the uncompressed first fragment at the start of the
+       datagram; it may well be the last one to arrive */
+    if(first_fragment != 0) {
+      if(reass_place(frag_reass, 0, buffer,
+                     uncomp_hdr_len + packetbuf_payload_len) <= 0) {
+        return;
+      }
+      if(frag_reass->received >= frag_size) {
+        last_fragment = 1;
+      }
+    }
+    if(last_fragment != 0) {
+      reass_deliver(frag_reass);
+    }
+#else /* SICSLOWPAN_FRAG_POOL */
     /* Add the size of the header only for the first fragment. */
     if(first_fragment != 0) {
       frag_info[frag_context].reassembled_len = uncomp_hdr_len + packetbuf_payload_len;
@@ -1684,6 +2051,7 @@ input(void)
       /* copy to uip */
       copy_frags2uip(frag_context);
     }
+#endif /* SICSLOWPAN_FRAG_POOL */
   }
 
   /*
@@ -1741,6 +2109,10 @@ sicslowpan_init(void)
 
   tcpip_set_outputfunc(output);
 
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_POOL
+  reass_init();
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_POOL */
+
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
 /* Preinitialize any address contexts for better header compression
  * (Saves up to 13 bytes per 6lowpan packet)
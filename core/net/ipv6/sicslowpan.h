@@ -321,6 +321,29 @@ struct sicslowpan_nh_compressor {
 
 int sicslowpan_get_last_rssi(void);
 
+/** Fragment reassembly statistics. */
+struct sicslowpan_reass_stats {
+  unsigned long reassembled; /**< Datagrams reassembled and delivered. */
+  unsigned long timeouts;    /**< Reassemblies that timed out. */
+  unsigned long evictions;   /**< Reassemblies evicted to make room. */
+  unsigned long duplicates;  /**< Duplicate fragments ignored. */
+  unsigned long overlaps;    /**< Reassemblies aborted by bad fragments. */
+  unsigned long dropped;     /**< Fragments dropped for lack of space. */
+};
+
+/**
+ * \brief Get the fragment reassembly statistics.
+ * \param stats A pointer to the structure to fill in.
+ *
+ * Only available with the pooled reassembly engine, which is enabled
+ * by setting SICSLOWPAN_CONF_FRAG_POOL (together with
+ * SICSLOWPAN_CONF_FRAG). SICSLOWPAN_CONF_REASS_CONTEXTS then sets the
+ * number of datagrams that can be reassembled at once, and
+ * SICSLOWPAN_CONF_FRAG_POOL_BLOCKS the size of the shared pool their
+ * fragments are stored in.
+ */
+void sicslowpan_get_reass_stats(struct sicslowpan_reass_stats *stats);
+
 extern const struct network_driver sicslowpan_driver;
 
 #endif /* SICSLOWPAN_H_ */
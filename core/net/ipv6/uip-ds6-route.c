@@ -82,6 +82,20 @@ LIST(notificationlist);
 
 static int num_routes = 0;
 
+#if UIP_DS6_ROUTE_LPM_HASH
+#if UIP_DS6_ROUTE_LPM_HASH_SIZE < 1
+#error UIP_CONF_DS6_ROUTE_LPM_HASH_SIZE must be at least 1 (it defaults to UIP_DS6_ROUTE_NB)
+#endif
+/* The prefix index: routes hashed by prefix and prefix length, and
+   the number of routes of each prefix length. */
+static uip_ds6_route_t *lpm_buckets[UIP_DS6_ROUTE_LPM_HASH_SIZE];
+#if UIP_DS6_ROUTE_NB < 256
+static uint8_t lpm_length_count[129];
+#else
+static uint16_t lpm_length_count[129];
+#endif
+#endif /* UIP_DS6_ROUTE_LPM_HASH */
+
 #undef DEBUG
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
@@ -153,11 +167,80 @@ uip_ds6_notification_rm(struct uip_ds6_notification *n)
 }
 #endif
 /*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_LPM_HASH
+/* Hash the part of a prefix that uip_ipaddr_prefixcmp() compares */
+static unsigned
+lpm_hash(const uip_ipaddr_t *addr, uint8_t length)
+{
+  unsigned h;
+  int i;
+
+  h = length;
+  for(i = 0; i < (length >> 3); i++) {
+    h = h * 31 + addr->u8[i];
+  }
+  return h % UIP_DS6_ROUTE_LPM_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+lpm_insert(uip_ds6_route_t *r)
+{
+  unsigned b;
+
+  b = lpm_hash(&r->ipaddr, r->length);
+  r->hash_next = lpm_buckets[b];
+  lpm_buckets[b] = r;
+  lpm_length_count[r->length]++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+lpm_remove(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **rp;
+
+  for(rp = &lpm_buckets[lpm_hash(&r->ipaddr, r->length)];
+      *rp != NULL;
+      rp = &(*rp)->hash_next) {
+    if(*rp == r) {
+      *rp = r->hash_next;
+      lpm_length_count[r->length]--;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+lpm_lookup(uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r;
+  int length;
+
+  for(length = 128; length >= 0; length--) {
+    if(lpm_length_count[length] == 0) {
+      continue;
+    }
+    for(r = lpm_buckets[lpm_hash(addr, length)];
+        r != NULL;
+        r = r->hash_next) {
+      if(r->length == length &&
+         uip_ipaddr_prefixcmp(addr, &r->ipaddr, length)) {
+        return r;
+      }
+    }
+  }
+  return NULL;
+}
+#endif /* UIP_DS6_ROUTE_LPM_HASH */
+/*---------------------------------------------------------------------------*/
 void
 uip_ds6_route_init(void)
 {
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_LPM_HASH
+  memset(lpm_buckets, 0, sizeof(lpm_buckets));
+  memset(lpm_length_count, 0, sizeof(lpm_length_count));
+#endif /* UIP_DS6_ROUTE_LPM_HASH */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 
@@ -228,15 +311,19 @@ uip_ds6_route_num_routes(void)
 uip_ds6_route_t *
 uip_ds6_route_lookup(uip_ipaddr_t *addr)
 {
+#if !UIP_DS6_ROUTE_LPM_HASH
   uip_ds6_route_t *r;
-  uip_ds6_route_t *found_route;
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_LPM_HASH */
+  uip_ds6_route_t *found_route;
 
   PRINTF("uip-ds6-route: Looking up route for ");
   PRINT6ADDR(addr);
   PRINTF("\n");
 
-
+#if UIP_DS6_ROUTE_LPM_HASH
+  found_route = lpm_lookup(addr);
+#else /* UIP_DS6_ROUTE_LPM_HASH */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
@@ -252,6 +339,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
       }
     }
   }
+#endif /* UIP_DS6_ROUTE_LPM_HASH */
 
   if(found_route != NULL) {
     PRINTF("uip-ds6-route: Found route: ");
@@ -263,6 +351,9 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     PRINTF("uip-ds6-route: No route found\n");
   }
 
+#if !UIP_DS6_ROUTE_LPM_HASH || UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+  /* With the prefix index, the list order only matters for evicting
+     the least recently used route. */
   if(found_route != NULL && found_route != list_head(routelist)) {
     /* If we found a route, we put it at the start of the routeslist
        list. The list is ordered by how recently we looked them up:
@@ -272,6 +363,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     list_remove(routelist, found_route);
     list_push(routelist, found_route);
   }
+#endif /* !UIP_DS6_ROUTE_LPM_HASH || UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
 
   return found_route;
 }
@@ -287,6 +379,14 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
   assert_nbr_routes_list_sane();
 #endif /* DEBUG != DEBUG_NONE */
 
+#if UIP_DS6_ROUTE_LPM_HASH
+  /* The prefix index only has room for valid prefix lengths */
+  if(length > 128) {
+    PRINTF("uip_ds6_route_add: invalid prefix length %u\n", length);
+    return NULL;
+  }
+#endif /* UIP_DS6_ROUTE_LPM_HASH */
+
   /* Get link-layer address of next hop, make sure it is in neighbor table */
   const uip_lladdr_t *nexthop_lladdr = uip_ds6_nbr_lladdr_from_ipaddr(nexthop);
   if(nexthop_lladdr == NULL) {
@@ -406,6 +506,9 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_LPM_HASH
+  lpm_insert(r);
+#endif /* UIP_DS6_ROUTE_LPM_HASH */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -444,6 +547,9 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
 
     /* Remove the route from the route list */
     list_remove(routelist, route);
+#if UIP_DS6_ROUTE_LPM_HASH
+    lpm_remove(route);
+#endif /* UIP_DS6_ROUTE_LPM_HASH */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -92,6 +92,23 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB UIP_CONF_MAX_ROUTES
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/* Index the routing table by prefix so that uip_ds6_route_lookup()
+   does not scan all routes. Routes are kept in a hash table keyed by
+   prefix and prefix length, and a lookup probes each prefix length in
+   use, longest first. */
+#ifdef UIP_CONF_DS6_ROUTE_LPM_HASH
+#define UIP_DS6_ROUTE_LPM_HASH UIP_CONF_DS6_ROUTE_LPM_HASH
+#else /* UIP_CONF_DS6_ROUTE_LPM_HASH */
+#define UIP_DS6_ROUTE_LPM_HASH 0
+#endif /* UIP_CONF_DS6_ROUTE_LPM_HASH */
+
+/* Number of hash buckets of the prefix index */
+#ifdef UIP_CONF_DS6_ROUTE_LPM_HASH_SIZE
+#define UIP_DS6_ROUTE_LPM_HASH_SIZE UIP_CONF_DS6_ROUTE_LPM_HASH_SIZE
+#else /* UIP_CONF_DS6_ROUTE_LPM_HASH_SIZE */
+#define UIP_DS6_ROUTE_LPM_HASH_SIZE UIP_DS6_ROUTE_NB
+#endif /* UIP_CONF_DS6_ROUTE_LPM_HASH_SIZE */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -151,6 +168,10 @@ struct uip_ds6_route_neighbor_routes {
 /** \brief An entry in the routing table */
 typedef struct uip_ds6_route {
   struct uip_ds6_route *next;
+#if UIP_DS6_ROUTE_LPM_HASH
+  /* The next route in the same bucket of the prefix index */
+  struct uip_ds6_route *hash_next;
+#endif /* UIP_DS6_ROUTE_LPM_HASH */
   /* Each route entry belongs to a specific neighbor. That neighbor
      holds a list of all routing entries that go through it. The
      routes field point to the uip_ds6_route_neighbor_routes that
@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup uip6
+ * @{
+ */
+
+/**
+ * \file
+ *         Retransmit buffer for the uIPv6 TCP sliding window mode
+ */
+
+#include "net/ipv6/uip-tcp-window.h"
+
+#if UIP_TCP_WINDOW
+
+#include "net/ip/uip_arch.h"
+#include "lib/memb.h"
+#include "sys/clock.h"
+
+#include <string.h>
+
+#if !NETSTACK_CONF_WITH_IPV6
+#error The TCP sliding window mode is only available with IPv6
+#endif
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+/* Number of duplicate ACKs that triggers a fast retransmit (RFC 5681). */
+#define DUPACK_THRESHOLD 3
+
+/* Period of the TCP timer in tcpip.c, which rto is counted in. */
+#define TIMER_PULSE      (CLOCK_SECOND / 2)
+
+/* Values of conn->wflags. */
+#define FLAG_ACK_PENDING 0x01 /* Buffered data not yet reported to the app */
+#define FLAG_REFUSED     0x02 /* The app's last data did not fit */
+#define FLAG_CLOSE       0x04 /* The app has closed the connection */
+
+struct uip_tcp_seg {
+  struct uip_tcp_seg *next;
+  clock_time_t sent;
+  uint16_t len;
+  uint8_t nrtx;
+  uint8_t data[UIP_TCP_MSS];
+};
+
+MEMB(segmemb, struct uip_tcp_seg, UIP_TCP_WINDOW_BUFFERS);
+/*---------------------------------------------------------------------------*/
+static uint32_t
+seq32(const uint8_t *seq)
+{
+  return ((uint32_t)seq[0] << 24) | ((uint32_t)seq[1] << 16) |
+    ((uint32_t)seq[2] << 8) | seq[3];
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_tcp_window_init(void)
+{
+  memb_init(&segmemb);
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_tcp_window_reset(struct uip_conn *conn)
+{
+  struct uip_tcp_seg *seg;
+
+  while(conn->rtxq != NULL) {
+    seg = conn->rtxq;
+    conn->rtxq = seg->next;
+    memb_free(&segmemb, seg);
+  }
+  conn->nseg = 0;
+  conn->cwnd = UIP_TCP_WINDOW_SEGMENTS > 1 ? 2 : 1;
+  conn->dupacks = 0;
+  conn->wflags = 0;
+  conn->snd_wnd = conn->initialmss;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_tcp_window_can_send(const struct uip_conn *conn)
+{
+  if(conn->wflags & FLAG_CLOSE) {
+    return 0;
+  }
+  if(conn->nseg >= conn->cwnd || conn->nseg >= UIP_TCP_WINDOW_SEGMENTS) {
+    return 0;
+  }
+  /* Keep within the window of the peer. When nothing is in flight,
+     one segment is always allowed so that a zero window is probed,
+     just like in the single segment mode. */
+  if(conn->len > 0 && (uint32_t)conn->len + conn->mss > conn->snd_wnd) {
+    return 0;
+  }
+  return memb_numfree(&segmemb) > 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_tcp_window_queue(struct uip_conn *conn, const void *data, uint16_t len)
+{
+  struct uip_tcp_seg *seg, *tail;
+
+  if(!uip_tcp_window_can_send(conn) ||
+     (seg = memb_alloc(&segmemb)) == NULL) {
+    conn->wflags |= FLAG_REFUSED;
+    return 0;
+  }
+
+  memcpy(seg->data, data, len);
+  seg->len = len;
+  seg->nrtx = 0;
+  seg->sent = clock_time();
+  seg->next = NULL;
+
+  if(conn->rtxq == NULL) {
+    conn->rtxq = seg;
+    /* The retransmission timer runs for the oldest segment only. */
+    conn->timer = conn->rto;
+    conn->nrtx = 0;
+  } else {
+    for(tail = conn->rtxq; tail->next != NULL; tail = tail->next);
+    tail->next = seg;
+  }
+  conn->nseg++;
+  conn->len += len;
+  conn->wflags = (conn->wflags & ~FLAG_REFUSED) | FLAG_ACK_PENDING;
+
+  PRINTF("uip-tcp-window: queued %u bytes, %u segments in flight\n",
+         len, conn->nseg);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_tcp_window_ack(struct uip_conn *conn, const uint8_t *ackno,
+                   int dup, int *rtt)
+{
+  struct uip_tcp_seg *seg;
+  uint32_t acked;
+  clock_time_t sent;
+  uint8_t freed, retransmitted;
+
+  *rtt = -1;
+  acked = seq32(ackno) - seq32(conn->snd_nxt);
+
+  if(acked == 0) {
+    if(dup && conn->rtxq != NULL && ++conn->dupacks == DUPACK_THRESHOLD) {
+      /* The peer keeps receiving segments beyond a hole: resend the
+         oldest one now instead of waiting for the timer, and halve the
+         congestion window. */
+      conn->cwnd = conn->cwnd > 2 ? conn->cwnd / 2 : 1;
+      return UIP_TCP_WINDOW_ACK_FASTRETX;
+    }
+    return UIP_TCP_WINDOW_ACK_NONE;
+  }
+  if(acked > conn->len) {
+    /* Old or bogus acknowledgement number. */
+    return UIP_TCP_WINDOW_ACK_NONE;
+  }
+
+  uip_add32(conn->snd_nxt, (uint16_t)acked);
+  memcpy(conn->snd_nxt, uip_acc32, sizeof(conn->snd_nxt));
+  conn->len -= acked;
+
+  /* Release the segments that have been acknowledged in full. Only
+     segments that were never retransmitted give an RTT sample (Karn's
+     algorithm). */
+  sent = 0;
+  freed = retransmitted = 0;
+  while((seg = conn->rtxq) != NULL && seg->len <= acked) {
+    acked -= seg->len;
+    freed++;
+    retransmitted |= seg->nrtx;
+    sent = seg->sent;
+    conn->rtxq = seg->next;
+    conn->nseg--;
+    memb_free(&segmemb, seg);
+  }
+  if(seg != NULL && acked > 0) {
+    /* Only part of the oldest segment was acknowledged. */
+    seg->len -= acked;
+    memmove(seg->data, &seg->data[acked], seg->len);
+    retransmitted |= seg->nrtx;
+  }
+
+  if(freed > 0 && !retransmitted) {
+    *rtt = (clock_time() - sent + TIMER_PULSE / 2) / TIMER_PULSE;
+    if(*rtt > 127) {
+      *rtt = 127;
+    }
+  }
+
+  if(conn->cwnd < UIP_TCP_WINDOW_SEGMENTS) {
+    conn->cwnd++;
+  }
+  conn->dupacks = 0;
+  conn->nrtx = 0;
+  conn->timer = conn->rto;
+
+  PRINTF("uip-tcp-window: acked, %u segments in flight, cwnd %u\n",
+         conn->nseg, conn->cwnd);
+  return UIP_TCP_WINDOW_ACK_NEW;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_tcp_window_rexmit(struct uip_conn *conn, void *buf)
+{
+  struct uip_tcp_seg *seg;
+
+  seg = conn->rtxq;
+  if(seg == NULL) {
+    return 0;
+  }
+  if(seg->nrtx < 0xff) {
+    seg->nrtx++;
+  }
+  conn->dupacks = 0;
+  memcpy(buf, seg->data, seg->len);
+  return seg->len;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_tcp_window_timeout(struct uip_conn *conn)
+{
+  conn->cwnd = 1;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+uip_tcp_window_appflags(struct uip_conn *conn)
+{
+  if(conn->wflags & FLAG_ACK_PENDING) {
+    conn->wflags &= ~FLAG_ACK_PENDING;
+    return UIP_ACKDATA;
+  }
+  if((conn->wflags & FLAG_REFUSED) && uip_tcp_window_can_send(conn)) {
+    /* The refused data is asked for again; if the application does not
+       send it, it is not asked for again until new data is refused. */
+    conn->wflags &= ~FLAG_REFUSED;
+    return UIP_REXMIT;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_tcp_window_wants_poll(const struct uip_conn *conn)
+{
+  return (conn->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+    (conn->wflags & (FLAG_ACK_PENDING | FLAG_REFUSED)) != 0 &&
+    uip_tcp_window_can_send(conn);
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_tcp_window_close(struct uip_conn *conn)
+{
+  conn->wflags |= FLAG_CLOSE;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_tcp_window_closing(const struct uip_conn *conn)
+{
+  return (conn->wflags & FLAG_CLOSE) != 0;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_TCP_WINDOW */
+/** @} */
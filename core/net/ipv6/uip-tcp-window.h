@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup uip6
+ * @{
+ */
+
+/**
+ * \file
+ *         Retransmit buffer for the uIPv6 TCP sliding window mode
+ *
+ *         With UIP_CONF_TCP_WINDOW_SEGMENTS set, every data segment a
+ *         connection sends is copied into a retransmit buffer, so up to
+ *         UIP_TCP_WINDOW_SEGMENTS segments can be unacknowledged at a
+ *         time. The stack retransmits lost segments by itself.
+ *
+ *         To the application, a segment counts as acknowledged as soon
+ *         as it has been buffered: the next time the application is
+ *         called, UIP_ACKDATA is set and it may send new data. If the
+ *         window is full, the data is refused and the application is
+ *         later called with UIP_REXMIT to send it again, exactly as if
+ *         it had been lost. Applications written for the single segment
+ *         mode, including tcp-socket and protosockets, therefore work
+ *         unchanged.
+ */
+
+#ifndef UIP_TCP_WINDOW_H_
+#define UIP_TCP_WINDOW_H_
+
+#include "net/ip/uip.h"
+
+/** \name Return values of uip_tcp_window_ack() */
+/** @{ */
+#define UIP_TCP_WINDOW_ACK_NONE     0 /**< Nothing new was acknowledged. */
+#define UIP_TCP_WINDOW_ACK_NEW      1 /**< Outstanding data was acknowledged. */
+#define UIP_TCP_WINDOW_ACK_FASTRETX 2 /**< Oldest segment should be resent. */
+/** @} */
+
+void uip_tcp_window_init(void);
+
+/** \brief Drop all buffered segments and reset the window state of a connection */
+void uip_tcp_window_reset(struct uip_conn *conn);
+
+/**
+ * \brief Buffer a new data segment for transmission
+ * \param conn The connection
+ * \param data The segment data
+ * \param len The segment length, at most UIP_TCP_MSS
+ * \return Non-zero if the segment was accepted, zero if the window is full
+ *
+ * An accepted segment starts conn->len bytes after conn->snd_nxt, and
+ * conn->len grows by \p len. A refused segment leaves the application
+ * to be called with UIP_REXMIT once the window opens.
+ */
+int uip_tcp_window_queue(struct uip_conn *conn, const void *data, uint16_t len);
+
+/**
+ * \brief Process the acknowledgement number of an incoming segment
+ * \param conn The connection
+ * \param ackno The acknowledgement number, in network byte order
+ * \param dup Non-zero if the segment could be a duplicate ACK, i.e.,
+ *        it carries no data, SYN or FIN and does not change the window
+ * \param rtt Set to the measured round-trip time in timer pulses, or
+ *        to -1 if no measurement could be taken
+ * \return One of the UIP_TCP_WINDOW_ACK_ values
+ */
+int uip_tcp_window_ack(struct uip_conn *conn, const uint8_t *ackno,
+                       int dup, int *rtt);
+
+/**
+ * \brief Copy the oldest unacknowledged segment for retransmission
+ * \param conn The connection
+ * \param buf Where to put the segment data
+ * \return The length of the segment
+ */
+uint16_t uip_tcp_window_rexmit(struct uip_conn *conn, void *buf);
+
+/** \brief Shrink the congestion window after a retransmission timeout */
+void uip_tcp_window_timeout(struct uip_conn *conn);
+
+/** \brief Whether a new segment would be accepted right now */
+int uip_tcp_window_can_send(const struct uip_conn *conn);
+
+/**
+ * \brief Get the flags to pass to the application when it is called
+ *
+ * Returns UIP_ACKDATA if data was buffered since the application
+ * was last called, or UIP_REXMIT if refused data can now be sent.
+ */
+uint8_t uip_tcp_window_appflags(struct uip_conn *conn);
+
+/**
+ * \brief Whether the application should be polled at once
+ *
+ * True if the connection has room for more data and the application
+ * is waiting for an acknowledgement or for its refused data to be
+ * taken. Used by tcpip.c to fill the window back to back.
+ */
+int uip_tcp_window_wants_poll(const struct uip_conn *conn);
+
+/** \brief Defer closing until all buffered data has been acknowledged */
+void uip_tcp_window_close(struct uip_conn *conn);
+
+/** \brief Whether the application has closed the connection */
+int uip_tcp_window_closing(const struct uip_conn *conn);
+
+#endif /* UIP_TCP_WINDOW_H_ */
+/** @} */
@@ -74,10 +74,12 @@
 #include "sys/cc.h"
 #include "net/ip/uip.h"
 #include "net/ip/uipopt.h"
+#include "net/ip/uip_arch.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/ipv6/uip-nd6.h"
 #include "net/ipv6/uip-ds6.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
+#include "net/ipv6/uip-tcp-window.h"
 
 #include <string.h>
 
@@ -258,6 +260,10 @@ static uint8_t iss[4];
 uint8_t uip_acc32[4];
 static uint8_t opt;
 static uint16_t tmp16;
+#if UIP_TCP_WINDOW
+/* Offset from snd_nxt of the sequence number of the next segment sent. */
+static uint16_t snd_off;
+#endif /* UIP_TCP_WINDOW */
 #endif /* UIP_TCP */
 /** @} */
 
@@ -322,6 +328,9 @@ uip_add32(uint8_t *op32, uint16_t op16)
 #endif /* UIP_TCP */
 
 #if ! UIP_ARCH_CHKSUM
+#if UIP_WORD_CHKSUM
+#define chksum uip_chksum_add
+#else /* UIP_WORD_CHKSUM */
 /*---------------------------------------------------------------------------*/
 static uint16_t
 chksum(uint16_t sum, const uint8_t *data, uint16_t len)
@@ -353,6 +362,7 @@ chksum(uint16_t sum, const uint8_t *data, uint16_t len)
   /* Return sum in host byte order. */
   return sum;
 }
+#endif /* UIP_WORD_CHKSUM */
 /*---------------------------------------------------------------------------*/
 uint16_t
 uip_chksum(uint16_t *data, uint16_t len)
@@ -443,7 +453,13 @@ uip_init(void)
   }
   for(c = 0; c < UIP_CONNS; ++c) {
     uip_conns[c].tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+    uip_conns[c].rtxq = NULL;
+#endif /* UIP_TCP_WINDOW */
   }
+#if UIP_TCP_WINDOW
+  uip_tcp_window_init();
+#endif /* UIP_TCP_WINDOW */
 #endif /* UIP_TCP */
 
 #if UIP_ACTIVE_OPEN || UIP_UDP
@@ -527,6 +543,9 @@ uip_connect(const uip_ipaddr_t *ripaddr, uint16_t rport)
   conn->lport = uip_htons(lastport);
   conn->rport = rport;
   uip_ipaddr_copy(&conn->ripaddr, ripaddr);
+#if UIP_TCP_WINDOW
+  uip_tcp_window_reset(conn);
+#endif /* UIP_TCP_WINDOW */
 
   return conn;
 }
@@ -850,6 +869,20 @@ uip_add_rcv_nxt(uint16_t n)
   uip_conn->rcv_nxt[2] = uip_acc32[2];
   uip_conn->rcv_nxt[3] = uip_acc32[3];
 }
+/*---------------------------------------------------------------------------*/
+static void
+tcp_rtt_estimate(struct uip_conn *conn, signed char m)
+{
+  /* This is taken directly from VJs original code in his paper */
+  m = m - (conn->sa >> 3);
+  conn->sa += m;
+  if(m < 0) {
+    m = -m;
+  }
+  m = m - (conn->sv >> 2);
+  conn->sv += m;
+  conn->rto = (conn->sa >> 3) + conn->sv;
+}
 #endif
 /*---------------------------------------------------------------------------*/
 
@@ -936,6 +969,15 @@ ext_hdr_options_process(void)
 }
 
 
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP_WINDOW
+/* In the sliding window mode, the application may be polled while
+   data is in flight, as long as there is room for more. */
+#define TCP_CAN_POLL(conn) (!uip_outstanding(conn) || \
+                            uip_tcp_window_can_send(conn))
+#else /* UIP_TCP_WINDOW */
+#define TCP_CAN_POLL(conn) (!uip_outstanding(conn))
+#endif /* UIP_TCP_WINDOW */
 /*---------------------------------------------------------------------------*/
 void
 uip_process(uint8_t flag)
@@ -949,14 +991,21 @@ uip_process(uint8_t flag)
   }
 #endif /* UIP_UDP */
   uip_sappdata = uip_appdata = &uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN];
+#if UIP_TCP_WINDOW
+  snd_off = 0;
+#endif /* UIP_TCP_WINDOW */
 
   /* Check if we were invoked because of a poll request for a
      particular connection. */
   if(flag == UIP_POLL_REQUEST) {
 #if UIP_TCP
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
-       !uip_outstanding(uip_connr)) {
+       TCP_CAN_POLL(uip_connr)) {
+      uip_slen = 0;
       uip_flags = UIP_POLL;
+#if UIP_TCP_WINDOW
+      uip_flags |= uip_tcp_window_appflags(uip_connr);
+#endif /* UIP_TCP_WINDOW */
       UIP_APPCALL();
       goto appsend;
 #if UIP_ACTIVE_OPEN
@@ -1009,6 +1058,9 @@ uip_process(uint8_t flag)
                uip_connr->tcpstateflags == UIP_SYN_RCVD) &&
               uip_connr->nrtx == UIP_MAXSYNRTX)) {
             uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+            uip_tcp_window_reset(uip_connr);
+#endif /* UIP_TCP_WINDOW */
 
             /*
              * We call UIP_APPCALL() with uip_flags set to
@@ -1051,6 +1103,14 @@ uip_process(uint8_t flag)
 #endif /* UIP_ACTIVE_OPEN */
 
           case UIP_ESTABLISHED:
+#if UIP_TCP_WINDOW
+            /*
+             * In the sliding window mode, the oldest segment is resent
+             * from the retransmit buffer.
+             */
+            uip_tcp_window_timeout(uip_connr);
+            goto tcp_send_rexmit;
+#else /* UIP_TCP_WINDOW */
             /*
              * In the ESTABLISHED state, we call upon the application
              * to do the actual retransmit after which we jump into
@@ -1060,6 +1120,7 @@ uip_process(uint8_t flag)
             uip_flags = UIP_REXMIT;
             UIP_APPCALL();
             goto apprexmit;
+#endif /* UIP_TCP_WINDOW */
 
           case UIP_FIN_WAIT_1:
           case UIP_CLOSING:
@@ -1068,12 +1129,17 @@ uip_process(uint8_t flag)
             goto tcp_send_finack;
           }
         }
-      } else if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+      }
+      if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+         TCP_CAN_POLL(uip_connr)) {
         /*
          * If there was no need for a retransmission, we poll the
          * application for new data.
          */
         uip_flags = UIP_POLL;
+#if UIP_TCP_WINDOW
+        uip_flags |= uip_tcp_window_appflags(uip_connr);
+#endif /* UIP_TCP_WINDOW */
         UIP_APPCALL();
         goto appsend;
       }
@@ -1366,6 +1432,25 @@ uip_process(uint8_t flag)
            */
 
           PRINTF("Processing Routing header\n");
+#if UIP_CONF_IPV6_RPL && UIP_CONF_ROUTER
+          /* An RPL source routing header with segments left: forward
+             the packet to the next address in the route. */
+          switch(rpl_process_srh_header()) {
+          case 1:
+            if(UIP_IP_BUF->ttl <= 1) {
+              uip_icmp6_error_output(ICMP6_TIME_EXCEEDED,
+                                     ICMP6_TIME_EXCEED_TRANSIT, 0);
+              UIP_STAT(++uip_stat.ip.drop);
+              goto send;
+            }
+            UIP_IP_BUF->ttl = UIP_IP_BUF->ttl - 1;
+            UIP_STAT(++uip_stat.ip.forwarded);
+            goto send;
+          case -1:
+            UIP_STAT(++uip_stat.ip.drop);
+            goto drop;
+          }
+#endif /* UIP_CONF_IPV6_RPL && UIP_CONF_ROUTER */
           if(UIP_ROUTING_BUF->seg_left > 0) {
             uip_icmp6_error_output(ICMP6_PARAM_PROB, ICMP6_PARAMPROB_HEADER, UIP_IPH_LEN + uip_ext_len + 2);
             UIP_STAT(++uip_stat.ip.drop);
@@ -1783,6 +1868,10 @@ uip_process(uint8_t flag)
     }
   }
 
+#if UIP_TCP_WINDOW
+  uip_tcp_window_reset(uip_connr);
+#endif /* UIP_TCP_WINDOW */
+
   /* Our response will be a SYNACK. */
 #if UIP_ACTIVE_OPEN
   tcp_send_synack:
@@ -1816,6 +1905,9 @@ uip_process(uint8_t flag)
      before we accept the reset. */
   if(UIP_TCP_BUF->flags & TCP_RST) {
     uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+    uip_tcp_window_reset(uip_connr);
+#endif /* UIP_TCP_WINDOW */
     UIP_LOG("tcp: got reset, aborting connection.");
     uip_flags = UIP_ABORT;
     UIP_APPCALL();
@@ -1859,6 +1951,33 @@ uip_process(uint8_t flag)
      data. If so, we update the sequence number, reset the length of
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
+#if UIP_TCP_WINDOW
+  if((UIP_TCP_BUF->flags & TCP_ACK) && uip_connr->rtxq != NULL) {
+    /* In the sliding window mode, any prefix of the data in flight may
+       be acknowledged. An ACK that acknowledges nothing new, carries
+       nothing and leaves the window unchanged is a duplicate ACK. */
+    int rtt;
+
+    tmp16 = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) + (uint16_t)UIP_TCP_BUF->wnd[1];
+    c = uip_tcp_window_ack(uip_connr, UIP_TCP_BUF->ackno,
+                           uip_len == 0 &&
+                           (UIP_TCP_BUF->flags & (TCP_SYN | TCP_FIN)) == 0 &&
+                           tmp16 == uip_connr->snd_wnd,
+                           &rtt);
+    if(rtt >= 0) {
+      tcp_rtt_estimate(uip_connr, rtt);
+    }
+    if(c == UIP_TCP_WINDOW_ACK_FASTRETX) {
+      UIP_STAT(++uip_stat.tcp.rexmit);
+      goto tcp_send_rexmit;
+    }
+    if(c == UIP_TCP_WINDOW_ACK_NEW) {
+      /* The window has moved: let the application send more or
+         close the connection, as it would on UIP_ACKDATA. */
+      uip_flags = UIP_POLL;
+    }
+  } else
+#endif /* UIP_TCP_WINDOW */
   if((UIP_TCP_BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
     uip_add32(uip_connr->snd_nxt, uip_connr->len);
 
@@ -1874,18 +1993,7 @@ uip_process(uint8_t flag)
 
       /* Do RTT estimation, unless we have done retransmissions. */
       if(uip_connr->nrtx == 0) {
-        signed char m;
-        m = uip_connr->rto - uip_connr->timer;
-        /* This is taken directly from VJs original code in his paper */
-        m = m - (uip_connr->sa >> 3);
-        uip_connr->sa += m;
-        if(m < 0) {
-          m = -m;
-        }
-        m = m - (uip_connr->sv >> 2);
-        uip_connr->sv += m;
-        uip_connr->rto = (uip_connr->sa >> 3) + uip_connr->sv;
-
+        tcp_rtt_estimate(uip_connr, uip_connr->rto - uip_connr->timer);
       }
       /* Set the acknowledged flag. */
       uip_flags = UIP_ACKDATA;
@@ -1898,6 +2006,13 @@ uip_process(uint8_t flag)
 
   }
 
+#if UIP_TCP_WINDOW
+  if(UIP_TCP_BUF->flags & TCP_ACK) {
+    uip_connr->snd_wnd = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) +
+      (uint16_t)UIP_TCP_BUF->wnd[1];
+  }
+#endif /* UIP_TCP_WINDOW */
+
   /* Do different things depending on in what state the connection is. */
   switch(uip_connr->tcpstateflags & UIP_TS_MASK) {
   /* CLOSED and LISTEN are not handled here. CLOSE_WAIT is not
@@ -2084,7 +2199,24 @@ uip_process(uint8_t flag)
          put into the uip_appdata and the length of the data should be
          put into uip_len. If the application don't have any data to
          send, uip_len must be set to 0. */
-    if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA)) {
+#if UIP_TCP_WINDOW
+    if(uip_tcp_window_closing(uip_connr)) {
+      /* The application has closed the connection. The FIN is sent
+         once all buffered data has been acknowledged. */
+      if(!uip_outstanding(uip_connr)) {
+        goto tcp_send_fin;
+      }
+      if(uip_flags & UIP_NEWDATA) {
+        goto tcp_send_ack;
+      }
+      goto drop;
+    }
+    /* In the sliding window mode, UIP_ACKDATA tells the application
+       that its data has been buffered, and UIP_REXMIT that the data it
+       could not send before can now be sent. */
+    uip_flags |= uip_tcp_window_appflags(uip_connr);
+#endif /* UIP_TCP_WINDOW */
+    if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA | UIP_REXMIT | UIP_POLL)) {
       uip_slen = 0;
       UIP_APPCALL();
 
@@ -2093,11 +2225,24 @@ uip_process(uint8_t flag)
       if(uip_flags & UIP_ABORT) {
         uip_slen = 0;
         uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_WINDOW
+        uip_tcp_window_reset(uip_connr);
+#endif /* UIP_TCP_WINDOW */
         UIP_TCP_BUF->flags = TCP_RST | TCP_ACK;
         goto tcp_send_nodata;
       }
 
       if(uip_flags & UIP_CLOSE) {
+#if UIP_TCP_WINDOW
+        if(uip_outstanding(uip_connr)) {
+          /* Wait for the data in flight to be acknowledged before
+             sending the FIN. */
+          uip_tcp_window_close(uip_connr);
+          uip_slen = 0;
+          goto tcp_send_ack;
+        }
+        tcp_send_fin:
+#endif /* UIP_TCP_WINDOW */
         uip_slen = 0;
         uip_connr->len = 1;
         uip_connr->tcpstateflags = UIP_FIN_WAIT_1;
@@ -2108,6 +2253,24 @@ uip_process(uint8_t flag)
 
       /* If uip_slen > 0, the application has data to be sent. */
       if(uip_slen > 0) {
+#if UIP_TCP_WINDOW
+        if(uip_slen > uip_connr->mss) {
+          uip_slen = uip_connr->mss;
+        }
+
+        /* The new segment follows the data already in flight. If the
+           window is full, the data is dropped here and the application
+           is asked to resend it later with UIP_REXMIT. */
+        snd_off = uip_connr->len;
+        if(uip_tcp_window_queue(uip_connr, uip_sappdata, uip_slen)) {
+          uip_appdata = uip_sappdata;
+          uip_len = uip_slen + UIP_TCPIP_HLEN;
+          UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+          goto tcp_send_noopts;
+        }
+        snd_off = 0;
+        uip_slen = 0;
+#else /* UIP_TCP_WINDOW */
 
         /* If the connection has acknowledged data, the contents of
              the ->len variable should be discarded. */
@@ -2137,9 +2300,12 @@ uip_process(uint8_t flag)
                retransmit) out more than it previously sent out. */
           uip_slen = uip_connr->len;
         }
+#endif /* UIP_TCP_WINDOW */
       }
+#if !UIP_TCP_WINDOW
       uip_connr->nrtx = 0;
       apprexmit:
+#endif /* !UIP_TCP_WINDOW */
       uip_appdata = uip_sappdata;
 
       /* If the application has data to be sent, or if the incoming
@@ -2155,9 +2321,7 @@ uip_process(uint8_t flag)
       /* If there is no data to send, just send out a pure ACK if
            there is newdata. */
       if(uip_flags & UIP_NEWDATA) {
-        uip_len = UIP_TCPIP_HLEN;
-        UIP_TCP_BUF->flags = TCP_ACK;
-        goto tcp_send_noopts;
+        goto tcp_send_ack;
       }
     }
     goto drop;
@@ -2228,10 +2392,26 @@ uip_process(uint8_t flag)
   }
   goto drop;
 
+#if UIP_TCP_WINDOW
+  /* Resend the oldest segment from the retransmit buffer. */
+  tcp_send_rexmit:
+  uip_appdata = uip_sappdata;
+  uip_len = uip_tcp_window_rexmit(uip_connr, uip_appdata) + UIP_TCPIP_HLEN;
+  UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+  goto tcp_send_noopts;
+#endif /* UIP_TCP_WINDOW */
+
   /* We jump here when we are ready to send the packet, and just want
      to set the appropriate TCP sequence numbers in the TCP header. */
   tcp_send_ack:
   UIP_TCP_BUF->flags = TCP_ACK;
+#if UIP_TCP_WINDOW
+  /* Acknowledge with the sequence number following the data in
+     flight, which the peer may already have received. */
+  if(uip_connr->rtxq != NULL) {
+    snd_off = uip_connr->len;
+  }
+#endif /* UIP_TCP_WINDOW */
 
   tcp_send_nodata:
   uip_len = UIP_IPTCPH_LEN;
@@ -2255,6 +2435,16 @@ uip_process(uint8_t flag)
   UIP_TCP_BUF->seqno[1] = uip_connr->snd_nxt[1];
   UIP_TCP_BUF->seqno[2] = uip_connr->snd_nxt[2];
   UIP_TCP_BUF->seqno[3] = uip_connr->snd_nxt[3];
+#if UIP_TCP_WINDOW
+  if(snd_off > 0) {
+    uip_add32(uip_connr->snd_nxt, snd_off);
+    UIP_TCP_BUF->seqno[0] = uip_acc32[0];
+    UIP_TCP_BUF->seqno[1] = uip_acc32[1];
+    UIP_TCP_BUF->seqno[2] = uip_acc32[2];
+    UIP_TCP_BUF->seqno[3] = uip_acc32[3];
+    snd_off = 0;
+  }
+#endif /* UIP_TCP_WINDOW */
 
   UIP_TCP_BUF->srcport  = uip_connr->lport;
   UIP_TCP_BUF->destport = uip_connr->rport;
@@ -33,7 +33,8 @@
 /**
  * \file
  *         Protects against replay attacks by comparing with the last
- *         unicast or broadcast frame counter of the sender.
+ *         unicast or broadcast frame counter of the sender, and with a
+ *         bitmap of the frame counters received before it.
  * \author
  *         Konrad Krentz <konrad.krentz@gmail.com>
  */
@@ -52,6 +53,8 @@
 /* This node's current frame counter value */
 static uint32_t counter;
 
+struct anti_replay_stats anti_replay_stats;
+
 /*---------------------------------------------------------------------------*/
 void
 anti_replay_set_counter(void)
@@ -82,6 +85,51 @@ anti_replay_init_info(struct anti_replay_info *info)
   info->last_broadcast_counter
       = info->last_unicast_counter
       = anti_replay_get_counter();
+#if ANTI_REPLAY_WINDOW_SIZE
+  info->broadcast_window = info->unicast_window = 1;
+#endif /* ANTI_REPLAY_WINDOW_SIZE */
+}
+/*---------------------------------------------------------------------------*/
+#if ANTI_REPLAY_WINDOW_SIZE
+#define WINDOW(info, type) (&(info)->type##_window)
+#else /* ANTI_REPLAY_WINDOW_SIZE */
+#define WINDOW(info, type) NULL
+#endif /* ANTI_REPLAY_WINDOW_SIZE */
+
+static int
+was_replayed(uint32_t *last, anti_replay_window_t *window, uint32_t received)
+{
+#if ANTI_REPLAY_WINDOW_SIZE
+  uint32_t diff;
+  
+  if(received > *last) {
+    /* Slide the window forward */
+    diff = received - *last;
+    *window = diff < ANTI_REPLAY_WINDOW_SIZE ? (*window << diff) | 1 : 1;
+    *last = received;
+    return 0;
+  }
+  
+  diff = *last - received;
+  if(diff >= ANTI_REPLAY_WINDOW_SIZE) {
+    anti_replay_stats.too_old++;
+    return 1;
+  }
+  if(*window & ((anti_replay_window_t)1 << diff)) {
+    anti_replay_stats.replayed++;
+    return 1;
+  }
+  *window |= (anti_replay_window_t)1 << diff;
+  anti_replay_stats.reordered++;
+  return 0;
+#else /* ANTI_REPLAY_WINDOW_SIZE */
+  if(received <= *last) {
+    anti_replay_stats.replayed++;
+    return 1;
+  }
+  *last = received;
+  return 0;
+#endif /* ANTI_REPLAY_WINDOW_SIZE */
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -93,20 +141,12 @@ anti_replay_was_replayed(struct anti_replay_info *info)
   
   if(packetbuf_holds_broadcast()) {
     /* broadcast */
-    if(received_counter <= info->last_broadcast_counter) {
-      return 1;
-    } else {
-      info->last_broadcast_counter = received_counter;
-      return 0;
-    }
+    return was_replayed(&info->last_broadcast_counter,
+        WINDOW(info, broadcast), received_counter);
   } else {
     /* unicast */
-    if(received_counter <= info->last_unicast_counter) {
-      return 1;
-    } else {
-      info->last_unicast_counter = received_counter;
-      return 0;
-    }
+    return was_replayed(&info->last_unicast_counter,
+        WINDOW(info, unicast), received_counter);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -47,11 +47,45 @@
 
 #include "contiki.h"
 
+/*
+ * Number of frame counters in the window, including the last one, at
+ * most 64. Counters up to ANTI_REPLAY_WINDOW_SIZE - 1 before the last
+ * one are still accepted if they were not received yet. With 0, only
+ * frames newer than the last one are accepted, so reordered frames are
+ * dropped.
+ */
+#ifdef ANTI_REPLAY_CONF_WINDOW_SIZE
+#define ANTI_REPLAY_WINDOW_SIZE ANTI_REPLAY_CONF_WINDOW_SIZE
+#else /* ANTI_REPLAY_CONF_WINDOW_SIZE */
+#define ANTI_REPLAY_WINDOW_SIZE 0
+#endif /* ANTI_REPLAY_CONF_WINDOW_SIZE */
+
+#if ANTI_REPLAY_WINDOW_SIZE > 64
+#error ANTI_REPLAY_CONF_WINDOW_SIZE must be at most 64
+#elif ANTI_REPLAY_WINDOW_SIZE > 32
+typedef uint64_t anti_replay_window_t;
+#else
+typedef uint32_t anti_replay_window_t;
+#endif
+
 struct anti_replay_info {
   uint32_t last_broadcast_counter;
   uint32_t last_unicast_counter;
+#if ANTI_REPLAY_WINDOW_SIZE
+  /* Bit i is set if last_*_counter - i was received */
+  anti_replay_window_t broadcast_window;
+  anti_replay_window_t unicast_window;
+#endif /* ANTI_REPLAY_WINDOW_SIZE */
 };
 
+struct anti_replay_stats {
+  uint32_t reordered; /**< Accepted frames older than the last one */
+  uint32_t replayed;  /**< Rejected frames that were received before */
+  uint32_t too_old;   /**< Rejected frames older than the window */
+};
+
+extern struct anti_replay_stats anti_replay_stats;
+
 /**
  * \brief Sets the frame counter packetbuf attributes.
  */
@@ -47,6 +47,7 @@
 #include "lib/random.h"
 
 #include "net/netstack.h"
+#include "net/nbr-table.h"
 
 #include "lib/list.h"
 #include "lib/memb.h"
@@ -93,6 +94,24 @@
 #define CSMA_MAX_MAX_FRAME_RETRIES 7
 #endif
 
+/* Look up neighbor queues through a neighbor table instead of walking
+   the list of queues. Queues for the broadcast address, and queues
+   that did not get a neighbor table entry, are still found in the list. */
+#ifdef CSMA_CONF_NEIGHBOR_INDEX
+#define CSMA_NEIGHBOR_INDEX CSMA_CONF_NEIGHBOR_INDEX
+#else
+#define CSMA_NEIGHBOR_INDEX 0
+#endif
+
+/* Set the frame pending bit on all but the last queued frame for a
+   neighbor, so that the whole queue goes out in one burst, and do not
+   back off between the frames of a burst. */
+#ifdef CSMA_CONF_BURST
+#define CSMA_BURST CSMA_CONF_BURST
+#else
+#define CSMA_BURST 0
+#endif
+
 /* Packet metadata */
 struct qbuf_metadata {
   mac_callback_t sent;
@@ -107,6 +126,9 @@ struct neighbor_queue {
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions;
+#if CSMA_NEIGHBOR_INDEX
+  uint8_t indexed;
+#endif
   LIST_STRUCT(queued_packet_list);
 };
 
@@ -130,13 +152,101 @@ MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
 LIST(neighbor_list);
 
+#if CSMA_NEIGHBOR_INDEX
+NBR_TABLE(struct neighbor_queue *, neighbor_index);
+/* Number of queues that are only in neighbor_list */
+static uint8_t unindexed;
+#endif /* CSMA_NEIGHBOR_INDEX */
+
+#if CSMA_BURST
+/* The queue being sent by NETSTACK_RDC.send_list(), NULL once freed */
+static struct neighbor_queue *burst;
+#endif /* CSMA_BURST */
+
 static void packet_sent(void *ptr, int status, int num_transmissions);
 static void transmit_packet_list(void *ptr);
+static void schedule_transmission(struct neighbor_queue *n);
+/*---------------------------------------------------------------------------*/
+#if CSMA_NEIGHBOR_INDEX
+static void
+index_add(struct neighbor_queue *n)
+{
+  struct neighbor_queue **entry;
+
+  entry = NULL;
+  if(!linkaddr_cmp(&n->addr, &linkaddr_null)) {
+    entry = nbr_table_add_lladdr(neighbor_index, &n->addr,
+                                 NBR_TABLE_REASON_MAC, NULL);
+  }
+  if(entry != NULL) {
+    *entry = n;
+    /* Keep the entry for as long as packets are queued. */
+    nbr_table_lock(neighbor_index, entry);
+    n->indexed = 1;
+  } else {
+    n->indexed = 0;
+    unindexed++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(struct neighbor_queue *n)
+{
+  struct neighbor_queue **entry;
+
+  if(n->indexed) {
+    entry = nbr_table_get_from_lladdr(neighbor_index, &n->addr);
+    if(entry != NULL) {
+      nbr_table_remove(neighbor_index, entry);
+    }
+  } else {
+    unindexed--;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_evicted(nbr_table_item_t *item)
+{
+  /* A locked entry can only be removed by NBR_TABLE_FIND_REMOVABLE. */
+  struct neighbor_queue *n = *(struct neighbor_queue **)item;
+
+  n->indexed = 0;
+  unindexed++;
+}
+#endif /* CSMA_NEIGHBOR_INDEX */
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_queue_free(struct neighbor_queue *n)
+{
+#if CSMA_NEIGHBOR_INDEX
+  index_remove(n);
+#endif
+#if CSMA_BURST
+  if(burst == n) {
+    burst = NULL;
+  }
+#endif
+  list_remove(neighbor_list, n);
+  memb_free(&neighbor_memb, n);
+}
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
 {
-  struct neighbor_queue *n = list_head(neighbor_list);
+  struct neighbor_queue *n;
+#if CSMA_NEIGHBOR_INDEX
+  struct neighbor_queue **entry;
+
+  entry = nbr_table_get_from_lladdr(neighbor_index, addr);
+  if(entry != NULL) {
+    return *entry;
+  }
+  if(unindexed == 0) {
+    return NULL;
+  }
+#endif /* CSMA_NEIGHBOR_INDEX */
+
+  n = list_head(neighbor_list);
   while(n != NULL) {
     if(linkaddr_cmp(&n->addr, addr)) {
       return n;
@@ -163,6 +273,27 @@ backoff_period(void)
   return time;
 }
 /*---------------------------------------------------------------------------*/
+#if CSMA_BURST
+static void
+set_pending(struct rdc_buf_list *q)
+{
+  /* Every frame but the last one announces that more frames follow.
+     Frames only leave the queue from its head, so a frame that has
+     the bit set never becomes the last one. */
+  for(; list_item_next(q) != NULL; q = list_item_next(q)) {
+    if(!queuebuf_attr(q->buf, PACKETBUF_ATTR_PENDING)) {
+      queuebuf_to_packetbuf(q->buf);
+      packetbuf_set_attr(PACKETBUF_ATTR_PENDING, 1);
+      if(!queuebuf_update_attr_from_packetbuf(q->buf)) {
+        /* The frame is sent without the bit, the receiver may then
+           turn its radio off before the next one */
+        PRINTF("csma: could not set the pending bit\n");
+      }
+    }
+  }
+}
+#endif /* CSMA_BURST */
+/*---------------------------------------------------------------------------*/
 static void
 transmit_packet_list(void *ptr)
 {
@@ -172,8 +303,21 @@ transmit_packet_list(void *ptr)
     if(q != NULL) {
       PRINTF("csma: preparing number %d %p, queue len %d\n", n->transmissions, q,
           list_length(n->queued_packet_list));
+#if CSMA_BURST
+      set_pending(q);
+      burst = n;
+#endif /* CSMA_BURST */
       /* Send packets in the neighbor's list */
       NETSTACK_RDC.send_list(packet_sent, n, q);
+#if CSMA_BURST
+      /* Frames that the RDC layer did not get to, without a failure
+         that already scheduled a retransmission, are sent next. */
+      if(burst != NULL && list_head(n->queued_packet_list) != NULL &&
+         ctimer_expired(&n->transmit_timer)) {
+        schedule_transmission(n);
+      }
+      burst = NULL;
+#endif /* CSMA_BURST */
     }
   }
 }
@@ -214,13 +358,18 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p, int status)
       /* There is a next packet. We reset current tx information */
       n->transmissions = 0;
       n->collisions = CSMA_MIN_BE;
+#if CSMA_BURST
+      /* The next packet is in the burst that is being sent. */
+      if(burst == n) {
+        return;
+      }
+#endif /* CSMA_BURST */
       /* Schedule next transmissions */
       schedule_transmission(n);
     } else {
       /* This was the last packet in the queue, we free the neighbor */
       ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      neighbor_queue_free(n);
     }
   }
 }
@@ -260,7 +409,9 @@ rexmit(struct rdc_buf_list *q, struct neighbor_queue *n)
   schedule_transmission(n);
   /* This is needed to correctly attribute energy that we spent
      transmitting this packet. */
-  queuebuf_update_attr_from_packetbuf(q->buf);
+  if(!queuebuf_update_attr_from_packetbuf(q->buf)) {
+    PRINTF("csma: could not update the attributes of %p\n", q);
+  }
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -396,6 +547,9 @@ send_packet(mac_callback_t sent, void *ptr)
       LIST_STRUCT_INIT(n, queued_packet_list);
       /* Add neighbor to the list */
       list_add(neighbor_list, n);
+#if CSMA_NEIGHBOR_INDEX
+      index_add(n);
+#endif /* CSMA_NEIGHBOR_INDEX */
     }
   }
 
@@ -445,8 +599,7 @@ send_packet(mac_callback_t sent, void *ptr)
       }
       /* The packet allocation failed. Remove and free neighbor entry if empty. */
       if(list_length(n->queued_packet_list) == 0) {
-        list_remove(neighbor_list, n);
-        memb_free(&neighbor_memb, n);
+        neighbor_queue_free(n);
       }
     } else {
       PRINTF("csma: Neighbor queue full\n");
@@ -491,6 +644,9 @@ init(void)
   memb_init(&packet_memb);
   memb_init(&metadata_memb);
   memb_init(&neighbor_memb);
+#if CSMA_NEIGHBOR_INDEX
+  nbr_table_register(neighbor_index, index_evicted);
+#endif /* CSMA_NEIGHBOR_INDEX */
 }
 /*---------------------------------------------------------------------------*/
 const struct mac_driver csma_driver = {
@@ -69,6 +69,88 @@ MEMB(slotframe_memb, struct tsch_slotframe, TSCH_SCHEDULE_MAX_SLOTFRAMES);
 /* List of slotframes (each slotframe holds its own list of links) */
 LIST(slotframe_list);
 
+#if TSCH_SCHEDULE_LINK_INDEX
+/* All links, grouped by slotframe in the order of slotframe_list, and
+ * sorted by timeslot within each slotframe. There is at most one link
+ * per timeslot in a slotframe. */
+static struct tsch_link *link_index[TSCH_SCHEDULE_MAX_LINKS];
+static uint16_t link_index_size;
+
+/* Recomputes the start of the range of each slotframe */
+static void
+index_update_ranges(void)
+{
+  struct tsch_slotframe *sf;
+  uint16_t start = 0;
+  for(sf = list_head(slotframe_list); sf != NULL; sf = list_item_next(sf)) {
+    sf->index_start = start;
+    start += sf->index_count;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the position within the slotframe range of the first link
+ * with a timeslot after the given one, or index_count if there is none */
+static uint16_t
+index_upper_bound(struct tsch_slotframe *sf, uint16_t timeslot)
+{
+  uint16_t low = 0;
+  uint16_t high = sf->index_count;
+  while(low < high) {
+    uint16_t mid = (low + high) / 2;
+    if(link_index[sf->index_start + mid]->timeslot <= timeslot) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_insert(struct tsch_slotframe *sf, struct tsch_link *l)
+{
+  uint16_t pos = sf->index_start + index_upper_bound(sf, l->timeslot);
+  memmove(&link_index[pos + 1], &link_index[pos],
+          (link_index_size - pos) * sizeof(link_index[0]));
+  link_index[pos] = l;
+  link_index_size++;
+  sf->index_count++;
+  index_update_ranges();
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(struct tsch_slotframe *sf, struct tsch_link *l)
+{
+  uint16_t pos;
+  for(pos = sf->index_start; pos < sf->index_start + sf->index_count; pos++) {
+    if(link_index[pos] == l) {
+      memmove(&link_index[pos], &link_index[pos + 1],
+              (link_index_size - pos - 1) * sizeof(link_index[0]));
+      link_index_size--;
+      sf->index_count--;
+      index_update_ranges();
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the first link of the slotframe after the given timeslot,
+ * wrapping around to the first link of the slotframe */
+static struct tsch_link *
+index_next_link(struct tsch_slotframe *sf, uint16_t timeslot)
+{
+  uint16_t i;
+  if(sf->index_count == 0) {
+    return NULL;
+  }
+  i = index_upper_bound(sf, timeslot);
+  if(i == sf->index_count) {
+    i = 0;
+  }
+  return link_index[sf->index_start + i];
+}
+#endif /* TSCH_SCHEDULE_LINK_INDEX */
+
 /* Adds and returns a slotframe (NULL if failure) */
 struct tsch_slotframe *
 tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
@@ -91,6 +173,10 @@ tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
       LIST_STRUCT_INIT(sf, links_list);
       /* Add the slotframe to the global list */
       list_add(slotframe_list, sf);
+#if TSCH_SCHEDULE_LINK_INDEX
+      sf->index_count = 0;
+      index_update_ranges();
+#endif /* TSCH_SCHEDULE_LINK_INDEX */
     }
     PRINTF("TSCH-schedule: add_slotframe %u %u\n",
            handle, size);
@@ -129,6 +215,9 @@ tsch_schedule_remove_slotframe(struct tsch_slotframe *slotframe)
       PRINTF("TSCH-schedule: remove slotframe %u %u\n", slotframe->handle, slotframe->size.val);
       memb_free(&slotframe_memb, slotframe);
       list_remove(slotframe_list, slotframe);
+#if TSCH_SCHEDULE_LINK_INDEX
+      index_update_ranges();
+#endif /* TSCH_SCHEDULE_LINK_INDEX */
       tsch_release_lock();
       return 1;
     }
@@ -209,6 +298,9 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
           address = &linkaddr_null;
         }
         linkaddr_copy(&l->addr, address);
+#if TSCH_SCHEDULE_LINK_INDEX
+        index_insert(slotframe, l);
+#endif /* TSCH_SCHEDULE_LINK_INDEX */
 
         PRINTF("TSCH-schedule: add_link %u %u %u %u %u %u\n",
                slotframe->handle, link_options, link_type, timeslot, channel_offset, TSCH_LOG_ID_FROM_LINKADDR(address));
@@ -256,6 +348,9 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
              TSCH_LOG_ID_FROM_LINKADDR(&l->addr));
 
       list_remove(slotframe->links_list, l);
+#if TSCH_SCHEDULE_LINK_INDEX
+      index_remove(slotframe, l);
+#endif /* TSCH_SCHEDULE_LINK_INDEX */
       memb_free(&link_memb, l);
 
       /* Release the lock before we update the neighbor (will take the lock) */
@@ -294,6 +389,13 @@ tsch_schedule_get_link_by_timeslot(struct tsch_slotframe *slotframe, uint16_t ti
 {
   if(!tsch_is_locked()) {
     if(slotframe != NULL) {
+#if TSCH_SCHEDULE_LINK_INDEX
+      uint16_t i = index_upper_bound(slotframe, timeslot);
+      if(i > 0 && link_index[slotframe->index_start + i - 1]->timeslot == timeslot) {
+        return link_index[slotframe->index_start + i - 1];
+      }
+      return NULL;
+#else /* TSCH_SCHEDULE_LINK_INDEX */
       struct tsch_link *l = list_head(slotframe->links_list);
       /* Loop over all items. Assume there is max one link per timeslot */
       while(l != NULL) {
@@ -303,6 +405,7 @@ tsch_schedule_get_link_by_timeslot(struct tsch_slotframe *slotframe, uint16_t ti
         l = list_item_next(l);
       }
       return l;
+#endif /* TSCH_SCHEDULE_LINK_INDEX */
     }
   }
   return NULL;
@@ -325,7 +428,13 @@ tsch_schedule_get_next_active_link(struct asn_t *asn, uint16_t *time_offset,
     while(sf != NULL) {
       /* Get timeslot from ASN, given the slotframe length */
       uint16_t timeslot = ASN_MOD(*asn, sf->size);
+#if TSCH_SCHEDULE_LINK_INDEX
+      /* Timeslots are unique within a slotframe, so only the first link
+       * after the current timeslot can be the earliest of this slotframe */
+      struct tsch_link *l = index_next_link(sf, timeslot);
+#else /* TSCH_SCHEDULE_LINK_INDEX */
       struct tsch_link *l = list_head(sf->links_list);
+#endif /* TSCH_SCHEDULE_LINK_INDEX */
       while(l != NULL) {
         uint16_t time_to_timeslot =
           l->timeslot > timeslot ?
@@ -369,7 +478,11 @@ tsch_schedule_get_next_active_link(struct asn_t *asn, uint16_t *time_offset,
           }
         }
 
+#if TSCH_SCHEDULE_LINK_INDEX
+        l = NULL;
+#else /* TSCH_SCHEDULE_LINK_INDEX */
         l = list_item_next(l);
+#endif /* TSCH_SCHEDULE_LINK_INDEX */
       }
       sf = list_item_next(sf);
     }
@@ -391,6 +504,9 @@ tsch_schedule_init(void)
     memb_init(&link_memb);
     memb_init(&slotframe_memb);
     list_init(slotframe_list);
+#if TSCH_SCHEDULE_LINK_INDEX
+    link_index_size = 0;
+#endif /* TSCH_SCHEDULE_LINK_INDEX */
     tsch_release_lock();
     return 1;
   } else {
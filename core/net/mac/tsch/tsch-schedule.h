@@ -72,6 +72,15 @@
 #define TSCH_SCHEDULE_MAX_LINKS 32
 #endif
 
+/* Keep an index of the links of each slotframe sorted by timeslot, so
+ * that finding the next active link takes a binary search per slotframe
+ * instead of a walk over every link. Costs one pointer per link. */
+#ifdef TSCH_SCHEDULE_CONF_LINK_INDEX
+#define TSCH_SCHEDULE_LINK_INDEX TSCH_SCHEDULE_CONF_LINK_INDEX
+#else
+#define TSCH_SCHEDULE_LINK_INDEX 0
+#endif
+
 /********** Constants *********/
 
 /* Link options */
@@ -122,6 +131,11 @@ struct tsch_slotframe {
   struct asn_divisor_t size;
   /* List of links belonging to this slotframe */
   LIST_STRUCT(links_list);
+#if TSCH_SCHEDULE_LINK_INDEX
+  /* Range of the links of this slotframe in the link index */
+  uint16_t index_start;
+  uint16_t index_count;
+#endif /* TSCH_SCHEDULE_LINK_INDEX */
 };
 
 /********** Functions *********/
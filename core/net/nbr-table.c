@@ -83,6 +83,21 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_HASH
+/* Open-addressing hash index over the keys in nbr_table_keys, using
+ * linear probing. A slot holds the neighbor index plus one, or zero
+ * if it is free. */
+#if NBR_TABLE_MAX_NEIGHBORS < 255
+typedef uint8_t nbr_table_slot_t;
+#else
+typedef uint16_t nbr_table_slot_t;
+#endif
+#if NBR_TABLE_HASH_SIZE <= NBR_TABLE_MAX_NEIGHBORS
+#error NBR_TABLE_HASH_SIZE must be larger than NBR_TABLE_MAX_NEIGHBORS
+#endif
+static nbr_table_slot_t hash_slots[NBR_TABLE_HASH_SIZE];
+#endif /* NBR_TABLE_HASH */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -126,16 +141,95 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
   return key_from_index(index_from_item(table, item));
 }
 /*---------------------------------------------------------------------------*/
+#if NBR_TABLE_HASH
+/* Get the home slot of a link-layer address in the hash index */
+static unsigned
+hash_lladdr(const linkaddr_t *lladdr)
+{
+  unsigned h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = h * 31 + lladdr->u8[i];
+  }
+  return h % NBR_TABLE_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+/* Add a key that was just put on nbr_table_keys to the hash index */
+static void
+hash_insert(nbr_table_key_t *key)
+{
+  unsigned slot;
+
+  slot = hash_lladdr(&key->lladdr);
+  while(hash_slots[slot] != 0) {
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+  hash_slots[slot] = index_from_key(key) + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a key from the hash index */
+static void
+hash_remove(nbr_table_key_t *key)
+{
+  unsigned slot, next, home;
+
+  slot = hash_lladdr(&key->lladdr);
+  while(hash_slots[slot] != index_from_key(key) + 1) {
+    if(hash_slots[slot] == 0) {
+      return;
+    }
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+
+  /* Shift back the following entries of the probe sequence, so that
+   * no free slot is left between an entry and its home slot. */
+  next = slot;
+  for(;;) {
+    hash_slots[slot] = 0;
+    do {
+      next = (next + 1) % NBR_TABLE_HASH_SIZE;
+      if(hash_slots[next] == 0) {
+        return;
+      }
+      home = hash_lladdr(&key_from_index(hash_slots[next] - 1)->lladdr);
+      /* Keep looking while the entry's home lies cyclically in
+       * (slot, next]; such an entry cannot move to slot. */
+    } while(slot <= next ? (slot < home && home <= next)
+            : (slot < home || home <= next));
+    hash_slots[slot] = hash_slots[next];
+    slot = next;
+  }
+}
+#endif /* NBR_TABLE_HASH */
+/*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
 {
+#if NBR_TABLE_HASH
+  unsigned slot;
+  int index;
+#else /* NBR_TABLE_HASH */
   nbr_table_key_t *key;
+#endif /* NBR_TABLE_HASH */
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by linkaddr_null. */
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_HASH
+  slot = hash_lladdr(lladdr);
+  while(hash_slots[slot] != 0) {
+    index = hash_slots[slot] - 1;
+    if(linkaddr_cmp(lladdr, &key_from_index(index)->lladdr)) {
+      return index;
+    }
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+  return -1;
+#else /* NBR_TABLE_HASH */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -144,6 +238,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     key = list_item_next(key);
   }
   return -1;
+#endif /* NBR_TABLE_HASH */
 }
 /*---------------------------------------------------------------------------*/
 /* Get bit from "used" or "locked" bitmap */
@@ -267,6 +362,9 @@ nbr_table_allocate(nbr_table_reason_t reason, void *data)
       used_map[index_from_key(least_used_key)] = 0;
       /* Remove neighbor from list */
       list_remove(nbr_table_keys, least_used_key);
+#if NBR_TABLE_HASH
+      hash_remove(least_used_key);
+#endif /* NBR_TABLE_HASH */
       /* Return associated key */
       return least_used_key;
     }
@@ -354,6 +452,9 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr, nbr_table_rea
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH
+    hash_insert(key);
+#endif /* NBR_TABLE_HASH */
   }
 
   /* Get item in the current table */
@@ -51,6 +51,9 @@
 
 struct packetbuf_attr packetbuf_attrs[PACKETBUF_NUM_ATTRS];
 struct packetbuf_addr packetbuf_addrs[PACKETBUF_NUM_ADDRS];
+#if PACKETBUF_SAVED_ATTRS
+uint8_t packetbuf_attr_bits[PACKETBUF_ATTR_BITS_SIZE];
+#endif /* PACKETBUF_SAVED_ATTRS */
 
 
 static uint16_t buflen, bufptr;
@@ -189,6 +192,9 @@ packetbuf_attr_clear(void)
 {
   int i;
   memset(packetbuf_attrs, 0, sizeof(packetbuf_attrs));
+#if PACKETBUF_SAVED_ATTRS
+  memset(packetbuf_attr_bits, 0, sizeof(packetbuf_attr_bits));
+#endif /* PACKETBUF_SAVED_ATTRS */
   for(i = 0; i < PACKETBUF_NUM_ADDRS; ++i) {
     linkaddr_copy(&packetbuf_addrs[i].addr, &linkaddr_null);
   }
@@ -208,13 +214,124 @@ packetbuf_attr_copyfrom(struct packetbuf_attr *attrs,
 {
   memcpy(packetbuf_attrs, attrs, sizeof(packetbuf_attrs));
   memcpy(packetbuf_addrs, addrs, sizeof(packetbuf_addrs));
+#if PACKETBUF_SAVED_ATTRS
+  {
+    int i;
+    for(i = 0; i < PACKETBUF_NUM_ATTRS; i++) {
+      PACKETBUF_ATTR_TRACK(i, packetbuf_attrs[i].val);
+    }
+  }
+#endif /* PACKETBUF_SAVED_ATTRS */
+}
+/*---------------------------------------------------------------------------*/
+#if PACKETBUF_SAVED_ATTRS
+/* The number of attributes set in bits, up to but not including type */
+static uint8_t
+count_bits(const uint8_t *bits, int type)
+{
+  /* The number of bits set in each nibble */
+  static const uint8_t nibble_bits[16] = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+  };
+  uint8_t num, last;
+  int i;
+
+  num = 0;
+  for(i = 0; i < type >> 3; i++) {
+    num += nibble_bits[bits[i] & 0x0f] + nibble_bits[bits[i] >> 4];
+  }
+  if(type & 7) {
+    last = bits[i] & ((1 << (type & 7)) - 1);
+    num += nibble_bits[last & 0x0f] + nibble_bits[last >> 4];
+  }
+  return num;
+}
+/*---------------------------------------------------------------------------*/
+int
+packetbuf_attr_save(struct packetbuf_saved_attrs *saved)
+{
+  uint8_t bits, num, type;
+  int i;
+
+  if(count_bits(packetbuf_attr_bits, PACKETBUF_ATTR_BITS_SIZE * 8) >
+     PACKETBUF_SAVED_ATTRS) {
+    /* Leave the saved attributes as they were. */
+    PRINTF("packetbuf: more than %d attributes set\n",
+           PACKETBUF_SAVED_ATTRS);
+    return 0;
+  }
+
+  memcpy(saved->bits, packetbuf_attr_bits, sizeof(saved->bits));
+  num = 0;
+  for(i = 0; i < PACKETBUF_ATTR_BITS_SIZE; i++) {
+    /* Most attributes are not set, so skip eight at a time. */
+    for(bits = packetbuf_attr_bits[i], type = i * 8; bits != 0;
+        bits >>= 1, type++) {
+      if(bits & 1) {
+        saved->vals[num++] = packetbuf_attrs[type].val;
+      }
+    }
+  }
+  memcpy(saved->addrs, packetbuf_addrs, sizeof(packetbuf_addrs));
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_attr_restore(const struct packetbuf_saved_attrs *saved)
+{
+  uint8_t bits, num, type;
+  int i;
+
+  memset(packetbuf_attrs, 0, sizeof(packetbuf_attrs));
+  memcpy(packetbuf_attr_bits, saved->bits, sizeof(saved->bits));
+  num = 0;
+  for(i = 0; i < PACKETBUF_ATTR_BITS_SIZE; i++) {
+    for(bits = saved->bits[i], type = i * 8; bits != 0;
+        bits >>= 1, type++) {
+      if(bits & 1) {
+        packetbuf_attrs[type].val = saved->vals[num++];
+      }
+    }
+  }
+  memcpy(packetbuf_addrs, saved->addrs, sizeof(packetbuf_addrs));
+}
+/*---------------------------------------------------------------------------*/
+packetbuf_attr_t
+packetbuf_saved_attr(const struct packetbuf_saved_attrs *saved, uint8_t type)
+{
+  if(!(saved->bits[type >> 3] & (1 << (type & 7)))) {
+    return 0;
+  }
+  return saved->vals[count_bits(saved->bits, type)];
+}
+#else /* PACKETBUF_SAVED_ATTRS */
+int
+packetbuf_attr_save(struct packetbuf_saved_attrs *saved)
+{
+  packetbuf_attr_copyto(saved->attrs, saved->addrs);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_attr_restore(const struct packetbuf_saved_attrs *saved)
+{
+  memcpy(packetbuf_attrs, saved->attrs, sizeof(packetbuf_attrs));
+  memcpy(packetbuf_addrs, saved->addrs, sizeof(packetbuf_addrs));
+}
+/*---------------------------------------------------------------------------*/
+packetbuf_attr_t
+packetbuf_saved_attr(const struct packetbuf_saved_attrs *saved, uint8_t type)
+{
+  return saved->attrs[type].val;
 }
+#endif /* PACKETBUF_SAVED_ATTRS */
 /*---------------------------------------------------------------------------*/
 #if !PACKETBUF_CONF_ATTRS_INLINE
 int
 packetbuf_set_attr(uint8_t type, const packetbuf_attr_t val)
 {
   packetbuf_attrs[type].val = val;
+  PACKETBUF_ATTR_TRACK(type, val);
   return 1;
 }
 /*---------------------------------------------------------------------------*/
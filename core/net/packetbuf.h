@@ -72,6 +72,21 @@
 #define PACKETBUF_WITH_PACKET_TYPE NETSTACK_CONF_WITH_RIME
 #endif
 
+/**
+ * \brief      The number of attributes kept with a saved packet
+ *
+ *             When non-zero, struct packetbuf_saved_attrs holds only
+ *             the attributes that are set, up to this many, instead
+ *             of all of them. This saves RAM in every queuebuf. A
+ *             packet with more attributes set cannot be queued. When
+ *             zero, all attributes are saved.
+ */
+#ifdef PACKETBUF_CONF_SAVED_ATTRS
+#define PACKETBUF_SAVED_ATTRS PACKETBUF_CONF_SAVED_ATTRS
+#else
+#define PACKETBUF_SAVED_ATTRS 0
+#endif
+
 /**
  * \brief      Clear and reset the packetbuf
  *
@@ -298,6 +313,34 @@ enum {
 
 #define PACKETBUF_IS_ADDR(type) ((type) >= PACKETBUF_ADDR_FIRST)
 
+#if PACKETBUF_SAVED_ATTRS
+/* One bit per attribute, set when the attribute is non-zero */
+extern uint8_t packetbuf_attr_bits[];
+#define PACKETBUF_ATTR_BITS_SIZE ((PACKETBUF_NUM_ATTRS + 7) / 8)
+#define PACKETBUF_ATTR_TRACK(type, val) do {                    \
+    if(val) {                                                   \
+      packetbuf_attr_bits[(type) >> 3] |= 1 << ((type) & 7);    \
+    } else {                                                    \
+      packetbuf_attr_bits[(type) >> 3] &= ~(1 << ((type) & 7)); \
+    }                                                           \
+  } while(0)
+
+/* bits[] tells which attributes are set, and vals[] holds their
+   values in the same order */
+struct packetbuf_saved_attrs {
+  uint8_t bits[PACKETBUF_ATTR_BITS_SIZE];
+  packetbuf_attr_t vals[PACKETBUF_SAVED_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+};
+#else /* PACKETBUF_SAVED_ATTRS */
+#define PACKETBUF_ATTR_TRACK(type, val)
+
+struct packetbuf_saved_attrs {
+  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+};
+#endif /* PACKETBUF_SAVED_ATTRS */
+
 #if PACKETBUF_CONF_ATTRS_INLINE
 
 extern struct packetbuf_attr packetbuf_attrs[];
@@ -307,6 +350,7 @@ static inline int
 packetbuf_set_attr(uint8_t type, const packetbuf_attr_t val)
 {
   packetbuf_attrs[type].val = val;
+  PACKETBUF_ATTR_TRACK(type, val);
   return 1;
 }
 static inline packetbuf_attr_t
@@ -347,6 +391,26 @@ void              packetbuf_attr_copyto(struct packetbuf_attr *attrs,
 void              packetbuf_attr_copyfrom(struct packetbuf_attr *attrs,
 					struct packetbuf_addr *addrs);
 
+/**
+ * \brief      Save the attributes and addresses of the packetbuf
+ * \param saved Where to save them
+ * \retval     Non-zero if they were saved, zero if more than
+ *             PACKETBUF_SAVED_ATTRS attributes are set
+ */
+int               packetbuf_attr_save(struct packetbuf_saved_attrs *saved);
+
+/**
+ * \brief      Replace the attributes and addresses of the packetbuf
+ *             with saved ones
+ */
+void              packetbuf_attr_restore(const struct packetbuf_saved_attrs *saved);
+
+/**
+ * \brief      Get an attribute from saved attributes
+ */
+packetbuf_attr_t  packetbuf_saved_attr(const struct packetbuf_saved_attrs *saved,
+                                       uint8_t type);
+
 #define PACKETBUF_ATTRIBUTES(...) { __VA_ARGS__ PACKETBUF_ATTR_LAST }
 #define PACKETBUF_ATTR_LAST { PACKETBUF_ATTR_NONE, 0 }
 
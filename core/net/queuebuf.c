@@ -74,8 +74,7 @@ struct queuebuf {
 struct queuebuf_data {
   uint8_t data[PACKETBUF_SIZE];
   uint16_t len;
-  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
-  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  struct packetbuf_saved_attrs attrs;
 };
 
 MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
@@ -339,8 +338,24 @@ queuebuf_new_from_packetbuf(void)
     buframptr = buf->ram_ptr;
 #endif
 
+    if(!packetbuf_attr_save(&buframptr->attrs)) {
+      PRINTF("queuebuf_new_from_packetbuf: too many attributes\n");
+#if WITH_SWAP
+      if(buf->location == IN_RAM) {
+        memb_free(&buframmem, buf->ram_ptr);
+      } else {
+        tmpdata_qbuf = NULL;
+      }
+#else
+      memb_free(&buframmem, buf->ram_ptr);
+#endif
+#if QUEUEBUF_DEBUG
+      list_remove(queuebuf_list, buf);
+#endif /* QUEUEBUF_DEBUG */
+      memb_free(&bufmem, buf);
+      return NULL;
+    }
     buframptr->len = packetbuf_copyto(buframptr->data);
-    packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
 
 #if WITH_SWAP
     if(buf->location == IN_CFS) {
@@ -366,29 +381,38 @@ queuebuf_new_from_packetbuf(void)
   return buf;
 }
 /*---------------------------------------------------------------------------*/
-void
+int
 queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
-  packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+  if(!packetbuf_attr_save(&buframptr->attrs)) {
+    PRINTF("queuebuf_update_attr_from_packetbuf: too many attributes\n");
+    return 0;
+  }
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
     queuebuf_flush_tmpdata();
   }
 #endif
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
-void
+int
 queuebuf_update_from_packetbuf(struct queuebuf *buf)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
-  packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+  if(!packetbuf_attr_save(&buframptr->attrs)) {
+    /* Keep the old data too, so that it matches the old attributes */
+    PRINTF("queuebuf_update_from_packetbuf: too many attributes\n");
+    return 0;
+  }
   buframptr->len = packetbuf_copyto(buframptr->data);
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
     queuebuf_flush_tmpdata();
   }
 #endif
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -421,7 +445,7 @@ queuebuf_to_packetbuf(struct queuebuf *b)
   if(memb_inmemb(&bufmem, b)) {
     struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
     packetbuf_copyfrom(buframptr->data, buframptr->len);
-    packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
+    packetbuf_attr_restore(&buframptr->attrs);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -446,14 +470,14 @@ linkaddr_t *
 queuebuf_addr(struct queuebuf *b, uint8_t type)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
-  return &buframptr->addrs[type - PACKETBUF_ADDR_FIRST].addr;
+  return &buframptr->attrs.addrs[type - PACKETBUF_ADDR_FIRST].addr;
 }
 /*---------------------------------------------------------------------------*/
 packetbuf_attr_t
 queuebuf_attr(struct queuebuf *b, uint8_t type)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
-  return buframptr->attrs[type].val;
+  return packetbuf_saved_attr(&buframptr->attrs, type);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -95,8 +95,14 @@ struct queuebuf *queuebuf_new_from_packetbuf_debug(const char *file, int line);
 #else /* QUEUEBUF_DEBUG */
 struct queuebuf *queuebuf_new_from_packetbuf(void);
 #endif /* QUEUEBUF_DEBUG */
-void queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
-void queuebuf_update_from_packetbuf(struct queuebuf *b);
+
+/* Replace the attributes, or the attributes and the data, of a
+   queuebuf with those in packetbuf. Both return 1 on success, or 0 if
+   packetbuf has more attributes set than a queuebuf can hold. The
+   queuebuf is then left unchanged, data included, so that its data
+   and attributes always belong together. */
+int queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
+int queuebuf_update_from_packetbuf(struct queuebuf *b);
 
 void queuebuf_to_packetbuf(struct queuebuf *b);
 void queuebuf_free(struct queuebuf *b);
@@ -48,6 +48,7 @@
 #include "net/ip/tcpip.h"
 #include "net/ipv6/uip-ds6.h"
 #include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-ns.h"
 #include "net/packetbuf.h"
 
 #define DEBUG DEBUG_NONE
@@ -389,6 +390,277 @@ rpl_invert_header(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_NON_STORING
+/* Find the RPL source routing header of the packet in uip_buf, if
+   any. Only hop-by-hop and destination options headers may precede
+   it. */
+static struct uip_routing_hdr *
+srh_find(void)
+{
+  uint8_t *next;
+  uint8_t *hdr;
+  uint8_t *end;
+
+  next = &UIP_IP_BUF->proto;
+  hdr = (uint8_t *)UIP_IP_BUF + UIP_IPH_LEN;
+  end = (uint8_t *)UIP_IP_BUF + uip_len;
+
+  while(hdr + RPL_RH_LEN <= end) {
+    switch(*next) {
+    case UIP_PROTO_HBHO:
+    case UIP_PROTO_DESTO:
+      next = hdr;
+      hdr += (((struct uip_ext_hdr *)hdr)->len << 3) + 8;
+      break;
+    case UIP_PROTO_ROUTING:
+      if(((struct uip_routing_hdr *)hdr)->routing_type == RPL_RH_TYPE_SRH) {
+        return (struct uip_routing_hdr *)hdr;
+      }
+      return NULL;
+    default:
+      return NULL;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+count_matching_bytes(const void *p1, const void *p2, uint8_t n)
+{
+  uint8_t i;
+
+  for(i = 0; i < n; i++) {
+    if(((const uint8_t *)p1)[i] != ((const uint8_t *)p2)[i]) {
+      break;
+    }
+  }
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+static rpl_dag_t *
+ns_root_dag(void)
+{
+  if(RPL_IS_NON_STORING(default_instance) &&
+     default_instance->current_dag != NULL &&
+     default_instance->current_dag->rank == ROOT_RANK(default_instance)) {
+    return default_instance->current_dag;
+  }
+  return NULL;
+}
+#endif /* RPL_WITH_NON_STORING */
+/*---------------------------------------------------------------------------*/
+int
+rpl_insert_srh_header(void)
+{
+#if RPL_WITH_NON_STORING
+  rpl_dag_t *dag;
+  rpl_ns_node_t *dest_node;
+  rpl_ns_node_t *root_node;
+  rpl_ns_node_t *node;
+  uip_ipaddr_t node_addr;
+  struct uip_routing_hdr *rh;
+  struct rpl_srh_hdr *srh;
+  uint8_t *hop_ptr;
+  uint8_t cmpri;
+  uint16_t path_len;
+  uint8_t padding;
+  uint16_t payload_len;
+  uint16_t ext_len;
+
+  /* Only the root of a non-storing DODAG inserts source routes, and
+     only for destinations it has learned from DAOs. Everything else is
+     routed as usual. */
+  dag = ns_root_dag();
+  if(dag == NULL || uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) ||
+     srh_find() != NULL) {
+    return 0;
+  }
+
+  dest_node = rpl_ns_get_node(dag, &UIP_IP_BUF->destipaddr);
+  if(dest_node == NULL) {
+    return 0;
+  }
+
+  if(!rpl_ns_is_node_reachable(dag, &UIP_IP_BUF->destipaddr)) {
+    PRINTF("RPL: No source route to ");
+    PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+    PRINTF("\n");
+    return 1;
+  }
+
+  /* Packets going down carry the source route only. */
+  rpl_remove_header();
+
+  /* Count the hops between the destination and the child of the root
+     that the packet is first sent to, and find how many leading bytes
+     all their addresses share with the destination. */
+  root_node = rpl_ns_get_node(dag, &dag->dag_id);
+  cmpri = 15;
+  path_len = 0;
+  for(node = dest_node; node->parent != root_node; node = node->parent) {
+    rpl_ns_get_node_global_addr(&node_addr, node->parent);
+    cmpri = MIN(cmpri, count_matching_bytes(&node_addr,
+                                            &UIP_IP_BUF->destipaddr, 16));
+    path_len++;
+  }
+
+  if(path_len == 0) {
+    /* A direct child of the root: no source route needed. */
+    return 0;
+  }
+
+  ext_len = RPL_RH_LEN + RPL_SRH_LEN + path_len * (16 - cmpri);
+  padding = ext_len % 8 == 0 ? 0 : (8 - (ext_len % 8));
+  ext_len += padding;
+
+  /* uip_ext_len cannot describe a longer header. */
+  if(ext_len > 255) {
+    PRINTF("RPL: Source route of %u hops too long\n", path_len + 1);
+    return 1;
+  }
+
+  if(uip_len + ext_len > UIP_LINK_MTU ||
+     UIP_LLH_LEN + uip_len + ext_len > UIP_BUFSIZE) {
+    PRINTF("RPL: Packet too long for a source routing header\n");
+    return 1;
+  }
+
+  memmove(uip_buf + UIP_LLH_LEN + UIP_IPH_LEN + ext_len,
+          uip_buf + UIP_LLH_LEN + UIP_IPH_LEN, uip_len - UIP_IPH_LEN);
+  memset(uip_buf + UIP_LLH_LEN + UIP_IPH_LEN, 0, ext_len);
+
+  rh = (struct uip_routing_hdr *)(uip_buf + UIP_LLH_LEN + UIP_IPH_LEN);
+  srh = (struct rpl_srh_hdr *)((uint8_t *)rh + RPL_RH_LEN);
+  rh->next = UIP_IP_BUF->proto;
+  UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
+  rh->len = (ext_len - 8) / 8;
+  rh->routing_type = RPL_RH_TYPE_SRH;
+  rh->seg_left = path_len;
+  srh->cmpr = (cmpri << 4) | cmpri;
+  srh->pad = padding << 4;
+
+  /* Write the addresses from the last (the destination) to the
+     first. The first hop becomes the IPv6 destination address. */
+  hop_ptr = (uint8_t *)rh + ext_len - padding;
+  for(node = dest_node; node->parent != root_node; node = node->parent) {
+    rpl_ns_get_node_global_addr(&node_addr, node);
+    hop_ptr -= 16 - cmpri;
+    memcpy(hop_ptr, ((uint8_t *)&node_addr) + cmpri, 16 - cmpri);
+  }
+  rpl_ns_get_node_global_addr(&UIP_IP_BUF->destipaddr, node);
+
+  payload_len = ((UIP_IP_BUF->len[0] << 8) | UIP_IP_BUF->len[1]) + ext_len;
+  UIP_IP_BUF->len[0] = payload_len >> 8;
+  UIP_IP_BUF->len[1] = payload_len & 0xff;
+  uip_ext_len = ext_len;
+  uip_len += ext_len;
+
+  PRINTF("RPL: Inserted a source route of %u hops, next hop ",
+         (unsigned)path_len + 1);
+  PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+  PRINTF("\n");
+#endif /* RPL_WITH_NON_STORING */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_process_srh_header(void)
+{
+#if RPL_WITH_NON_STORING
+  struct uip_routing_hdr *rh;
+  struct rpl_srh_hdr *srh;
+  uip_ipaddr_t current_dest_addr;
+  uint8_t *addr_ptr;
+  uint8_t cmpri;
+  uint8_t cmpre;
+  uint8_t cmpr;
+  uint8_t padding;
+  uint8_t path_len;
+  uint16_t ext_len;
+
+  rh = srh_find();
+  if(rh == NULL || rh->seg_left == 0) {
+    /* No source route, or we are the final destination. */
+    return 0;
+  }
+
+  srh = (struct rpl_srh_hdr *)((uint8_t *)rh + RPL_RH_LEN);
+  ext_len = (rh->len << 3) + 8;
+  cmpri = srh->cmpr >> 4;
+  cmpre = srh->cmpr & 0x0f;
+  padding = srh->pad >> 4;
+
+  if(ext_len < RPL_RH_LEN + RPL_SRH_LEN + padding + (16 - cmpre) ||
+     (uint8_t *)rh + ext_len > (uint8_t *)UIP_IP_BUF + uip_len) {
+    PRINTF("RPL: Malformed source routing header\n");
+    return -1;
+  }
+  path_len = ((ext_len - padding - RPL_RH_LEN - RPL_SRH_LEN - (16 - cmpre))
+              / (16 - cmpri)) + 1;
+  if(rh->seg_left > path_len) {
+    PRINTF("RPL: Source routing header with %u segments left of %u\n",
+           rh->seg_left, path_len);
+    return -1;
+  }
+
+  /* Swap the IPv6 destination address and the next address in the
+     route, as per RFC 6554, section 4.2. */
+  addr_ptr = (uint8_t *)rh + RPL_RH_LEN + RPL_SRH_LEN +
+    (path_len - rh->seg_left) * (16 - cmpri);
+  cmpr = rh->seg_left == 1 ? cmpre : cmpri;
+  uip_ipaddr_copy(&current_dest_addr, &UIP_IP_BUF->destipaddr);
+  memcpy(((uint8_t *)&UIP_IP_BUF->destipaddr) + cmpr, addr_ptr, 16 - cmpr);
+  memcpy(addr_ptr, ((uint8_t *)&current_dest_addr) + cmpr, 16 - cmpr);
+  rh->seg_left--;
+
+  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) ||
+     uip_ds6_is_my_addr(&UIP_IP_BUF->destipaddr)) {
+    /* RFC 6554, section 4.2: multicast addresses are not allowed,
+       and an address of ours further down the route means a loop. */
+    PRINTF("RPL: Bad address in source routing header\n");
+    return -1;
+  }
+
+  PRINTF("RPL: Forwarding along source route to ");
+  PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+  PRINTF(", %u segments left\n", rh->seg_left);
+  return 1;
+#else /* RPL_WITH_NON_STORING */
+  return 0;
+#endif /* RPL_WITH_NON_STORING */
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_srh_get_next_hop(uip_ipaddr_t *ipaddr)
+{
+#if RPL_WITH_NON_STORING
+  rpl_dag_t *dag;
+  rpl_ns_node_t *dest_node;
+
+  if(srh_find() == NULL) {
+    /* Without a source routing header, the only packets that are
+       source routed are those from the root to its direct children. */
+    dag = ns_root_dag();
+    if(dag == NULL) {
+      return 0;
+    }
+    dest_node = rpl_ns_get_node(dag, &UIP_IP_BUF->destipaddr);
+    if(dest_node == NULL || dest_node->parent == NULL ||
+       dest_node->parent != rpl_ns_get_node(dag, &dag->dag_id)) {
+      return 0;
+    }
+  }
+
+  /* The IPv6 destination address is that of the next hop, which is a
+     neighbor: send to its link-local address. */
+  uip_ipaddr_copy(ipaddr, &UIP_IP_BUF->destipaddr);
+  uip_create_linklocal_prefix(ipaddr);
+  return 1;
+#else /* RPL_WITH_NON_STORING */
+  return 0;
+#endif /* RPL_WITH_NON_STORING */
+}
+/*---------------------------------------------------------------------------*/
 void
 rpl_insert_header(void)
 {
@@ -51,6 +51,7 @@
 #include "net/ipv6/uip-nd6.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-ns.h"
 #include "net/packetbuf.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
 #include "random.h"
@@ -627,6 +628,93 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
 #endif /* RPL_LEAF_ONLY */
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_NON_STORING
+static void
+dao_input_nonstoring(rpl_instance_t *instance, uip_ipaddr_t *dao_sender_addr,
+                     uint8_t flags, uint8_t sequence,
+                     unsigned char *buffer, int pos, int buffer_length)
+{
+  rpl_dag_t *dag;
+  uip_ipaddr_t prefix;
+  uip_ipaddr_t dao_parent_addr;
+  uint8_t lifetime;
+  uint8_t prefixlen;
+  uint8_t subopt_type;
+  int have_parent;
+  int len;
+  int i;
+
+  dag = instance->current_dag;
+  if(dag->rank != ROOT_RANK(instance)) {
+    /* In non-storing mode, DAOs are sent to the root only. */
+    PRINTF("RPL: Ignoring a non-storing mode DAO as we are not the root\n");
+    return;
+  }
+
+  lifetime = instance->default_lifetime;
+  prefixlen = 0;
+  have_parent = 0;
+  memset(&prefix, 0, sizeof(prefix));
+
+  for(i = pos; i < buffer_length; i += len) {
+    subopt_type = buffer[i];
+    if(subopt_type == RPL_OPTION_PAD1) {
+      len = 1;
+    } else {
+      /* The option consists of a two-byte header and a payload. */
+      len = 2 + buffer[i + 1];
+    }
+
+    switch(subopt_type) {
+    case RPL_OPTION_TARGET:
+      prefixlen = buffer[i + 3];
+      memset(&prefix, 0, sizeof(prefix));
+      memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
+      break;
+    case RPL_OPTION_TRANSIT:
+      lifetime = buffer[i + 5];
+      /* The transit option carries the global address of the parent. */
+      if(buffer[i + 1] >= RPL_NS_TRANSIT_LEN) {
+        memcpy(&dao_parent_addr, buffer + i + 6, sizeof(dao_parent_addr));
+        have_parent = 1;
+      }
+      break;
+    }
+  }
+
+  PRINTF("RPL: Non-storing DAO lifetime: %u, prefix ", (unsigned)lifetime);
+  PRINT6ADDR(&prefix);
+  PRINTF(" parent ");
+  PRINT6ADDR(&dao_parent_addr);
+  PRINTF("\n");
+
+  if(prefixlen != sizeof(prefix) * CHAR_BIT || !have_parent) {
+    PRINTF("RPL: Non-storing DAO without a host target and a parent\n");
+    return;
+  }
+
+  if(lifetime == RPL_ZERO_LIFETIME) {
+    PRINTF("RPL: No-Path DAO received\n");
+    rpl_ns_expire_parent(dag, &prefix, &dao_parent_addr);
+  } else if(rpl_ns_update_node(dag, &prefix, &dao_parent_addr,
+                                RPL_LIFETIME(instance, lifetime)) == NULL) {
+    RPL_STAT(rpl_stats.mem_overflows++);
+    PRINTF("RPL: Could not add a link after receiving a DAO\n");
+    if(flags & RPL_DAO_K_FLAG) {
+      dao_ack_output(instance, dao_sender_addr, sequence,
+                     RPL_DAO_ACK_UNABLE_TO_ADD_ROUTE_AT_ROOT);
+    }
+    return;
+  }
+
+  if(flags & RPL_DAO_K_FLAG) {
+    PRINTF("RPL: Sending DAO ACK\n");
+    dao_ack_output(instance, dao_sender_addr, sequence,
+                   RPL_DAO_ACK_UNCONDITIONAL_ACCEPT);
+  }
+}
+#endif /* RPL_WITH_NON_STORING */
+/*---------------------------------------------------------------------------*/
 static void
 dao_input(void)
 {
@@ -692,6 +780,14 @@ dao_input(void)
     pos += 16;
   }
 
+#if RPL_WITH_NON_STORING
+  if(RPL_IS_NON_STORING(instance)) {
+    dao_input_nonstoring(instance, &dao_sender_addr, flags, sequence,
+                         buffer, pos, buffer_length);
+    goto discard;
+  }
+#endif /* RPL_WITH_NON_STORING */
+
   learned_from = uip_is_addr_mcast(&dao_sender_addr) ?
                  RPL_ROUTE_FROM_MULTICAST_DAO : RPL_ROUTE_FROM_UNICAST_DAO;
 
@@ -1073,12 +1169,21 @@ dao_output_target_seq(rpl_parent_t *parent, uip_ipaddr_t *prefix,
 
   /* Create a transit information sub-option. */
   buffer[pos++] = RPL_OPTION_TRANSIT;
-  buffer[pos++] = 4;
+  buffer[pos++] = RPL_IS_NON_STORING(instance) ? RPL_NS_TRANSIT_LEN : 4;
   buffer[pos++] = 0; /* flags - ignored */
   buffer[pos++] = 0; /* path control - ignored */
   buffer[pos++] = 0; /* path seq - ignored */
   buffer[pos++] = lifetime;
 
+  if(RPL_IS_NON_STORING(instance) && rpl_get_parent_ipaddr(parent) != NULL) {
+    /* In non-storing mode the DAO goes to the root, which needs the
+       global address of our parent: the DODAG prefix followed by the
+       interface identifier of the parent's link-local address. */
+    memcpy(buffer + pos, &dag->prefix_info.prefix, 8);
+    memcpy(buffer + pos + 8, ((uint8_t *)rpl_get_parent_ipaddr(parent)) + 8, 8);
+    pos += 16;
+  }
+
   PRINTF("RPL: Sending a %sDAO with sequence number %u, lifetime %u, prefix ",
       lifetime == RPL_ZERO_LIFETIME ? "No-Path " : "", seq_no, lifetime);
   PRINT6ADDR(prefix);
@@ -1087,7 +1192,11 @@ dao_output_target_seq(rpl_parent_t *parent, uip_ipaddr_t *prefix,
   PRINTF("\n");
 
   if(rpl_get_parent_ipaddr(parent) != NULL) {
-    uip_icmp6_send(rpl_get_parent_ipaddr(parent), ICMP6_RPL, RPL_CODE_DAO, pos);
+    if(RPL_IS_NON_STORING(instance)) {
+      uip_icmp6_send(&dag->dag_id, ICMP6_RPL, RPL_CODE_DAO, pos);
+    } else {
+      uip_icmp6_send(rpl_get_parent_ipaddr(parent), ICMP6_RPL, RPL_CODE_DAO, pos);
+    }
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup uip6
+ * @{
+ */
+
+/**
+ * \file
+ *         RPL non-storing mode: the root keeps one parent link per
+ *         node in the DODAG, learned from DAOs, and computes source
+ *         routes from them on demand. Nodes other than the root keep
+ *         no downward routing state at all.
+ */
+
+#include "net/rpl/rpl-ns.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+
+#include <string.h>
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#if RPL_WITH_NON_STORING
+
+/* Lifetime of nodes that have only been seen as the parent of another
+   node, and of the root itself. */
+#define RPL_NS_INFINITE_LIFETIME 0xffffffff
+
+static int num_nodes;
+
+LIST(nodelist);
+MEMB(nodememb, rpl_ns_node_t, RPL_NS_LINK_NUM);
+
+/*---------------------------------------------------------------------------*/
+int
+rpl_ns_num_nodes(void)
+{
+  return num_nodes;
+}
+/*---------------------------------------------------------------------------*/
+static int
+node_matches_address(const rpl_dag_t *dag, const rpl_ns_node_t *node,
+                     const uip_ipaddr_t *addr)
+{
+  return addr != NULL
+      && node != NULL
+      && dag != NULL
+      && dag == node->dag
+      && !memcmp(addr, &((rpl_dag_t *)dag)->prefix_info.prefix, 8)
+      && !memcmp(((const unsigned char *)addr) + 8, node->link_identifier, 8);
+}
+/*---------------------------------------------------------------------------*/
+rpl_ns_node_t *
+rpl_ns_get_node(const rpl_dag_t *dag, const uip_ipaddr_t *addr)
+{
+  rpl_ns_node_t *l;
+
+  for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
+    if(node_matches_address(dag, l, addr)) {
+      return l;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_ns_is_node_reachable(const rpl_dag_t *dag, const uip_ipaddr_t *addr)
+{
+  int max_depth;
+  rpl_ns_node_t *node;
+  rpl_ns_node_t *root_node;
+
+  if(dag == NULL) {
+    return 0;
+  }
+
+  /* Walk up the parent links until we reach the root. The depth limit
+     guards against loops in the graph. */
+  max_depth = RPL_NS_LINK_NUM;
+  node = rpl_ns_get_node(dag, addr);
+  root_node = rpl_ns_get_node(dag, &dag->dag_id);
+  while(node != NULL && node != root_node && max_depth > 0) {
+    node = node->parent;
+    max_depth--;
+  }
+  return node != NULL && node == root_node;
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_expire_parent(rpl_dag_t *dag, const uip_ipaddr_t *child,
+                     const uip_ipaddr_t *parent)
+{
+  rpl_ns_node_t *l;
+
+  l = rpl_ns_get_node(dag, child);
+  /* Only expire the link if the child still uses this parent. A
+     No-Path DAO for an old parent may arrive after the DAO for the
+     new one. */
+  if(l != NULL && node_matches_address(dag, l->parent, parent)) {
+    l->lifetime = RPL_NOPATH_REMOVAL_DELAY;
+  }
+}
+/*---------------------------------------------------------------------------*/
+rpl_ns_node_t *
+rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child,
+                   const uip_ipaddr_t *parent, uint32_t lifetime)
+{
+  rpl_ns_node_t *child_node;
+  rpl_ns_node_t *parent_node;
+  rpl_ns_node_t *old_parent_node;
+
+  if(dag == NULL || child == NULL ||
+     memcmp(child, &dag->prefix_info.prefix, 8) != 0) {
+    /* Only nodes within the prefix of the DODAG can be stored. */
+    return NULL;
+  }
+
+  parent_node = NULL;
+  if(parent != NULL) {
+    parent_node = rpl_ns_get_node(dag, parent);
+    if(parent_node == NULL) {
+      /* We have not heard from the parent yet: add it with an
+         infinite lifetime until its own DAO arrives. */
+      parent_node = rpl_ns_update_node(dag, parent, NULL,
+                                       RPL_NS_INFINITE_LIFETIME);
+      if(parent_node == NULL) {
+        return NULL;
+      }
+    }
+  }
+
+  child_node = rpl_ns_get_node(dag, child);
+  if(child_node == NULL) {
+    child_node = memb_alloc(&nodememb);
+    if(child_node == NULL) {
+      PRINTF("RPL: No space for more non-storing links\n");
+      return NULL;
+    }
+    child_node->parent = NULL;
+    list_add(nodelist, child_node);
+    num_nodes++;
+  }
+
+  child_node->dag = dag;
+  child_node->lifetime = lifetime;
+  memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
+
+  if(rpl_ns_is_node_reachable(dag, child)) {
+    old_parent_node = child_node->parent;
+    child_node->parent = parent_node;
+    if(!rpl_ns_is_node_reachable(dag, child)) {
+      /* The new parent would create a loop. Keep the old one; the
+         next DAO will tell us more about the topology. */
+      PRINTF("RPL: New parent link would create a loop, ignoring it\n");
+      child_node->parent = old_parent_node;
+    }
+  } else {
+    child_node->parent = parent_node;
+  }
+
+  return child_node;
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_init(void)
+{
+  num_nodes = 0;
+  memb_init(&nodememb);
+  list_init(nodelist);
+}
+/*---------------------------------------------------------------------------*/
+rpl_ns_node_t *
+rpl_ns_node_head(void)
+{
+  return list_head(nodelist);
+}
+/*---------------------------------------------------------------------------*/
+rpl_ns_node_t *
+rpl_ns_node_next(rpl_ns_node_t *item)
+{
+  return list_item_next(item);
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_get_node_global_addr(uip_ipaddr_t *addr, rpl_ns_node_t *node)
+{
+  if(addr != NULL && node != NULL && node->dag != NULL) {
+    memcpy(addr, &node->dag->prefix_info.prefix, 8);
+    memcpy(((unsigned char *)addr) + 8, &node->link_identifier, 8);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_periodic(void)
+{
+  rpl_ns_node_t *l;
+  rpl_ns_node_t *next;
+
+  /* First pass, decrement lifetime for all nodes with non-infinite
+     lifetime. */
+  for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
+    if(l->lifetime != RPL_NS_INFINITE_LIFETIME && l->lifetime > 0) {
+      l->lifetime--;
+    }
+  }
+
+  /* Second pass, remove dead nodes, and detach their children. The
+     children become unreachable until they send a new DAO. */
+  l = list_head(nodelist);
+  while(l != NULL) {
+    next = list_item_next(l);
+    if(l->lifetime == 0) {
+      rpl_ns_node_t *l2;
+      for(l2 = list_head(nodelist); l2 != NULL; l2 = list_item_next(l2)) {
+        if(l2->parent == l) {
+          l2->parent = NULL;
+        }
+      }
+      list_remove(nodelist, l);
+      memb_free(&nodememb, l);
+      num_nodes--;
+    }
+    l = next;
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* RPL_WITH_NON_STORING */
+
+/** @} */
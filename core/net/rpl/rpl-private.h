@@ -108,6 +108,21 @@
 #define RPL_HDR_OPT_RANK_ERR_SHIFT   	6
 #define RPL_HDR_OPT_FWD_ERR		0x20
 #define RPL_HDR_OPT_FWD_ERR_SHIFT   	5
+
+/* RPL source routing header (RFC 6554). */
+#define RPL_RH_TYPE_SRH                 3
+#define RPL_RH_LEN                      4
+#define RPL_SRH_LEN                     4
+
+struct rpl_srh_hdr {
+  uint8_t cmpr;                 /* CmprI (high nibble), CmprE (low nibble) */
+  uint8_t pad;                  /* Pad (high nibble), reserved */
+  uint8_t reserved[2];
+};
+
+/* Length of the Transit Information option in non-storing mode DAOs,
+   which carries the global address of the parent. */
+#define RPL_NS_TRANSIT_LEN              20
 /*---------------------------------------------------------------------------*/
 /* Default values for RPL constants and variables. */
 
@@ -187,6 +202,20 @@
 #endif /* UIP_IPV6_MULTICAST_RPL */
 #endif /* RPL_CONF_MOP */
 
+/* Support for non-storing mode: forwarding along source routing
+   headers (RFC 6554) on all nodes, and the parent link graph and
+   source route computation on the root. It is enabled by default when
+   non-storing mode is the configured MOP. */
+#ifdef RPL_CONF_WITH_NON_STORING
+#define RPL_WITH_NON_STORING            RPL_CONF_WITH_NON_STORING
+#else /* RPL_CONF_WITH_NON_STORING */
+#define RPL_WITH_NON_STORING            (RPL_MOP_DEFAULT == RPL_MOP_NON_STORING)
+#endif /* RPL_CONF_WITH_NON_STORING */
+
+#define RPL_IS_NON_STORING(instance)    (RPL_WITH_NON_STORING && \
+                                         (instance) != NULL && \
+                                         (instance)->mop == RPL_MOP_NON_STORING)
+
 /* Emit a pre-processor error if the user configured multicast with bad MOP */
 #if RPL_CONF_MULTICAST && (RPL_MOP_DEFAULT != RPL_MOP_STORING_MULTICAST)
 #error "RPL Multicast requires RPL_MOP_DEFAULT==3. Check contiki-conf.h"
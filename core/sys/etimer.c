@@ -53,6 +53,230 @@ static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
 PROCESS(etimer_process, "Event timer");
+#if ETIMER_HEAP
+/*---------------------------------------------------------------------------*/
+/*
+ * With the heap backend, timerlist is the root of a pairing heap in
+ * which no timer expires before its parent. Expiration times are
+ * compared by their signed difference, which gives an ordering that
+ * does not change as the clock advances, provided that no two pending
+ * timers expire more than half the clock_time_t range apart.
+ */
+static int
+expires_before(struct etimer *a, struct etimer *b)
+{
+  clock_time_t diff;
+
+  diff = (a->timer.start + a->timer.interval) -
+    (b->timer.start + b->timer.interval);
+  return diff > ((clock_time_t)~0 >> 1);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Link two heap roots together and return the new root.
+ */
+static struct etimer *
+meld(struct etimer *a, struct etimer *b)
+{
+  struct etimer *t;
+
+  if(expires_before(b, a)) {
+    t = a;
+    a = b;
+    b = t;
+  }
+  /* b becomes the leftmost child of a. */
+  b->prev = a;
+  b->next = a->child;
+  if(a->child != NULL) {
+    a->child->prev = b;
+  }
+  a->child = b;
+  return a;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Meld a list of sibling subtrees into one heap, using the standard
+ * two-pass pairing: meld pairs left to right, then meld the results
+ * right to left.
+ */
+static struct etimer *
+merge_pairs(struct etimer *first)
+{
+  struct etimer *a, *b, *pairs, *root;
+
+  if(first == NULL) {
+    return NULL;
+  }
+
+  pairs = NULL;
+  while(first != NULL) {
+    a = first;
+    b = a->next;
+    if(b != NULL) {
+      first = b->next;
+      a = meld(a, b);
+    } else {
+      first = NULL;
+    }
+    /* Collect the pairs in reverse order. */
+    a->next = pairs;
+    pairs = a;
+  }
+
+  root = pairs;
+  pairs = pairs->next;
+  while(pairs != NULL) {
+    a = pairs;
+    pairs = pairs->next;
+    root = meld(root, a);
+  }
+  root->next = root->prev = NULL;
+  return root;
+}
+/*---------------------------------------------------------------------------*/
+static int
+in_heap(struct etimer *t)
+{
+  return t->in_heap == ~(uintptr_t)t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_insert(struct etimer *t)
+{
+  t->next = t->prev = t->child = NULL;
+  t->in_heap = ~(uintptr_t)t;
+  if(timerlist == NULL) {
+    timerlist = t;
+  } else {
+    timerlist = meld(timerlist, t);
+    timerlist->next = timerlist->prev = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_remove(struct etimer *t)
+{
+  struct etimer *subtree;
+
+  if(t == timerlist) {
+    timerlist = merge_pairs(t->child);
+  } else {
+    /* Cut t out of its sibling list. */
+    if(t->prev->child == t) {
+      t->prev->child = t->next;
+    } else {
+      t->prev->next = t->next;
+    }
+    if(t->next != NULL) {
+      t->next->prev = t->prev;
+    }
+    subtree = merge_pairs(t->child);
+    if(subtree != NULL) {
+      timerlist = meld(timerlist, subtree);
+    }
+  }
+  t->next = t->prev = t->child = NULL;
+  t->in_heap = 0;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Find the first timer, in preorder, that belongs to process p.
+ */
+static struct etimer *
+find_process_timer(struct process *p)
+{
+  struct etimer *t;
+
+  t = timerlist;
+  while(t != NULL) {
+    if(t->p == p) {
+      return t;
+    }
+    if(t->child != NULL) {
+      t = t->child;
+    } else {
+      /* Climb until there is a right sibling to visit. */
+      while(t != NULL && t->next == NULL) {
+        while(t->prev != NULL && t->prev->next == t) {
+          t = t->prev;
+        }
+        t = t->prev;
+      }
+      if(t != NULL) {
+        t = t->next;
+      }
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_time(void)
+{
+  if(timerlist == NULL) {
+    next_expiration = 0;
+  } else {
+    next_expiration = timerlist->timer.start + timerlist->timer.interval;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_process, ev, data)
+{
+  struct etimer *t;
+
+  PROCESS_BEGIN();
+
+  timerlist = NULL;
+
+  while(1) {
+    PROCESS_YIELD();
+
+    if(ev == PROCESS_EVENT_EXITED) {
+      while((t = find_process_timer(data)) != NULL) {
+        heap_remove(t);
+      }
+      update_time();
+      continue;
+    } else if(ev != PROCESS_EVENT_POLL) {
+      continue;
+    }
+
+    while(timerlist != NULL && timer_expired(&timerlist->timer)) {
+      t = timerlist;
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+        heap_remove(t);
+        /* Reset the process ID of the event timer, to signal that the
+           etimer has expired. This is later checked in the
+           etimer_expired() function. */
+        t->p = PROCESS_NONE;
+      } else {
+        etimer_request_poll();
+        break;
+      }
+    }
+    update_time();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_timer(struct etimer *timer)
+{
+  etimer_request_poll();
+
+  /* The timer may have a new expiration time, so it is reinserted if
+     it is already in the heap. */
+  if(timer->p != PROCESS_NONE && in_heap(timer)) {
+    heap_remove(timer);
+  }
+  timer->p = PROCESS_CURRENT();
+  heap_insert(timer);
+
+  update_time();
+}
+#else /* ETIMER_HEAP */
 /*---------------------------------------------------------------------------*/
 static void
 update_time(void)
@@ -141,12 +365,6 @@ PROCESS_THREAD(etimer_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
-void
-etimer_request_poll(void)
-{
-  process_poll(&etimer_process);
-}
-/*---------------------------------------------------------------------------*/
 static void
 add_timer(struct etimer *timer)
 {
@@ -172,6 +390,13 @@ add_timer(struct etimer *timer)
 
   update_time();
 }
+#endif /* ETIMER_HEAP */
+/*---------------------------------------------------------------------------*/
+void
+etimer_request_poll(void)
+{
+  process_poll(&etimer_process);
+}
 /*---------------------------------------------------------------------------*/
 void
 etimer_set(struct etimer *et, clock_time_t interval)
@@ -205,7 +430,17 @@ etimer_restart(struct etimer *et)
 void
 etimer_adjust(struct etimer *et, int timediff)
 {
+#if ETIMER_HEAP
+  if(et->p != PROCESS_NONE && in_heap(et)) {
+    heap_remove(et);
+    et->timer.start += timediff;
+    heap_insert(et);
+  } else {
+    et->timer.start += timediff;
+  }
+#else /* ETIMER_HEAP */
   et->timer.start += timediff;
+#endif /* ETIMER_HEAP */
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -242,6 +477,12 @@ etimer_next_expiration_time(void)
 void
 etimer_stop(struct etimer *et)
 {
+#if ETIMER_HEAP
+  if(et->p != PROCESS_NONE && in_heap(et)) {
+    heap_remove(et);
+    update_time();
+  }
+#else /* ETIMER_HEAP */
   struct etimer *t;
 
   /* First check if et is the first event timer on the list. */
@@ -262,6 +503,7 @@ etimer_stop(struct etimer *et)
       update_time();
     }
   }
+#endif /* ETIMER_HEAP */
 
   /* Remove the next pointer from the item to be removed. */
   et->next = NULL;
@@ -65,6 +65,24 @@
 #include "sys/timer.h"
 #include "sys/process.h"
 
+#include <stdint.h>
+
+/*
+ * Pending event timers are by default kept on an unsorted list, which
+ * is walked whenever a timer is added or expires. ETIMER_CONF_HEAP
+ * selects a backend that keeps them in a pairing heap ordered by
+ * expiration time instead: adding and stopping a timer is O(log n)
+ * amortized, and the next expiration time is found in O(1).
+ *
+ * With the heap backend, pending timers must expire less than half
+ * the clock_time_t range apart.
+ */
+#ifdef ETIMER_CONF_HEAP
+#define ETIMER_HEAP ETIMER_CONF_HEAP
+#else /* ETIMER_CONF_HEAP */
+#define ETIMER_HEAP 0
+#endif /* ETIMER_CONF_HEAP */
+
 /**
  * A timer.
  *
@@ -77,6 +95,15 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_HEAP
+  /* With the heap backend, next links siblings, child points to the
+     leftmost child, and prev to the left sibling or, for a leftmost
+     child, to the parent. in_heap is the complement of the address
+     of the timer while it is in the heap, so that an uninitialized
+     timer is not mistaken for one. */
+  struct etimer *child, *prev;
+  uintptr_t in_heap;
+#endif /* ETIMER_HEAP */
 };
 
 /**
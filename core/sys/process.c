@@ -44,6 +44,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "sys/process.h"
 #include "sys/arg.h"
@@ -65,8 +66,38 @@ struct event_data {
   struct process *p;
 };
 
+#if PROCESS_CONF_PRIORITIES
+/*
+ * One event queue per priority level. nevents is the total number of
+ * events waiting in all queues.
+ */
+struct event_queue {
+  process_num_events_t nevents, fevent;
+  struct event_data events[PROCESS_CONF_PRIO_NUMEVENTS];
+#if PROCESS_CONF_STATS
+  process_num_events_t maxevents;
+  unsigned short overflows;
+#endif /* PROCESS_CONF_STATS */
+};
+
+static struct event_queue queues[PROCESS_CONF_PRIORITIES];
+static int nevents;
+
+/*
+ * Processes that have been polled but not yet serviced, linked
+ * through their next_poll pointers.
+ */
+static struct process *volatile poll_list, *volatile poll_tail;
+
+/* Processes taken off the ready list by the ongoing do_poll(). */
+static struct process *volatile poll_batch;
+#else /* PROCESS_CONF_PRIORITIES */
 static process_num_events_t nevents, fevent;
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
+#if PROCESS_CONF_STATS
+static unsigned short overflows;
+#endif /* PROCESS_CONF_STATS */
+#endif /* PROCESS_CONF_PRIORITIES */
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
@@ -120,6 +151,31 @@ process_start(struct process *p, process_data_t data)
   process_post_synch(p, PROCESS_EVENT_INIT, data);
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_PRIORITIES
+/*
+ * Remove a process from a poll list. Returns NULL if the process was
+ * not on the list, the process itself if it was first on the list, or
+ * else its predecessor.
+ */
+static struct process *
+unlink_poll(struct process *volatile *list, struct process *p)
+{
+  struct process *q;
+
+  if(*list == p) {
+    *list = p->next_poll;
+    return p;
+  }
+  for(q = *list; q != NULL; q = q->next_poll) {
+    if(q->next_poll == p) {
+      q->next_poll = p->next_poll;
+      return q;
+    }
+  }
+  return NULL;
+}
+#endif /* PROCESS_CONF_PRIORITIES */
+/*---------------------------------------------------------------------------*/
 static void
 exit_process(struct process *p, struct process *fromprocess)
 {
@@ -157,6 +213,22 @@ exit_process(struct process *p, struct process *fromprocess)
     }
   }
 
+#if PROCESS_CONF_PRIORITIES
+  /* Drop a pending poll so that the process is not left linked on
+     the ready list if it is started again. */
+  PROCESS_CONF_POLL_LOCK();
+  if(p->needspoll) {
+    if(!unlink_poll(&poll_batch, p)) {
+      q = unlink_poll(&poll_list, p);
+      if(poll_tail == p) {
+        poll_tail = q == p ? NULL : q;
+      }
+    }
+    p->needspoll = 0;
+  }
+  PROCESS_CONF_POLL_UNLOCK();
+#endif /* PROCESS_CONF_PRIORITIES */
+
   if(p == process_list) {
     process_list = process_list->next;
   } else {
@@ -209,7 +281,16 @@ process_init(void)
 {
   lastevent = PROCESS_EVENT_MAX;
 
+#if PROCESS_CONF_PRIORITIES
+  memset(queues, 0, sizeof(queues));
+  nevents = 0;
+  poll_list = poll_tail = poll_batch = NULL;
+#else /* PROCESS_CONF_PRIORITIES */
   nevents = fevent = 0;
+#if PROCESS_CONF_STATS
+  overflows = 0;
+#endif /* PROCESS_CONF_STATS */
+#endif /* PROCESS_CONF_PRIORITIES */
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
 #endif /* PROCESS_CONF_STATS */
@@ -221,6 +302,37 @@ process_init(void)
  * Call each process' poll handler.
  */
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_PRIORITIES
+static void
+do_poll(void)
+{
+  struct process *p;
+
+  /* Take the whole ready list at once. Processes that are polled
+     while we run the poll handlers go on a fresh list and are
+     serviced in the next round. */
+  PROCESS_CONF_POLL_LOCK();
+  poll_requested = 0;
+  poll_batch = poll_list;
+  poll_list = poll_tail = NULL;
+  PROCESS_CONF_POLL_UNLOCK();
+
+  for(;;) {
+    PROCESS_CONF_POLL_LOCK();
+    p = poll_batch;
+    if(p != NULL) {
+      poll_batch = p->next_poll;
+      p->needspoll = 0;
+    }
+    PROCESS_CONF_POLL_UNLOCK();
+    if(p == NULL) {
+      break;
+    }
+    p->state = PROCESS_STATE_RUNNING;
+    call_process(p, PROCESS_EVENT_POLL, NULL);
+  }
+}
+#else /* PROCESS_CONF_PRIORITIES */
 static void
 do_poll(void)
 {
@@ -236,6 +348,7 @@ do_poll(void)
     }
   }
 }
+#endif /* PROCESS_CONF_PRIORITIES */
 /*---------------------------------------------------------------------------*/
 /*
  * Process the next event in the event queue and deliver it to
@@ -249,6 +362,9 @@ do_event(void)
   static process_data_t data;
   static struct process *receiver;
   static struct process *p;
+#if PROCESS_CONF_PRIORITIES
+  static struct event_queue *q;
+#endif /* PROCESS_CONF_PRIORITIES */
   
   /*
    * If there are any events in the queue, take the first one and walk
@@ -260,6 +376,18 @@ do_event(void)
 
   if(nevents > 0) {
     
+#if PROCESS_CONF_PRIORITIES
+    /* Take the event from the highest priority queue that has one. */
+    for(q = &queues[PROCESS_PRIO_MAX]; q->nevents == 0; --q);
+
+    ev = q->events[q->fevent].ev;
+    data = q->events[q->fevent].data;
+    receiver = q->events[q->fevent].p;
+
+    q->fevent = (q->fevent + 1) % PROCESS_CONF_PRIO_NUMEVENTS;
+    --q->nevents;
+    --nevents;
+#else /* PROCESS_CONF_PRIORITIES */
     /* There are events that we should deliver. */
     ev = events[fevent].ev;
     
@@ -270,6 +398,7 @@ do_event(void)
        and decrease the number of events. */
     fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
     --nevents;
+#endif /* PROCESS_CONF_PRIORITIES */
 
     /* If this is a broadcast event, we deliver it to all events, in
        order of their priority. */
@@ -301,13 +430,28 @@ do_event(void)
 int
 process_run(void)
 {
+#if PROCESS_CONF_PRIORITIES
+  int budget;
+#endif /* PROCESS_CONF_PRIORITIES */
+
   /* Process poll events. */
   if(poll_requested) {
     do_poll();
   }
 
+#if PROCESS_CONF_PRIORITIES
+  /* Process a batch of events, letting polls preempt between them. */
+  for(budget = PROCESS_CONF_EVENT_BUDGET; budget > 0 && nevents > 0;
+      --budget) {
+    do_event();
+    if(poll_requested) {
+      do_poll();
+    }
+  }
+#else /* PROCESS_CONF_PRIORITIES */
   /* Process one event from the queue */
   do_event();
+#endif /* PROCESS_CONF_PRIORITIES */
 
   return nevents + poll_requested;
 }
@@ -322,6 +466,9 @@ int
 process_post(struct process *p, process_event_t ev, process_data_t data)
 {
   static process_num_events_t snum;
+#if PROCESS_CONF_PRIORITIES
+  struct event_queue *q;
+#endif /* PROCESS_CONF_PRIORITIES */
 
   if(PROCESS_CURRENT() == NULL) {
     PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
@@ -331,8 +478,13 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   PROCESS_NAME_STRING(PROCESS_CURRENT()), ev,
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
-  
+
+#if PROCESS_CONF_PRIORITIES
+  q = &queues[p == PROCESS_BROADCAST ? PROCESS_PRIO_DEFAULT : p->priority];
+  if(q->nevents == PROCESS_CONF_PRIO_NUMEVENTS) {
+#else /* PROCESS_CONF_PRIORITIES */
   if(nevents == PROCESS_CONF_NUMEVENTS) {
+#endif /* PROCESS_CONF_PRIORITIES */
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -340,14 +492,36 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
       printf("soft panic: event queue is full when event %d was posted to %s from %s\n", ev, PROCESS_NAME_STRING(p), PROCESS_NAME_STRING(process_current));
     }
 #endif /* DEBUG */
+#if PROCESS_CONF_STATS
+#if PROCESS_CONF_PRIORITIES
+    q->overflows++;
+#else /* PROCESS_CONF_PRIORITIES */
+    overflows++;
+#endif /* PROCESS_CONF_PRIORITIES */
+#endif /* PROCESS_CONF_STATS */
     return PROCESS_ERR_FULL;
   }
-  
+
+#if PROCESS_CONF_PRIORITIES
+  snum = (process_num_events_t)(q->fevent + q->nevents) % PROCESS_CONF_PRIO_NUMEVENTS;
+  q->events[snum].ev = ev;
+  q->events[snum].data = data;
+  q->events[snum].p = p;
+  ++q->nevents;
+  ++nevents;
+
+#if PROCESS_CONF_STATS
+  if(q->nevents > q->maxevents) {
+    q->maxevents = q->nevents;
+  }
+#endif /* PROCESS_CONF_STATS */
+#else /* PROCESS_CONF_PRIORITIES */
   snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
   events[snum].ev = ev;
   events[snum].data = data;
   events[snum].p = p;
   ++nevents;
+#endif /* PROCESS_CONF_PRIORITIES */
 
 #if PROCESS_CONF_STATS
   if(nevents > process_maxevents) {
@@ -373,12 +547,56 @@ process_poll(struct process *p)
   if(p != NULL) {
     if(p->state == PROCESS_STATE_RUNNING ||
        p->state == PROCESS_STATE_CALLED) {
+#if PROCESS_CONF_PRIORITIES
+      PROCESS_CONF_POLL_LOCK();
+      if(!p->needspoll) {
+        /* Append the process to the ready list. */
+        p->needspoll = 1;
+        p->next_poll = NULL;
+        if(poll_tail == NULL) {
+          poll_list = p;
+        } else {
+          poll_tail->next_poll = p;
+        }
+        poll_tail = p;
+      }
+      poll_requested = 1;
+      PROCESS_CONF_POLL_UNLOCK();
+#else /* PROCESS_CONF_PRIORITIES */
       p->needspoll = 1;
       poll_requested = 1;
+#endif /* PROCESS_CONF_PRIORITIES */
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_PRIORITIES
+void
+process_set_priority(struct process *p, unsigned char prio)
+{
+  p->priority = prio > PROCESS_PRIO_MAX ? PROCESS_PRIO_MAX : prio;
+}
+#endif /* PROCESS_CONF_PRIORITIES */
+/*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_STATS
+void
+process_get_stats(unsigned char prio, struct process_stats *stats)
+{
+#if PROCESS_CONF_PRIORITIES
+  if(prio > PROCESS_PRIO_MAX) {
+    prio = PROCESS_PRIO_MAX;
+  }
+  stats->depth = queues[prio].nevents;
+  stats->max_depth = queues[prio].maxevents;
+  stats->overflows = queues[prio].overflows;
+#else /* PROCESS_CONF_PRIORITIES */
+  stats->depth = nevents;
+  stats->max_depth = process_maxevents;
+  stats->overflows = overflows;
+#endif /* PROCESS_CONF_PRIORITIES */
+}
+#endif /* PROCESS_CONF_STATS */
+/*---------------------------------------------------------------------------*/
 int
 process_is_running(struct process *p)
 {
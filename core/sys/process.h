@@ -88,6 +88,48 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/*
+ * Number of priority levels of the priority-aware scheduler. Zero
+ * (the default) selects the classic scheduler with a single event
+ * queue, where process_run() delivers one event per call and polls
+ * are found by scanning the process list.
+ *
+ * A non-zero value gives every priority level its own event queue of
+ * PROCESS_CONF_PRIO_NUMEVENTS entries, keeps polled processes on a
+ * ready list instead of scanning for them, and lets process_run()
+ * deliver up to PROCESS_CONF_EVENT_BUDGET events per call, highest
+ * priority first.
+ */
+#ifndef PROCESS_CONF_PRIORITIES
+#define PROCESS_CONF_PRIORITIES 0
+#endif /* PROCESS_CONF_PRIORITIES */
+
+#if PROCESS_CONF_PRIORITIES
+#ifndef PROCESS_CONF_PRIO_NUMEVENTS
+#define PROCESS_CONF_PRIO_NUMEVENTS PROCESS_CONF_NUMEVENTS
+#endif /* PROCESS_CONF_PRIO_NUMEVENTS */
+
+#ifndef PROCESS_CONF_EVENT_BUDGET
+#define PROCESS_CONF_EVENT_BUDGET 8
+#endif /* PROCESS_CONF_EVENT_BUDGET */
+
+/*
+ * The ready list is updated by process_poll(), which may be called
+ * from interrupt context. Ports that poll processes from interrupt
+ * handlers should map these to their interrupt disable/restore
+ * primitives.
+ */
+#ifndef PROCESS_CONF_POLL_LOCK
+#define PROCESS_CONF_POLL_LOCK()
+#define PROCESS_CONF_POLL_UNLOCK()
+#endif /* PROCESS_CONF_POLL_LOCK */
+
+/** The priority of processes that never set one. */
+#define PROCESS_PRIO_DEFAULT  0
+/** The highest priority, typically used by radio and network drivers. */
+#define PROCESS_PRIO_MAX      (PROCESS_CONF_PRIORITIES - 1)
+#endif /* PROCESS_CONF_PRIORITIES */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -323,6 +365,10 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_CONF_PRIORITIES
+  unsigned char priority;
+  struct process *next_poll;
+#endif /* PROCESS_CONF_PRIORITIES */
 };
 
 /**
@@ -389,6 +435,21 @@ CCIF void process_post_synch(struct process *p,
  */
 CCIF void process_exit(struct process *p);
 
+#if PROCESS_CONF_PRIORITIES
+/**
+ * \brief      Set the scheduling priority of a process
+ * \param p    The process
+ * \param prio The priority, from PROCESS_PRIO_DEFAULT (lowest) to
+ *             PROCESS_PRIO_MAX (highest)
+ *
+ *             Events posted to a process are queued on the event
+ *             queue of the priority the process has at the time of
+ *             posting. Broadcast events are queued at
+ *             PROCESS_PRIO_DEFAULT. Out-of-range priorities are
+ *             clamped to PROCESS_PRIO_MAX.
+ */
+CCIF void process_set_priority(struct process *p, unsigned char prio);
+#endif /* PROCESS_CONF_PRIORITIES */
 
 /**
  * Get a pointer to the currently running process.
@@ -494,6 +555,10 @@ void process_init(void);
  * may choose to put the CPU to sleep when there are no pending
  * events.
  *
+ * With PROCESS_CONF_PRIORITIES, up to PROCESS_CONF_EVENT_BUDGET
+ * events are processed per call, and pending polls are serviced
+ * between any two of them.
+ *
  * \return The number of events that are currently waiting in the
  * event queue.
  */
@@ -519,6 +584,30 @@ CCIF int process_is_running(struct process *p);
  */
 int process_nevents(void);
 
+#if PROCESS_CONF_STATS
+/**
+ * Event queue statistics, one set per event queue.
+ */
+struct process_stats {
+  /** Number of events currently waiting in the queue. */
+  process_num_events_t depth;
+  /** The largest number of events that have been waiting at once. */
+  process_num_events_t max_depth;
+  /** Number of process_post() calls that failed with PROCESS_ERR_FULL. */
+  unsigned short overflows;
+};
+
+/**
+ * Get the statistics of an event queue.
+ *
+ * \param prio The priority of the queue. The classic scheduler has a
+ * single queue, which is reported for any priority.
+ *
+ * \param stats The structure to fill in.
+ */
+void process_get_stats(unsigned char prio, struct process_stats *stats);
+#endif /* PROCESS_CONF_STATS */
+
 /** @} */
 
 CCIF extern struct process *process_list;
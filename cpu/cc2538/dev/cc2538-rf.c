@@ -49,6 +49,9 @@
 #include "dev/sys-ctrl.h"
 #include "dev/udma.h"
 #include "reg.h"
+#if CC2538_RF_RX_QUEUE_LEN
+#include "dev/radio-rx-queue.h"
+#endif
 
 #include <string.h>
 /*---------------------------------------------------------------------------*/
@@ -136,6 +139,12 @@ static uint8_t send_on_cca = 1;
 static int8_t rssi;
 static uint8_t crc_corr;
 
+#if CC2538_RF_RX_QUEUE_LEN
+static uint8_t rx_queue_buf[RADIO_RX_QUEUE_BUF_SIZE(CC2538_RF_RX_QUEUE_LEN,
+                                                   CC2538_RF_MAX_PACKET_LEN)];
+static struct radio_rx_queue rx_queue;
+#endif
+
 void mac_timer_init(void);
 uint32_t get_sfd_timestamp(void);
 /*---------------------------------------------------------------------------*/
@@ -668,8 +677,10 @@ send(const void *payload, unsigned short payload_len)
   return transmit(payload_len);
 }
 /*---------------------------------------------------------------------------*/
+/* Reads a frame from the RX FIFO and leaves its RSSI and CRC/Corr
+   byte in rssi and crc_corr */
 static int
-read(void *buf, unsigned short bufsize)
+read_fifo(void *buf, unsigned short bufsize)
 {
   uint8_t i;
   uint8_t len;
@@ -748,8 +759,6 @@ read(void *buf, unsigned short bufsize)
 
   /* MS bit CRC OK/Not OK, 7 LS Bits, Correlation value */
   if(crc_corr & CRC_BIT_MASK) {
-    packetbuf_set_attr(PACKETBUF_ATTR_RSSI, rssi);
-    packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, crc_corr & LQI_BIT_MASK);
     RIMESTATS_ADD(llrx);
   } else {
     RIMESTATS_ADD(badcrc);
@@ -789,6 +798,53 @@ read(void *buf, unsigned short bufsize)
 }
 /*---------------------------------------------------------------------------*/
 static int
+read(void *buf, unsigned short bufsize)
+{
+  int len;
+
+#if CC2538_RF_RX_QUEUE_LEN
+  /* The RX ISR has already moved the oldest frames out of the FIFO */
+  if(radio_rx_queue_pending(&rx_queue)) {
+    return radio_rx_queue_get(&rx_queue, buf, bufsize);
+  }
+#endif
+
+  len = read_fifo(buf, bufsize);
+  if(len > 0) {
+    packetbuf_set_attr(PACKETBUF_ATTR_RSSI, rssi);
+    packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, crc_corr & LQI_BIT_MASK);
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+#if CC2538_RF_RX_QUEUE_LEN
+/* Called by the RX ISR: moves the frame from the RX FIFO to the queue,
+   so that the FIFO is free for the next one before the process runs */
+static void
+queue_frame(void)
+{
+  uint8_t *buf;
+  int len;
+
+  if((REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_FIFOP) == 0) {
+    return;
+  }
+
+  buf = radio_rx_queue_reserve(&rx_queue);
+  if(buf == NULL) {
+    PRINTF("RF: RX queue full\n");
+    CC2538_RF_CSP_ISFLUSHRX();
+    return;
+  }
+
+  len = read_fifo(buf, CC2538_RF_MAX_PACKET_LEN);
+  if(len > 0) {
+    radio_rx_queue_commit(&rx_queue, len, rssi, crc_corr & LQI_BIT_MASK);
+  }
+}
+#endif /* CC2538_RF_RX_QUEUE_LEN */
+/*---------------------------------------------------------------------------*/
+static int
 receiving_packet(void)
 {
   PRINTF("RF: Receiving\n");
@@ -809,6 +865,11 @@ pending_packet(void)
 {
   PRINTF("RF: Pending\n");
 
+#if CC2538_RF_RX_QUEUE_LEN
+  if(radio_rx_queue_pending(&rx_queue)) {
+    return 1;
+  }
+#endif
   return (REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_FIFOP);
 }
 /*---------------------------------------------------------------------------*/
@@ -1026,11 +1087,25 @@ PROCESS_THREAD(cc2538_rf_process, ev, data)
   int len;
   PROCESS_BEGIN();
 
+#if CC2538_RF_RX_QUEUE_LEN
+  radio_rx_queue_init(&rx_queue, rx_queue_buf, CC2538_RF_RX_QUEUE_LEN,
+                      CC2538_RF_MAX_PACKET_LEN);
+#endif
+
   while(1) {
     /* Only if we are not in poll mode oder we are in poll mode and transceiver has to be reset */
     PROCESS_YIELD_UNTIL((!poll_mode || (poll_mode && (rf_flags & RF_MUST_RESET))) && (ev == PROCESS_EVENT_POLL));
 
     if(!poll_mode) {
+#if CC2538_RF_RX_QUEUE_LEN
+      while(radio_rx_queue_pending(&rx_queue)) {
+        len = radio_rx_queue_read(&rx_queue);
+
+        if(len > 0) {
+          NETSTACK_RDC.input();
+        }
+      }
+#else /* CC2538_RF_RX_QUEUE_LEN */
       packetbuf_clear();
       len = read(packetbuf_dataptr(), PACKETBUF_SIZE);
 
@@ -1039,6 +1114,7 @@ PROCESS_THREAD(cc2538_rf_process, ev, data)
 
         NETSTACK_RDC.input();
       }
+#endif /* CC2538_RF_RX_QUEUE_LEN */
     }
 
     /* If we were polled due to an RF error, reset the transceiver */
@@ -1077,6 +1153,9 @@ cc2538_rf_rx_tx_isr(void)
   ENERGEST_ON(ENERGEST_TYPE_IRQ);
   
   if(!poll_mode) {
+#if CC2538_RF_RX_QUEUE_LEN
+    queue_frame();
+#endif
     process_poll(&cc2538_rf_process);
   }
 
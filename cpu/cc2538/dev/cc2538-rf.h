@@ -85,6 +85,17 @@
 #else
 #define CC2538_RF_AUTOACK 1
 #endif /* CC2538_RF_CONF_AUTOACK */
+
+/*
+ * Number of received frames that can wait for the driver process, a
+ * power of two. With 0, frames are read from the RX FIFO by the process
+ * and a frame that arrives before it runs is lost.
+ */
+#ifdef CC2538_RF_CONF_RX_QUEUE_LEN
+#define CC2538_RF_RX_QUEUE_LEN CC2538_RF_CONF_RX_QUEUE_LEN
+#else
+#define CC2538_RF_RX_QUEUE_LEN 0
+#endif /* CC2538_RF_CONF_RX_QUEUE_LEN */
 /*---------------------------------------------------------------------------
  * Command Strobe Processor
  *---------------------------------------------------------------------------*/
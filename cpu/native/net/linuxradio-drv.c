@@ -153,7 +153,7 @@ handle_fd(fd_set *rset, fd_set *wset)
   }
 }
 
-static const struct select_callback linuxradio_sock_callback = { set_fd, handle_fd };
+static const struct select_callback linuxradio_sock_callback = { set_fd, handle_fd, NULL };
 
 static int
 on(void)
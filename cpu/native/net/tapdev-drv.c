@@ -59,10 +59,8 @@ tapdev_output(void)
 #endif
 /*---------------------------------------------------------------------------*/
 static void
-pollhandler(void)
+input(void)
 {
-  uip_len = tapdev_poll();
-
   if(uip_len > 0) {
 #if NETSTACK_CONF_WITH_IPV6
     if(BUF->type == uip_htons(UIP_ETHTYPE_IPV6)) {
@@ -88,6 +86,30 @@ pollhandler(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+pollhandler(void)
+{
+#if NETSTACK_CONF_WITH_IPV6
+  int i;
+
+  for(i = 0; i < TAPDEV_RX_BATCH; i++) {
+    uip_len = tapdev_poll();
+    if(uip_len == 0) {
+      break;
+    }
+    input();
+  }
+
+  /* Frames that were read ahead are handled on the next poll. */
+  if(tapdev_pending()) {
+    process_poll(&tapdev_process);
+  }
+#else /* NETSTACK_CONF_WITH_IPV6 */
+  uip_len = tapdev_poll();
+  input();
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(tapdev_process, ev, data)
 {
   PROCESS_POLLHANDLER(pollhandler());
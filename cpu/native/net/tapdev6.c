@@ -38,6 +38,7 @@
 
 #if NETSTACK_CONF_WITH_IPV6
 
+#include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -83,6 +84,17 @@ static int drop = 0;
 
 static int fd = -1;
 
+#if TAPDEV_RX_BATCH > 1
+/* Frames read ahead from the tap device. */
+static struct {
+  uint16_t len;
+  uint8_t data[UIP_BUFSIZE];
+} rx_ring[TAPDEV_RX_RING];
+static int rx_head, rx_count;
+#endif /* TAPDEV_RX_BATCH > 1 */
+
+static struct tapdev_stats stats;
+
 static unsigned long lasttime;
 
 #define BUF ((struct uip_eth_hdr *)&uip_buf[0])
@@ -108,6 +120,74 @@ tapdev_fd(void)
 }
 
 
+#if TAPDEV_RX_BATCH > 1
+/*---------------------------------------------------------------------------*/
+static void
+count_batch(unsigned long n)
+{
+  if(n > 0) {
+    stats.batches++;
+    stats.frames += n;
+    if(n > stats.max_batch) {
+      stats.max_batch = n;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Read frames from the nonblocking tap device until it is empty or the
+   ring is full. */
+static void
+fill_ring(void)
+{
+  int ret, n, slot;
+
+  n = 0;
+  while(rx_count < TAPDEV_RX_RING) {
+    slot = (rx_head + rx_count) % TAPDEV_RX_RING;
+    ret = read(fd, rx_ring[slot].data, UIP_BUFSIZE);
+    if(ret <= 0) {
+      if(ret == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        perror("tapdev_poll: read");
+      }
+      break;
+    }
+    PRINTF("tapdev6: read %d bytes (max %d)\n", ret, UIP_BUFSIZE);
+    rx_ring[slot].len = ret;
+    rx_count++;
+    n++;
+  }
+  if(rx_count == TAPDEV_RX_RING) {
+    stats.ring_full++;
+  }
+  count_batch(n);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+tapdev_poll(void)
+{
+  uint16_t len;
+
+  if(rx_count == 0 && fd > 0) {
+    fill_ring();
+  }
+  if(rx_count == 0) {
+    return 0;
+  }
+
+  len = rx_ring[rx_head].len;
+  memcpy(uip_buf, rx_ring[rx_head].data, len);
+  rx_head = (rx_head + 1) % TAPDEV_RX_RING;
+  rx_count--;
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+tapdev_pending(void)
+{
+  return rx_count;
+}
+#else /* TAPDEV_RX_BATCH > 1 */
+/*---------------------------------------------------------------------------*/
 uint16_t
 tapdev_poll(void)
 {
@@ -134,10 +214,27 @@ tapdev_poll(void)
   
   if(ret == -1) {
     perror("tapdev_poll: read");
+  } else if(ret > 0) {
+    stats.batches++;
+    stats.frames++;
+    stats.max_batch = 1;
   }
   return ret;
 }
 /*---------------------------------------------------------------------------*/
+int
+tapdev_pending(void)
+{
+  return 0;
+}
+#endif /* TAPDEV_RX_BATCH > 1 */
+/*---------------------------------------------------------------------------*/
+void
+tapdev_get_stats(struct tapdev_stats *s)
+{
+  memcpy(s, &stats, sizeof(*s));
+}
+/*---------------------------------------------------------------------------*/
 #if defined(__APPLE__)
 static int reqfd = -1, sfd = -1, interface_index;
 
@@ -314,6 +411,14 @@ tapdev_init(void)
   }
 #endif /* Linux */
 
+#if TAPDEV_RX_BATCH > 1
+  /* The receive ring is filled until the device runs dry. */
+  if(fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == -1) {
+    perror("tapdev: tapdev_init: fcntl");
+    exit(1);
+  }
+#endif /* TAPDEV_RX_BATCH > 1 */
+
 #ifdef __APPLE__
   tapdev_init_darwin_routes();
 #endif
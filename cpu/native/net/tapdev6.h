@@ -38,9 +38,33 @@
 
 #include "contiki-net.h"
 
+/* The maximum number of frames handed to the stack per poll. With a
+   value above 1, frames are read ahead into a receive ring. */
+#ifdef TAPDEV_CONF_RX_BATCH
+#define TAPDEV_RX_BATCH TAPDEV_CONF_RX_BATCH
+#else
+#define TAPDEV_RX_BATCH 1
+#endif
+
+/* The number of frames in the receive ring. */
+#ifdef TAPDEV_CONF_RX_RING
+#define TAPDEV_RX_RING TAPDEV_CONF_RX_RING
+#else
+#define TAPDEV_RX_RING TAPDEV_RX_BATCH
+#endif
+
+struct tapdev_stats {
+  unsigned long frames;    /* Frames read from the tap device. */
+  unsigned long batches;   /* Reads of at least one frame. */
+  unsigned long max_batch; /* The most frames read at once. */
+  unsigned long ring_full; /* Reads that stopped at a full ring. */
+};
+
 void tapdev_init(void);
 uint8_t tapdev_send(const uip_lladdr_t *lladdr);
 uint16_t tapdev_poll(void);
 void tapdev_do_send(void);
 void tapdev_exit(void); //math
+int tapdev_pending(void);
+void tapdev_get_stats(struct tapdev_stats *stats);
 #endif /* TAPDEV_H_ */
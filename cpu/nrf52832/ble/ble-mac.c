@@ -51,6 +51,7 @@
 #include "net/packetbuf.h"
 #include "net/netstack.h"
 #include "net/linkaddr.h"
+#include "lib/frame-ring.h"
 
 #include "dev/watchdog.h"
 
@@ -66,6 +67,10 @@
 #define BLE_MAC_MAX_INTERFACE_NUM 1 /**< Maximum number of interfaces, i.e., connection to master devices */
 #endif
 
+#ifndef BLE_MAC_RX_QUEUE_LEN
+#define BLE_MAC_RX_QUEUE_LEN 1 /**< Number of received packets that can wait for the driver process, a power of two */
+#endif
+
 /*---------------------------------------------------------------------------*/
 process_event_t ble_event_interface_added; /**< This event is broadcast when BLE connection is established */
 process_event_t ble_event_interface_deleted; /**< This event is broadcast when BLE connection is destroyed */
@@ -85,14 +90,12 @@ typedef struct {
 static ble_mac_interface_t interfaces[BLE_MAC_MAX_INTERFACE_NUM];
 
 static volatile int busy_tx; /**< Flag is set to 1 when the driver is busy transmitting a packet. */
-static volatile int busy_rx; /**< Flag is set to 1 when there is a received packet pending. */
+/* A received packet is queued as the sender address and RSSI, followed by the payload. */
+#define RX_RSSI_OFFSET sizeof(eui64_t)
+#define RX_HDR_LEN     (sizeof(eui64_t) + 1)
 
-struct {
-  eui64_t src;
-  uint8_t payload[PACKETBUF_SIZE];
-  uint16_t len;
-  int8_t rssi;
-} input_packet;
+static uint8_t rx_buf[BLE_MAC_RX_QUEUE_LEN * FRAME_RING_SLOT_SIZE(RX_HDR_LEN + PACKETBUF_SIZE)];
+static struct frame_ring rx_ring; /**< Received packets pending for the driver process */
 
 static mac_callback_t mac_sent_cb;
 static void *mac_sent_ptr;
@@ -211,22 +214,26 @@ ble_mac_ipsp_evt_handler_irq(ble_ipsp_handle_t *p_handle, ble_ipsp_evt_t *p_evt)
     case BLE_IPSP_EVT_CHANNEL_DATA_RX: {
       PRINTF("ble-mac: data received\n");
       if(p_instance != NULL) {
-        if(busy_rx) {
-          PRINTF("ble-mac: packet dropped as input buffer is busy\n");
-          break;
-        }
+        uint8_t *slot;
+        int8_t rssi;
 
         if(p_evt->evt_param->params.ch_rx.len > PACKETBUF_SIZE) {
           PRINTF("ble-mac: packet buffer is too small!\n");
           break;
         }
 
-        busy_rx = 1;
+        slot = frame_ring_reserve(&rx_ring);
+        if(slot == NULL) {
+          PRINTF("ble-mac: packet dropped as input queue is full\n");
+          break;
+        }
 
-        input_packet.len = p_evt->evt_param->params.ch_rx.len;
-        memcpy(input_packet.payload, p_evt->evt_param->params.ch_rx.p_data, input_packet.len);
-        memcpy(input_packet.src.identifier, p_instance->peer_addr.identifier, sizeof(eui64_t));
-        sd_ble_gap_rssi_get(p_handle->conn_handle, &input_packet.rssi);
+        memcpy(slot, p_instance->peer_addr.identifier, sizeof(eui64_t));
+        sd_ble_gap_rssi_get(p_handle->conn_handle, &rssi);
+        slot[RX_RSSI_OFFSET] = (uint8_t)rssi;
+        memcpy(slot + RX_HDR_LEN, p_evt->evt_param->params.ch_rx.p_data,
+               p_evt->evt_param->params.ch_rx.len);
+        frame_ring_commit(&rx_ring, RX_HDR_LEN + p_evt->evt_param->params.ch_rx.len);
 
         process_poll(&ble_ipsp_process);
       } else {
@@ -247,17 +254,22 @@ ble_mac_ipsp_evt_handler_irq(ble_ipsp_handle_t *p_handle, ble_ipsp_evt_t *p_evt)
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(ble_ipsp_process, ev, data)
 {
+  uint8_t *slot;
+  uint16_t len;
+
   PROCESS_BEGIN();
 
   while(1) {
     PROCESS_WAIT_EVENT();
     if(ev == PROCESS_EVENT_POLL) {
-      packetbuf_copyfrom(input_packet.payload, input_packet.len);
-      packetbuf_set_attr(PACKETBUF_ATTR_RSSI, input_packet.rssi);
-      packetbuf_set_addr(PACKETBUF_ADDR_SENDER, (const linkaddr_t *)input_packet.src.identifier);
-      packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
-      busy_rx = 0;
-      NETSTACK_LLSEC.input();
+      while((slot = frame_ring_peek(&rx_ring, &len)) != NULL) {
+        packetbuf_copyfrom(slot + RX_HDR_LEN, len - RX_HDR_LEN);
+        packetbuf_set_attr(PACKETBUF_ATTR_RSSI, (int8_t)slot[RX_RSSI_OFFSET]);
+        packetbuf_set_addr(PACKETBUF_ADDR_SENDER, (const linkaddr_t *)slot);
+        packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+        frame_ring_release(&rx_ring);
+        NETSTACK_LLSEC.input();
+      }
     }
   }
 
@@ -360,6 +372,8 @@ init(void)
   uint32_t err_code;
   ble_ipsp_init_t ipsp_init_params;
 
+  frame_ring_init(&rx_ring, rx_buf, BLE_MAC_RX_QUEUE_LEN, RX_HDR_LEN + PACKETBUF_SIZE);
+
   memset(&ipsp_init_params, 0, sizeof(ipsp_init_params));
   ipsp_init_params.evt_handler = ble_mac_ipsp_evt_handler_irq;
   err_code = ble_ipsp_init(&ipsp_init_params);
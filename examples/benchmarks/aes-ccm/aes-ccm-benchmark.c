@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         AES-128 and CCM* benchmark for the native platform.
+ *         Checks CCM_STAR against a test vector from RFC 3610 and
+ *         against the two-pass CCM* that calls AES_128.encrypt() per
+ *         block, and measures how many frames per second both secure.
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+#include "lib/ccm-star.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MIC_LEN  8
+#define HDR_LEN  23
+#define ROUNDS   20000
+#define TESTS    10000
+
+/* see RFC 3610 */
+#define AUTH_FLAGS(Adata, M) ((Adata ? (1u << 6) : 0) | (((M - 2u) >> 1) << 3) | 1u)
+
+static uint8_t frame[512 + MIC_LEN];
+static uint8_t copy[512 + MIC_LEN];
+static uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+/*---------------------------------------------------------------------------*/
+static void
+set_iv(uint8_t *iv, uint8_t flags, uint8_t counter)
+{
+  iv[0] = flags;
+  memcpy(iv + 1, nonce, CCM_STAR_NONCE_LENGTH);
+  iv[14] = 0;
+  iv[15] = counter;
+}
+/*---------------------------------------------------------------------------*/
+static void
+xor_block(uint8_t *x, const uint8_t *data, uint8_t len)
+{
+  uint8_t i;
+
+  for(i = 0; i < len && i < AES_128_BLOCK_SIZE; i++) {
+    x[i] ^= data[i];
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+ref_ctr(uint8_t *m, uint8_t m_len)
+{
+  uint8_t s[AES_128_BLOCK_SIZE];
+  uint16_t pos;
+
+  for(pos = 0; pos < m_len; pos += AES_128_BLOCK_SIZE) {
+    set_iv(s, 1, pos / AES_128_BLOCK_SIZE + 1);
+    AES_128.encrypt(s);
+    xor_block(m + pos, s, m_len - pos);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+ref_mic(const uint8_t *m, uint8_t m_len, const uint8_t *a, uint8_t a_len,
+        uint8_t *result)
+{
+  uint8_t x[AES_128_BLOCK_SIZE];
+  uint8_t s[AES_128_BLOCK_SIZE];
+  uint16_t pos;
+
+  set_iv(x, AUTH_FLAGS(a_len, MIC_LEN), m_len);
+  AES_128.encrypt(x);
+  if(a_len) {
+    x[1] ^= a_len;
+    xor_block(x + 2, a, a_len < 14 ? a_len : 14);
+    AES_128.encrypt(x);
+    for(pos = 14; pos < a_len; pos += AES_128_BLOCK_SIZE) {
+      xor_block(x, a + pos, a_len - pos);
+      AES_128.encrypt(x);
+    }
+  }
+  for(pos = 0; pos < m_len; pos += AES_128_BLOCK_SIZE) {
+    xor_block(x, m + pos, m_len - pos);
+    AES_128.encrypt(x);
+  }
+  set_iv(s, 1, 0);
+  AES_128.encrypt(s);
+  xor_block(x, s, MIC_LEN);
+  memcpy(result, x, MIC_LEN);
+}
+/*---------------------------------------------------------------------------*/
+/* The CBC-MAC pass and the CTR pass of the original ccm-star.c. */
+static void
+ref_aead(uint8_t *m, uint8_t m_len, const uint8_t *a, uint8_t a_len,
+         uint8_t *result, int forward)
+{
+  if(!forward) {
+    ref_ctr(m, m_len);
+  }
+  ref_mic(m, m_len, a, a_len, result);
+  if(forward) {
+    ref_ctr(m, m_len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+ccm_aead(uint8_t *m, uint8_t m_len, const uint8_t *a, uint8_t a_len,
+         uint8_t *result, int forward)
+{
+  CCM_STAR.aead(nonce, m, m_len, a, a_len, result, MIC_LEN, forward);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+nsecs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+/* Secures and unsecures a frame of len bytes ROUNDS times. */
+static unsigned long
+frames_per_second(void (*f)(uint8_t *, uint8_t, const uint8_t *, uint8_t,
+                            uint8_t *, int), uint8_t len)
+{
+  unsigned long start;
+  int i;
+
+  start = nsecs();
+  for(i = 0; i < ROUNDS; i++) {
+    f(frame + HDR_LEN, len - HDR_LEN - MIC_LEN, frame, HDR_LEN,
+      frame + len - MIC_LEN, i & 1);
+  }
+  return ROUNDS * 1000000000ULL / (nsecs() - start);
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_vector(void)
+{
+  /* Packet Vector #1 from RFC 3610 */
+  static const uint8_t key[AES_128_KEY_LENGTH] = {
+    0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+    0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf };
+  static const uint8_t vector_nonce[CCM_STAR_NONCE_LENGTH] = {
+    0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00, 0xa0,
+    0xa1, 0xa2, 0xa3, 0xa4, 0xa5 };
+  static const uint8_t oracle[23 + MIC_LEN] = {
+    0x58, 0x8c, 0x97, 0x9a, 0x61, 0xc6, 0x63, 0xd2,
+    0xf0, 0x66, 0xd0, 0xc2, 0xc0, 0xf9, 0x89, 0x80,
+    0x6d, 0x5f, 0x6b, 0x61, 0xda, 0xc3, 0x84, 0x17,
+    0xe8, 0xd1, 0x2c, 0xfd, 0xf9, 0x26, 0xe0 };
+  uint8_t i;
+
+  for(i = 0; i < 31; i++) {
+    frame[i] = i;
+  }
+  memcpy(nonce, vector_nonce, CCM_STAR_NONCE_LENGTH);
+  CCM_STAR.set_key(key);
+  ccm_aead(frame + 8, 23, frame, 8, frame + 31, 1);
+  return memcmp(frame + 8, oracle, sizeof(oracle)) == 0;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(aes_ccm_benchmark_process, "AES-CCM* benchmark");
+AUTOSTART_PROCESSES(&aes_ccm_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(aes_ccm_benchmark_process, ev, data)
+{
+  static const uint8_t lengths[] = { 40, 80, 127 };
+  uint8_t key[AES_128_KEY_LENGTH];
+  unsigned long ref_fps, ccm_fps;
+  uint8_t m_len, a_len;
+  int i, j, errors;
+
+  PROCESS_BEGIN();
+
+  printf("aes-ccm: T-table %s, %s multi-block encryption\n",
+         AES_128_WITH_TTABLE ? "on" : "off",
+         AES_128.encrypt_blocks != NULL ? "with" : "without");
+  printf("aes-ccm test vector: %s\n", check_vector() ? "ok" : "FAILED");
+
+  errors = 0;
+  for(i = 0; i < TESTS; i++) {
+    for(j = 0; j < AES_128_KEY_LENGTH; j++) {
+      key[j] = random_rand();
+    }
+    for(j = 0; j < CCM_STAR_NONCE_LENGTH; j++) {
+      nonce[j] = random_rand();
+    }
+    for(j = 0; j < sizeof(frame); j++) {
+      frame[j] = random_rand();
+    }
+    memcpy(copy, frame, sizeof(frame));
+    m_len = random_rand() % 225;
+    /* Every other test covers the headers of up to 255 bytes */
+    a_len = random_rand() % ((i & 2) ? 256 : 32);
+    CCM_STAR.set_key(key);
+    ref_aead(copy + a_len, m_len, copy, a_len, copy + a_len + m_len, i & 1);
+    ccm_aead(frame + a_len, m_len, frame, a_len, frame + a_len + m_len, i & 1);
+    if(memcmp(frame, copy, sizeof(frame)) != 0) {
+      printf("mismatch: m_len %u, a_len %u, %s\n", m_len, a_len,
+             (i & 1) ? "forward" : "inverse");
+      errors++;
+    }
+  }
+  printf("aes-ccm differential test: %d errors\n", errors);
+
+  printf("aes-ccm benchmark, frames per second (two passes / CCM_STAR)\n");
+  for(i = 0; i < sizeof(lengths); i++) {
+    ref_fps = frames_per_second(ref_aead, lengths[i]);
+    ccm_fps = frames_per_second(ccm_aead, lengths[i]);
+    printf("%4u bytes: %lu / %lu\n", lengths[i], ref_fps, ccm_fps);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Test of the anti-replay window of llsec for the native
+ *         platform. Checks replays inside the window, counters that
+ *         arrive out of order, counters behind the window and window
+ *         shifts larger than the bitmap, for unicast and broadcast
+ *         frames, and then compares anti_replay_was_replayed() with a
+ *         model that remembers every counter received.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/llsec/anti-replay.h"
+#include "net/llsec/llsec802154.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define W ANTI_REPLAY_WINDOW_SIZE
+
+#define START      1000
+#define MODEL_MAX  60000
+#define ROUNDS     20000
+
+static int errors;
+
+#define CHECK(cond) do {                                        \
+    if(!(cond)) {                                               \
+      errors++;                                                 \
+      printf("line %d: check failed: %s\n", __LINE__, #cond);   \
+    }                                                           \
+  } while(0)
+
+static struct anti_replay_info info;
+static const linkaddr_t unicast_addr = { { 0x02, 0, 0, 0, 0, 0, 0, 0x01 } };
+
+/* Counters received by the model, and the newest one */
+static uint8_t model_seen[MODEL_MAX + 1024];
+static uint32_t model_last;
+static struct anti_replay_stats model_stats;
+/*---------------------------------------------------------------------------*/
+static void
+set_frame(uint32_t counter, int broadcast)
+{
+  frame802154_frame_counter_t c;
+
+  packetbuf_clear();
+  c.u32 = LLSEC802154_HTONL(counter);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_0_1, c.u16[0]);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_2_3, c.u16[1]);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER,
+                     broadcast ? &linkaddr_null : &unicast_addr);
+}
+/*---------------------------------------------------------------------------*/
+/* Whether a unicast frame with this counter is accepted */
+static int
+accepted(uint32_t counter)
+{
+  set_frame(counter, 0);
+  return !anti_replay_was_replayed(&info);
+}
+/*---------------------------------------------------------------------------*/
+static int
+broadcast_accepted(uint32_t counter)
+{
+  set_frame(counter, 1);
+  return !anti_replay_was_replayed(&info);
+}
+/*---------------------------------------------------------------------------*/
+static void
+init_info(uint32_t counter)
+{
+  set_frame(counter, 0);
+  anti_replay_init_info(&info);
+  memset(&anti_replay_stats, 0, sizeof(anti_replay_stats));
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_cases(void)
+{
+  uint32_t last;
+  int i;
+
+  /* Replays of the first and the next counters */
+  init_info(START);
+  CHECK(!accepted(START));
+  CHECK(accepted(START + 1));
+  CHECK(!accepted(START + 1));
+  CHECK(!accepted(START));
+  CHECK(anti_replay_stats.replayed + anti_replay_stats.too_old == 3);
+
+  /* Counters inside the window that arrive out of order are accepted
+     once: first the odd ones from the oldest on, then the even ones
+     from the newest on */
+  last = START + 2 + 2 * W;
+  CHECK(accepted(last));
+  for(i = W - 1; i >= 1; i--) {
+    if(i % 2 == 1) {
+      CHECK(accepted(last - i));
+    }
+  }
+  for(i = 2; i < W; i += 2) {
+    CHECK(accepted(last - i));
+  }
+  for(i = 1; i < W; i++) {
+    CHECK(!accepted(last - i));
+  }
+  CHECK(!accepted(last));
+#if W
+  CHECK(anti_replay_stats.reordered == W - 1);
+#endif
+
+  /* Behind the window */
+  CHECK(!accepted(last - W));
+  CHECK(!accepted(last - W - 1));
+  CHECK(!accepted(START + 2));
+
+  /* A shift of one less than the window keeps the old last counter in
+     it, a shift of the window size or more drops all of it */
+  memset(&anti_replay_stats, 0, sizeof(anti_replay_stats));
+  if(W > 1) {
+    CHECK(accepted(last + W - 1));
+    CHECK(!accepted(last));
+    CHECK(anti_replay_stats.replayed == 1 && anti_replay_stats.too_old == 0);
+    CHECK(accepted(last + W - 2) == (W > 2));
+    last += W - 1;
+  }
+  if(W > 0) {
+    memset(&anti_replay_stats, 0, sizeof(anti_replay_stats));
+    CHECK(accepted(last + W));
+    CHECK(!accepted(last));
+    CHECK(anti_replay_stats.too_old == 1);
+    last += W;
+  }
+
+  /* Shifts much larger than the bitmap */
+  CHECK(accepted(last + 64 * 3 + 5));
+  last += 64 * 3 + 5;
+  CHECK(!accepted(last));
+  CHECK(accepted(last - 1) == (W > 1));
+  CHECK(!accepted(last - 64));
+  CHECK(accepted(last + 100000));
+  last += 100000;
+  for(i = 1; i < W; i++) {
+    CHECK(accepted(last - i));
+  }
+  CHECK(!accepted(last - W));
+
+  /* Broadcast counters are kept apart from unicast ones */
+  init_info(START);
+  CHECK(accepted(START + 10));
+  CHECK(broadcast_accepted(START + 5));
+  CHECK(broadcast_accepted(START + 4) == (W > 1));
+  CHECK(!broadcast_accepted(START + 5));
+  CHECK(accepted(START + 9) == (W > 1));
+  CHECK(!accepted(START + 10));
+  CHECK(broadcast_accepted(START + 10));
+}
+/*---------------------------------------------------------------------------*/
+static int
+model_accepted(uint32_t counter)
+{
+  if(counter > model_last) {
+    model_last = counter;
+    model_seen[counter] = 1;
+    return 1;
+  }
+  if(model_last - counter >= W) {
+    model_stats.too_old++;
+    return 0;
+  }
+  if(model_seen[counter]) {
+    model_stats.replayed++;
+    return 0;
+  }
+  model_seen[counter] = 1;
+  model_stats.reordered++;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Random counters around the last one, with now and then a jump */
+static void
+check_model(void)
+{
+  uint32_t counter;
+  int i, r, mismatches;
+
+  init_info(START);
+  memset(model_seen, 0, sizeof(model_seen));
+  memset(&model_stats, 0, sizeof(model_stats));
+  model_last = START;
+  model_seen[START] = 1;
+
+  mismatches = 0;
+  for(i = 0; i < ROUNDS && model_last < MODEL_MAX; i++) {
+    r = random_rand() % 100;
+    if(r < 50) {
+      counter = model_last + 1 + random_rand() % 3;
+    } else if(r < 98) {
+      counter = model_last - random_rand() % (W + 3);
+    } else {
+      counter = model_last + W + random_rand() % 100;
+    }
+    if(accepted(counter) != model_accepted(counter)) {
+      mismatches++;
+    }
+  }
+  CHECK(mismatches == 0);
+  CHECK(anti_replay_stats.reordered == model_stats.reordered);
+  CHECK(anti_replay_stats.replayed + anti_replay_stats.too_old ==
+        model_stats.replayed + model_stats.too_old);
+#if W
+  CHECK(anti_replay_stats.replayed == model_stats.replayed);
+  CHECK(anti_replay_stats.too_old == model_stats.too_old);
+#endif
+  printf("model: %d counters, %lu reordered, %lu replayed, %lu too old\n",
+         i, (unsigned long)model_stats.reordered,
+         (unsigned long)model_stats.replayed,
+         (unsigned long)model_stats.too_old);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(anti_replay_test_process, "Anti-replay test");
+AUTOSTART_PROCESSES(&anti_replay_test_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(anti_replay_test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("anti-replay test, window %d\n", W);
+  check_cases();
+  check_model();
+  printf("anti-replay test: %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Internet checksum benchmark for the native platform.
+ *         Checks uip_chksum_add() against the byte pair loop of uIP
+ *         over random lengths, alignments and initial sums, and
+ *         measures the cost of both for a few packet sizes.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/uip_arch.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define MAX_LEN 1500
+#define ROUNDS  100000
+
+static uint8_t buf[MAX_LEN + 8];
+/*---------------------------------------------------------------------------*/
+/* The byte pair loop from uip6.c, used as the reference. */
+static uint16_t
+ref_chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint16_t t;
+  const uint8_t *dataptr;
+  const uint8_t *last_byte;
+
+  dataptr = data;
+  last_byte = data + len - 1;
+
+  while(dataptr < last_byte) {
+    t = (dataptr[0] << 8) + dataptr[1];
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+    dataptr += 2;
+  }
+
+  if(dataptr == last_byte) {
+    t = (dataptr[0] << 8) + 0;
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+  }
+
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+nsecs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+chksum_ns(uint16_t (*f)(uint16_t, const uint8_t *, uint16_t), uint16_t len)
+{
+  unsigned long start;
+  uint16_t sum;
+  int i;
+
+  sum = 0;
+  start = nsecs();
+  for(i = 0; i < ROUNDS; i++) {
+    sum = f(sum, buf + (i & 1), len);
+  }
+  /* Keep the loop from being optimized away. */
+  if(sum == 1) {
+    printf(" ");
+  }
+  return (nsecs() - start) * 10 / ROUNDS;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(chksum_benchmark_process, "Checksum benchmark");
+AUTOSTART_PROCESSES(&chksum_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(chksum_benchmark_process, ev, data)
+{
+  static const uint16_t lengths[] = { 20, 40, 127, 576, 1280, 1500 };
+  unsigned long ref_ns, word_ns;
+  uint16_t len, sum;
+  int i, offset, errors;
+
+  PROCESS_BEGIN();
+
+  errors = 0;
+  for(len = 0; len <= MAX_LEN; len++) {
+    for(offset = 0; offset < 8; offset++) {
+      for(i = 0; i < len + offset; i++) {
+        buf[i] = random_rand();
+      }
+      /* Runs of 0xff bytes exercise the carry folding. */
+      if(len % 3 == 0) {
+        for(i = offset; i < len + offset; i++) {
+          buf[i] = 0xff;
+        }
+      }
+      sum = (offset & 1) ? random_rand() : 0;
+      if(uip_chksum_add(sum, buf + offset, len) !=
+         ref_chksum(sum, buf + offset, len)) {
+        printf("mismatch: length %u, offset %d, sum 0x%04x\n",
+               len, offset, sum);
+        errors++;
+      }
+    }
+  }
+  printf("chksum differential test: %d errors\n", errors);
+
+  printf("chksum benchmark, ns per checksum (byte pairs / words)\n");
+  for(i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    ref_ns = chksum_ns(ref_chksum, lengths[i]);
+    word_ns = chksum_ns(uip_chksum_add, lengths[i]);
+    printf("%4u bytes: %lu.%lu / %lu.%lu\n", lengths[i],
+           ref_ns / 10, ref_ns % 10, word_ns / 10, word_ns % 10);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
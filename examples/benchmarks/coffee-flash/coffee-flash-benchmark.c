@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Coffee flash benchmark for the native platform.
+ *         Runs Coffee on the flash simulation of the native xmem and
+ *         counts the pages read and programmed and the sectors erased
+ *         for a logger that appends small records, and for small
+ *         modifications through the micro logs. It also checks the
+ *         contents of files against copies in RAM while they are
+ *         written, modified, read and reopened at random. Build with
+ *         WRITE_BUFFER=<bytes> to measure the Coffee write buffer.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "dev/xmem-arch.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef COFFEE_WRITE_BUFFER_SIZE
+#define COFFEE_WRITE_BUFFER_SIZE 0
+#endif
+
+#define LOG_SIZE 32768
+#define MODIFY_SIZE 4096
+#define MODIFY_ROUNDS 400
+#define CHECK_FILES 3
+#define CHECK_SIZE 2048
+
+static unsigned char shadow[CHECK_FILES][CHECK_SIZE];
+static int shadow_len[CHECK_FILES];
+static unsigned char buf[LOG_SIZE];
+static unsigned long flash_writes;
+/*---------------------------------------------------------------------------*/
+static void
+start_count(void)
+{
+  struct cfs_coffee_stats cs;
+
+  cfs_coffee_get_stats(&cs);
+  flash_writes = cs.flash_writes;
+  xmem_reset_stats();
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_count(const char *name, unsigned long bytes)
+{
+  struct xmem_stats xs;
+  struct cfs_coffee_stats cs;
+
+  xmem_get_stats(&xs);
+  cfs_coffee_get_stats(&cs);
+  printf("%-16s %6lu writes %6lu programs %6lu reads %2lu erases, "
+         "%lu.%02lu bytes programmed per byte\n",
+         name, cs.flash_writes - flash_writes, xs.programs, xs.reads,
+         xs.erases, xs.bytes_programmed / bytes,
+         xs.bytes_programmed % bytes * 100 / bytes);
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill(unsigned char *p, int len)
+{
+  int i;
+
+  /* Coffee finds the end of a file at its last non-zero byte. */
+  for(i = 0; i < len; i++) {
+    p[i] = 1 + random_rand() % 255;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+log_records(int record_size)
+{
+  static unsigned char record[64];
+  char name[24];
+  int fd, len, errors;
+
+  errors = 0;
+  snprintf(name, sizeof(name), "log%d", record_size);
+  cfs_coffee_reserve(name, LOG_SIZE);
+  fill(buf, LOG_SIZE);
+
+  start_count();
+  fd = cfs_open(name, CFS_WRITE | CFS_APPEND);
+  for(len = 0; len + record_size <= LOG_SIZE; len += record_size) {
+    memcpy(record, &buf[len], record_size);
+    if(cfs_write(fd, record, record_size) != record_size) {
+      errors++;
+    }
+  }
+  cfs_close(fd);
+  snprintf(name, sizeof(name), "log %d B", record_size);
+  print_count(name, len);
+
+  snprintf(name, sizeof(name), "log%d", record_size);
+  fd = cfs_open(name, CFS_READ);
+  if(cfs_read(fd, buf, len) != len) {
+    errors++;
+  }
+  cfs_close(fd);
+  cfs_remove(name);
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+static int
+modify_records(int record_size)
+{
+  static unsigned char file[MODIFY_SIZE];
+  char name[24];
+  int fd, i, offset, errors;
+
+  errors = 0;
+  snprintf(name, sizeof(name), "mod%d", record_size);
+  fill(file, sizeof(file));
+  fd = cfs_open(name, CFS_WRITE);
+  cfs_write(fd, file, sizeof(file));
+  cfs_close(fd);
+
+  start_count();
+  fd = cfs_open(name, CFS_READ | CFS_WRITE);
+  for(i = 0; i < MODIFY_ROUNDS; i++) {
+    offset = random_rand() % (sizeof(file) / record_size) * record_size;
+    fill(&file[offset], record_size);
+    cfs_seek(fd, offset, CFS_SEEK_SET);
+    if(cfs_write(fd, &file[offset], record_size) != record_size) {
+      errors++;
+    }
+  }
+  cfs_close(fd);
+  snprintf(name, sizeof(name), "mod %d B", record_size);
+  print_count(name, MODIFY_ROUNDS * record_size);
+
+  snprintf(name, sizeof(name), "mod%d", record_size);
+  fd = cfs_open(name, CFS_READ);
+  if(cfs_read(fd, buf, sizeof(file)) != sizeof(file) ||
+     memcmp(buf, file, sizeof(file)) != 0) {
+    errors++;
+  }
+  cfs_close(fd);
+  cfs_remove(name);
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_file(int fd, int f)
+{
+  cfs_seek(fd, 0, CFS_SEEK_SET);
+  if(cfs_read(fd, buf, CHECK_SIZE) != shadow_len[f] ||
+     memcmp(buf, shadow[f], shadow_len[f]) != 0) {
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check(int rounds)
+{
+  static const char *names[CHECK_FILES] = { "c0", "c1", "c2" };
+  int fds[CHECK_FILES];
+  int i, f, offset, len, errors;
+
+  errors = 0;
+  for(f = 0; f < CHECK_FILES; f++) {
+    cfs_coffee_reserve(names[f], CHECK_SIZE);
+    fds[f] = cfs_open(names[f], CFS_READ | CFS_WRITE);
+    shadow_len[f] = 0;
+  }
+
+  for(i = 0; i < rounds; i++) {
+    f = random_rand() % CHECK_FILES;
+    switch(random_rand() % 8) {
+    case 0:
+      errors += check_file(fds[f], f);
+      break;
+    case 1:
+      /* Reopen, which finds the end of the file from the storage. */
+      cfs_close(fds[f]);
+      fds[f] = cfs_open(names[f], CFS_READ | CFS_WRITE);
+      errors += check_file(fds[f], f);
+      break;
+    case 2:
+      cfs_coffee_flush();
+      break;
+    case 3:
+    case 4:
+      /* Modify the file. */
+      if(shadow_len[f] == 0) {
+        break;
+      }
+      offset = random_rand() % shadow_len[f];
+      len = 1 + random_rand() % 32;
+      if(offset + len > shadow_len[f]) {
+        len = shadow_len[f] - offset;
+      }
+      fill(&shadow[f][offset], len);
+      cfs_seek(fds[f], offset, CFS_SEEK_SET);
+      errors += cfs_write(fds[f], &shadow[f][offset], len) != len;
+      break;
+    default:
+      /* Append to the file. */
+      len = 1 + random_rand() % 48;
+      if(shadow_len[f] + len > CHECK_SIZE) {
+        break;
+      }
+      fill(&shadow[f][shadow_len[f]], len);
+      cfs_seek(fds[f], 0, CFS_SEEK_END);
+      errors += cfs_write(fds[f], &shadow[f][shadow_len[f]], len) != len;
+      shadow_len[f] += len;
+      break;
+    }
+  }
+
+  for(f = 0; f < CHECK_FILES; f++) {
+    errors += check_file(fds[f], f);
+    cfs_close(fds[f]);
+    cfs_remove(names[f]);
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(coffee_flash_benchmark_process, "Coffee flash benchmark");
+AUTOSTART_PROCESSES(&coffee_flash_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_flash_benchmark_process, ev, data)
+{
+  static const int sizes[] = { 4, 16, 64 };
+  static int i, errors;
+
+  PROCESS_BEGIN();
+
+  printf("coffee-flash benchmark, %d byte write buffer\n",
+         COFFEE_WRITE_BUFFER_SIZE);
+  cfs_coffee_format();
+
+  errors = 0;
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    errors += log_records(sizes[i]);
+  }
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    errors += modify_records(sizes[i]);
+  }
+  for(i = 0; i < 20; i++) {
+    errors += check(500);
+  }
+  printf("file check: %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
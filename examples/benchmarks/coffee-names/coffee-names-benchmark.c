@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Coffee name lookup benchmark for the native platform.
+ *         Creates, opens and removes files from a pool of names at
+ *         random, checks each open against the set of files that
+ *         should exist, and reports the file headers read per
+ *         operation and the time taken. Build with
+ *         NAME_CACHE=<entries> to measure the Coffee name cache.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#ifndef COFFEE_NAME_CACHE_SIZE
+#define COFFEE_NAME_CACHE_SIZE 0
+#endif
+
+#define NAMES 48
+#define FILE_SIZE 200
+#define ROUNDS 20000
+
+static char exists[NAMES];
+/*---------------------------------------------------------------------------*/
+static unsigned long
+nsecs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static int
+run(int names)
+{
+  struct cfs_coffee_stats before, after;
+  unsigned long start, elapsed, reads;
+  char name[16];
+  int i, n, fd, errors;
+
+  errors = 0;
+  cfs_coffee_get_stats(&before);
+  start = nsecs();
+  for(i = 0; i < ROUNDS; i++) {
+    n = random_rand() % names;
+    snprintf(name, sizeof(name), "file%d", n);
+    switch(random_rand() % 4) {
+    case 0:
+      /* Create the file, or fail to create it again. */
+      errors += (cfs_coffee_reserve(name, FILE_SIZE) == 0) != !exists[n];
+      exists[n] = 1;
+      break;
+    case 1:
+      errors += (cfs_remove(name) == 0) != exists[n];
+      exists[n] = 0;
+      break;
+    default:
+      fd = cfs_open(name, CFS_READ);
+      errors += (fd >= 0) != exists[n];
+      if(fd >= 0) {
+        cfs_close(fd);
+      }
+      break;
+    }
+  }
+  elapsed = nsecs() - start;
+  cfs_coffee_get_stats(&after);
+
+  reads = (after.header_reads - before.header_reads) * 100 / ROUNDS;
+  printf("%5d %7lu.%02lu %10lu %10lu %10lu\n", names,
+         reads / 100, reads % 100,
+         after.name_cache_hits - before.name_cache_hits,
+         after.name_cache_misses - before.name_cache_misses,
+         elapsed / ROUNDS);
+
+  for(n = 0; n < names; n++) {
+    if(exists[n]) {
+      snprintf(name, sizeof(name), "file%d", n);
+      errors += cfs_remove(name) != 0;
+      exists[n] = 0;
+    }
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(coffee_names_benchmark_process, "Coffee name lookup benchmark");
+AUTOSTART_PROCESSES(&coffee_names_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_names_benchmark_process, ev, data)
+{
+  static const int pools[] = { 8, 16, NAMES };
+  static int i, errors;
+
+  PROCESS_BEGIN();
+
+  printf("coffee-names benchmark, %d entry name cache\n",
+         COFFEE_NAME_CACHE_SIZE);
+  cfs_coffee_format();
+
+  printf("names reads/op       hits     misses    op (ns)\n");
+  errors = 0;
+  for(i = 0; i < sizeof(pools) / sizeof(pools[0]); i++) {
+    errors += run(pools[i]);
+  }
+  printf("lookup check: %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
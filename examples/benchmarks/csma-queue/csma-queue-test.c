@@ -0,0 +1,499 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Test of the neighbor queues of CSMA for the native platform.
+ *         An RDC driver below CSMA sends the frames that it is given
+ *         at once and logs them, and fails the frames that the test
+ *         tells it to. The test checks that the frames for a neighbor
+ *         join its queue whether the queue is found through the
+ *         neighbor table or, for queues without an entry and after an
+ *         eviction, in the list, and that a queue goes out as one
+ *         burst, also when the RDC driver stops early or the queue is
+ *         freed in the middle of NETSTACK_RDC.send_list().
+ */
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "net/nbr-table.h"
+#include "net/mac/mac.h"
+#include "lib/list.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if !CSMA_CONF_BURST
+#error The test expects the frames of a queue to be sent as one burst
+#endif
+
+#define NEIGHBORS 8
+#define FRAMES    96
+#define LOG_LEN   64
+#define DATA_LEN  20
+
+static int errors;
+
+#define CHECK(cond) do {                                        \
+    if(!(cond)) {                                               \
+      errors++;                                                 \
+      printf("line %d: check failed: %s\n", __LINE__, #cond);   \
+    }                                                           \
+  } while(0)
+
+static linkaddr_t neighbors[NEIGHBORS];
+#define BROADCAST (&linkaddr_null)
+
+/* The upper layer: the MAC callbacks of each frame */
+static uint8_t ids[FRAMES];
+static int tx_calls[FRAMES];
+static int tx_status[FRAMES];
+/* When frame chain_id is done, frames chain_next and chain_next + 1
+   are sent to chain_dst[0] and chain_dst[1] */
+static int chain_id = -1;
+static int chain_next;
+static const linkaddr_t *chain_dst[2];
+
+/* The RDC driver: what it sent, and how it fails */
+struct sent_frame {
+  uint8_t id;
+  uint8_t call;
+  uint8_t pending;
+  linkaddr_t dst;
+};
+static struct sent_frame sent_log[LOG_LEN];
+static int log_len;
+static int send_list_calls;
+/* Fail the first transmission of frame rdc_fail_id with rdc_fail_status */
+static int rdc_fail_id = -1;
+static int rdc_fail_status;
+/* Send at most this many frames per call, if non-zero */
+static int rdc_limit;
+
+/* The neighbor table entry to evict when the table is full */
+static const linkaddr_t *removable;
+static int find_removable_calls;
+/*---------------------------------------------------------------------------*/
+const linkaddr_t *
+csma_queue_test_find_removable(nbr_table_reason_t reason, void *data)
+{
+  find_removable_calls++;
+  return removable;
+}
+/*---------------------------------------------------------------------------*/
+static int
+rdc_send_one(mac_callback_t sent, void *ptr)
+{
+  struct sent_frame *f;
+  int status;
+
+  if(log_len < LOG_LEN) {
+    f = &sent_log[log_len++];
+    f->id = ((uint8_t *)packetbuf_dataptr())[0];
+    f->call = send_list_calls;
+    f->pending = packetbuf_attr(PACKETBUF_ATTR_PENDING);
+    linkaddr_copy(&f->dst, packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+  }
+  status = MAC_TX_OK;
+  if(((uint8_t *)packetbuf_dataptr())[0] == rdc_fail_id) {
+    status = rdc_fail_status;
+    rdc_fail_id = -1;
+  }
+  mac_call_sent_callback(sent, ptr, status, 1);
+  return status;
+}
+/*---------------------------------------------------------------------------*/
+static void
+rdc_send(mac_callback_t sent, void *ptr)
+{
+  send_list_calls++;
+  rdc_send_one(sent, ptr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+rdc_send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *list)
+{
+  struct rdc_buf_list *next;
+  int sent_frames;
+
+  send_list_calls++;
+  for(sent_frames = 0; list != NULL; sent_frames++) {
+    if(rdc_limit != 0 && sent_frames == rdc_limit) {
+      return;
+    }
+    /* The callback frees the frame, as nullrdc expects */
+    next = list_item_next(list);
+    queuebuf_to_packetbuf(list->buf);
+    if(rdc_send_one(sent, ptr) != MAC_TX_OK) {
+      return;
+    }
+    list = next;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+rdc_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+rdc_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+rdc_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+rdc_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+rdc_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+const struct rdc_driver csma_queue_test_rdc_driver = {
+  "csma-queue-test",
+  rdc_init,
+  rdc_send,
+  rdc_send_list,
+  rdc_input,
+  rdc_on,
+  rdc_off,
+  rdc_channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+/* No network layer, so that only the frames of the test are sent */
+static void
+network_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+network_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+const struct network_driver csma_queue_test_network_driver = {
+  "csma-queue-test",
+  network_init,
+  network_input,
+};
+/*---------------------------------------------------------------------------*/
+static void mac_send(int id, const linkaddr_t *dst, int max_transmissions);
+
+static void
+tx_done(void *ptr, int status, int num_tx)
+{
+  int id;
+
+  id = *(uint8_t *)ptr;
+  tx_calls[id]++;
+  tx_status[id] = status;
+  if(id == chain_id) {
+    chain_id = -1;
+    mac_send(chain_next, chain_dst[0], 0);
+    mac_send(chain_next + 1, chain_dst[1], 0);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_send(int id, const linkaddr_t *dst, int max_transmissions)
+{
+  packetbuf_clear();
+  memset(packetbuf_dataptr(), 0, DATA_LEN);
+  ((uint8_t *)packetbuf_dataptr())[0] = id;
+  packetbuf_set_datalen(DATA_LEN);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, dst);
+  if(max_transmissions > 0) {
+    packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                       max_transmissions);
+  }
+  NETSTACK_MAC.send(tx_done, &ids[id]);
+}
+/*---------------------------------------------------------------------------*/
+static void
+reset(void)
+{
+  memset(tx_calls, 0, sizeof(tx_calls));
+  memset(tx_status, 0xff, sizeof(tx_status));
+  log_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+log_index(int id)
+{
+  int i;
+
+  for(i = 0; i < log_len; i++) {
+    if(sent_log[i].id == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+/* Whether frames id[0..n-1] were sent to dst in this order as the only
+   frames of one call, each announcing the next one, and sent once */
+static int
+sent_in_one_burst(const linkaddr_t *dst, const int *id, int n)
+{
+  int i, k;
+
+  i = log_index(id[0]);
+  if(i < 0 || i + n > log_len ||
+     (i > 0 && sent_log[i - 1].call == sent_log[i].call) ||
+     (i + n < log_len && sent_log[i + n].call == sent_log[i].call)) {
+    return 0;
+  }
+  for(k = 0; k < n; k++) {
+    if(sent_log[i + k].id != id[k] ||
+       sent_log[i + k].call != sent_log[i].call ||
+       sent_log[i + k].pending != (k < n - 1) ||
+       !linkaddr_cmp(&sent_log[i + k].dst, dst) ||
+       tx_calls[id[k]] != 1 || tx_status[id[k]] != MAC_TX_OK) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Whether the log holds frames id[0..n-1] in this order, with a new
+   call where id[] holds -1 */
+static int
+sent_in_calls(const int *id, int n)
+{
+  int i, k;
+
+  i = 0;
+  for(k = 0; k < n; k++) {
+    if(id[k] == -1) {
+      if(i == 0 || i == log_len || sent_log[i].call == sent_log[i - 1].call) {
+        return 0;
+      }
+      continue;
+    }
+    if(i == log_len || sent_log[i].id != id[k] ||
+       (i > 0 && id[k - 1] != -1 &&
+        sent_log[i].call != sent_log[i - 1].call)) {
+      return 0;
+    }
+    i++;
+  }
+  return i == log_len;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(csma_queue_test_process, "CSMA queue test");
+AUTOSTART_PROCESSES(&csma_queue_test_process);
+/*---------------------------------------------------------------------------*/
+#define WAIT(t) do {                                    \
+    etimer_set(&et, (t));                               \
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));      \
+  } while(0)
+
+#define BURST(dst, ...) do {                                            \
+    static const int burst_ids[] = { __VA_ARGS__ };                     \
+    CHECK(sent_in_one_burst((dst), burst_ids,                           \
+                            sizeof(burst_ids) / sizeof(burst_ids[0]))); \
+  } while(0)
+
+#define CALLS(...) do {                                                 \
+    static const int call_ids[] = { __VA_ARGS__ };                      \
+    CHECK(sent_in_calls(call_ids, sizeof(call_ids) / sizeof(call_ids[0]))); \
+  } while(0)
+
+PROCESS_THREAD(csma_queue_test_process, ev, data)
+{
+  static struct etimer et;
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < FRAMES; i++) {
+    ids[i] = i;
+  }
+  for(i = 0; i < NEIGHBORS; i++) {
+    neighbors[i].u8[0] = 0x02;
+    neighbors[i].u8[LINKADDR_SIZE - 1] = i + 1;
+  }
+  /* Let the system start */
+  WAIT(CLOCK_SECOND / 10);
+
+  printf("csma-queue test, neighbor index %d, %d table entries\n",
+         CSMA_CONF_NEIGHBOR_INDEX, NBR_TABLE_CONF_MAX_NEIGHBORS);
+
+  /* Frames for three neighbors, interleaved, all queued before the
+     first one is sent */
+  reset();
+  mac_send(0, &neighbors[0], 0);
+  mac_send(1, &neighbors[0], 0);
+  mac_send(2, &neighbors[1], 0);
+  mac_send(3, &neighbors[0], 0);
+  mac_send(4, &neighbors[2], 0);
+  mac_send(5, &neighbors[2], 0);
+  mac_send(6, &neighbors[1], 0);
+  WAIT(CLOCK_SECOND / 10);
+  BURST(&neighbors[0], 0, 1, 3);
+  BURST(&neighbors[1], 2, 6);
+  BURST(&neighbors[2], 4, 5);
+  CHECK(log_len == 7);
+  printf("lookup: %d frames in 3 queues\n", log_len);
+
+  /* More queues than neighbor table entries, and the broadcast queue,
+     which never has one: the second frame for each must join the
+     queue of the first */
+  reset();
+  for(i = 0; i < 7; i++) {
+    mac_send(10 + i, i < 6 ? &neighbors[i] : BROADCAST, 0);
+  }
+  for(i = 6; i >= 0; i--) {
+    mac_send(20 + i, i < 6 ? &neighbors[i] : BROADCAST, 0);
+  }
+  WAIT(CLOCK_SECOND / 10);
+  for(i = 0; i < 7; i++) {
+    int burst_ids[2] = { 10 + i, 20 + i };
+    CHECK(sent_in_one_burst(i < 6 ? &neighbors[i] : BROADCAST, burst_ids, 2));
+  }
+  CHECK(log_len == 14);
+  printf("unindexed: %d frames in 7 queues\n", log_len);
+
+  /* The entry of neighbor 1 is evicted while it has a frame queued */
+  reset();
+  for(i = 0; i < 4; i++) {
+    mac_send(30 + i, &neighbors[i], 0);
+  }
+  find_removable_calls = 0;
+  removable = &neighbors[1];
+  mac_send(34, &neighbors[4], 0);
+  removable = NULL;
+  mac_send(35, &neighbors[1], 0);
+  mac_send(36, &neighbors[4], 0);
+  WAIT(CLOCK_SECOND / 10);
+#if CSMA_CONF_NEIGHBOR_INDEX
+  CHECK(find_removable_calls > 0);
+#endif
+  BURST(&neighbors[0], 30);
+  BURST(&neighbors[1], 31, 35);
+  BURST(&neighbors[2], 32);
+  BURST(&neighbors[3], 33);
+  BURST(&neighbors[4], 34, 36);
+  CHECK(log_len == 7);
+  printf("evicted: %d frames in 5 queues\n", log_len);
+
+  /* A failed frame stops the burst; it and the frames behind it are
+     sent in the next one */
+  reset();
+  rdc_fail_id = 41;
+  rdc_fail_status = MAC_TX_NOACK;
+  for(i = 40; i < 44; i++) {
+    mac_send(i, &neighbors[0], 0);
+  }
+  WAIT(CLOCK_SECOND / 10);
+  CALLS(40, 41, -1, 41, 42, 43);
+  CHECK(sent_log[0].pending && sent_log[1].pending && sent_log[2].pending &&
+        sent_log[3].pending && !sent_log[4].pending);
+  for(i = 40; i < 44; i++) {
+    CHECK(tx_calls[i] == 1 && tx_status[i] == MAC_TX_OK);
+  }
+
+  /* The frames that the RDC driver did not get to are sent next */
+  reset();
+  rdc_limit = 2;
+  for(i = 44; i < 49; i++) {
+    mac_send(i, &neighbors[0], 0);
+  }
+  WAIT(CLOCK_SECOND / 10);
+  rdc_limit = 0;
+  CALLS(44, 45, -1, 46, 47, -1, 48);
+  for(i = 44; i < 49; i++) {
+    CHECK(tx_calls[i] == 1 && tx_status[i] == MAC_TX_OK);
+  }
+
+  /* A frame that is dropped in the middle of a burst */
+  reset();
+  rdc_fail_id = 50;
+  rdc_fail_status = MAC_TX_NOACK;
+  mac_send(50, &neighbors[0], 1);
+  mac_send(51, &neighbors[0], 0);
+  mac_send(52, &neighbors[0], 0);
+  WAIT(CLOCK_SECOND / 10);
+  CALLS(50, -1, 51, 52);
+  CHECK(tx_calls[50] == 1 && tx_status[50] == MAC_TX_NOACK);
+  CHECK(tx_calls[51] == 1 && tx_status[51] == MAC_TX_OK);
+  CHECK(tx_calls[52] == 1 && tx_status[52] == MAC_TX_OK);
+
+  /* The last frame of a burst is dropped, which frees the queue inside
+     NETSTACK_RDC.send_list(), and its callback queues new frames that
+     may reuse the queue */
+  reset();
+  rdc_fail_id = 55;
+  rdc_fail_status = MAC_TX_NOACK;
+  chain_id = 55;
+  chain_next = 56;
+  chain_dst[0] = &neighbors[1];
+  chain_dst[1] = &neighbors[0];
+  mac_send(54, &neighbors[0], 0);
+  mac_send(55, &neighbors[0], 1);
+  WAIT(CLOCK_SECOND / 10);
+  CHECK(log_len == 4 && log_index(54) == 0 && log_index(55) == 1);
+  CHECK(sent_log[0].call == sent_log[1].call);
+  CHECK(tx_calls[54] == 1 && tx_status[54] == MAC_TX_OK);
+  CHECK(tx_calls[55] == 1 && tx_status[55] == MAC_TX_NOACK);
+  BURST(&neighbors[1], 56);
+  BURST(&neighbors[0], 57);
+  printf("burst: %d send_list calls in total\n", send_list_calls);
+
+  /* Every queue and packet has been freed */
+  reset();
+  for(i = 0; i < QUEUEBUF_CONF_NUM; i++) {
+    mac_send(60 + i, &neighbors[i % NEIGHBORS], 0);
+  }
+  WAIT(CLOCK_SECOND / 10);
+  for(i = 0; i < QUEUEBUF_CONF_NUM; i++) {
+    CHECK(tx_calls[60 + i] == 1 && tx_status[60 + i] == MAC_TX_OK);
+  }
+  CHECK(log_len == QUEUEBUF_CONF_NUM);
+
+  printf("csma-queue test: %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
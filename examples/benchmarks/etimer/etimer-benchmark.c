@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Event timer benchmark for the native platform. Measures the
+ *         cost of setting timers, of running the event timer poll
+ *         handler and of delivering expirations with 10, 100 and 1000
+ *         pending timers. Build with ETIMER_HEAP=1 to measure the
+ *         heap backend instead of the list backend.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_TIMERS 1000
+#define ROUNDS     10000
+
+static struct etimer timers[MAX_TIMERS];
+/* Timers that are set without being initialized first */
+static struct etimer junk[10];
+static struct etimer guard;
+static const int sizes[] = { 10, 100, 1000 };
+/*---------------------------------------------------------------------------*/
+static unsigned long
+nsecs(clockid_t clk)
+{
+  struct timespec ts;
+
+  clock_gettime(clk, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+far_interval(void)
+{
+  return 60 * CLOCK_SECOND + random_rand() % CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(etimer_benchmark_process, "Etimer benchmark");
+AUTOSTART_PROCESSES(&etimer_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_benchmark_process, ev, data)
+{
+  static int s, n, i, expired;
+  static unsigned long start, set_ns, poll_ns, expire_ns;
+
+  PROCESS_BEGIN();
+
+  printf("etimer benchmark, %s backend\n", ETIMER_HEAP ? "heap" : "list");
+  printf("%6s %12s %12s %14s\n",
+         "timers", "set (ns)", "poll (ns)", "expire (ns)");
+
+  for(s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    n = sizes[s];
+
+    for(i = 0; i < n; i++) {
+      etimer_set(&timers[i], far_interval());
+    }
+
+    /* Re-set random timers among n pending ones. */
+    start = nsecs(CLOCK_MONOTONIC);
+    for(i = 0; i < ROUNDS; i++) {
+      etimer_set(&timers[random_rand() % n], far_interval());
+    }
+    set_ns = (nsecs(CLOCK_MONOTONIC) - start) / ROUNDS;
+
+    /* Run the poll handler of the event timer process with nothing
+       to expire. */
+    start = nsecs(CLOCK_MONOTONIC);
+    for(i = 0; i < ROUNDS; i++) {
+      process_post_synch(&etimer_process, PROCESS_EVENT_POLL, NULL);
+    }
+    poll_ns = (nsecs(CLOCK_MONOTONIC) - start) / ROUNDS;
+
+    /* Let all n timers expire within 50 ticks and count the CPU time
+       spent until all expiration events have been delivered. */
+    start = nsecs(CLOCK_PROCESS_CPUTIME_ID);
+    for(i = 0; i < n; i++) {
+      etimer_set(&timers[i], 1 + i % 50);
+    }
+    for(expired = 0; expired < n;) {
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+      expired++;
+    }
+    expire_ns = (nsecs(CLOCK_PROCESS_CPUTIME_ID) - start) / n;
+
+    printf("%6d %12lu %12lu %14lu\n", n, set_ns, poll_ns, expire_ns);
+  }
+
+  /* Set timers that hold stale data, as timers on the stack or in
+     reused memory do, among pending ones. */
+  for(i = 0; i < 100; i++) {
+    etimer_set(&timers[i], CLOCK_SECOND / 2 + i);
+  }
+  memset(junk, 0xa5, sizeof(junk));
+  for(i = 0; i < sizeof(junk) / sizeof(junk[0]); i++) {
+    memcpy(&junk[i], &timers[i], sizeof(junk[i]));
+    junk[i].p = &etimer_benchmark_process;
+    etimer_set(&junk[i], 1 + i);
+  }
+  for(expired = 0; expired < sizeof(junk) / sizeof(junk[0]);) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+    expired += data >= (void *)junk && data < (void *)&junk[10];
+  }
+  /* The pending timers must all still expire. */
+  etimer_set(&guard, CLOCK_SECOND * 2);
+  for(expired = 0; expired < 100;) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+    if(data == &guard) {
+      break;
+    }
+    expired++;
+  }
+  etimer_stop(&guard);
+  printf("uninitialized timers: %d of 100 pending timers lost\n",
+         100 - expired);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
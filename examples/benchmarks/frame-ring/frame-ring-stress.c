@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Stress test for the frame ring on the native platform. A
+ *         producer thread queues numbered frames while the Contiki
+ *         process consumes them, and every frame is checked for order,
+ *         length and content.
+ */
+
+#include "contiki.h"
+#include "lib/frame-ring.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define SLOTS   8
+#define MAX_LEN 127
+#define FRAMES  2000000UL
+
+static uint8_t buf[SLOTS * FRAME_RING_SLOT_SIZE(MAX_LEN)];
+static struct frame_ring ring;
+
+/* Whether the producer drops frames when the ring is full */
+static volatile int lossy;
+static volatile int producer_done;
+static unsigned long producer_full;
+/*---------------------------------------------------------------------------*/
+static uint16_t
+frame_len(unsigned long seq)
+{
+  return 4 + (seq * 7) % (MAX_LEN - 3);
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill(uint8_t *frame, unsigned long seq)
+{
+  uint16_t i, len;
+
+  len = frame_len(seq);
+  memcpy(frame, &seq, 4);
+  for(i = 4; i < len; i++) {
+    frame[i] = seq + i;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+check(const uint8_t *frame, uint16_t len, unsigned long seq)
+{
+  uint32_t got;
+  uint16_t i;
+
+  memcpy(&got, frame, 4);
+  if(got != (uint32_t)seq || len != frame_len(seq)) {
+    return 0;
+  }
+  for(i = 4; i < len; i++) {
+    if(frame[i] != (uint8_t)(seq + i)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void *
+producer(void *arg)
+{
+  uint8_t frame[MAX_LEN];
+  unsigned long seq;
+  uint8_t *slot;
+
+  for(seq = 0; seq < FRAMES; seq++) {
+    if(lossy && (seq & 15) == 0) {
+      /* Send in bursts, so that the consumer keeps up now and then. */
+      sched_yield();
+    }
+    /* Alternate between writing in place and copying in. */
+    if(seq & 1) {
+      fill(frame, seq);
+      while(!frame_ring_put(&ring, frame, frame_len(seq))) {
+        producer_full++;
+        if(lossy) {
+          break;
+        }
+        sched_yield();
+      }
+    } else {
+      while((slot = frame_ring_reserve(&ring)) == NULL) {
+        producer_full++;
+        if(lossy) {
+          break;
+        }
+        sched_yield();
+      }
+      if(slot != NULL) {
+        fill(slot, seq);
+        frame_ring_commit(&ring, frame_len(seq));
+      }
+    }
+  }
+  FRAME_RING_BARRIER();
+  producer_done = 1;
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+nsecs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+/* Consumes frames until the producer is done. Returns the number of
+   errors; *received is set to the number of frames received. */
+static unsigned long
+run(int drop, unsigned long *received, unsigned long *ns)
+{
+  uint8_t frame[MAX_LEN];
+  unsigned long expected, errors, start;
+  pthread_t thread;
+  uint8_t *slot;
+  uint16_t len;
+  int ret;
+
+  frame_ring_init(&ring, buf, SLOTS, MAX_LEN);
+  lossy = drop;
+  producer_full = 0;
+  expected = errors = *received = 0;
+  producer_done = 0;
+
+  start = nsecs();
+  pthread_create(&thread, NULL, producer, NULL);
+  while(expected < FRAMES) {
+    if(*received & 1) {
+      ret = frame_ring_get(&ring, frame, sizeof(frame));
+      slot = ret < 0 ? NULL : frame;
+      len = ret;
+    } else {
+      slot = frame_ring_peek(&ring, &len);
+    }
+    if(slot == NULL) {
+      if(producer_done && frame_ring_elements(&ring) == 0) {
+        break;
+      }
+      sched_yield();
+      continue;
+    }
+    if(drop) {
+      /* Some frames may have been dropped, but never reordered. */
+      while(expected < FRAMES && !check(slot, len, expected)) {
+        expected++;
+      }
+    }
+    if(!check(slot, len, expected)) {
+      errors++;
+    }
+    if(!(*received & 1)) {
+      frame_ring_release(&ring);
+    }
+    expected++;
+    (*received)++;
+  }
+  pthread_join(thread, NULL);
+  *ns = nsecs() - start;
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(frame_ring_stress_process, "Frame ring stress test");
+AUTOSTART_PROCESSES(&frame_ring_stress_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(frame_ring_stress_process, ev, data)
+{
+  unsigned long errors, received, ns;
+
+  PROCESS_BEGIN();
+
+  errors = run(0, &received, &ns);
+  printf("frame-ring lossless: %lu frames, %lu errors, %lu full, %lu frames/s\n",
+         received, errors, producer_full,
+         (unsigned long)(received * 1000000000ULL / ns));
+
+  errors = run(1, &received, &ns);
+  printf("frame-ring lossy: %lu frames, %lu dropped, %lu errors%s\n",
+         received, FRAMES - received, errors,
+         (uint16_t)(FRAMES - received) == ring.dropped ? "" :
+         ", drop count mismatch");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Memory block allocator test and benchmark for the native
+ *         platform. Runs random allocations and frees against blocks
+ *         of 16, 64 and 256 chunks and of 16 single bytes, and checks
+ *         every result against a model of the block. Then measures the
+ *         cost of a free and an allocation with three quarters of the
+ *         chunks in use. Build with FREELIST=0 to measure the search
+ *         for free chunks instead of the free list.
+ */
+
+#include "contiki.h"
+#include "lib/memb.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TESTS  200000
+#define ROUNDS 1000000
+#define MAX_CHUNKS 256
+
+struct chunk {
+  struct chunk *next;
+  uint8_t data[30];
+};
+
+MEMB(chunks16, struct chunk, 16);
+MEMB(chunks64, struct chunk, 64);
+MEMB(chunks256, struct chunk, 256);
+/* Chunks too small to hold a free list link */
+MEMB(bytes, char, 16);
+
+static struct memb *blocks[] = { &chunks16, &chunks64, &chunks256, &bytes };
+
+/* The chunks in use, and the byte that each one is filled with */
+static char *held[MAX_CHUNKS];
+static uint8_t fill[MAX_CHUNKS];
+static uint8_t in_use[MAX_CHUNKS];
+static unsigned short order[1024];
+static char outside;
+/*---------------------------------------------------------------------------*/
+static unsigned long
+nsecs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static int
+index_of(struct memb *m, char *p)
+{
+  return (p - (char *)m->mem) / m->size;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_fill(struct memb *m, char *p, uint8_t b)
+{
+  int i;
+
+  for(i = 0; i < m->size; i++) {
+    if((uint8_t)p[i] != b) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+test_block(struct memb *m)
+{
+  int i, k, n, errors;
+  char *p;
+
+  memb_init(m);
+  memset(in_use, 0, sizeof(in_use));
+  n = 0;
+  errors = 0;
+
+  for(i = 0; i < TESTS; i++) {
+    if(random_rand() & 1) {
+      p = memb_alloc(m);
+      if(n == m->num) {
+        errors += p != NULL;
+      } else if(p == NULL || !memb_inmemb(m, p) ||
+                (p - (char *)m->mem) % m->size != 0 ||
+                in_use[index_of(m, p)]) {
+        errors++;
+      } else {
+        in_use[index_of(m, p)] = 1;
+        held[n] = p;
+        fill[n] = random_rand();
+        memset(p, fill[n], m->size);
+        n++;
+      }
+    } else if(n > 0) {
+      k = random_rand() % n;
+      p = held[k];
+      /* The chunks in use must not have been touched */
+      errors += !check_fill(m, p, fill[k]);
+      errors += memb_free(m, p) != 0;
+      if((i & 15) == 0) {
+        /* Freeing a free chunk must change nothing */
+        errors += memb_free(m, p) != 0;
+      }
+      in_use[index_of(m, p)] = 0;
+      n--;
+      held[k] = held[n];
+      fill[k] = fill[n];
+    } else {
+      errors += memb_free(m, &outside) != -1;
+    }
+    errors += memb_numfree(m) != m->num - n;
+  }
+  for(k = 0; k < n; k++) {
+    errors += !check_fill(m, held[k], fill[k]);
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+time_block(struct memb *m)
+{
+  unsigned long start;
+  int i, k, n;
+
+  memb_init(m);
+  n = m->num * 3 / 4;
+  for(i = 0; i < n; i++) {
+    held[i] = memb_alloc(m);
+  }
+  /* Free chunks in a random order, so that the free ones are spread
+     over the block. */
+  for(i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+    order[i] = random_rand() % n;
+  }
+
+  start = nsecs();
+  for(i = 0; i < ROUNDS; i++) {
+    k = order[i & (sizeof(order) / sizeof(order[0]) - 1)];
+    memb_free(m, held[k]);
+    held[k] = memb_alloc(m);
+  }
+  return (nsecs() - start) * 1000 / ROUNDS;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(memb_benchmark_process, "Memb benchmark");
+AUTOSTART_PROCESSES(&memb_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(memb_benchmark_process, ev, data)
+{
+  unsigned long ps;
+  int i, errors;
+
+  PROCESS_BEGIN();
+
+  printf("memb benchmark, free list %s\n", MEMB_FREELIST ? "on" : "off");
+
+  errors = 0;
+  for(i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++) {
+    errors += test_block(blocks[i]);
+  }
+  printf("memb random test: %d errors\n", errors);
+
+  printf("%6s %6s %20s\n", "chunks", "size", "free+alloc (ns)");
+  for(i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++) {
+    ps = time_block(blocks[i]);
+    printf("%6u %6u %16lu.%03lu\n", blocks[i]->num, blocks[i]->size,
+           ps / 1000, ps % 1000);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Managed memory test and benchmark for the native platform.
+ *         Runs random allocations, frees and compactions with random
+ *         budgets, and checks every allocation result and the content
+ *         of every block. Then measures the cost of allocating and
+ *         freeing, and of compacting with a few budgets while idle.
+ *         Build with DEFERRED=0 to measure compaction on every free.
+ */
+
+#include "contiki.h"
+#include "lib/mmem.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define BLOCKS 64
+#define TESTS  200000
+#define ROUNDS 200000
+/* Operations between two idle compactions */
+#define IDLE_INTERVAL 8
+
+#if MMEM_DEFERRED_COMPACTION
+#define EXTENT(size) (((size) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+#else
+#define EXTENT(size) (size)
+#endif
+
+static struct mmem blocks[BLOCKS];
+static unsigned int sizes[BLOCKS];
+static uint8_t fill[BLOCKS];
+static uint8_t in_use[BLOCKS];
+/* Bytes in use, rounded up as mmem does */
+static unsigned int used;
+static unsigned long allocs, failed, frees;
+#if !MMEM_DEFERRED_COMPACTION
+/* Bytes that the frees have moved down */
+static unsigned long moved;
+#endif /* !MMEM_DEFERRED_COMPACTION */
+/* Fill and check the blocks, which is left out when timing */
+static int check;
+/*---------------------------------------------------------------------------*/
+static unsigned long
+nsecs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned int
+random_size(void)
+{
+  /* Mostly small blocks, and some large ones */
+  if((random_rand() & 3) == 0) {
+    return 1 + random_rand() % 600;
+  }
+  return 1 + random_rand() % 40;
+}
+/*---------------------------------------------------------------------------*/
+/* Allocates or frees block i, and returns the number of errors */
+static int
+random_op(int i)
+{
+  unsigned int j, size;
+#if !MMEM_DEFERRED_COMPACTION
+  struct mmem *n;
+#endif /* !MMEM_DEFERRED_COMPACTION */
+
+  if(in_use[i]) {
+#if !MMEM_DEFERRED_COMPACTION
+    for(n = blocks[i].next; n != NULL; n = n->next) {
+      moved += n->size;
+    }
+#endif /* !MMEM_DEFERRED_COMPACTION */
+    mmem_free(&blocks[i]);
+    frees++;
+    in_use[i] = 0;
+    used -= EXTENT(sizes[i]);
+    return 0;
+  }
+
+  size = random_size();
+  allocs++;
+  if(!mmem_alloc(&blocks[i], size)) {
+    failed++;
+    /* An allocation must only fail when not enough memory is free */
+    return used + EXTENT(size) <= MMEM_CONF_SIZE;
+  }
+  in_use[i] = 1;
+  sizes[i] = size;
+  fill[i] = random_rand();
+  used += EXTENT(size);
+  for(j = 0; check && j < size; j++) {
+    ((uint8_t *)MMEM_PTR(&blocks[i]))[j] = fill[i] + j;
+  }
+  return used > MMEM_CONF_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the number of blocks whose content has changed */
+static int
+check_blocks(void)
+{
+  unsigned int j;
+  int i, errors;
+
+  errors = 0;
+  for(i = 0; check && i < BLOCKS; i++) {
+    if(in_use[i]) {
+      for(j = 0; j < sizes[i]; j++) {
+        if(((uint8_t *)MMEM_PTR(&blocks[i]))[j] != (uint8_t)(fill[i] + j)) {
+          errors++;
+          break;
+        }
+      }
+    }
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_all(void)
+{
+  int i;
+
+  for(i = 0; i < BLOCKS; i++) {
+    if(in_use[i]) {
+      mmem_free(&blocks[i]);
+      in_use[i] = 0;
+    }
+  }
+  used = 0;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Runs ROUNDS random allocations and frees, and compacts with the
+ * given budget after every IDLE_INTERVAL of them. Returns the time
+ * spent in allocations and frees, and in compactions, in nanoseconds
+ * per operation.
+ */
+static void
+time_ops(unsigned int budget, unsigned long *op_ns, unsigned long *compact_ns)
+{
+  unsigned long start;
+  int i, j;
+
+  free_all();
+  frees = 0;
+  *op_ns = *compact_ns = 0;
+  for(i = 0; i < ROUNDS; i += IDLE_INTERVAL) {
+    start = nsecs();
+    for(j = 0; j < IDLE_INTERVAL; j++) {
+      random_op(random_rand() % BLOCKS);
+    }
+    *op_ns += nsecs() - start;
+#if MMEM_DEFERRED_COMPACTION
+    if(budget > 0) {
+      start = nsecs();
+      mmem_compact(budget);
+      *compact_ns += nsecs() - start;
+    }
+#endif /* MMEM_DEFERRED_COMPACTION */
+  }
+  *op_ns /= ROUNDS;
+  *compact_ns /= ROUNDS;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(mmem_benchmark_process, "Mmem benchmark");
+AUTOSTART_PROCESSES(&mmem_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mmem_benchmark_process, ev, data)
+{
+#if MMEM_DEFERRED_COMPACTION
+  static const unsigned int budgets[] = { 0, 64, 256, 1024 };
+  struct mmem_stats before, after;
+#endif /* MMEM_DEFERRED_COMPACTION */
+  static int i, j, errors;
+  unsigned long op_ns, compact_ns;
+
+  PROCESS_BEGIN();
+
+  mmem_init();
+  printf("mmem benchmark, %u bytes, deferred compaction %s\n",
+         MMEM_CONF_SIZE, MMEM_DEFERRED_COMPACTION ? "on" : "off");
+
+  /* Let the compaction process run between batches of operations, as
+     it would while the system is idle. */
+  check = 1;
+  errors = 0;
+  for(i = 0; i < TESTS / BLOCKS; i++) {
+    for(j = 0; j < BLOCKS; j++) {
+#if MMEM_DEFERRED_COMPACTION
+      if(random_rand() % 10 == 0) {
+        mmem_compact(random_rand() % 1024);
+        continue;
+      }
+#endif /* MMEM_DEFERRED_COMPACTION */
+      errors += random_op(random_rand() % BLOCKS);
+    }
+    errors += check_blocks();
+    process_poll(PROCESS_CURRENT());
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+  }
+  printf("mmem random test: %d errors, %lu of %lu allocations failed\n",
+         errors, failed, allocs);
+
+  check = 0;
+#if MMEM_DEFERRED_COMPACTION
+  printf("%6s %10s %13s %11s %7s\n", "budget", "op (ns)",
+         "compact (ns)", "moved/free", "forced");
+  for(i = 0; i < sizeof(budgets) / sizeof(budgets[0]); i++) {
+    mmem_get_stats(&before);
+    time_ops(budgets[i], &op_ns, &compact_ns);
+    mmem_get_stats(&after);
+    printf("%6u %10lu %13lu %11lu %7u\n", budgets[i], op_ns, compact_ns,
+           (after.moved - before.moved) / frees,
+           after.compactions - before.compactions);
+  }
+#else /* MMEM_DEFERRED_COMPACTION */
+  moved = 0;
+  time_ops(0, &op_ns, &compact_ns);
+  printf("%10s %11s\n", "op (ns)", "moved/free");
+  printf("%10lu %11lu\n", op_ns, moved / frees);
+#endif /* MMEM_DEFERRED_COMPACTION */
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Neighbor table lookup benchmark for the native platform.
+ *         Fills a neighbor table, measures the cost of looking up
+ *         present and absent link-layer addresses, and checks that
+ *         lookups stay correct while neighbors are being replaced.
+ *         Build with NBR_TABLE_HASH=1 to measure the hashed lookup.
+ */
+
+#include "contiki.h"
+#include "net/nbr-table.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define ROUNDS 1000000
+#define ADDRS  (2 * NBR_TABLE_MAX_NEIGHBORS)
+
+struct bench_nbr {
+  uint16_t id;
+};
+
+NBR_TABLE(struct bench_nbr, bench_nbrs);
+
+static linkaddr_t addrs[ADDRS];
+/*---------------------------------------------------------------------------*/
+static unsigned long
+nsecs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+lookup_ns(int first, int count)
+{
+  unsigned long start;
+  int i, found;
+
+  found = 0;
+  start = nsecs();
+  for(i = 0; i < ROUNDS; i++) {
+    found += nbr_table_get_from_lladdr(bench_nbrs,
+                                       &addrs[first + i % count]) != NULL;
+  }
+  /* Keep the loop from being optimized away. */
+  if(found < 0) {
+    printf("unreachable\n");
+  }
+  return (nsecs() - start) / ROUNDS;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(nbr_table_benchmark_process, "Neighbor table benchmark");
+AUTOSTART_PROCESSES(&nbr_table_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(nbr_table_benchmark_process, ev, data)
+{
+  static struct bench_nbr *n;
+  static int i, j, errors;
+
+  PROCESS_BEGIN();
+
+  nbr_table_register(bench_nbrs, NULL);
+
+  for(i = 0; i < ADDRS; i++) {
+    for(j = 0; j < LINKADDR_SIZE; j++) {
+      addrs[i].u8[j] = random_rand();
+    }
+  }
+
+  for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS; i++) {
+    n = nbr_table_add_lladdr(bench_nbrs, &addrs[i], NBR_TABLE_REASON_UNDEFINED, NULL);
+    n->id = i;
+  }
+
+  printf("nbr-table benchmark, %s lookup, %d neighbors\n",
+         NBR_TABLE_HASH ? "hashed" : "linear", NBR_TABLE_MAX_NEIGHBORS);
+  printf("hit:  %lu ns per lookup\n", lookup_ns(0, NBR_TABLE_MAX_NEIGHBORS));
+  printf("miss: %lu ns per lookup\n",
+         lookup_ns(NBR_TABLE_MAX_NEIGHBORS, NBR_TABLE_MAX_NEIGHBORS));
+
+  /* Replace neighbors at random and check that exactly the
+     neighbors in the table are found. */
+  errors = 0;
+  for(i = 0; i < 10000; i++) {
+    j = random_rand() % ADDRS;
+    if(nbr_table_get_from_lladdr(bench_nbrs, &addrs[j]) == NULL) {
+      n = nbr_table_add_lladdr(bench_nbrs, &addrs[j], NBR_TABLE_REASON_UNDEFINED, NULL);
+      n->id = j;
+    }
+  }
+  for(i = 0; i < ADDRS; i++) {
+    n = nbr_table_get_from_lladdr(bench_nbrs, &addrs[i]);
+    if(n != NULL && (n->id != i ||
+       !linkaddr_cmp(nbr_table_get_lladdr(bench_nbrs, n), &addrs[i]))) {
+      errors++;
+    }
+  }
+  for(n = nbr_table_head(bench_nbrs), i = 0; n != NULL;
+      n = nbr_table_next(bench_nbrs, n), i++) {
+    if(nbr_table_get_from_lladdr(bench_nbrs, &addrs[n->id]) != n) {
+      errors++;
+    }
+  }
+  printf("replacement check: %d neighbors, %d errors\n", i, errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
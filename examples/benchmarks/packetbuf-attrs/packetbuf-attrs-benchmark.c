@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Packetbuf attribute benchmark for the native platform.
+ *         Measures the RAM that each queued frame spends on saved
+ *         attributes, and the cost of saving and restoring them, for
+ *         the attributes that CSMA, ContikiMAC and TSCH have set when
+ *         a frame is queued. It also checks that saved attributes are
+ *         restored exactly, for random sets of attributes. Build with
+ *         SAVED_ATTRS=<n> for the compact saved attributes, and with
+ *         TSCH=1 for the attributes of a TSCH node.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define ROUNDS 200000
+#define PAYLOAD_LEN 64
+
+struct profile {
+  const char *name;
+  const uint8_t *types;
+  int num;
+};
+
+#if !BENCHMARK_TSCH
+/* Set by sicslowpan, the llsec driver and the MAC before queueing */
+static const uint8_t csma_types[] = {
+  PACKETBUF_ATTR_NETWORK_ID, PACKETBUF_ATTR_CHANNEL,
+  PACKETBUF_ATTR_FRAME_TYPE, PACKETBUF_ATTR_MAC_SEQNO,
+  PACKETBUF_ATTR_PENDING,
+};
+/* CSMA over ContikiMAC, after the first transmission attempt */
+static const uint8_t contikimac_types[] = {
+  PACKETBUF_ATTR_NETWORK_ID, PACKETBUF_ATTR_CHANNEL,
+  PACKETBUF_ATTR_FRAME_TYPE, PACKETBUF_ATTR_MAC_SEQNO,
+  PACKETBUF_ATTR_PENDING, PACKETBUF_ATTR_MAC_ACK,
+  PACKETBUF_ATTR_IS_CREATED_AND_SECURED,
+};
+#else /* !BENCHMARK_TSCH */
+/* A unicast frame with Orchestra and link-layer security */
+static const uint8_t tsch_types[] = {
+  PACKETBUF_ATTR_NETWORK_ID, PACKETBUF_ATTR_CHANNEL,
+  PACKETBUF_ATTR_FRAME_TYPE, PACKETBUF_ATTR_MAC_SEQNO,
+  PACKETBUF_ATTR_MAC_ACK, PACKETBUF_ATTR_SECURITY_LEVEL,
+  PACKETBUF_ATTR_KEY_ID_MODE, PACKETBUF_ATTR_KEY_INDEX,
+  PACKETBUF_ATTR_TSCH_SLOTFRAME, PACKETBUF_ATTR_TSCH_TIMESLOT,
+};
+#endif /* BENCHMARK_TSCH */
+
+#define PROFILE(name, types) { name, types, sizeof(types) }
+static const struct profile profiles[] = {
+#if BENCHMARK_TSCH
+  PROFILE("TSCH", tsch_types),
+#else /* BENCHMARK_TSCH */
+  PROFILE("CSMA", csma_types),
+  PROFILE("ContikiMAC", contikimac_types),
+#endif /* BENCHMARK_TSCH */
+};
+
+/* The attributes that the packetbuf should have */
+static packetbuf_attr_t expected[PACKETBUF_NUM_ATTRS];
+static linkaddr_t sender, receiver;
+static uint8_t payload[PAYLOAD_LEN];
+/*---------------------------------------------------------------------------*/
+static unsigned long
+nsecs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_attr(uint8_t type, packetbuf_attr_t val)
+{
+  packetbuf_set_attr(type, val);
+  expected[type] = val;
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill_packetbuf(void)
+{
+  packetbuf_clear();
+  memset(expected, 0, sizeof(expected));
+  packetbuf_copyfrom(payload, sizeof(payload));
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &sender);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &receiver);
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_packetbuf(void)
+{
+  int i, errors;
+
+  errors = 0;
+  for(i = 0; i < PACKETBUF_NUM_ATTRS; i++) {
+    if(packetbuf_attr(i) != expected[i]) {
+      errors++;
+    }
+  }
+  if(!linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_SENDER), &sender) ||
+     !linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &receiver)) {
+    errors++;
+  }
+  if(packetbuf_datalen() != sizeof(payload) ||
+     memcmp(packetbuf_dataptr(), payload, sizeof(payload)) != 0) {
+    errors++;
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+save_restore_ns(void)
+{
+  static struct packetbuf_saved_attrs saved;
+  unsigned long start;
+  int i;
+
+  start = nsecs();
+  for(i = 0; i < ROUNDS; i++) {
+    packetbuf_attr_save(&saved);
+    packetbuf_attr_restore(&saved);
+  }
+  return (nsecs() - start) / ROUNDS;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+queuebuf_ns(void)
+{
+  struct queuebuf *q;
+  unsigned long start;
+  int i;
+
+  start = nsecs();
+  for(i = 0; i < ROUNDS; i++) {
+    q = queuebuf_new_from_packetbuf();
+    if(q == NULL) {
+      return 0;
+    }
+    queuebuf_to_packetbuf(q);
+    queuebuf_free(q);
+  }
+  return (nsecs() - start) / ROUNDS;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check(int rounds)
+{
+  struct queuebuf *q;
+  int i, j, n, fits, errors;
+
+  errors = 0;
+  for(i = 0; i < rounds; i++) {
+    /* Set a random number of random attributes, some of them back to
+       zero, and save them in a queuebuf. */
+    fill_packetbuf();
+    n = random_rand() % 16;
+    for(j = 0; j < n; j++) {
+      set_attr(1 + random_rand() % (PACKETBUF_NUM_ATTRS - 1),
+               random_rand() % 4 == 0 ? 0 : random_rand());
+    }
+    n = 0;
+    for(j = 0; j < PACKETBUF_NUM_ATTRS; j++) {
+      n += expected[j] != 0;
+    }
+    fits = PACKETBUF_SAVED_ATTRS == 0 || n <= PACKETBUF_SAVED_ATTRS;
+
+    q = queuebuf_new_from_packetbuf();
+    if(q == NULL) {
+      errors += fits;
+      continue;
+    }
+    errors += !fits;
+    for(j = 0; j < PACKETBUF_NUM_ATTRS; j++) {
+      if(queuebuf_attr(q, j) != expected[j]) {
+        errors++;
+      }
+    }
+
+    /* Restore them over other attributes. */
+    packetbuf_clear();
+    for(j = 0; j < 8; j++) {
+      packetbuf_set_attr(1 + random_rand() % (PACKETBUF_NUM_ATTRS - 1),
+                         random_rand() | 1);
+    }
+    queuebuf_to_packetbuf(q);
+    queuebuf_free(q);
+    errors += check_packetbuf();
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(packetbuf_attrs_benchmark_process, "Packetbuf attribute benchmark");
+AUTOSTART_PROCESSES(&packetbuf_attrs_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(packetbuf_attrs_benchmark_process, ev, data)
+{
+  static int i, j, errors;
+  const struct profile *p;
+
+  PROCESS_BEGIN();
+
+  queuebuf_init();
+  for(i = 0; i < sizeof(payload); i++) {
+    payload[i] = i;
+  }
+  sender.u8[0] = 1;
+  receiver.u8[0] = 2;
+
+  printf("packetbuf-attrs benchmark, %d attributes, %d addresses\n",
+         PACKETBUF_NUM_ATTRS, PACKETBUF_NUM_ADDRS);
+  if(PACKETBUF_SAVED_ATTRS) {
+    printf("compact saved attributes, room for %d\n", PACKETBUF_SAVED_ATTRS);
+  } else {
+    printf("full saved attributes\n");
+  }
+  printf("saved attributes: %u bytes per queued frame (%u for all)\n",
+         (unsigned)sizeof(struct packetbuf_saved_attrs),
+         (unsigned)(PACKETBUF_NUM_ATTRS * sizeof(struct packetbuf_attr) +
+                    PACKETBUF_NUM_ADDRS * sizeof(struct packetbuf_addr)));
+
+  errors = 0;
+  for(i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+    p = &profiles[i];
+    fill_packetbuf();
+    for(j = 0; j < p->num; j++) {
+      set_attr(p->types[j], j + 1);
+    }
+    if(PACKETBUF_SAVED_ATTRS && p->num > PACKETBUF_SAVED_ATTRS) {
+      printf("%-10s %2d attributes: do not fit\n", p->name, p->num);
+      continue;
+    }
+    printf("%-10s %2d attributes: save+restore %lu ns, queuebuf %lu ns\n",
+           p->name, p->num, save_restore_ns(), queuebuf_ns());
+    errors += check_packetbuf();
+  }
+
+  errors += check(20000);
+  printf("attribute check: %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
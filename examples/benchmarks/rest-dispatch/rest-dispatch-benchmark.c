@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         REST engine dispatch benchmark for the native platform.
+ *         Measures the cost of dispatching CoAP requests for a
+ *         growing number of resources, and checks the resource found
+ *         for each path against a search of the resource list. Build
+ *         with REST_URI_INDEX=<buckets> to measure the indexed
+ *         dispatch.
+ */
+
+#include "contiki.h"
+#include "rest-engine.h"
+#include "er-coap.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define ROUNDS 100000
+#define MAX_RESOURCES 256
+/* Resources per object, each object also gets a parent resource */
+#define OBJECT_RESOURCES 8
+#define PATH_LEN 32
+
+static resource_t resources[MAX_RESOURCES + MAX_RESOURCES / OBJECT_RESOURCES];
+static char paths[MAX_RESOURCES + MAX_RESOURCES / OBJECT_RESOURCES][PATH_LEN];
+static int activated;
+static unsigned long handled;
+/*---------------------------------------------------------------------------*/
+static void
+get_handler(void *request, void *response, uint8_t *buffer,
+            uint16_t preferred_size, int32_t *offset)
+{
+  handled++;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+nsecs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static void
+activate(int i, rest_resource_flags_t flags)
+{
+  int n = activated++;
+
+  if(flags & HAS_SUB_RESOURCES) {
+    snprintf(paths[n], PATH_LEN, "%d", 3300 + i);
+  } else {
+    snprintf(paths[n], PATH_LEN, "%d/0/%d", 3300 + i / OBJECT_RESOURCES,
+             5700 + i % OBJECT_RESOURCES);
+  }
+  resources[n].flags = flags;
+  resources[n].attributes = "";
+  resources[n].get_handler = get_handler;
+  rest_activate_resource(&resources[n], paths[n]);
+}
+/*---------------------------------------------------------------------------*/
+/* A request path: a resource, a sub-path of a parent, or a missing one */
+static void
+random_path(char *path, int resource_count)
+{
+  int i = random_rand() % resource_count;
+
+  switch(random_rand() % 3) {
+  case 0:
+    snprintf(path, PATH_LEN, "%d/0/%d", 3300 + i / OBJECT_RESOURCES,
+             5700 + i % OBJECT_RESOURCES);
+    break;
+  case 1:
+    snprintf(path, PATH_LEN, "%d/1/%d", 3300 + i / OBJECT_RESOURCES,
+             5700 + i % OBJECT_RESOURCES);
+    break;
+  default:
+    snprintf(path, PATH_LEN, "%d/0/%d", 9300 + i / OBJECT_RESOURCES,
+             5700 + i % OBJECT_RESOURCES);
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Search of the resource list, as done without the index */
+static resource_t *
+reference_find(const char *url, int url_len)
+{
+  resource_t *r;
+  int len;
+
+  for(r = list_head(rest_get_resources()); r != NULL; r = r->next) {
+    len = strlen(r->url);
+    if((url_len == len
+        || (url_len > len && (r->flags & HAS_SUB_RESOURCES)
+            && url[len] == '/'))
+       && strncmp(r->url, url, len) == 0) {
+      return r;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+#define REQUESTS 64
+static unsigned long
+dispatch_ns(int resource_count)
+{
+  static coap_packet_t requests[REQUESTS];
+  static char request_paths[REQUESTS][PATH_LEN];
+  coap_packet_t response[1];
+  uint8_t buffer[REST_MAX_CHUNK_SIZE];
+  int32_t offset = 0;
+  unsigned long start;
+  int i;
+
+  for(i = 0; i < REQUESTS; i++) {
+    random_path(request_paths[i], resource_count);
+    coap_init_message(&requests[i], COAP_TYPE_CON, COAP_GET, i);
+    coap_set_header_uri_path(&requests[i], request_paths[i]);
+  }
+
+  start = nsecs();
+  for(i = 0; i < ROUNDS; i++) {
+    coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, i);
+    rest_invoke_restful_service(&requests[i % REQUESTS], response, buffer,
+                                sizeof(buffer), &offset);
+  }
+  return (nsecs() - start) / ROUNDS;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check(int resource_count, int rounds)
+{
+  char path[PATH_LEN];
+  int i, errors;
+
+  errors = 0;
+  for(i = 0; i < rounds; i++) {
+    random_path(path, resource_count);
+    if(rest_find_resource(path, strlen(path)) !=
+       reference_find(path, strlen(path))) {
+      errors++;
+    }
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(rest_dispatch_benchmark_process, "REST dispatch benchmark");
+AUTOSTART_PROCESSES(&rest_dispatch_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(rest_dispatch_benchmark_process, ev, data)
+{
+  static const int targets[] = { 8, 16, 32, 64, 128, 256 };
+  static int i, count, errors;
+
+  PROCESS_BEGIN();
+
+  rest_init_engine();
+
+  printf("rest-dispatch benchmark, %s dispatch\n",
+         REST_URI_INDEX_SIZE ? "indexed" : "list");
+  errors = 0;
+  count = 0;
+  for(i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+    /* Children first, so that they are found before their parents */
+    while(count < targets[i]) {
+      activate(count++, NO_FLAGS);
+      if(count % OBJECT_RESOURCES == 0) {
+        activate(count / OBJECT_RESOURCES - 1, HAS_SUB_RESOURCES);
+      }
+    }
+    printf("%3d resources: %lu ns per request\n", activated,
+           dispatch_ns(count));
+    errors += check(count, 10000);
+  }
+
+  /* Activating resources again must leave lookups unchanged. */
+  for(i = 0; i < activated; i++) {
+    rest_activate_resource(&resources[i], paths[i]);
+  }
+  errors += check(count, 10000);
+  printf("dispatch check: %d errors (%lu requests handled)\n", errors,
+         handled);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         SLIP codec benchmark for the native platform. Measures the
+ *         throughput of slip_encode() and slip_decode() against the
+ *         byte at a time loops that tunslip6 and the native border
+ *         router used before, reading with fread() as they did, for frames with few and with many bytes
+ *         to escape.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "slip-codec.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define FRAME_LEN 1280
+#define FRAMES    64
+#define ROUNDS    200
+/* The size of the reads of the decoder */
+#define CHUNK     4096
+
+static uint8_t frames[FRAMES][FRAME_LEN];
+static uint8_t encoded[FRAMES * SLIP_ENCODED_MAX(FRAME_LEN)];
+static int encoded_len;
+static uint8_t out[SLIP_ENCODED_MAX(FRAME_LEN)];
+static uint8_t frame[FRAME_LEN];
+/*---------------------------------------------------------------------------*/
+/* The escaping loop of tunslip6, used as the reference. */
+static int
+ref_encode(uint8_t *o, const uint8_t *p, int len)
+{
+  int i, n;
+
+  n = 0;
+  for(i = 0; i < len; i++) {
+    switch(p[i]) {
+    case SLIP_END:
+      o[n++] = SLIP_ESC;
+      o[n++] = SLIP_ESC_END;
+      break;
+    case SLIP_ESC:
+      o[n++] = SLIP_ESC;
+      o[n++] = SLIP_ESC_ESC;
+      break;
+    default:
+      o[n++] = p[i];
+      break;
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* The decoding state machine of tunslip6, which read one byte at a
+   time with fread(), used as the reference. Returns the number of
+   frames. */
+static int
+ref_decode(const uint8_t *p, int len)
+{
+  int pos, count, esc;
+  uint8_t c;
+  FILE *f;
+
+  f = fmemopen((void *)p, len, "r");
+  pos = count = esc = 0;
+  while(fread(&c, 1, 1, f) == 1) {
+    if(esc) {
+      esc = 0;
+      if(c == SLIP_ESC_END) {
+        c = SLIP_END;
+      } else if(c == SLIP_ESC_ESC) {
+        c = SLIP_ESC;
+      }
+    } else if(c == SLIP_END) {
+      if(pos > 0) {
+        count++;
+        pos = 0;
+      }
+      continue;
+    } else if(c == SLIP_ESC) {
+      esc = 1;
+      continue;
+    }
+    if(pos >= sizeof(frame)) {
+      pos = 0;
+    }
+    frame[pos++] = c;
+  }
+  fclose(f);
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+static int
+codec_decode(const uint8_t *p, int len)
+{
+  static struct slip_decoder dec;
+  const uint8_t *end;
+  int count, n;
+
+  slip_decoder_init(&dec, frame, sizeof(frame), 0);
+  count = 0;
+  for(; len > 0; len -= n) {
+    n = len < CHUNK ? len : CHUNK;
+    end = p + n;
+    while(slip_decode(&dec, &p, end) != SLIP_DECODE_MORE) {
+      count++;
+    }
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+nsecs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+/* Fills the frames with random bytes, of which one in every escape_one
+   on average is SLIP_END or SLIP_ESC. */
+static void
+fill(int escape_one)
+{
+  int i, j;
+
+  for(i = 0; i < FRAMES; i++) {
+    for(j = 0; j < FRAME_LEN; j++) {
+      frames[i][j] = random_rand();
+      if(frames[i][j] == SLIP_END || frames[i][j] == SLIP_ESC) {
+        frames[i][j] = 0;
+      }
+      if(random_rand() % escape_one == 0) {
+        frames[i][j] = (random_rand() & 1) ? SLIP_END : SLIP_ESC;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the encoding speed in MB/s */
+static unsigned long
+encode_mbps(int codec)
+{
+  unsigned long start, bytes;
+  int i, r, n;
+
+  bytes = 0;
+  start = nsecs();
+  for(r = 0; r < ROUNDS; r++) {
+    for(i = 0; i < FRAMES; i++) {
+      if(codec) {
+        n = slip_encode(out, frames[i], FRAME_LEN, 0);
+      } else {
+        n = ref_encode(out, frames[i], FRAME_LEN);
+      }
+      out[n] = SLIP_END;
+      bytes += FRAME_LEN;
+    }
+  }
+  return bytes * 1000 / (nsecs() - start);
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the decoding speed in MB/s of the encoded bytes */
+static unsigned long
+decode_mbps(int codec, int *errors)
+{
+  unsigned long start;
+  int r, count;
+
+  start = nsecs();
+  for(r = 0; r < ROUNDS; r++) {
+    if(codec) {
+      count = codec_decode(encoded, encoded_len);
+    } else {
+      count = ref_decode(encoded, encoded_len);
+    }
+    if(count != FRAMES) {
+      (*errors)++;
+    }
+  }
+  return (unsigned long)encoded_len * ROUNDS * 1000 / (nsecs() - start);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(slip_codec_benchmark_process, "SLIP codec benchmark");
+AUTOSTART_PROCESSES(&slip_codec_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(slip_codec_benchmark_process, ev, data)
+{
+  static const int escape_one[] = { 1000000, 256, 16 };
+  int i, j, errors;
+
+  PROCESS_BEGIN();
+
+  printf("slip-codec benchmark, MB/s (byte loop / codec)\n");
+  for(i = 0; i < sizeof(escape_one) / sizeof(escape_one[0]); i++) {
+    fill(escape_one[i]);
+    encoded_len = 0;
+    errors = 0;
+    for(j = 0; j < FRAMES; j++) {
+      encoded_len += slip_encode(encoded + encoded_len, frames[j],
+                                 FRAME_LEN, 0);
+      encoded[encoded_len++] = SLIP_END;
+    }
+    printf("1 in %d escaped: encode %lu / %lu, ", escape_one[i],
+           encode_mbps(0), encode_mbps(1));
+    printf("decode %lu / %lu", decode_mbps(0, &errors),
+           decode_mbps(1, &errors));
+    printf("%s\n", errors ? ", frames lost" : "");
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Randomized test of the SLIP codec. Random frames are encoded,
+ *         joined and cut into random reads, and must be decoded back
+ *         unchanged; random bytes must never make the decoder write
+ *         outside its buffer or lose the frames that follow them.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "slip-codec.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_FRAME  300
+#define BUF_SIZE   256
+#define BATCH      32
+#define ROUNDS     20000
+
+static uint8_t frames[BATCH][MAX_FRAME];
+static uint16_t lens[BATCH];
+static uint8_t stream[BATCH * SLIP_ENCODED_MAX(MAX_FRAME) + 2 * MAX_FRAME];
+/* The decoder buffer, with guard bytes on both sides */
+static uint8_t buf[BUF_SIZE + 32];
+#define GUARD 0x5a
+/*---------------------------------------------------------------------------*/
+/* A random byte, often one that SLIP treats specially */
+static uint8_t
+random_byte(void)
+{
+  static const uint8_t special[] = {
+    SLIP_END, SLIP_ESC, SLIP_ESC_END, SLIP_ESC_ESC, SLIP_ESC_XON,
+    SLIP_ESC_XOFF, XON, XOFF, '\n'
+  };
+
+  if(random_rand() % 4 == 0) {
+    return special[random_rand() % sizeof(special)];
+  }
+  return random_rand();
+}
+/*---------------------------------------------------------------------------*/
+static int
+guards_intact(void)
+{
+  int i;
+
+  for(i = 0; i < 16; i++) {
+    if(buf[i] != GUARD || buf[16 + BUF_SIZE + i] != GUARD) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Encodes a batch of random frames, some of them too long or empty,
+   and optionally with random bytes before them. Decodes the stream in
+   random reads and returns the number of errors. */
+static int
+fuzz_round(int garbage)
+{
+  struct slip_decoder dec;
+  const uint8_t *p, *end, *garbage_end;
+  int i, j, len, n, flags, ret, expect, errors;
+
+  len = 0;
+  if(garbage) {
+    n = random_rand() % (2 * MAX_FRAME);
+    for(i = 0; i < n; i++) {
+      stream[len++] = random_byte();
+    }
+    /* Two, in case the random bytes end with a SLIP_ESC. */
+    stream[len++] = SLIP_END;
+    stream[len++] = SLIP_END;
+  }
+  garbage_end = stream + len;
+
+  flags = random_rand() & 1 ? SLIP_CODEC_XONXOFF : 0;
+  for(i = 0; i < BATCH; i++) {
+    lens[i] = random_rand() % 8 == 0 ? random_rand() % MAX_FRAME :
+      random_rand() % BUF_SIZE;
+    for(j = 0; j < lens[i]; j++) {
+      frames[i][j] = random_byte();
+    }
+    n = slip_encode(&stream[len], frames[i], lens[i], flags);
+    if(n > SLIP_ENCODED_MAX(lens[i]) - 1) {
+      return 1;
+    }
+    /* No bytes that would end the frame or stop the line. */
+    for(j = 0; j < n; j++) {
+      if(stream[len + j] == SLIP_END ||
+         ((flags & SLIP_CODEC_XONXOFF) &&
+          (stream[len + j] == XON || stream[len + j] == XOFF))) {
+        return 1;
+      }
+    }
+    len += n;
+    stream[len++] = SLIP_END;
+  }
+
+  memset(buf, GUARD, sizeof(buf));
+  slip_decoder_init(&dec, buf + 16, BUF_SIZE,
+                    random_rand() & 1 ? SLIP_CODEC_LINES : 0);
+
+  errors = 0;
+  expect = 0;
+  p = stream;
+  while(p < stream + len) {
+    n = random_rand() % 8 == 0 ? 1 : random_rand() % 600 + 1;
+    end = p + n < stream + len ? p + n : stream + len;
+    while((ret = slip_decode(&dec, &p, end)) != SLIP_DECODE_MORE) {
+      if(dec.len < 0 || dec.len > BUF_SIZE || !guards_intact()) {
+        return errors + 1;
+      }
+      if(p <= garbage_end || ret == SLIP_DECODE_LINE) {
+        /* Anything goes for the random bytes, and lines are only
+           parts of frames. */
+        continue;
+      }
+      /* Empty frames are not returned. */
+      while(expect < BATCH && lens[expect] == 0) {
+        expect++;
+      }
+      if(expect == BATCH) {
+        return errors + 1;
+      }
+      if(lens[expect] > BUF_SIZE) {
+        if(ret != SLIP_DECODE_OVERFLOW || dec.len != 0) {
+          errors++;
+        }
+      } else if(ret != SLIP_DECODE_FRAME || dec.len != lens[expect] ||
+                memcmp(dec.buf, frames[expect], dec.len) != 0) {
+        errors++;
+      }
+      expect++;
+    }
+  }
+  while(expect < BATCH && lens[expect] == 0) {
+    expect++;
+  }
+  return errors + (expect != BATCH);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(slip_codec_fuzz_process, "SLIP codec fuzz test");
+AUTOSTART_PROCESSES(&slip_codec_fuzz_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(slip_codec_fuzz_process, ev, data)
+{
+  int i, errors;
+
+  PROCESS_BEGIN();
+
+  errors = 0;
+  for(i = 0; i < ROUNDS; i++) {
+    errors += fuzz_round(i & 1);
+  }
+  printf("slip-codec fuzz test: %d rounds, %d errors\n", ROUNDS, errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
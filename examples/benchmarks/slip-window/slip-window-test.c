@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Loopback test of the windowed serial radio protocol for the
+ *         native platform. The RDC driver of the native-border-router
+ *         and the slip-radio run in the same program: the frames that
+ *         the border router writes are fed byte by byte to the SLIP
+ *         driver of the radio, and what the radio writes is decoded
+ *         and handled as border-router-cmds.c does. The radio driver
+ *         below the slip-radio holds the frames until the test
+ *         completes them. The test checks the ?W/!W exchange, that a
+ *         window of full-size !T frames sent back to back arrives
+ *         intact, that received frames arrive as !F, and that a frame
+ *         that times out keeps its credit until its late report or a
+ *         second timeout.
+ */
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "dev/slip.h"
+#include "packetutils.h"
+#include "border-router.h"
+#include "slip-radio.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SLIP_END     0300
+#define SLIP_ESC     0333
+#define SLIP_ESC_END 0334
+#define SLIP_ESC_ESC 0335
+
+/* The largest 802.15.4 frame. Its '!T' command, with the one
+   attribute that the border router sets, is '!T' <sid> <count>
+   <attribute> <frame> <CRC>, 136 bytes. */
+#define FULL_LEN 127
+#define FRAMES   10
+#define TIMEOUT  BORDER_ROUTER_RDC_CONF_TIMEOUT
+
+extern const struct rdc_driver border_router_rdc_driver;
+PROCESS_NAME(slip_radio_process);
+
+static int errors;
+
+#define CHECK(cond) do {                                        \
+    if(!(cond)) {                                               \
+      errors++;                                                 \
+      printf("line %d: check failed: %s\n", __LINE__, #cond);   \
+    }                                                           \
+  } while(0)
+
+/* Frames that the radio driver holds until the test completes them */
+struct radio_frame {
+  mac_callback_t sent;
+  void *ptr;
+  uint16_t len;
+  uint8_t data[PACKETBUF_SIZE];
+};
+static struct radio_frame radio_frames[FRAMES];
+static int radio_pending;
+
+/* The border router side: the MAC callbacks of the frames it sent,
+   and what it got from the radio */
+static uint8_t ids[FRAMES];
+static int tx_calls[FRAMES];
+static int tx_status[FRAMES];
+static int window;
+static int rx_frames;
+static uint8_t rx_frame[PACKETBUF_SIZE];
+static int rx_len;
+/* Set to lose the next frame on the serial line */
+static int drop_next;
+
+/* SLIP decoder of what the radio writes */
+static uint8_t radio_out[PACKETBUF_SIZE + 16];
+static int radio_out_len;
+static int radio_out_esc;
+/*---------------------------------------------------------------------------*/
+static void
+fill(uint8_t *buf, int id, int len)
+{
+  int i;
+
+  for(i = 0; i < len; i++) {
+    buf[i] = id * 31 + i;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_frame(const uint8_t *buf, int id, int len)
+{
+  int i;
+
+  for(i = 0; i < len; i++) {
+    if(buf[i] != (uint8_t)(id * 31 + i)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* The border router side, as in border-router-cmds.c */
+static void
+radio_output(const uint8_t *data, int len)
+{
+  if(data[0] != '!') {
+    return;
+  }
+  if(data[1] == 'W') {
+    window = data[2];
+    border_router_rdc_set_window(data[2]);
+  } else if(data[1] == 'A') {
+    if(packetutils_check_crc(data, len) != 5) {
+      border_router_window_stats.crc_errors++;
+      return;
+    }
+    border_router_rdc_report(data[2], data[3], data[4]);
+  } else if(data[1] == 'F') {
+    len = packetutils_check_crc(data, len);
+    if(len < 2) {
+      border_router_window_stats.crc_errors++;
+      return;
+    }
+    rx_len = len - 2;
+    memcpy(rx_frame, &data[2], rx_len);
+    rx_frames++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+write_to_slip(const uint8_t *buf, int len)
+{
+  int i;
+
+  if(drop_next) {
+    drop_next = 0;
+    return;
+  }
+  /* Written back to back, as the radio's UART would receive them */
+  slip_input_byte(SLIP_END);
+  for(i = 0; i < len; i++) {
+    if(buf[i] == SLIP_END) {
+      slip_input_byte(SLIP_ESC);
+      slip_input_byte(SLIP_ESC_END);
+    } else if(buf[i] == SLIP_ESC) {
+      slip_input_byte(SLIP_ESC);
+      slip_input_byte(SLIP_ESC_ESC);
+    } else {
+      slip_input_byte(buf[i]);
+    }
+  }
+  slip_input_byte(SLIP_END);
+}
+/*---------------------------------------------------------------------------*/
+void
+slip_set_batched(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+slip_arch_init(unsigned long ubr)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+slip_arch_writeb(unsigned char c)
+{
+  if(c == SLIP_END) {
+    if(radio_out_len > 0) {
+      radio_output(radio_out, radio_out_len);
+    }
+    radio_out_len = 0;
+    return;
+  }
+  if(c == SLIP_ESC) {
+    radio_out_esc = 1;
+    return;
+  }
+  if(radio_out_esc) {
+    c = c == SLIP_ESC_END ? SLIP_END : SLIP_ESC;
+    radio_out_esc = 0;
+  }
+  if(radio_out_len < sizeof(radio_out)) {
+    radio_out[radio_out_len++] = c;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+radio_send(mac_callback_t sent, void *ptr)
+{
+  struct radio_frame *f;
+
+  if(radio_pending == FRAMES) {
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 0);
+    return;
+  }
+  f = &radio_frames[radio_pending++];
+  f->sent = sent;
+  f->ptr = ptr;
+  f->len = packetbuf_datalen();
+  memcpy(f->data, packetbuf_dataptr(), f->len);
+}
+/*---------------------------------------------------------------------------*/
+static void
+radio_send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *list)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+radio_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+radio_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+radio_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+const struct rdc_driver slip_window_test_rdc_driver = {
+  "slip-window-test",
+  radio_init,
+  radio_send,
+  radio_send_list,
+  radio_input,
+  radio_on,
+  radio_off,
+  radio_channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+/* Completes the transmission of the i:th frame that the radio holds */
+static void
+radio_complete(int i, int status)
+{
+  struct radio_frame f;
+
+  f = radio_frames[i];
+  radio_pending--;
+  memmove(&radio_frames[i], &radio_frames[i + 1],
+          (radio_pending - i) * sizeof(radio_frames[0]));
+  mac_call_sent_callback(f.sent, f.ptr, status, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+tx_done(void *ptr, int status, int num_tx)
+{
+  int id;
+
+  id = *(uint8_t *)ptr;
+  tx_calls[id]++;
+  tx_status[id] = status;
+}
+/*---------------------------------------------------------------------------*/
+/* Sends frame id from the border router */
+static void
+br_send(int id, int len)
+{
+  packetbuf_clear();
+  fill(packetbuf_dataptr(), id, len);
+  packetbuf_set_datalen(len);
+  border_router_rdc_driver.send(tx_done, &ids[id]);
+}
+/*---------------------------------------------------------------------------*/
+/* Receives frame id at the radio */
+static void
+radio_receive(int id, int len)
+{
+  packetbuf_clear();
+  fill(packetbuf_dataptr(), id, len);
+  packetbuf_set_datalen(len);
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(slip_window_test_process, "Slip window test");
+AUTOSTART_PROCESSES(&slip_window_test_process, &slip_radio_process);
+/*---------------------------------------------------------------------------*/
+/* Let the SLIP process of the radio handle what it has received */
+#define SETTLE() do {                           \
+    for(settle = 0; settle < 10; settle++) {    \
+      PROCESS_PAUSE();                          \
+    }                                           \
+  } while(0)
+
+#define WAIT(t) do {                                    \
+    etimer_set(&et, (t));                               \
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));      \
+  } while(0)
+
+PROCESS_THREAD(slip_window_test_process, ev, data)
+{
+  static struct etimer et;
+  static int settle;
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < FRAMES; i++) {
+    ids[i] = i;
+  }
+  /* Let the slip-radio start its SLIP process */
+  WAIT(CLOCK_SECOND / 10);
+
+  printf("slip-window test, window %d, %d byte frames\n",
+         SLIP_RADIO_CONF_WINDOW, FULL_LEN);
+
+  write_to_slip((const uint8_t *)"?W", 2);
+  SETTLE();
+  CHECK(window == SLIP_RADIO_CONF_WINDOW && slip_radio_windowed());
+
+  /* A window of full-size frames, written back to back before the
+     radio handles any of them */
+  for(i = 0; i < SLIP_RADIO_CONF_WINDOW; i++) {
+    br_send(i, FULL_LEN);
+  }
+  SETTLE();
+  CHECK(radio_pending == SLIP_RADIO_CONF_WINDOW);
+  for(i = 0; i < radio_pending; i++) {
+    CHECK(radio_frames[i].len == FULL_LEN &&
+          check_frame(radio_frames[i].data, i, FULL_LEN));
+  }
+  while(radio_pending > 0) {
+    radio_complete(0, MAC_TX_OK);
+  }
+  for(i = 0; i < SLIP_RADIO_CONF_WINDOW; i++) {
+    CHECK(tx_calls[i] == 1 && tx_status[i] == MAC_TX_OK);
+  }
+  printf("window: %d frames sent back to back\n", SLIP_RADIO_CONF_WINDOW);
+
+  /* Received frames */
+  for(i = 0; i < 3; i++) {
+    radio_receive(i, 20 + 40 * i);
+    CHECK(rx_frames == i + 1 && rx_len == 20 + 40 * i &&
+          check_frame(rx_frame, i, rx_len));
+  }
+  printf("received: %d frames\n", rx_frames);
+
+  /* The radio holds frame 2 past the timeout of the border router */
+  br_send(2, 40);
+  SETTLE();
+  CHECK(radio_pending == 1);
+  WAIT(TIMEOUT * 3 / 2);
+  CHECK(tx_calls[2] == 1 && tx_status[2] == MAC_TX_ERR);
+  /* Frame 2 still takes a credit, so only frame 3 is sent */
+  br_send(3, 40);
+  br_send(4, 40);
+  SETTLE();
+  CHECK(radio_pending == 2 && tx_calls[4] == 0);
+  /* The late report of frame 2 returns its credit */
+  radio_complete(0, MAC_TX_OK);
+  SETTLE();
+  CHECK(radio_pending == 2 && tx_calls[2] == 1);
+  CHECK(check_frame(radio_frames[1].data, 4, 40));
+  while(radio_pending > 0) {
+    radio_complete(0, MAC_TX_OK);
+  }
+  CHECK(tx_calls[3] == 1 && tx_status[3] == MAC_TX_OK);
+  CHECK(tx_calls[4] == 1 && tx_status[4] == MAC_TX_OK);
+  printf("timeout: late report returned the credit\n");
+
+  /* Frame 5 is lost on the serial line */
+  drop_next = 1;
+  br_send(5, 40);
+  WAIT(TIMEOUT * 3 / 2);
+  CHECK(tx_calls[5] == 1 && tx_status[5] == MAC_TX_ERR);
+  br_send(6, 40);
+  br_send(7, 40);
+  SETTLE();
+  CHECK(radio_pending == 1 && tx_calls[7] == 0);
+  radio_complete(0, MAC_TX_OK);
+  SETTLE();
+  CHECK(radio_pending == 1 && check_frame(radio_frames[0].data, 7, 40));
+  radio_complete(0, MAC_TX_OK);
+  /* A second timeout gives up on the report of frame 5, and a whole
+     window can be sent again. */
+  WAIT(TIMEOUT * 3 / 2);
+  br_send(8, 40);
+  br_send(9, 40);
+  SETTLE();
+  CHECK(radio_pending == 2 && check_frame(radio_frames[1].data, 9, 40));
+  while(radio_pending > 0) {
+    radio_complete(0, MAC_TX_OK);
+  }
+  CHECK(tx_calls[5] == 1);
+  for(i = 6; i < 10; i++) {
+    CHECK(tx_calls[i] == 1 && tx_status[i] == MAC_TX_OK);
+  }
+  printf("lost frame: credit returned after a second timeout\n");
+
+  CHECK(border_router_window_stats.timeouts == 2 &&
+        border_router_window_stats.stale == 1 &&
+        border_router_window_stats.crc_errors == 0);
+  printf("slip-window test: %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
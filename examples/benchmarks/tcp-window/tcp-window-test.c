@@ -0,0 +1,449 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Test of the uIPv6 TCP sliding window mode for the native
+ *         platform. A tcp-socket server sends to a peer that is
+ *         simulated by building segments in uip_buf and feeding them
+ *         to uip_input(). The test checks that the window fills, that
+ *         lost segments are resent after duplicate ACKs and after
+ *         timeouts, that old and bogus ACKs are ignored, that a
+ *         transfer over a lossy link arrives intact, and that closing
+ *         the socket with data in flight sends the FIN after the data.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/tcp-socket.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-tcp-window.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_PSH 0x08
+#define TCP_ACK 0x10
+
+#define PORT      80
+#define PEER_PORT 4000
+#define PEER_WND  1000
+#define STREAM_LEN 20000
+#define LOSS_PERCENT 10
+
+#if UIP_TCP_WINDOW_SEGMENTS < 2
+#error The test needs UIP_CONF_TCP_WINDOW_SEGMENTS of at least 2
+#endif
+
+#define IP_BUF  ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define TCP_BUF ((struct uip_tcpip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+static struct tcp_socket sock;
+static uint8_t inbuf[400];
+static uint8_t outbuf[3000];
+static uint8_t stream[STREAM_LEN];
+static uip_ipaddr_t local_addr, peer_addr;
+static struct uip_conn *conn;
+
+/* The initial sequence number of the server, and of the peer */
+static uint32_t iss;
+static uint32_t peer_seq;
+
+/* The number of stream bytes given to the socket */
+static uint32_t queued;
+
+/* The peer's view: the stream bytes it has received, the next one it
+   expects, and whether it drops the data segments it receives */
+static uint8_t received[STREAM_LEN];
+static uint32_t rcv_next;
+static uint8_t lossy;
+static int acks_due;
+static unsigned long segments, dropped, out_of_order;
+
+/* The last segment sent by the server, len -1 if none */
+static int out_len;
+static uint32_t out_seq;
+static uint8_t out_flags;
+
+static int errors;
+
+#define CHECK(cond) do {                                        \
+    if(!(cond)) {                                               \
+      errors++;                                                 \
+      printf("line %d: check failed: %s\n", __LINE__, #cond);   \
+    }                                                           \
+  } while(0)
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+    ((uint32_t)p[2] << 8) | p[3];
+}
+/*---------------------------------------------------------------------------*/
+static void
+put32(uint8_t *p, uint32_t v)
+{
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+/*---------------------------------------------------------------------------*/
+/* The sequence number of a stream offset */
+static uint32_t
+seq(uint32_t offset)
+{
+  return iss + 1 + offset;
+}
+/*---------------------------------------------------------------------------*/
+/* The sequence number of the first byte the server has not yet sent */
+static uint32_t
+snd_end(void)
+{
+  return get32(conn->snd_nxt) + conn->len;
+}
+/*---------------------------------------------------------------------------*/
+/* Take the segment that the server left in uip_buf, if any */
+static void
+capture(void)
+{
+  uint32_t offset;
+
+  if(uip_len == 0) {
+    out_len = -1;
+    return;
+  }
+  out_seq = get32(TCP_BUF->seqno);
+  out_flags = TCP_BUF->flags;
+  out_len = uip_len - UIP_IPH_LEN - ((TCP_BUF->tcpoffset >> 4) << 2);
+  uip_len = 0;
+  if(out_len == 0 || (out_flags & TCP_SYN)) {
+    return;
+  }
+
+  segments++;
+  if(lossy && random_rand() % 100 < LOSS_PERCENT) {
+    dropped++;
+    return;
+  }
+  offset = out_seq - seq(0);
+  if(offset >= STREAM_LEN) {
+    return;
+  }
+  /* Like most hosts, the peer keeps segments that arrive after a
+     hole, and acknowledges every segment. */
+  acks_due++;
+  if(offset > rcv_next) {
+    out_of_order++;
+  }
+  CHECK(offset + out_len <= STREAM_LEN &&
+        memcmp(&uip_buf[UIP_LLH_LEN + UIP_IPTCPH_LEN], &stream[offset],
+               out_len) == 0);
+  if(offset + out_len <= STREAM_LEN) {
+    memset(&received[offset], 1, out_len);
+  }
+  while(rcv_next < STREAM_LEN && received[rcv_next]) {
+    rcv_next++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Send a segment from the peer, and take the server's answer */
+static void
+peer_send(uint8_t flags, uint32_t ack, int len)
+{
+  int hdr_len;
+
+  hdr_len = UIP_TCPH_LEN + ((flags & TCP_SYN) ? 4 : 0);
+  memset(uip_buf, 0, UIP_LLH_LEN + UIP_IPH_LEN + hdr_len);
+  IP_BUF->vtc = 0x60;
+  IP_BUF->proto = UIP_PROTO_TCP;
+  IP_BUF->ttl = 64;
+  IP_BUF->len[0] = (hdr_len + len) >> 8;
+  IP_BUF->len[1] = (hdr_len + len) & 0xff;
+  uip_ipaddr_copy(&IP_BUF->srcipaddr, &peer_addr);
+  uip_ipaddr_copy(&IP_BUF->destipaddr, &local_addr);
+  TCP_BUF->srcport = UIP_HTONS(PEER_PORT);
+  TCP_BUF->destport = UIP_HTONS(PORT);
+  put32(TCP_BUF->seqno, peer_seq);
+  put32(TCP_BUF->ackno, ack);
+  TCP_BUF->tcpoffset = (hdr_len / 4) << 4;
+  if(flags & TCP_SYN) {
+    /* MSS option */
+    TCP_BUF->optdata[0] = 2;
+    TCP_BUF->optdata[1] = 4;
+    TCP_BUF->optdata[2] = UIP_TCP_MSS >> 8;
+    TCP_BUF->optdata[3] = UIP_TCP_MSS & 0xff;
+  }
+  TCP_BUF->flags = flags;
+  TCP_BUF->wnd[0] = PEER_WND >> 8;
+  TCP_BUF->wnd[1] = PEER_WND & 0xff;
+  memset(&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + hdr_len], 'x', len);
+  uip_len = UIP_IPH_LEN + hdr_len + len;
+  uip_ext_len = 0;
+  TCP_BUF->tcpchksum = 0;
+  TCP_BUF->tcpchksum = ~uip_tcpchksum();
+
+  uip_input();
+
+  peer_seq += len + ((flags & (TCP_SYN | TCP_FIN)) ? 1 : 0);
+  capture();
+}
+/*---------------------------------------------------------------------------*/
+/* Poll the server, as tcpip.c does when the socket has new data, and
+   let it fill its window; returns the number of data segments sent */
+static int
+fill_window(void)
+{
+  int n;
+
+  n = 0;
+  do {
+    uip_poll_conn(conn);
+    capture();
+    if(out_len <= 0) {
+      break;
+    }
+    n++;
+  } while(uip_tcp_window_wants_poll(conn));
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* Run the periodic timer until the server sends data; returns the
+   number of timer pulses */
+static int
+wait_rexmit(void)
+{
+  int pulses;
+
+  for(pulses = 1; pulses <= 100; pulses++) {
+    uip_periodic_conn(conn);
+    capture();
+    if(out_len > 0) {
+      return pulses;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+input(struct tcp_socket *s, void *ptr, const uint8_t *data, int len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+event(struct tcp_socket *s, void *ptr, tcp_socket_event_t ev)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_window(void)
+{
+  uint32_t una;
+  int i;
+
+  /* The handshake, after which the server sends its first segment */
+  peer_seq = 1000;
+  peer_send(TCP_SYN, 0, 0);
+  CHECK(out_len == 0 && (out_flags & (TCP_SYN | TCP_ACK)) == (TCP_SYN | TCP_ACK));
+  iss = out_seq;
+  for(i = 0; i < UIP_CONNS; i++) {
+    if(uip_conns[i].tcpstateflags != UIP_CLOSED &&
+       uip_conns[i].lport == UIP_HTONS(PORT)) {
+      conn = &uip_conns[i];
+    }
+  }
+  CHECK(conn != NULL);
+  peer_send(TCP_ACK, seq(0), 0);
+  CHECK(out_len == UIP_TCP_MSS && out_seq == seq(0));
+
+  /* Segments are sent back to back up to the congestion window */
+  fill_window();
+  CHECK(conn->nseg == conn->cwnd && conn->len == conn->nseg * UIP_TCP_MSS);
+  peer_send(TCP_ACK, seq(UIP_TCP_MSS), 0);
+  fill_window();
+  CHECK(conn->nseg == conn->cwnd && conn->len == conn->nseg * UIP_TCP_MSS);
+  printf("window: %d segments in flight\n", conn->nseg);
+  una = get32(conn->snd_nxt);
+
+  /* The oldest segment is lost: three duplicate ACKs resend it */
+  peer_send(TCP_ACK, una, 0);
+  CHECK(out_len == -1);
+  peer_send(TCP_ACK, una, 0);
+  CHECK(out_len == -1);
+  peer_send(TCP_ACK, una, 0);
+  CHECK(out_len == UIP_TCP_MSS && out_seq == una);
+  CHECK(conn->cwnd == 1);
+
+  /* Data from the peer is acknowledged after the data in flight */
+  peer_send(TCP_ACK | TCP_PSH, una, 10);
+  CHECK(out_len == 0 && out_seq == snd_end());
+  CHECK(get32(TCP_BUF->ackno) == peer_seq);
+
+  /* Part of a segment is acknowledged */
+  i = conn->len;
+  peer_send(TCP_ACK, una + 150, 0);
+  /* The window has moved, so the server may send a new segment */
+  CHECK(get32(conn->snd_nxt) == una + 150 &&
+        conn->len == i - 150 + (out_len > 0 ? out_len : 0));
+
+  /* An ACK overtaken by a later one, and one for data never sent, are
+     ignored */
+  i = conn->len;
+  peer_send(TCP_ACK, una + 100, 0);
+  CHECK(out_len == -1 && conn->len == i);
+  peer_send(TCP_ACK, snd_end() + 1, 0);
+  CHECK(conn->len == i && get32(conn->snd_nxt) == una + 150);
+  printf("window: duplicate and out of order ACKs done\n");
+
+  /* The peer has received everything up to una + 150 */
+  rcv_next = una + 150 - seq(0);
+  memset(received, 1, rcv_next);
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_lossy(void)
+{
+  uint32_t last;
+  unsigned long rexmit;
+  int rounds, stalls;
+
+  lossy = 1;
+  segments = 0;
+  rexmit = uip_stat.tcp.rexmit;
+  last = rcv_next;
+  stalls = 0;
+  for(rounds = 0; rcv_next < STREAM_LEN && rounds < 20000; rounds++) {
+    if(queued < STREAM_LEN) {
+      queued += tcp_socket_send(&sock, &stream[queued], STREAM_LEN - queued);
+    }
+    fill_window();
+    while(acks_due > 0) {
+      /* Segments after a hole give duplicate ACKs. */
+      acks_due--;
+      peer_send(TCP_ACK, seq(rcv_next), 0);
+      fill_window();
+    }
+    if(rcv_next == last) {
+      /* Nothing new arrived: wait for a retransmission */
+      stalls++;
+      if(wait_rexmit() < 0 || conn->tcpstateflags != UIP_ESTABLISHED) {
+        break;
+      }
+    }
+    last = rcv_next;
+  }
+  lossy = 0;
+
+  CHECK(rcv_next == STREAM_LEN);
+  CHECK(conn->tcpstateflags == UIP_ESTABLISHED);
+  printf("lossy: %u bytes, %lu of %lu segments dropped, %lu out of order, "
+         "%lu retransmissions, %d timeouts\n",
+         (unsigned)rcv_next, dropped, segments, out_of_order,
+         uip_stat.tcp.rexmit - rexmit, stalls);
+
+  /* Acknowledge the rest, so that nothing is in flight */
+  acks_due = 0;
+  peer_send(TCP_ACK, seq(rcv_next), 0);
+  CHECK(conn->len == 0 && conn->nseg == 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_close(void)
+{
+  uint32_t data_seq;
+
+  /* Close with a segment in flight: the FIN waits for its ACK */
+  CHECK(tcp_socket_send(&sock, stream, UIP_TCP_MSS) == UIP_TCP_MSS);
+  CHECK(fill_window() == 1 && conn->len == UIP_TCP_MSS);
+  data_seq = get32(conn->snd_nxt);
+  tcp_socket_close(&sock);
+  uip_poll_conn(conn);
+  capture();
+  CHECK(!(out_flags & TCP_FIN));
+  CHECK(conn->tcpstateflags == UIP_ESTABLISHED &&
+        uip_tcp_window_closing(conn));
+
+  /* The segment is lost, and resent after a timeout */
+  CHECK(wait_rexmit() > 0 && out_seq == data_seq && out_len == UIP_TCP_MSS);
+  CHECK(!(out_flags & TCP_FIN));
+
+  /* Its ACK releases the FIN */
+  peer_send(TCP_ACK, data_seq + UIP_TCP_MSS, 0);
+  CHECK((out_flags & TCP_FIN) && out_seq == data_seq + UIP_TCP_MSS);
+  CHECK(conn->tcpstateflags == UIP_FIN_WAIT_1);
+  peer_send(TCP_ACK | TCP_FIN, data_seq + UIP_TCP_MSS + 1, 0);
+  CHECK(conn->tcpstateflags == UIP_TIME_WAIT);
+  printf("close: FIN sent after the data in flight\n");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(tcp_window_test_process, "TCP window test");
+AUTOSTART_PROCESSES(&tcp_window_test_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tcp_window_test_process, ev, data)
+{
+  static struct etimer et;
+  int i;
+
+  PROCESS_BEGIN();
+
+  /* Let tcpip_process start */
+  etimer_set(&et, CLOCK_SECOND / 4);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  printf("tcp-window test, %d segment window\n", UIP_TCP_WINDOW_SEGMENTS);
+
+  uip_ip6addr(&local_addr, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
+  uip_ip6addr(&peer_addr, 0xaaaa, 0, 0, 0, 0, 0, 0, 2);
+  uip_ds6_addr_add(&local_addr, 0, ADDR_MANUAL);
+  for(i = 0; i < STREAM_LEN; i++) {
+    stream[i] = i * 7 + (i >> 8);
+  }
+
+  tcp_socket_register(&sock, NULL, inbuf, sizeof(inbuf),
+                      outbuf, sizeof(outbuf), input, event);
+  tcp_socket_listen(&sock, PORT);
+  queued = tcp_socket_send(&sock, stream, 2000);
+
+  test_window();
+  test_lossy();
+  test_close();
+
+  printf("tcp-window test: %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         TSCH schedule benchmark for the native platform.
+ *         Measures the cost of tsch_schedule_get_next_active_link()
+ *         for a growing number of links, and checks its result
+ *         against an exhaustive search over all links while links
+ *         are added and removed. Build with TSCH_SCHEDULE_LINK_INDEX=1
+ *         to measure the indexed lookup.
+ */
+
+#include "contiki.h"
+#include "net/mac/tsch/tsch.h"
+#include "net/mac/tsch/tsch-schedule.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define ROUNDS 200000
+#define NEIGHBORS 8
+/* A slotframe for EBs, one for broadcast, and a large unicast one */
+#define EB_SIZE 7
+#define BROADCAST_SIZE 13
+#define UNICAST_SIZE 1009
+
+static struct tsch_slotframe *sf_eb, *sf_broadcast, *sf_unicast;
+static linkaddr_t neighbors[NEIGHBORS];
+
+/* Stand-ins for the parts of TSCH used by the schedule. */
+const linkaddr_t tsch_broadcast_address = { { 0xff, 0xff, 0xff, 0xff,
+                                              0xff, 0xff, 0xff, 0xff } };
+struct tsch_link *current_link;
+/*---------------------------------------------------------------------------*/
+int
+tsch_is_locked(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_get_lock(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_release_lock(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+struct tsch_neighbor *
+tsch_queue_add_nbr(const linkaddr_t *addr)
+{
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+nsecs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_random_link(struct tsch_slotframe *sf)
+{
+  static const uint8_t options[] = {
+    LINK_OPTION_TX, LINK_OPTION_RX, LINK_OPTION_TX | LINK_OPTION_RX,
+    LINK_OPTION_TX | LINK_OPTION_RX | LINK_OPTION_SHARED
+  };
+  uint8_t o = options[random_rand() % 4];
+
+  tsch_schedule_add_link(sf, o, LINK_TYPE_NORMAL,
+                         (o & LINK_OPTION_TX) ? &neighbors[random_rand() % NEIGHBORS] : NULL,
+                         random_rand() % sf->size.val, 0);
+}
+/*---------------------------------------------------------------------------*/
+/* Exhaustive search over all links, as done without the index */
+static struct tsch_link *
+reference_next_link(struct asn_t *asn, uint16_t *time_offset,
+                    struct tsch_link **backup_link)
+{
+  uint16_t time_to_curr_best = 0;
+  struct tsch_link *curr_best = NULL;
+  struct tsch_link *curr_backup = NULL;
+  struct tsch_slotframe *sf;
+  struct tsch_link *l;
+
+  for(sf = tsch_schedule_get_slotframe_by_handle(0); sf != NULL;
+      sf = list_item_next(sf)) {
+    uint16_t timeslot = ASN_MOD(*asn, sf->size);
+    for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+      uint16_t time_to_timeslot =
+        l->timeslot > timeslot ?
+        l->timeslot - timeslot :
+        sf->size.val + l->timeslot - timeslot;
+      if(curr_best == NULL || time_to_timeslot < time_to_curr_best) {
+        time_to_curr_best = time_to_timeslot;
+        curr_best = l;
+        curr_backup = NULL;
+      } else if(time_to_timeslot == time_to_curr_best) {
+        struct tsch_link *new_best = NULL;
+        if((curr_best->link_options & LINK_OPTION_TX) == (l->link_options & LINK_OPTION_TX)) {
+          if(l->slotframe_handle < curr_best->slotframe_handle) {
+            new_best = l;
+          }
+        } else if(l->link_options & LINK_OPTION_TX) {
+          new_best = l;
+        }
+        if(curr_backup == NULL) {
+          if(new_best != l && (l->link_options & LINK_OPTION_RX)) {
+            curr_backup = l;
+          }
+          if(new_best != curr_best && (curr_best->link_options & LINK_OPTION_RX)) {
+            curr_backup = curr_best;
+          }
+        }
+        if(new_best != NULL) {
+          curr_best = new_best;
+        }
+      }
+    }
+  }
+  *time_offset = time_to_curr_best;
+  *backup_link = curr_backup;
+  return curr_best;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+lookup_ns(void)
+{
+  struct asn_t asn;
+  struct tsch_link *backup;
+  uint16_t offset;
+  unsigned long start, sum;
+  int i;
+
+  ASN_INIT(asn, 0, 0);
+  sum = 0;
+  start = nsecs();
+  for(i = 0; i < ROUNDS; i++) {
+    tsch_schedule_get_next_active_link(&asn, &offset, &backup);
+    sum += offset;
+    ASN_INC(asn, 1);
+  }
+  /* Keep the loop from being optimized away. */
+  if(sum == 1) {
+    printf(" ");
+  }
+  return (nsecs() - start) / ROUNDS;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check(int rounds)
+{
+  struct asn_t asn;
+  struct tsch_link *link, *backup, *ref_link, *ref_backup;
+  uint16_t offset, ref_offset;
+  int i, errors;
+
+  errors = 0;
+  for(i = 0; i < rounds; i++) {
+    ASN_INIT(asn, 0, random_rand() * 65536UL + random_rand());
+    link = tsch_schedule_get_next_active_link(&asn, &offset, &backup);
+    ref_link = reference_next_link(&asn, &ref_offset, &ref_backup);
+    if(link != ref_link || backup != ref_backup || offset != ref_offset) {
+      errors++;
+    }
+    if(tsch_schedule_get_link_by_timeslot(sf_unicast, i % UNICAST_SIZE) !=
+       NULL &&
+       tsch_schedule_get_link_by_timeslot(sf_unicast,
+                                          i % UNICAST_SIZE)->timeslot !=
+       i % UNICAST_SIZE) {
+      errors++;
+    }
+  }
+  return errors;
+}
+/*---------------------------------------------------------------------------*/
+static int
+count_links(struct tsch_slotframe *sf)
+{
+  return list_length(sf->links_list);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(tsch_schedule_benchmark_process, "TSCH schedule benchmark");
+AUTOSTART_PROCESSES(&tsch_schedule_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tsch_schedule_benchmark_process, ev, data)
+{
+  static const int targets[] = { 8, 32, 128, 256, 500 };
+  static int i, j, n, errors;
+  struct tsch_link *l;
+
+  PROCESS_BEGIN();
+
+  tsch_schedule_init();
+  for(i = 0; i < NEIGHBORS; i++) {
+    neighbors[i].u8[0] = i + 1;
+  }
+
+  sf_eb = tsch_schedule_add_slotframe(0, EB_SIZE);
+  sf_broadcast = tsch_schedule_add_slotframe(1, BROADCAST_SIZE);
+  sf_unicast = tsch_schedule_add_slotframe(2, UNICAST_SIZE);
+  for(i = 0; i < 3; i++) {
+    add_random_link(sf_eb);
+    add_random_link(sf_broadcast);
+  }
+
+  printf("tsch-schedule benchmark, %s lookup\n",
+         TSCH_SCHEDULE_LINK_INDEX ? "indexed" : "linear");
+  errors = 0;
+  for(i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+    while(count_links(sf_eb) + count_links(sf_broadcast) +
+          count_links(sf_unicast) < targets[i]) {
+      add_random_link(sf_unicast);
+    }
+    printf("%3d links: %lu ns per lookup\n", targets[i], lookup_ns());
+    errors += check(2000);
+  }
+
+  /* Replace links at random and check the lookups again. */
+  n = count_links(sf_unicast);
+  for(i = 0; i < 2000; i++) {
+    j = random_rand() % n;
+    for(l = list_head(sf_unicast->links_list); j > 0; j--) {
+      l = list_item_next(l);
+    }
+    tsch_schedule_remove_link(sf_unicast, l);
+    /* Adding a link replaces any link in the same timeslot */
+    while(count_links(sf_unicast) < n) {
+      add_random_link(sf_unicast);
+    }
+    if(random_rand() % 8 == 0) {
+      add_random_link(sf_broadcast);
+    }
+    if(i % 100 == 0) {
+      errors += check(200);
+    }
+  }
+  printf("lookup check: %d errors\n", errors);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -42,6 +42,7 @@
 #include "dev/serial-line.h"
 #include "net/rpl/rpl.h"
 #include "net/ip/uiplib.h"
+#include "packetutils.h"
 #include <string.h>
 
 #define DEBUG DEBUG_NONE
@@ -53,6 +54,24 @@ uint8_t command_context;
 void packet_sent(uint8_t sessionid, uint8_t status, uint8_t tx);
 void nbr_print_stat(void);
 
+/*---------------------------------------------------------------------------*/
+static void
+print_latency(const char *name, const struct border_router_latency *latency)
+{
+  int i;
+
+  printf("%s latency (ticks):", name);
+  for(i = 0; i < BORDER_ROUTER_LATENCY_BUCKETS; i++) {
+    if(i == 0) {
+      printf(" 0:%lu", latency->count[i]);
+    } else if(i < BORDER_ROUTER_LATENCY_BUCKETS - 1) {
+      printf(" <%u:%lu", 1 << i, latency->count[i]);
+    } else {
+      printf(" >=%u:%lu", 1 << (i - 1), latency->count[i]);
+    }
+  }
+  printf(" max:%lu\n", (unsigned long)latency->max);
+}
 /*---------------------------------------------------------------------------*/
 PROCESS(border_router_cmd_process, "Border router cmd process");
 /*---------------------------------------------------------------------------*/
@@ -85,6 +104,29 @@ border_router_cmd_handler(const uint8_t *data, int len)
 	     data[2], data[3], data[4]);
       packet_sent(data[2], data[3], data[4]);
       return 1;
+    } else if(data[1] == 'A' && command_context == CMD_CONTEXT_RADIO) {
+      /* Report of the windowed protocol, '!A' <sid> <status> <tx> <CRC> */
+      if(packetutils_check_crc(data, len) != 5) {
+        border_router_window_stats.crc_errors++;
+        return 1;
+      }
+      PRINTF("Window report for sid:%d st:%d tx:%d\n",
+	     data[2], data[3], data[4]);
+      border_router_rdc_report(data[2], data[3], data[4]);
+      return 1;
+    } else if(data[1] == 'W' && command_context == CMD_CONTEXT_RADIO) {
+      PRINTF("Radio window is %d\n", data[2]);
+      border_router_rdc_set_window(data[2]);
+      return 1;
+    } else if(data[1] == 'F' && command_context == CMD_CONTEXT_RADIO) {
+      /* Received frame, '!F' <frame> <CRC> */
+      len = packetutils_check_crc(data, len);
+      if(len < 2) {
+        border_router_window_stats.crc_errors++;
+        return 1;
+      }
+      slip_packet_input((unsigned char *)&data[2], len - 2);
+      return 1;
     } else if(data[1] == 'D' && command_context == CMD_CONTEXT_RADIO) {
       /* We need to know that this is from the slip-radio here... */
       PRINTF("Sensor data received\n");
@@ -113,6 +155,15 @@ border_router_cmd_handler(const uint8_t *data, int len)
     } else if(data[1] == 'S') {
       border_router_print_stat();
       return 1;
+    } else if(data[1] == 'L') {
+      print_latency("TX", &border_router_tx_latency);
+      print_latency("RX", &border_router_rx_latency);
+      printf("timeouts:%lu stale:%lu full:%lu crc errors:%lu\n",
+             border_router_window_stats.timeouts,
+             border_router_window_stats.stale,
+             border_router_window_stats.full,
+             border_router_window_stats.crc_errors);
+      return 1;
     }
   }
   return 0;
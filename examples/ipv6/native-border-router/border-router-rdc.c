@@ -40,6 +40,7 @@
 #include "net/packetbuf.h"
 #include "net/queuebuf.h"
 #include "net/netstack.h"
+#include "sys/ctimer.h"
 #include "packetutils.h"
 #include "border-router.h"
 #include <string.h>
@@ -52,27 +53,101 @@
 #define PRINTF(...)
 #endif
 
+/* The largest number of frames to have outstanding at the slip-radio.
+   The radio tells how many frames it can take, see README.md; radios
+   that do not know the windowed protocol get one frame at a time. */
+#ifdef BORDER_ROUTER_RDC_CONF_WINDOW
+#define BORDER_ROUTER_RDC_WINDOW BORDER_ROUTER_RDC_CONF_WINDOW
+#else
+#define BORDER_ROUTER_RDC_WINDOW 8
+#endif
+
+/* Time after which an outstanding frame is given up */
+#ifdef BORDER_ROUTER_RDC_CONF_TIMEOUT
+#define BORDER_ROUTER_RDC_TIMEOUT BORDER_ROUTER_RDC_CONF_TIMEOUT
+#else
+#define BORDER_ROUTER_RDC_TIMEOUT (2 * CLOCK_SECOND)
+#endif
+
 #define MAX_CALLBACKS 16
 static int callback_pos;
 
+/* 3 bytes per packet attribute is required for serialization */
+#define FRAME_SIZE (PACKETBUF_NUM_ATTRS * 3 + PACKETBUF_SIZE + 3)
+
+/* Values of tx_callback.state */
+#define SLOT_FREE     0
+#define SLOT_QUEUED   1
+#define SLOT_IN_FLIGHT 2
+/* Reported as failed, but the radio may still hold the frame, so the
+   slot keeps its credit until the report or a second timeout. */
+#define SLOT_TIMED_OUT 3
+
 /* a structure for calling back when packet data is coming back
    from radio... */
 struct tx_callback {
   mac_callback_t cback;
   void *ptr;
-  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
-  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  struct packetbuf_saved_attrs attrs;
+#if BORDER_ROUTER_RDC_WINDOW
+  clock_time_t sent;
+  uint8_t state;
+  /* Bumped when the slot is freed. The session id carries the slot
+     index in its low and the generation in its high four bits, so a
+     late report for an earlier frame in the same slot is ignored. */
+  uint8_t gen;
+  uint16_t len;
+  uint8_t buf[FRAME_SIZE + 2];
+#endif /* BORDER_ROUTER_RDC_WINDOW */
 };
 
 static struct tx_callback callbacks[MAX_CALLBACKS];
+
+struct border_router_latency border_router_tx_latency;
+struct border_router_latency border_router_rx_latency;
+struct border_router_window_stats border_router_window_stats;
+
+#if BORDER_ROUTER_RDC_WINDOW
+#if MAX_CALLBACKS > 16
+#error The session id has room for 16 slots only
+#endif
+/* The window given by the radio, zero until it has answered '?W' */
+static uint8_t window;
+static uint8_t in_flight;
+/* Queued slots, in the order they are to be sent */
+static uint8_t queue[MAX_CALLBACKS];
+static uint8_t queue_first, queue_len;
+static struct ctimer timeout_timer;
+
+static void check_timeouts(void *ptr);
+#endif /* BORDER_ROUTER_RDC_WINDOW */
+/*---------------------------------------------------------------------------*/
+void
+border_router_latency_add(struct border_router_latency *latency,
+                          clock_time_t time)
+{
+  int i;
+
+  for(i = 0; i < BORDER_ROUTER_LATENCY_BUCKETS - 1 && (time >> i) > 0; i++);
+  latency->count[i]++;
+  if(time > latency->max) {
+    latency->max = time;
+  }
+}
 /*---------------------------------------------------------------------------*/
 void packet_sent(uint8_t sessionid, uint8_t status, uint8_t tx)
 {
+#if BORDER_ROUTER_RDC_WINDOW
+  if(window > 0) {
+    PRINTF("*** ERROR: '!R' report in windowed mode\n");
+    return;
+  }
+#endif /* BORDER_ROUTER_RDC_WINDOW */
   if(sessionid < MAX_CALLBACKS) {
     struct tx_callback *callback;
     callback = &callbacks[sessionid];
     packetbuf_clear();
-    packetbuf_attr_copyfrom(callback->attrs, callback->addrs);
+    packetbuf_attr_restore(&callback->attrs);
     mac_call_sent_callback(callback->cback, callback->ptr, status, tx);
   } else {
     PRINTF("*** ERROR: too high session id %d\n", sessionid);
@@ -85,9 +160,11 @@ setup_callback(mac_callback_t sent, void *ptr)
   struct tx_callback *callback;
   int tmp = callback_pos;
   callback = &callbacks[callback_pos];
+  if(!packetbuf_attr_save(&callback->attrs)) {
+    return -1;
+  }
   callback->cback = sent;
   callback->ptr = ptr;
-  packetbuf_attr_copyto(callback->attrs, callback->addrs);
 
   callback_pos++;
   if(callback_pos >= MAX_CALLBACKS) {
@@ -97,13 +174,146 @@ setup_callback(mac_callback_t sent, void *ptr)
   return tmp;
 }
 /*---------------------------------------------------------------------------*/
+#if BORDER_ROUTER_RDC_WINDOW
+static void
+send_window(void)
+{
+  struct tx_callback *callback;
+
+  while(in_flight < window && queue_len > 0) {
+    callback = &callbacks[queue[queue_first]];
+    queue_first = (queue_first + 1) % MAX_CALLBACKS;
+    queue_len--;
+
+    callback->state = SLOT_IN_FLIGHT;
+    callback->sent = clock_time();
+    in_flight++;
+    write_to_slip(callback->buf, callback->len);
+  }
+  if(in_flight > 0 && ctimer_expired(&timeout_timer)) {
+    ctimer_set(&timeout_timer, BORDER_ROUTER_RDC_TIMEOUT / 4,
+               check_timeouts, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+call_sent(struct tx_callback *callback, int status, int tx)
+{
+  packetbuf_clear();
+  packetbuf_attr_restore(&callback->attrs);
+  mac_call_sent_callback(callback->cback, callback->ptr, status, tx);
+}
+/*---------------------------------------------------------------------------*/
+static void
+release_slot(struct tx_callback *callback)
+{
+  callback->state = SLOT_FREE;
+  callback->gen++;
+  in_flight--;
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_timeouts(void *ptr)
+{
+  clock_time_t now;
+  int i;
+
+  now = clock_time();
+  for(i = 0; i < MAX_CALLBACKS; i++) {
+    if(now - callbacks[i].sent < BORDER_ROUTER_RDC_TIMEOUT) {
+      continue;
+    }
+    if(callbacks[i].state == SLOT_IN_FLIGHT) {
+      PRINTF("br-rdc: no report for slot %d\n", i);
+      border_router_window_stats.timeouts++;
+      callbacks[i].state = SLOT_TIMED_OUT;
+      callbacks[i].sent = now;
+      call_sent(&callbacks[i], MAC_TX_ERR, 0);
+    } else if(callbacks[i].state == SLOT_TIMED_OUT) {
+      /* The frame or its report was lost on the serial line. */
+      PRINTF("br-rdc: releasing slot %d\n", i);
+      release_slot(&callbacks[i]);
+      send_window();
+    }
+  }
+  if(in_flight > 0 && ctimer_expired(&timeout_timer)) {
+    ctimer_set(&timeout_timer, BORDER_ROUTER_RDC_TIMEOUT / 4,
+               check_timeouts, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+border_router_rdc_report(uint8_t sessionid, uint8_t status, uint8_t tx)
+{
+  struct tx_callback *callback;
+
+  callback = &callbacks[sessionid & 0x0f];
+  if((sessionid & 0x0f) >= MAX_CALLBACKS ||
+     (callback->state != SLOT_IN_FLIGHT &&
+      callback->state != SLOT_TIMED_OUT) ||
+     (sessionid >> 4) != (callback->gen & 0x0f)) {
+    PRINTF("br-rdc: stale report for sid %d\n", sessionid);
+    border_router_window_stats.stale++;
+    return;
+  }
+  if(callback->state == SLOT_TIMED_OUT) {
+    /* Already reported as failed; the report only returns the credit. */
+    PRINTF("br-rdc: late report for sid %d\n", sessionid);
+    border_router_window_stats.stale++;
+  } else {
+    border_router_latency_add(&border_router_tx_latency,
+                              clock_time() - callback->sent);
+    call_sent(callback, status, tx);
+  }
+  release_slot(callback);
+  /* The report returned a credit. */
+  send_window();
+}
+/*---------------------------------------------------------------------------*/
+void
+border_router_rdc_set_window(uint8_t size)
+{
+  window = MIN(size, BORDER_ROUTER_RDC_WINDOW);
+  if(window > 0) {
+    /* The radio takes a window of frames back to back. */
+    slip_set_batched();
+  }
+  send_window();
+}
+/*---------------------------------------------------------------------------*/
+static struct tx_callback *
+window_slot(void)
+{
+  int i;
+
+  for(i = 0; i < MAX_CALLBACKS; i++) {
+    if(callbacks[i].state == SLOT_FREE) {
+      return &callbacks[i];
+    }
+  }
+  return NULL;
+}
+#else /* BORDER_ROUTER_RDC_WINDOW */
+void
+border_router_rdc_report(uint8_t sessionid, uint8_t status, uint8_t tx)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+border_router_rdc_set_window(uint8_t size)
+{
+}
+#endif /* BORDER_ROUTER_RDC_WINDOW */
+/*---------------------------------------------------------------------------*/
 static void
 send_packet(mac_callback_t sent, void *ptr)
 {
   int size;
-  /* 3 bytes per packet attribute is required for serialization */
-  uint8_t buf[PACKETBUF_NUM_ATTRS * 3 + PACKETBUF_SIZE + 3];
-  uint8_t sid;
+  uint8_t buf[FRAME_SIZE];
+  int sid;
+#if BORDER_ROUTER_RDC_WINDOW
+  struct tx_callback *callback;
+#endif /* BORDER_ROUTER_RDC_WINDOW */
 
   packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
 
@@ -124,8 +334,44 @@ send_packet(mac_callback_t sent, void *ptr)
     if(size < 0 || size + packetbuf_totlen() + 3 > sizeof(buf)) {
       PRINTF("br-rdc: send failed, too large header\n");
       mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
+#if BORDER_ROUTER_RDC_WINDOW
+    } else if(window > 0) {
+      callback = window_slot();
+      if(callback == NULL) {
+        PRINTF("br-rdc: send failed, no free slot\n");
+        border_router_window_stats.full++;
+        mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
+        return;
+      }
+      if(!packetbuf_attr_save(&callback->attrs)) {
+        PRINTF("br-rdc: send failed, too many attributes\n");
+        mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
+        return;
+      }
+      callback->cback = sent;
+      callback->ptr = ptr;
+
+      /* '!T' <sid> <attributes> <frame> <CRC> */
+      callback->buf[0] = '!';
+      callback->buf[1] = 'T';
+      callback->buf[2] = (callback - callbacks) | ((callback->gen & 0x0f) << 4);
+      memcpy(&callback->buf[3], &buf[3], size);
+      memcpy(&callback->buf[3 + size], packetbuf_hdrptr(), packetbuf_totlen());
+      callback->len = packetutils_append_crc(callback->buf,
+                                             packetbuf_totlen() + size + 3);
+
+      callback->state = SLOT_QUEUED;
+      queue[(queue_first + queue_len) % MAX_CALLBACKS] = callback - callbacks;
+      queue_len++;
+      send_window();
+#endif /* BORDER_ROUTER_RDC_WINDOW */
     } else {
       sid = setup_callback(sent, ptr);
+      if(sid < 0) {
+        PRINTF("br-rdc: send failed, too many attributes\n");
+        mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
+        return;
+      }
 
       buf[0] = '!';
       buf[1] = 'S';
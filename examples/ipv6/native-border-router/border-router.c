@@ -237,6 +237,8 @@ static void
 request_mac(void)
 {
   write_to_slip((uint8_t *)"?M", 2);
+  /* Slip-radios that support the windowed protocol answer with '!W'. */
+  write_to_slip((uint8_t *)"?W", 2);
 }
 /*---------------------------------------------------------------------------*/
 void
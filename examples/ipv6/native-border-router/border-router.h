@@ -50,9 +50,39 @@ void border_router_set_mac(const uint8_t *data);
 void border_router_set_sensors(const char *data, int len);
 void border_router_print_stat(void);
 
+/* Latency histogram in clock ticks: bucket 0 counts zero, bucket i
+   counts [2^(i-1), 2^i) and the last bucket everything above. */
+#define BORDER_ROUTER_LATENCY_BUCKETS 12
+struct border_router_latency {
+  unsigned long count[BORDER_ROUTER_LATENCY_BUCKETS];
+  clock_time_t max;
+};
+
+struct border_router_window_stats {
+  unsigned long timeouts;   /* frames the radio never reported */
+  unsigned long stale;      /* reports for frames no longer outstanding */
+  unsigned long full;       /* frames dropped for lack of a slot */
+  unsigned long crc_errors; /* commands from the radio with a bad CRC */
+};
+
+/* From handing a frame to the radio until its report */
+extern struct border_router_latency border_router_tx_latency;
+/* From the read that brought the first byte of a received frame until
+   the frame is handled */
+extern struct border_router_latency border_router_rx_latency;
+extern struct border_router_window_stats border_router_window_stats;
+
+void border_router_latency_add(struct border_router_latency *latency,
+                               clock_time_t time);
+void border_router_rdc_report(uint8_t sessionid, uint8_t status, uint8_t tx);
+void border_router_rdc_set_window(uint8_t size);
+
+void slip_packet_input(unsigned char *data, int len);
+void slip_set_batched(void);
+
 void tun_init(void);
 
-int slip_init(void);
+void slip_init(void);
 int slip_set_fd(int maxfd, fd_set *rset, fd_set *wset);
 void slip_handle_fd(fd_set *rset, fd_set *wset);
 
@@ -54,7 +54,9 @@
 #include "net/netstack.h"
 #include "net/packetbuf.h"
 #include "cmd.h"
+#include "border-router.h"
 #include "border-router-cmds.h"
+#include "slip-codec.h"
 
 extern int slip_config_verbose;
 extern int slip_config_flowcontrol;
@@ -72,8 +74,6 @@ extern speed_t slip_config_b_rate;
 
 int devopen(const char *dev, int flags);
 
-static FILE *inslip;
-
 /* for statistics */
 long slip_sent = 0;
 long slip_received = 0;
@@ -83,11 +83,6 @@ int slipfd = 0;
 //#define PROGRESS(s) fprintf(stderr, s)
 #define PROGRESS(s) do { } while(0)
 
-#define SLIP_END     0300
-#define SLIP_ESC     0333
-#define SLIP_ESC_END 0334
-#define SLIP_ESC_ESC 0335
-
 /*---------------------------------------------------------------------------*/
 static void *
 get_in_addr(struct sockaddr *sa)
@@ -170,121 +165,157 @@ slip_packet_input(unsigned char *data, int len)
 }
 /*---------------------------------------------------------------------------*/
 /*
- * Read from serial, when we have a packet call slip_packet_input. No output
- * buffering, input buffered by stdio.
+ * Handle a frame received over serial: a command or a packet.
  */
-void
-serial_input(FILE *inslip)
+static void
+serial_frame(unsigned char *inbuf, int len, clock_time_t latency)
 {
-  static unsigned char inbuf[2048];
-  static int inbufptr = 0;
-  int ret,i;
-  unsigned char c;
-
-#ifdef linux
-  ret = fread(&c, 1, 1, inslip);
-  if(ret == -1 || ret == 0) err(1, "serial_input: read");
-  goto after_fread;
-#endif
+  int i;
 
- read_more:
-  if(inbufptr >= sizeof(inbuf)) {
-     fprintf(stderr, "*** dropping large %d byte packet\n", inbufptr);
-     inbufptr = 0;
+  if(inbuf[0] == '!' && len > 1 && inbuf[1] == 'F') {
+    border_router_latency_add(&border_router_rx_latency, latency);
   }
-  ret = fread(&c, 1, 1, inslip);
-#ifdef linux
- after_fread:
-#endif
-  if(ret == -1) {
-    err(1, "serial_input: read");
-  }
-  if(ret == 0) {
-    clearerr(inslip);
-    return;
-  }
-  slip_received++;
-  switch(c) {
-  case SLIP_END:
-    if(inbufptr > 0) {
-      if(inbuf[0] == '!') {
-	command_context = CMD_CONTEXT_RADIO;
-	cmd_input(inbuf, inbufptr);
-      } else if(inbuf[0] == '?') {
+  if(inbuf[0] == '!') {
+    command_context = CMD_CONTEXT_RADIO;
+    cmd_input(inbuf, len);
+  } else if(inbuf[0] == '?') {
 #define DEBUG_LINE_MARKER '\r'
-      } else if(inbuf[0] == DEBUG_LINE_MARKER) {
-	fwrite(inbuf + 1, inbufptr - 1, 1, stdout);
-      } else if(is_sensible_string(inbuf, inbufptr)) {
-        if(slip_config_verbose == 1) {   /* strings already echoed below for verbose>1 */
-          fwrite(inbuf, inbufptr, 1, stdout);
-        }
-      } else {
-        if(slip_config_verbose > 2) {
-          printf("Packet from SLIP of length %d - write TUN\n", inbufptr);
-          if(slip_config_verbose > 4) {
+  } else if(inbuf[0] == DEBUG_LINE_MARKER) {
+    fwrite(inbuf + 1, len - 1, 1, stdout);
+  } else if(is_sensible_string(inbuf, len)) {
+    if(slip_config_verbose == 1) {   /* strings already echoed below for verbose>1 */
+      fwrite(inbuf, len, 1, stdout);
+    }
+  } else {
+    if(slip_config_verbose > 2) {
+      printf("Packet from SLIP of length %d - write TUN\n", len);
+      if(slip_config_verbose > 4) {
 #if WIRESHARK_IMPORT_FORMAT
-            printf("0000");
-	    for(i = 0; i < inbufptr; i++) printf(" %02x", inbuf[i]);
+        printf("0000");
+        for(i = 0; i < len; i++) printf(" %02x", inbuf[i]);
 #else
-            printf("         ");
-            for(i = 0; i < inbufptr; i++) {
-              printf("%02x", inbuf[i]);
-              if((i & 3) == 3) printf(" ");
-              if((i & 15) == 15) printf("\n         ");
-            }
-#endif
-            printf("\n");
-          }
+        printf("         ");
+        for(i = 0; i < len; i++) {
+          printf("%02x", inbuf[i]);
+          if((i & 3) == 3) printf(" ");
+          if((i & 15) == 15) printf("\n         ");
         }
-	slip_packet_input(inbuf, inbufptr);
+#endif
+        printf("\n");
       }
-      inbufptr = 0;
     }
-    break;
+    border_router_latency_add(&border_router_rx_latency, latency);
+    slip_packet_input(inbuf, len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Read from serial, when we have a packet call slip_packet_input. No output
+ * buffering, input is read in chunks and decoded by slip-codec.
+ */
+static void
+serial_input(int infd)
+{
+  static unsigned char inbuf[2048];
+  static struct slip_decoder dec;
+  static int echoed;
+  /* Whether a frame has been started, in the read made at frame_start */
+  static uint8_t partial;
+  static clock_time_t frame_start;
+  unsigned char chunk[4096];
+  const unsigned char *p, *end;
+  clock_time_t now;
+  int ret, first;
+
+  if(dec.buf == NULL) {
+    /* Echo lines as they are received for verbose=2,3,5+ */
+    slip_decoder_init(&dec, inbuf, sizeof(inbuf),
+                      (slip_config_verbose >= 2 && slip_config_verbose != 4) ?
+                      SLIP_CODEC_LINES : 0);
+  }
 
-  case SLIP_ESC:
-    if(fread(&c, 1, 1, inslip) != 1) {
-      clearerr(inslip);
-      /* Put ESC back and give up! */
-      ungetc(SLIP_ESC, inslip);
-      return;
+  for(first = 1;; first = 0) {
+    ret = read(infd, chunk, sizeof(chunk));
+    if(ret == -1 && errno != EAGAIN) {
+      err(1, "serial_input: read");
     }
-
-    switch(c) {
-    case SLIP_ESC_END:
-      c = SLIP_END;
-      break;
-    case SLIP_ESC_ESC:
-      c = SLIP_ESC;
-      break;
+#ifdef linux
+    if(first && ret <= 0) {
+      err(1, "serial_input: read");
     }
-    /* FALLTHROUGH */
-  default:
-    inbuf[inbufptr++] = c;
-
-    /* Echo lines as they are received for verbose=2,3,5+ */
-    /* Echo all printable characters for verbose==4 */
-    if(slip_config_verbose == 4) {
-      if(c == 0 || c == '\r' || c == '\n' || c == '\t' || (c >= ' ' && c <= '~')) {
-	fwrite(&c, 1, 1, stdout);
+#endif
+    if(ret <= 0) {
+      return;
+    }
+    slip_received += ret;
+    now = clock_time();
+
+    p = chunk;
+    end = chunk + ret;
+    do {
+      if(!partial) {
+        /* The next frame starts in this read. */
+        frame_start = now;
+      }
+      ret = slip_decode(&dec, &p, end);
+
+      /* Echo all printable characters for verbose==4 */
+      if(slip_config_verbose == 4 && ret != SLIP_DECODE_OVERFLOW) {
+        for(; echoed < dec.len; echoed++) {
+          unsigned char c = inbuf[echoed];
+          if(c == 0 || c == '\r' || c == '\n' || c == '\t' || (c >= ' ' && c <= '~')) {
+            fwrite(&c, 1, 1, stdout);
+          }
+        }
       }
-    } else if(slip_config_verbose >= 2) {
-      if(c == '\n' && is_sensible_string(inbuf, inbufptr)) {
-        fwrite(inbuf, inbufptr, 1, stdout);
-        inbufptr = 0;
+
+      switch(ret) {
+      case SLIP_DECODE_OVERFLOW:
+        fprintf(stderr, "*** dropping packet larger than %d bytes\n", dec.size);
+        /* The decoder has cleared the frame: nothing of it is echoed
+           or timed. */
+        echoed = 0;
+        partial = 0;
+        break;
+
+      case SLIP_DECODE_LINE:
+        if(is_sensible_string(inbuf, dec.len)) {
+          fwrite(inbuf, dec.len, 1, stdout);
+          dec.len = 0;
+        }
+        partial = dec.len > 0;
+        break;
+
+      case SLIP_DECODE_FRAME:
+        echoed = 0;
+        /* Frames queued behind others in the same read wait for them. */
+        serial_frame(inbuf, dec.len, clock_time() - frame_start);
+        partial = 0;
+        break;
+
+      default:
+        /* The rest of the frame comes with later reads. */
+        partial = dec.len > 0;
+        break;
       }
+    } while(ret != SLIP_DECODE_MORE);
+
+    if(end - chunk < sizeof(chunk)) {
+      /* Nothing more to read for now. */
+      return;
     }
-    break;
   }
-
-  goto read_more;
 }
-
+/*---------------------------------------------------------------------------*/
 unsigned char slip_buf[2048];
 int slip_end, slip_begin, slip_packet_end, slip_packet_count;
+/* End of the last complete packet in slip_buf */
+static int slip_last_end;
 static struct timer send_delay_timer;
 /* delay between slip packets */
 static clock_time_t send_delay = SEND_DELAY;
+/* write all complete packets at once instead of one by one */
+static uint8_t batched;
 /*---------------------------------------------------------------------------*/
 static void
 slip_send(int fd, unsigned char c)
@@ -298,6 +329,7 @@ slip_send(int fd, unsigned char c)
   if(c == SLIP_END) {
     /* Full packet received. */
     slip_packet_count++;
+    slip_last_end = slip_end;
     if(slip_packet_end == 0) {
       slip_packet_end = slip_end;
     }
@@ -311,15 +343,26 @@ slip_empty()
 }
 /*---------------------------------------------------------------------------*/
 void
+slip_set_batched(void)
+{
+  /* The slip-radio has said how many frames it can take, and the
+     border router never has more outstanding, so there is no need to
+     wait between them. */
+  batched = 1;
+  send_delay = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
 slip_flushbuf(int fd)
 {
-  int n;
+  int n, i;
 
   if(slip_empty()) {
     return;
   }
 
-  n = write(fd, slip_buf + slip_begin, slip_packet_end - slip_begin);
+  n = write(fd, slip_buf + slip_begin,
+            (batched ? slip_last_end : slip_packet_end) - slip_begin);
 
   if(n == -1 && errno != EAGAIN) {
     err(1, "slip_flushbuf write failed");
@@ -327,13 +370,19 @@ slip_flushbuf(int fd)
     PROGRESS("Q");		/* Outqueue is full! */
   } else {
     slip_begin += n;
-    if(slip_begin == slip_packet_end) {
+    if(slip_begin >= slip_packet_end) {
+      /* The first packet, and possibly more, has been written. */
       slip_packet_count--;
-      if(slip_end > slip_packet_end) {
-        memcpy(slip_buf, slip_buf + slip_packet_end,
-               slip_end - slip_packet_end);
+      for(i = slip_packet_end; i < slip_begin; i++) {
+        if(slip_buf[i] == SLIP_END) {
+          slip_packet_count--;
+        }
+      }
+      if(slip_end > slip_begin) {
+        memmove(slip_buf, slip_buf + slip_begin, slip_end - slip_begin);
       }
-      slip_end -= slip_packet_end;
+      slip_end -= slip_begin;
+      slip_last_end -= slip_begin;
       slip_begin = slip_packet_end = 0;
       if(slip_end > 0) {
         /* Find end of next slip packet */
@@ -356,7 +405,7 @@ static void
 write_to_serial(int outfd, const uint8_t *inbuf, int len)
 {
   const uint8_t *p = inbuf;
-  int i;
+  int i, start;
 
   if(slip_config_verbose > 2) {
 #ifdef __CYGWIN__
@@ -385,6 +434,17 @@ write_to_serial(int outfd, const uint8_t *inbuf, int len)
    */
   /* slip_send(outfd, SLIP_END); */
 
+  if(slip_end + SLIP_ENCODED_MAX(len) <= sizeof(slip_buf)) {
+    /* There is room for the packet even if every byte is escaped, so
+       escape it straight into the buffer. */
+    start = slip_end;
+    slip_end += slip_encode(slip_buf + slip_end, p, len, 0);
+    slip_sent += slip_end - start;
+    slip_send(outfd, SLIP_END);
+    PROGRESS("t");
+    return;
+  }
+
   for(i = 0; i < len; i++) {
     switch(p[i]) {
     case SLIP_END:
@@ -475,7 +535,7 @@ static void
 handle_fd(fd_set *rset, fd_set *wset)
 {
   if(FD_ISSET(slipfd, rset)) {
-    serial_input(inslip);
+    serial_input(slipfd);
   }
 
   if(FD_ISSET(slipfd, wset)) {
@@ -483,7 +543,19 @@ handle_fd(fd_set *rset, fd_set *wset)
   }
 }
 /*---------------------------------------------------------------------------*/
-static const struct select_callback slip_callback = { set_fd, handle_fd };
+static int
+timeout(void)
+{
+  /* Wake up to flush when the send delay expires. */
+  if(!slip_empty() && send_delay > 0 && !timer_expired(&send_delay_timer)) {
+    return timer_remaining(&send_delay_timer) * 1000 / CLOCK_SECOND;
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static const struct select_callback slip_callback = {
+  set_fd, handle_fd, timeout
+};
 /*---------------------------------------------------------------------------*/
 void
 slip_init(void)
@@ -538,9 +610,5 @@ slip_init(void)
 
   timer_set(&send_delay_timer, 0);
   slip_send(slipfd, SLIP_END);
-  inslip = fdopen(slipfd, "r");
-  if(inslip == NULL) {
-    err(1, "main: fdopen");
-  }
 }
 /*---------------------------------------------------------------------------*/
@@ -76,7 +76,8 @@ static int set_fd(fd_set *rset, fd_set *wset);
 static void handle_fd(fd_set *rset, fd_set *wset);
 static const struct select_callback tun_select_callback = {
   set_fd,
-  handle_fd
+  handle_fd,
+  NULL
 };
 #endif /* __CYGWIN__ */
 
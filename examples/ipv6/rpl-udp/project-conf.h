@@ -56,4 +56,14 @@
 
 #define RPL_CONF_DEFAULT_ROUTE_INFINITE_LIFETIME 1
 
+#if WITH_NON_STORING
+/* Non-storing mode: the root keeps one parent link per node and
+   source routes downward traffic, other nodes keep no routes. */
+#undef RPL_CONF_MOP
+#define RPL_CONF_MOP RPL_MOP_NON_STORING
+#undef UIP_CONF_MAX_ROUTES
+#define UIP_CONF_MAX_ROUTES   0
+#define RPL_NS_CONF_LINK_NUM  40
+#endif /* WITH_NON_STORING */
+
 #endif /* PROJECT_CONF_H_ */
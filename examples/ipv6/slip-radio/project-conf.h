@@ -36,6 +36,14 @@
 #undef UIP_CONF_BUFFER_SIZE
 #define UIP_CONF_BUFFER_SIZE    140
 
+/* The border router sends a window of frames back to back, so the
+   SLIP receive buffer must hold all of them. */
+#ifndef SLIP_RADIO_CONF_WINDOW
+#define SLIP_RADIO_CONF_WINDOW     2
+#endif
+#undef SLIP_CONF_RX_BUFSIZE
+#define SLIP_CONF_RX_BUFSIZE    (SLIP_RADIO_CONF_WINDOW * UIP_CONF_BUFFER_SIZE + 1)
+
 #undef UIP_CONF_ROUTER
 #define UIP_CONF_ROUTER                 0
 
@@ -32,7 +32,10 @@
 #include "net/ip/uip.h"
 #include "net/packetbuf.h"
 #include "dev/slip.h"
+#include "packetutils.h"
+#include "slip-radio.h"
 #include <stdio.h>
+#include <string.h>
 
 #define SLIP_END     0300
 #define SLIP_ESC     0333
@@ -91,6 +94,14 @@ slipnet_input(void)
     printf("\n");
   }
 
+  if(slip_radio_windowed() && uip_len + 4 <= UIP_BUFSIZE) {
+    /* '!F' <frame> <CRC> lets the border router detect corrupt frames. */
+    memmove(&uip_buf[2], uip_buf, uip_len);
+    uip_buf[0] = '!';
+    uip_buf[1] = 'F';
+    uip_len = packetutils_append_crc(uip_buf, uip_len + 2);
+  }
+
   /* printf("SUT: %u\n", uip_len); */
   slip_send_packet(uip_buf, uip_len);
 }
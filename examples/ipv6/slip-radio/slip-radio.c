@@ -54,10 +54,38 @@ extern const struct slip_radio_sensors SLIP_RADIO_CONF_SENSORS;
 
 void slip_send_packet(const uint8_t *ptr, int len);
 
+/* Number of frames the border router may have outstanding when it
+   uses the windowed protocol. Frames arrive while the previous one is
+   being sent, so the SLIP receive buffer must hold this many frames. */
+#ifdef SLIP_RADIO_CONF_WINDOW
+#define SLIP_RADIO_WINDOW SLIP_RADIO_CONF_WINDOW
+#else
+#define SLIP_RADIO_WINDOW 2
+#endif
+
+/* The SLIP driver keeps at most two received frames */
+#if SLIP_RADIO_WINDOW > 2
+#error SLIP_RADIO_CONF_WINDOW can be at most 2
+#endif
+#if SLIP_RADIO_WINDOW > 1 && \
+    SLIP_CONF_RX_BUFSIZE < SLIP_RADIO_WINDOW * (UIP_BUFSIZE - UIP_LLH_LEN) + 1
+#error SLIP_CONF_RX_BUFSIZE must hold SLIP_RADIO_CONF_WINDOW frames
+#endif
+
  /* max 16 packets at the same time??? */
 uint8_t packet_ids[16];
 int packet_pos;
 
+/* Session ids of the frames of the windowed protocol */
+struct window_slot {
+  uint8_t sid;
+  uint8_t used;
+};
+static struct window_slot window[SLIP_RADIO_WINDOW];
+
+/* Set once the border router has asked for the window size */
+static uint8_t windowed;
+
 static int slip_radio_cmd_handler(const uint8_t *data, int len);
 
 #if CONTIKI_TARGET_NOOLIBERRY
@@ -95,6 +123,68 @@ packet_sent(void *ptr, int status, int transmissions)
   cmd_send(buf, pos);
 }
 /*---------------------------------------------------------------------------*/
+static void
+report(uint8_t sid, int status, int transmissions)
+{
+  uint8_t buf[7];
+  int pos;
+
+  pos = 0;
+  buf[pos++] = '!';
+  buf[pos++] = 'A';
+  buf[pos++] = sid;
+  buf[pos++] = status;
+  buf[pos++] = transmissions;
+  pos = packetutils_append_crc(buf, pos);
+  cmd_send(buf, pos);
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_packet_sent(void *ptr, int status, int transmissions)
+{
+  struct window_slot *slot = ptr;
+
+  PRINTF("Slip-radio: window packet sent! sid: %d, status: %d, tx: %d\n",
+         slot->sid, status, transmissions);
+  slot->used = 0;
+  report(slot->sid, status, transmissions);
+}
+/*---------------------------------------------------------------------------*/
+/* Send a frame given as <sid> <attributes> <frame> after the command */
+static int
+send_frame(const uint8_t *data, int len, mac_callback_t sent, void *ptr)
+{
+  int pos;
+
+  packetbuf_clear();
+  pos = packetutils_deserialize_atts(&data[3], len - 3);
+  if(pos < 0) {
+    PRINTF("slip-radio: illegal packet attributes\n");
+    return 0;
+  }
+  pos += 3;
+  len -= pos;
+  if(len > PACKETBUF_SIZE) {
+    len = PACKETBUF_SIZE;
+  }
+  memcpy(packetbuf_dataptr(), &data[pos], len);
+  packetbuf_set_datalen(len);
+
+  PRINTF("slip-radio: sending %u (%d bytes)\n",
+         data[2], packetbuf_datalen());
+
+  /* parse frame before sending to get addresses, etc. */
+  no_framer.parse();
+  NETSTACK_LLSEC.send(sent, ptr);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+slip_radio_windowed(void)
+{
+  return windowed;
+}
+/*---------------------------------------------------------------------------*/
 static int
 slip_radio_cmd_handler(const uint8_t *data, int len)
 {
@@ -103,37 +193,47 @@ slip_radio_cmd_handler(const uint8_t *data, int len)
     /* should send out stuff to the radio - ignore it as IP */
     /* --- s e n d --- */
     if(data[1] == 'S') {
-      int pos;
       packet_ids[packet_pos] = data[2];
 
-      packetbuf_clear();
-      pos = packetutils_deserialize_atts(&data[3], len - 3);
-      if(pos < 0) {
-        PRINTF("slip-radio: illegal packet attributes\n");
+      if(!send_frame(data, len, packet_sent, &packet_ids[packet_pos])) {
         return 1;
       }
-      pos += 3;
-      len -= pos;
-      if(len > PACKETBUF_SIZE) {
-        len = PACKETBUF_SIZE;
-      }
-      memcpy(packetbuf_dataptr(), &data[pos], len);
-      packetbuf_set_datalen(len);
-
-      PRINTF("slip-radio: sending %u (%d bytes)\n",
-             data[2], packetbuf_datalen());
-
-      /* parse frame before sending to get addresses, etc. */
-      no_framer.parse();
-      NETSTACK_LLSEC.send(packet_sent, &packet_ids[packet_pos]);
 
       packet_pos++;
       if(packet_pos >= sizeof(packet_ids)) {
 	packet_pos = 0;
       }
 
+      return 1;
+    } else if(data[1] == 'T') {
+      /* Windowed send, the same as 'S' followed by a CRC */
+      len = packetutils_check_crc(data, len);
+      if(len < 4) {
+        /* The border router times the frame out. */
+        return 1;
+      }
+      for(i = 0; i < SLIP_RADIO_WINDOW && window[i].used; i++);
+      if(i == SLIP_RADIO_WINDOW) {
+        PRINTF("slip-radio: window full\n");
+        report(data[2], MAC_TX_ERR, 0);
+        return 1;
+      }
+      window[i].sid = data[2];
+      window[i].used = 1;
+      if(!send_frame(data, len, window_packet_sent, &window[i])) {
+        window[i].used = 0;
+        report(data[2], MAC_TX_ERR_FATAL, 0);
+      }
       return 1;
     }
+  } else if(data[0] == '?' && data[1] == 'W') {
+    uint8_t buf[3];
+    buf[0] = '!';
+    buf[1] = 'W';
+    buf[2] = SLIP_RADIO_WINDOW;
+    windowed = 1;
+    cmd_send(buf, sizeof(buf));
+    return 1;
   } else if(uip_buf[0] == '?') {
     PRINTF("Got request message of type %c\n", uip_buf[1]);
     if(data[1] == 'M') {
@@ -38,4 +38,7 @@ struct slip_radio_sensors {
   void (* send)(void);
 };
 
+/* Whether received frames are sent to the border router as '!F' commands */
+int slip_radio_windowed(void);
+
 #endif /* SLIP_RADIO_H_ */
@@ -431,6 +431,9 @@ typedef uint32_t rtimer_clock_t;
 #endif
 #define UIP_CONF_UDP                         1
 #define UIP_CONF_UDP_CHECKSUMS               1
+#ifndef UIP_CONF_WORD_CHKSUM
+#define UIP_CONF_WORD_CHKSUM                 1
+#endif
 #define UIP_CONF_ICMP6                       1
 
 /* ND and Routing */
@@ -41,6 +41,9 @@
 struct select_callback {
   int  (* set_fd)(fd_set *fdr, fd_set *fdw);
   void (* handle_fd)(fd_set *fdr, fd_set *fdw);
+  /* Optional. Milliseconds until set_fd() should be called again
+     because it may then want other descriptors, or -1 for never. */
+  int  (* timeout)(void);
 };
 int select_set_callback(int fd, const struct select_callback *callback);
 
@@ -73,6 +76,17 @@ typedef unsigned short uip_stats_t;
 #define UIP_CONF_TCP_SPLIT       0
 #define UIP_CONF_LOGGING         0
 #define UIP_CONF_UDP_CHECKSUMS   1
+#ifndef UIP_CONF_WORD_CHKSUM
+#define UIP_CONF_WORD_CHKSUM     1
+#endif /* UIP_CONF_WORD_CHKSUM */
+
+#ifndef AES_128_CONF_WITH_TTABLE
+#define AES_128_CONF_WITH_TTABLE 1
+#endif /* AES_128_CONF_WITH_TTABLE */
+
+/* Frame ring producers and consumers may be threads on different cores */
+#define FRAME_RING_CONF_BARRIER() __sync_synchronize()
+#define FRAME_RING_CONF_CACHE_LINE 64
 
 #ifndef NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE
 #define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE 8
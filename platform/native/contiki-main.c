@@ -78,6 +78,49 @@
 #define SELECT_MAX 8
 #endif
 
+/*
+ * With SELECT_CONF_EPOLL, the main loop waits with epoll(7) instead of
+ * select(2). It sleeps until the next etimer expires, a select
+ * callback times out or a descriptor becomes ready, rather than waking
+ * up every millisecond, and handles up to SELECT_BATCH rounds of ready
+ * descriptors per wakeup. Callbacks without a timeout function are
+ * asked for their descriptors at least every SELECT_MAX_TIMEOUT
+ * milliseconds.
+ */
+#ifdef SELECT_CONF_EPOLL
+#define SELECT_EPOLL SELECT_CONF_EPOLL
+#else
+#define SELECT_EPOLL 0
+#endif
+
+#ifdef SELECT_CONF_BATCH
+#define SELECT_BATCH SELECT_CONF_BATCH
+#else
+#define SELECT_BATCH 16
+#endif
+
+#ifdef SELECT_CONF_MAX_TIMEOUT
+#define SELECT_MAX_TIMEOUT SELECT_CONF_MAX_TIMEOUT
+#else
+#define SELECT_MAX_TIMEOUT 1000
+#endif
+
+#if SELECT_EPOLL
+#ifndef __linux__
+#error "SELECT_CONF_EPOLL requires Linux"
+#endif
+#include <sys/epoll.h>
+
+#include <poll.h>
+
+static int epoll_fd = -1;
+/* The events each descriptor is currently registered for. */
+static uint32_t epoll_registered[SELECT_MAX];
+/* Descriptors that epoll does not support, such as regular files,
+   which are polled instead. */
+static fd_set epoll_rejected;
+#endif /* SELECT_EPOLL */
+
 static const struct select_callback *select_callback[SELECT_MAX];
 static int select_max = 0;
 
@@ -99,6 +142,16 @@ select_set_callback(int fd, const struct select_callback *callback)
       callback = NULL;
     }
 
+#if SELECT_EPOLL
+    if(callback != select_callback[fd]) {
+      /* Register the descriptor again when it is next asked for. */
+      if(epoll_registered[fd] != 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        epoll_registered[fd] = 0;
+      }
+      FD_CLR(fd, &epoll_rejected);
+    }
+#endif /* SELECT_EPOLL */
     select_callback[fd] = callback;
 
     /* Update fd max */
@@ -120,6 +173,180 @@ select_set_callback(int fd, const struct select_callback *callback)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+/* Ask the callbacks which descriptors they wait for. Returns the
+   highest descriptor with a callback that wants to be called. */
+static int
+select_set_fds(fd_set *fdr, fd_set *fdw)
+{
+  int i;
+  int maxfd;
+
+  FD_ZERO(fdr);
+  FD_ZERO(fdw);
+  maxfd = 0;
+  for(i = 0; i <= select_max; i++) {
+    if(select_callback[i] != NULL && select_callback[i]->set_fd(fdr, fdw)) {
+      maxfd = i;
+    }
+  }
+  return maxfd;
+}
+/*---------------------------------------------------------------------------*/
+#if SELECT_EPOLL
+static void
+epoll_register(fd_set *fdr, fd_set *fdw)
+{
+  struct epoll_event ev;
+  uint32_t events;
+  int fd;
+
+  for(fd = 0; fd < SELECT_MAX; fd++) {
+    events = 0;
+    if(FD_ISSET(fd, fdr)) {
+      events |= EPOLLIN;
+    }
+    if(FD_ISSET(fd, fdw)) {
+      events |= EPOLLOUT;
+    }
+    if(events == epoll_registered[fd] || FD_ISSET(fd, &epoll_rejected)) {
+      continue;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+    if(events == 0) {
+      /* Fails harmlessly if the descriptor has been closed. */
+      epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+    } else if(epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0 &&
+              epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      if(errno != EPERM) {
+        perror("epoll_ctl");
+      }
+      FD_SET(fd, &epoll_rejected);
+      events = 0;
+    }
+    epoll_registered[fd] = events;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Poll the wanted descriptors that epoll rejected. Ready ones are
+   added to rset and wset. Returns the number of ready descriptors. */
+static int
+epoll_poll_rejected(fd_set *fdr, fd_set *fdw, fd_set *rset, fd_set *wset)
+{
+  struct pollfd fds[SELECT_MAX];
+  int fd, n, i, ready;
+
+  n = 0;
+  for(fd = 0; fd <= select_max; fd++) {
+    if(FD_ISSET(fd, &epoll_rejected) &&
+       (FD_ISSET(fd, fdr) || FD_ISSET(fd, fdw))) {
+      fds[n].fd = fd;
+      fds[n].events = (FD_ISSET(fd, fdr) ? POLLIN : 0) |
+        (FD_ISSET(fd, fdw) ? POLLOUT : 0);
+      n++;
+    }
+  }
+  if(n == 0 || poll(fds, n, 0) <= 0) {
+    return 0;
+  }
+
+  ready = 0;
+  for(i = 0; i < n; i++) {
+    if(fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+      FD_SET(fds[i].fd, rset);
+    }
+    if(fds[i].revents & POLLOUT) {
+      FD_SET(fds[i].fd, wset);
+    }
+    ready += fds[i].revents != 0;
+  }
+  return ready;
+}
+/*---------------------------------------------------------------------------*/
+/* Milliseconds until the next etimer expires or a select callback
+   times out. */
+static int
+epoll_timeout(void)
+{
+  clock_time_t now, left;
+  int timeout, t, i;
+
+  timeout = SELECT_MAX_TIMEOUT;
+  for(i = 0; i <= select_max; i++) {
+    if(select_callback[i] != NULL && select_callback[i]->timeout != NULL) {
+      t = select_callback[i]->timeout();
+      if(t >= 0 && t < timeout) {
+        timeout = t;
+      }
+    }
+  }
+
+  if(!etimer_pending()) {
+    return timeout;
+  }
+
+  now = clock_time();
+  left = etimer_next_expiration_time() - now;
+  if(left > ((clock_time_t)~0 >> 1)) {
+    /* Already expired. */
+    return 0;
+  }
+  if(left > timeout) {
+    return timeout;
+  }
+  return (int)left;
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_run(int timeout)
+{
+  struct epoll_event events[SELECT_MAX];
+  fd_set fdr, fdw, rset, wset;
+  int batch, n, i, ready;
+
+  for(batch = 0; batch < SELECT_BATCH; batch++) {
+    select_set_fds(&fdr, &fdw);
+    epoll_register(&fdr, &fdw);
+
+    FD_ZERO(&rset);
+    FD_ZERO(&wset);
+    ready = epoll_poll_rejected(&fdr, &fdw, &rset, &wset);
+
+    /* Only the first wait may sleep; the following ones pick up
+       descriptors that became ready while handling the previous. */
+    n = epoll_wait(epoll_fd, events, SELECT_MAX,
+                   batch == 0 && ready == 0 ? timeout : 0);
+    if(n < 0) {
+      if(errno != EINTR) {
+        perror("epoll_wait");
+      }
+      return;
+    } else if(n == 0 && ready == 0) {
+      return;
+    }
+
+    for(i = 0; i < n; i++) {
+      if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        FD_SET(events[i].data.fd, &rset);
+      }
+      if(events[i].events & EPOLLOUT) {
+        FD_SET(events[i].data.fd, &wset);
+      }
+    }
+    for(i = 0; i <= select_max; i++) {
+      if(select_callback[i] != NULL) {
+        select_callback[i]->handle_fd(&rset, &wset);
+      }
+    }
+
+    /* Let the stack process what was just read before reading more. */
+    process_run();
+  }
+}
+#endif /* SELECT_EPOLL */
+/*---------------------------------------------------------------------------*/
 static int
 stdin_set_fd(fd_set *rset, fd_set *wset)
 {
@@ -130,14 +357,19 @@ static void
 stdin_handle_fd(fd_set *rset, fd_set *wset)
 {
   char c;
+  int n;
   if(FD_ISSET(STDIN_FILENO, rset)) {
-    if(read(STDIN_FILENO, &c, 1) > 0) {
+    n = read(STDIN_FILENO, &c, 1);
+    if(n > 0) {
       serial_line_input_byte(c);
+    } else if(n == 0) {
+      /* End of file, as with a redirected standard input. */
+      select_set_callback(STDIN_FILENO, NULL);
     }
   }
 }
 const static struct select_callback stdin_fd = {
-  stdin_set_fd, stdin_handle_fd
+  stdin_set_fd, stdin_handle_fd, NULL
 };
 /*---------------------------------------------------------------------------*/
 static void
@@ -250,7 +482,21 @@ main(int argc, char **argv)
   setvbuf(stdout, (char *)NULL, _IONBF, 0);
 
   select_set_callback(STDIN_FILENO, &stdin_fd);
+#if SELECT_EPOLL
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if(epoll_fd < 0) {
+    perror("epoll_create1");
+    return 1;
+  }
+#endif /* SELECT_EPOLL */
   while(1) {
+#if SELECT_EPOLL
+    int retval;
+
+    retval = process_run();
+
+    epoll_run(retval ? 0 : epoll_timeout());
+#else /* SELECT_EPOLL */
     fd_set fdr;
     fd_set fdw;
     int maxfd;
@@ -263,14 +509,7 @@ main(int argc, char **argv)
     tv.tv_sec = 0;
     tv.tv_usec = retval ? 1 : 1000;
 
-    FD_ZERO(&fdr);
-    FD_ZERO(&fdw);
-    maxfd = 0;
-    for(i = 0; i <= select_max; i++) {
-      if(select_callback[i] != NULL && select_callback[i]->set_fd(&fdr, &fdw)) {
-        maxfd = i;
-      }
-    }
+    maxfd = select_set_fds(&fdr, &fdw);
 
     retval = select(maxfd + 1, &fdr, &fdw, NULL, &tv);
     if(retval < 0) {
@@ -285,6 +524,7 @@ main(int argc, char **argv)
         }
       }
     }
+#endif /* SELECT_EPOLL */
 
     etimer_request_poll();
 
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Flash simulation for the xmem driver of the native platform.
+ *
+ *         The native xmem keeps 1 MB of storage in RAM or, with
+ *         XMEM_CONF_FILE set to a file name, in that file, so that the
+ *         contents survive a restart. It counts the flash operations
+ *         that a real device would have performed, so that the write
+ *         amplification of, e.g., Coffee can be measured.
+ */
+
+#ifndef XMEM_ARCH_H_
+#define XMEM_ARCH_H_
+
+/** Flash operation counts of the native xmem */
+struct xmem_stats {
+  unsigned long reads;            /**< Pages read */
+  unsigned long programs;         /**< Pages programmed */
+  unsigned long erases;           /**< Sectors erased */
+  unsigned long bytes_programmed; /**< Bytes programmed */
+  unsigned long overwrites;       /**< Bytes programmed without an erase */
+};
+
+/**
+ * \brief Get the flash operation counts
+ *
+ * A read or a program counts once for every page of XMEM_CONF_PAGE_SIZE
+ * bytes (256 by default) that it touches, and an erase once for every
+ * call. A byte counts as an overwrite when programming it would have to
+ * turn a programmed bit back into an erased one, which real flash
+ * cannot do without an erase.
+ */
+void xmem_get_stats(struct xmem_stats *stats);
+
+/** \brief Set the flash operation counts to zero */
+void xmem_reset_stats(void);
+
+#endif /* XMEM_ARCH_H_ */
@@ -34,30 +34,93 @@
 
 #include "contiki-conf.h"
 #include "dev/xmem.h"
+#include "dev/xmem-arch.h"
 
 #include <stdio.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #define XMEM_SIZE 1024 * 1024
 
-static unsigned char xmem[XMEM_SIZE];
+/* Keep the contents in this file between runs, instead of in RAM. */
+#ifdef XMEM_CONF_FILE
+#define XMEM_FILE XMEM_CONF_FILE
+#endif
+
+/* The page size of the simulated flash, for the statistics. */
+#ifdef XMEM_CONF_PAGE_SIZE
+#define XMEM_PAGE_SIZE XMEM_CONF_PAGE_SIZE
+#else
+#define XMEM_PAGE_SIZE 256
+#endif
+
+static unsigned char xmem_ram[XMEM_SIZE];
+static unsigned char *xmem;
+static struct xmem_stats stats;
+/*---------------------------------------------------------------------------*/
+static int
+xmem_open(unsigned long offset, long size)
+{
+#ifdef XMEM_FILE
+  int fd;
+#endif
+
+  if(size < 0 || offset > XMEM_SIZE || size > XMEM_SIZE - offset) {
+    return 0;
+  }
+  if(xmem != NULL) {
+    return 1;
+  }
+
+  xmem = xmem_ram;
+#ifdef XMEM_FILE
+  fd = open(XMEM_FILE, O_RDWR | O_CREAT, 0644);
+  if(fd < 0 || ftruncate(fd, XMEM_SIZE) < 0 ||
+     (xmem = mmap(NULL, XMEM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+                  fd, 0)) == MAP_FAILED) {
+    perror("xmem: " XMEM_FILE);
+    xmem = xmem_ram;
+  }
+  if(fd >= 0) {
+    close(fd);
+  }
+#endif /* XMEM_FILE */
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* The number of flash pages that size bytes from offset on touch. */
+static unsigned long
+pages(int size, unsigned long offset)
+{
+  if(size <= 0) {
+    return 0;
+  }
+  return (offset + size - 1) / XMEM_PAGE_SIZE - offset / XMEM_PAGE_SIZE + 1;
+}
 /*---------------------------------------------------------------------------*/
 int
 xmem_pwrite(const void *buf, int size, unsigned long offset)
 {
-  /*  int f;
-  char name[400];
+  const unsigned char *p;
+  int i;
 
-  snprintf(name, sizeof(name), "xmem.%d.%d", node_x(), node_y());
-  f = open(name, O_WRONLY | O_APPEND | O_CREAT, 0644);
-  lseek(f, addr, SEEK_SET);
-  write(f, buf, size);
-  close(f);*/
+  if(!xmem_open(offset, size)) {
+    return -1;
+  }
 
-  /*  printf("xmem_write(offset 0x%02x, buf %p, size %l);\n", offset, buf, size);*/
+  /* Like Coffee, treat erased bits as zero. Flash can then only set
+     bits, so count the bytes where a bit would have to be cleared. */
+  p = buf;
+  for(i = 0; i < size; i++) {
+    if(xmem[offset + i] & ~p[i]) {
+      stats.overwrites++;
+    }
+  }
+  stats.programs += pages(size, offset);
+  stats.bytes_programmed += size;
 
   memcpy(&xmem[offset], buf, size);
   return size;
@@ -66,7 +129,10 @@ xmem_pwrite(const void *buf, int size, unsigned long offset)
 int
 xmem_pread(void *buf, int size, unsigned long offset)
 {
-  /*  printf("xmem_read(addr 0x%02x, buf %p, size %d);\n", addr, buf, size);*/
+  if(!xmem_open(offset, size)) {
+    return -1;
+  }
+  stats.reads += pages(size, offset);
   memcpy(buf, &xmem[offset], size);
   return size;
 }
@@ -74,7 +140,10 @@ xmem_pread(void *buf, int size, unsigned long offset)
 int
 xmem_erase(long nbytes, unsigned long offset)
 {
-  /*  printf("xmem_read(addr 0x%02x, buf %p, size %d);\n", addr, buf, size);*/
+  if(!xmem_open(offset, nbytes)) {
+    return -1;
+  }
+  stats.erases++;
   memset(&xmem[offset], 0, nbytes);
   return nbytes;
 }
@@ -85,3 +154,15 @@ xmem_init(void)
 
 }
 /*---------------------------------------------------------------------------*/
+void
+xmem_get_stats(struct xmem_stats *s)
+{
+  memcpy(s, &stats, sizeof(*s));
+}
+/*---------------------------------------------------------------------------*/
+void
+xmem_reset_stats(void)
+{
+  memset(&stats, 0, sizeof(stats));
+}
+/*---------------------------------------------------------------------------*/
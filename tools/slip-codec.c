@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2016, SICS Swedish ICT
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+#include "slip-codec.h"
+
+#include <string.h>
+
+/* Bits of special[] */
+#define SPECIAL_SLIP    0x01 /* SLIP_END and SLIP_ESC */
+#define SPECIAL_XONXOFF 0x02
+#define SPECIAL_LINE    0x04
+
+static const uint8_t special[256] = {
+  [SLIP_END] = SPECIAL_SLIP,
+  [SLIP_ESC] = SPECIAL_SLIP,
+  [XON] = SPECIAL_XONXOFF,
+  [XOFF] = SPECIAL_XONXOFF,
+  ['\n'] = SPECIAL_LINE,
+};
+
+/* Whether a word has a byte of value b, see "Bit Twiddling Hacks" */
+#define ONES            (~0UL / 0xff)
+#define HAS_ZERO(w)     (((w) - ONES) & ~(w) & (ONES << 7))
+#define HAS_BYTE(w, b)  HAS_ZERO((w) ^ (ONES * (b)))
+
+/* Values of slip_decoder.state */
+#define STATE_DATA 0
+#define STATE_ESC  1
+#define STATE_DROP 2 /* Skipping the rest of a frame that is too long */
+#define STATE_DONE 3 /* A frame has been returned */
+/*---------------------------------------------------------------------------*/
+void
+slip_decoder_init(struct slip_decoder *dec, uint8_t *buf, int size,
+                  uint8_t flags)
+{
+  dec->buf = buf;
+  dec->size = size;
+  dec->len = 0;
+  dec->state = STATE_DATA;
+  dec->flags = flags;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+unescape(uint8_t c)
+{
+  switch(c) {
+  case SLIP_ESC_END:
+    return SLIP_END;
+  case SLIP_ESC_ESC:
+    return SLIP_ESC;
+  case SLIP_ESC_XON:
+    return XON;
+  case SLIP_ESC_XOFF:
+    return XOFF;
+  }
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the first byte from p on that is special according to mask,
+   or end if there is none. */
+static const uint8_t *
+scan(const uint8_t *p, const uint8_t *end, uint8_t mask)
+{
+  unsigned long w;
+
+  if(mask == SPECIAL_SLIP) {
+    /* The common case: skip a word at a time until one holds a
+       SLIP_END or SLIP_ESC. */
+    while(end - p >= sizeof(w)) {
+      memcpy(&w, p, sizeof(w));
+      if(HAS_BYTE(w, SLIP_END) || HAS_BYTE(w, SLIP_ESC)) {
+        break;
+      }
+      p += sizeof(w);
+    }
+  }
+  while(p < end && !(special[*p] & mask)) {
+    p++;
+  }
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+/* Starts skipping the rest of a frame that does not fit. The bytes
+   kept so far are dropped at once, so that callers that echo the
+   buffer do not see them again. */
+static int
+overflow(struct slip_decoder *dec, const uint8_t **data, const uint8_t *p)
+{
+  dec->len = 0;
+  dec->state = STATE_DROP;
+  *data = p;
+  return SLIP_DECODE_OVERFLOW;
+}
+/*---------------------------------------------------------------------------*/
+int
+slip_decode(struct slip_decoder *dec, const uint8_t **data,
+            const uint8_t *end)
+{
+  const uint8_t *p, *run;
+  uint8_t mask;
+
+  if(dec->state == STATE_DONE) {
+    dec->len = 0;
+    dec->state = STATE_DATA;
+  }
+  mask = SPECIAL_SLIP;
+  if(dec->flags & SLIP_CODEC_LINES) {
+    mask |= SPECIAL_LINE;
+  }
+
+  p = *data;
+  while(p < end) {
+    if(dec->state == STATE_DROP) {
+      p = memchr(p, SLIP_END, end - p);
+      if(p == NULL) {
+        p = end;
+        break;
+      }
+      p++;
+      dec->len = 0;
+      dec->state = STATE_DATA;
+      continue;
+    }
+
+    if(dec->state == STATE_ESC) {
+      if(dec->len >= dec->size) {
+        return overflow(dec, data, p);
+      }
+      dec->buf[dec->len++] = unescape(*p++);
+      dec->state = STATE_DATA;
+      continue;
+    }
+
+    /* Copy the bytes up to the next one that needs a closer look. */
+    run = p;
+    p = scan(p, end, mask);
+    if(p - run > dec->size - dec->len) {
+      return overflow(dec, data, p);
+    }
+    memcpy(dec->buf + dec->len, run, p - run);
+    dec->len += p - run;
+    if(p == end) {
+      break;
+    }
+
+    switch(*p++) {
+    case SLIP_END:
+      if(dec->len > 0) {
+        dec->state = STATE_DONE;
+        *data = p;
+        return SLIP_DECODE_FRAME;
+      }
+      break;
+    case SLIP_ESC:
+      dec->state = STATE_ESC;
+      break;
+    default:
+      /* A newline, which is kept in the frame. */
+      if(dec->len >= dec->size) {
+        return overflow(dec, data, p);
+      }
+      dec->buf[dec->len++] = '\n';
+      *data = p;
+      return SLIP_DECODE_LINE;
+    }
+  }
+  *data = p;
+  return SLIP_DECODE_MORE;
+}
+/*---------------------------------------------------------------------------*/
+int
+slip_encode(uint8_t *out, const uint8_t *data, int len, uint8_t flags)
+{
+  const uint8_t *p, *end, *run;
+  uint8_t *o;
+  uint8_t mask;
+
+  mask = SPECIAL_SLIP;
+  if(flags & SLIP_CODEC_XONXOFF) {
+    mask |= SPECIAL_XONXOFF;
+  }
+
+  o = out;
+  p = data;
+  end = data + len;
+  while(p < end) {
+    run = p;
+    p = scan(p, end, mask);
+    memcpy(o, run, p - run);
+    o += p - run;
+    if(p == end) {
+      break;
+    }
+
+    *o++ = SLIP_ESC;
+    switch(*p++) {
+    case SLIP_END:
+      *o++ = SLIP_ESC_END;
+      break;
+    case SLIP_ESC:
+      *o++ = SLIP_ESC_ESC;
+      break;
+    case XON:
+      *o++ = SLIP_ESC_XON;
+      break;
+    default:
+      *o++ = SLIP_ESC_XOFF;
+      break;
+    }
+  }
+  return o - out;
+}
+/*---------------------------------------------------------------------------*/
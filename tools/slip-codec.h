@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2016, SICS Swedish ICT
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         SLIP encoder and decoder for host tools such as tunslip6 and
+ *         the native border router. Both work on whole buffers: runs
+ *         of bytes that need no escaping are found with a table lookup
+ *         and copied at once, and the decoder keeps its state between
+ *         calls so that a frame may be split across any number of
+ *         reads.
+ */
+
+#ifndef SLIP_CODEC_H_
+#define SLIP_CODEC_H_
+
+#include <stdint.h>
+
+#define SLIP_END      0300
+#define SLIP_ESC      0333
+#define SLIP_ESC_END  0334
+#define SLIP_ESC_ESC  0335
+#define SLIP_ESC_XON  0336
+#define SLIP_ESC_XOFF 0337
+#define XON           17
+#define XOFF          19
+
+/* Escape XON and XOFF too, for software flow control */
+#define SLIP_CODEC_XONXOFF 0x01
+/* Make slip_decode() return after each newline, for echoing text */
+#define SLIP_CODEC_LINES   0x02
+
+/** The largest encoding of \p len bytes, including the SLIP_END */
+#define SLIP_ENCODED_MAX(len) (2 * (len) + 1)
+
+/** \name Return values of slip_decode() */
+/** @{ */
+#define SLIP_DECODE_MORE      0 /**< All input used, the frame is not complete */
+#define SLIP_DECODE_FRAME     1 /**< A complete frame is in the buffer */
+#define SLIP_DECODE_LINE      2 /**< The buffer ends with a newline */
+#define SLIP_DECODE_OVERFLOW -1 /**< The frame is too long and is dropped */
+/** @} */
+
+struct slip_decoder {
+  uint8_t *buf;
+  int size;
+  int len;
+  uint8_t state;
+  uint8_t flags;
+};
+
+/**
+ * \brief Initialize a decoder
+ * \param dec The decoder
+ * \param buf Where to put the decoded frames
+ * \param size The size of \p buf, which is the longest frame accepted
+ * \param flags Zero or SLIP_CODEC_LINES
+ */
+void slip_decoder_init(struct slip_decoder *dec, uint8_t *buf, int size,
+                       uint8_t flags);
+
+/**
+ * \brief Decode received bytes
+ * \param dec The decoder
+ * \param data Pointer to the next byte to decode; advanced past the
+ *        bytes used
+ * \param end The end of the received bytes
+ * \return One of the SLIP_DECODE_ values
+ *
+ * Call repeatedly until SLIP_DECODE_MORE is returned. After
+ * SLIP_DECODE_FRAME the frame is in dec->buf and is dec->len bytes
+ * long; it stays there until the next call. After SLIP_DECODE_LINE
+ * the caller may set dec->len to zero to drop the text so far from
+ * the frame. After SLIP_DECODE_OVERFLOW, the frame so far is dropped
+ * and dec->len is zero, and the rest of the frame is skipped.
+ */
+int slip_decode(struct slip_decoder *dec, const uint8_t **data,
+                const uint8_t *end);
+
+/**
+ * \brief Encode a frame
+ * \param out Where to put the encoded bytes, room for
+ *        SLIP_ENCODED_MAX(len) bytes is always enough
+ * \param data The frame
+ * \param len The length of the frame
+ * \param flags Zero or SLIP_CODEC_XONXOFF
+ * \return The number of bytes put in \p out
+ *
+ * The SLIP_END that ends the frame is not added.
+ */
+int slip_encode(uint8_t *out, const uint8_t *data, int len, uint8_t flags);
+
+#endif /* SLIP_CODEC_H_ */